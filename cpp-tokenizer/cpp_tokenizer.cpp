@@ -1,4 +1,13 @@
 #include "cpp_tokenizer.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+
+#if defined(__AVX2__)
+#  include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#  include <emmintrin.h>
+#endif
 
 // static std::vector<std::string> seperators = {
 //   " ", "\n", ".", "!", "\t", ";", ":", "\\", "/", "+", "-",  "*",  "&",
@@ -9,126 +18,378 @@
 //   '%', '<', '>', '=', '(', ')', '{', '}', '[', ']', '"', '\'', ','
 // };
 
-static std::string seperators = " \n\r.!\t;:\\/+-*&%<>=(){}[]\"',|~^";
-
-static std::vector<std::string> operators = {
-  "::", "->", "<=", ">=", "+=", "-=", "/=", "*=", "^=", "&&", "==",
-  "&=", "||", "%=", ">>", "<<", "~",  "+",  "-",  "*",  "/",  "=",
-  "<",  ">",  "!",  "?",  ":",  "^",  "&",  "|",  "%",  "."};
-
-static std::vector<std::string> keywords = {"alignas",
-                                            "alignof",
-                                            "and_eq",
-                                            "and",
-                                            "asm",
-                                            "atomic_cancel",
-                                            "atomic_commit",
-                                            "atomic_noexcept",
-                                            "auto",
-                                            "bitand",
-                                            "bitor",
-                                            "bool",
-                                            "break",
-                                            "case",
-                                            "catch",
-                                            "char8_t",
-                                            "char16_t",
-                                            "char32_t",
-                                            "char",
-                                            "class",
-                                            "compl",
-                                            "concept",
-                                            "consteval",
-                                            "constexpr",
-                                            "constinit",
-                                            "const_cast",
-                                            "const",
-                                            "continue",
-                                            "co_await",
-                                            "co_return",
-                                            "co_yeild",
-                                            "decltype",
-                                            "default",
-                                            "delete",
-                                            "double",
-                                            "do",
-                                            "dynamic_cast",
-                                            "else",
-                                            "enum",
-                                            "explicit",
-                                            "export",
-                                            "extern",
-                                            "false",
-                                            "float",
-                                            "for",
-                                            "friend",
-                                            "goto",
-                                            "if",
-                                            "inline",
-                                            "int",
-                                            "long",
-                                            "mutable",
-                                            "namespace",
-                                            "new",
-                                            "noexcept",
-                                            "not_eq",
-                                            "not",
-                                            "nullptr",
-                                            "operator",
-                                            "or_eq",
-                                            "or",
-                                            "private",
-                                            "protected",
-                                            "public",
-                                            "reflexpr",
-                                            "register",
-                                            "reinterpret_cast",
-                                            "requires",
-                                            "return",
-                                            "short",
-                                            "signed",
-                                            "sizeof",
-                                            "static_assert",
-                                            "static_cast",
-                                            "static",
-                                            "struct",
-                                            "switch",
-                                            "synchronized",
-                                            "template",
-                                            "this",
-                                            "thread_local",
-                                            "throw",
-                                            "true",
-                                            "try",
-                                            "typedef",
-                                            "typeid",
-                                            "typename",
-                                            "union",
-                                            "unsigned",
-                                            "using",
-                                            "virtual",
-                                            "void",
-                                            "volatile",
-                                            "wchar_t",
-                                            "while",
-                                            "xor_eq",
-                                            "xor"};
-
-static std::vector<std::string> preprocessor_directives = {"#ifndef",
-                                                           "#ifdef",
-                                                           "#if",
-                                                           "#else",
-                                                           "#elif",
-                                                           "#elifdef",
-                                                           "#elifndef",
-                                                           "#endif",
-                                                           "#define",
-                                                           "#undef",
-                                                           "#include",
-                                                           "#error",
-                                                           "#warning",
-                                                           "#pragma",
-                                                           "#line"};
+static constexpr std::string_view seperators =
+  " \n\r.!\t;:\\/+-*&%<>=(){}[]\"',|~^";
+
+static constexpr auto operators = std::to_array<std::string_view>(
+  {"::", "->", "<=", ">=", "+=", "-=", "/=", "*=", "^=", "&&", "==",
+   "&=", "||", "%=", ">>", "<<", "~",  "+",  "-",  "*",  "/",  "=",
+   "<",  ">",  "!",  "?",  ":",  "^",  "&",  "|",  "%",  "."});
+
+static constexpr auto keywords = std::to_array<std::string_view>({
+  "alignas", "alignof", "and_eq", "and", "asm", "atomic_cancel",
+  "atomic_commit", "atomic_noexcept", "auto", "bitand", "bitor", "bool",
+  "break", "case", "catch", "char8_t", "char16_t", "char32_t", "char", "class",
+  "compl", "concept", "consteval", "constexpr", "constinit", "const_cast",
+  "const", "continue", "co_await", "co_return", "co_yeild", "decltype",
+  "default", "delete", "double", "do", "dynamic_cast", "else", "enum",
+  "explicit", "export", "extern", "false", "float", "for", "friend", "goto",
+  "if", "inline", "int", "long", "mutable", "namespace", "new", "noexcept",
+  "not_eq", "not", "nullptr", "operator", "or_eq", "or", "private",
+  "protected", "public", "reflexpr", "register", "reinterpret_cast",
+  "requires", "return", "short", "signed", "sizeof", "static_assert",
+  "static_cast", "static", "struct", "switch", "synchronized", "template",
+  "this", "thread_local", "throw", "true", "try", "typedef", "typeid",
+  "typename", "union", "unsigned", "using", "virtual", "void", "volatile",
+  "wchar_t", "while", "xor_eq", "xor"});
+
+static constexpr auto preprocessor_directives =
+  std::to_array<std::string_view>({"#ifndef", "#ifdef", "#if", "#else",
+                                   "#elif", "#elifdef", "#elifndef", "#endif",
+                                   "#define", "#undef", "#include", "#error",
+                                   "#warning", "#pragma", "#line"});
+
+/// @brief Hash of word, FNV-1a with seed, its bits mixed down.
+static constexpr uint32_t word_hash(std::string_view word,
+                                    const uint32_t& seed) noexcept
+{
+  uint32_t hash = seed;
+  for(const char& c : word)
+  {
+    hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+  }
+  return hash ^ (hash >> 16);
+}
+
+/// @brief Perfect hash table of words, built at compile time. Each word
+///        has a slot of its own, holding its index + 1 (0 for empty
+///        slots), so looking up a word costs one hash and one compare.
+template<std::size_t TableSize>
+struct WordTable
+{
+  /// @brief Seed of hash with no collisions among words.
+  uint32_t seed;
+
+  /// @brief Shortest and longest word, other lengths aren't hashed.
+  std::size_t min_length, max_length;
+
+  /// @brief Slots, by hash of word.
+  std::array<uint8_t, TableSize> slots;
+};
+
+/// @brief Builds perfect hash table of words, trying seeds till words
+///        land in distinct slots.
+template<std::size_t TableSize, std::size_t Count>
+static consteval WordTable<TableSize>
+build_word_table(const std::array<std::string_view, Count>& words) noexcept
+{
+  static_assert((TableSize & (TableSize - 1)) == 0 && Count < 256);
+  for(uint32_t seed = 2166136261u;; seed++)
+  {
+    WordTable<TableSize> table{seed, words[0].size(), words[0].size(), {}};
+    bool collided = false;
+    for(std::size_t i = 0; i < Count && !collided; i++)
+    {
+      uint8_t& slot = table.slots[word_hash(words[i], seed) & (TableSize - 1)];
+      collided = slot != 0;
+      slot = i + 1;
+      table.min_length = std::min(table.min_length, words[i].size());
+      table.max_length = std::max(table.max_length, words[i].size());
+    }
+    if(!collided)
+    {
+      return table;
+    }
+  }
+}
+
+/// @brief Tells if word is one of words of table.
+template<std::size_t TableSize, std::size_t Count>
+static inline bool
+is_word_of(const WordTable<TableSize>& table,
+           const std::array<std::string_view, Count>& words,
+           std::string_view word) noexcept
+{
+  if(word.size() < table.min_length || word.size() > table.max_length)
+  {
+    return false;
+  }
+  const uint8_t slot =
+    table.slots[word_hash(word, table.seed) & (TableSize - 1)];
+  return slot != 0 && words[slot - 1] == word;
+}
+
+static constexpr WordTable<1024> keywords_table =
+  build_word_table<1024>(keywords);
+
+static constexpr WordTable<64> preprocessor_directives_table =
+  build_word_table<64>(preprocessor_directives);
+
+/// @brief Class of character, picks state lexing a token starting with it.
+enum class CharClass : uint8_t
+{
+  /// @brief Character of identifier (or keyword).
+  WORD,
+  DIGIT,
+  HASH,
+  WHITESPACE,
+  TAB,
+  /// @brief Characters skipped - '\n', '\r'.
+  IGNORED,
+  QUOTE,
+  DOUBLE_QUOTE,
+  SLASH,
+  LESS_THAN,
+  DOT,
+  COMMA,
+  SEMICOLON,
+  BRACKET_OPEN,
+  BRACKET_CLOSE,
+  SQUARE_BRACKET_OPEN,
+  SQUARE_BRACKET_CLOSE,
+  CURLY_BRACE_OPEN,
+  CURLY_BRACE_CLOSE,
+  /// @brief Character starting an operator.
+  OPERATOR,
+  /// @brief Separator not starting any token - '\\'.
+  BACKSLASH
+};
+
+/// @brief Flags of character.
+enum CharFlag : uint8_t
+{
+  /// @brief Ends identifiers (and keywords).
+  SEPARATOR = 1 << 0,
+  /// @brief Ends header in double quotes.
+  QUOTED_HEADER_END = 1 << 1,
+  /// @brief Ends header in angle brackets.
+  ANGLE_HEADER_END = 1 << 2,
+  /// @brief Continues number.
+  NUMBER_PART = 1 << 3,
+  /// @brief Starts a keyword, other words aren't looked up.
+  KEYWORD_START = 1 << 4
+};
+
+/// @brief Character tables of lexer, built at compile time.
+struct CharTable
+{
+  /// @brief Class of each character.
+  std::array<CharClass, 256> classes;
+
+  /// @brief Flags of each character.
+  std::array<uint8_t, 256> flags;
+
+  /// @brief Bits of characters which follow each character in a two
+  ///        character operator, and bit of each such character.
+  std::array<uint8_t, 256> operator_seconds, operator_second_bit;
+};
+
+/// @brief Builds character tables of lexer.
+static consteval CharTable build_char_table() noexcept
+{
+  CharTable table{};
+  for(const char& c : seperators)
+  {
+    table.flags[static_cast<unsigned char>(c)] |= SEPARATOR;
+  }
+  for(const char& c : std::string_view(" \n\r!\t;:+*&%<>=(){}[]\"',|~^"))
+  {
+    table.flags[static_cast<unsigned char>(c)] |= QUOTED_HEADER_END;
+  }
+  for(const char& c : std::string_view(">\n\t\r "))
+  {
+    table.flags[static_cast<unsigned char>(c)] |= ANGLE_HEADER_END;
+  }
+  for(const char& c : std::string_view("0123456789.ef"))
+  {
+    table.flags[static_cast<unsigned char>(c)] |= NUMBER_PART;
+  }
+  for(const std::string_view& keyword : keywords)
+  {
+    table.flags[static_cast<unsigned char>(keyword[0])] |= KEYWORD_START;
+  }
+
+  table.classes.fill(CharClass::WORD);
+  uint8_t next_bit = 1;
+  for(const std::string_view& op : operators)
+  {
+    const unsigned char first = op[0];
+    table.classes[first] = CharClass::OPERATOR;
+    if(op.size() == 2)
+    {
+      const unsigned char second = op[1];
+      uint8_t& bit = table.operator_second_bit[second];
+      if(bit == 0)
+      {
+        bit = next_bit;
+        next_bit <<= 1;
+      }
+      table.operator_seconds[first] |= bit;
+    }
+  }
+  for(char c = '0'; c <= '9'; c++)
+  {
+    table.classes[c] = CharClass::DIGIT;
+  }
+  table.classes['#'] = CharClass::HASH;
+  table.classes[' '] = CharClass::WHITESPACE;
+  table.classes['\t'] = CharClass::TAB;
+  table.classes['\n'] = CharClass::IGNORED;
+  table.classes['\r'] = CharClass::IGNORED;
+  table.classes['\''] = CharClass::QUOTE;
+  table.classes['"'] = CharClass::DOUBLE_QUOTE;
+  table.classes['/'] = CharClass::SLASH;
+  table.classes['<'] = CharClass::LESS_THAN;
+  table.classes['.'] = CharClass::DOT;
+  table.classes[','] = CharClass::COMMA;
+  table.classes[';'] = CharClass::SEMICOLON;
+  table.classes['('] = CharClass::BRACKET_OPEN;
+  table.classes[')'] = CharClass::BRACKET_CLOSE;
+  table.classes['['] = CharClass::SQUARE_BRACKET_OPEN;
+  table.classes[']'] = CharClass::SQUARE_BRACKET_CLOSE;
+  table.classes['{'] = CharClass::CURLY_BRACE_OPEN;
+  table.classes['}'] = CharClass::CURLY_BRACE_CLOSE;
+  table.classes['\\'] = CharClass::BACKSLASH;
+  return table;
+}
+
+static constexpr CharTable char_table = build_char_table();
+
+/// @brief Tells if character has flag.
+static inline bool has_flag(const char& c, const CharFlag& flag) noexcept
+{
+  return char_table.flags[static_cast<unsigned char>(c)] & flag;
+}
+
+/// @brief Gives word at offset of string, characters till a separator.
+static inline std::string_view word_at(const std::string& str,
+                                       const uint32_t& offset) noexcept
+{
+  std::size_t end = offset;
+  while(end < str.size() && !has_flag(str[end], SEPARATOR))
+  {
+    end++;
+  }
+  return std::string_view(str).substr(offset, end - offset);
+}
+
+/// Bytes of comments, strings and runs of spaces scanned at once.
+static constexpr std::size_t block_size = 32;
+
+/// @brief Finds bytes of block equal to any of four characters, repeat a
+///        character to look for fewer.
+/// @param block pointer to block_size bytes.
+/// @return Returns bitmask of matching bytes, bit i for byte i.
+static inline uint32_t match_block(const char* block,
+                                   const char& a,
+                                   const char& b,
+                                   const char& c,
+                                   const char& d) noexcept
+{
+#if defined(__AVX2__)
+  const __m256i bytes =
+    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+  return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(
+    _mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(a)),
+                    _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(b))),
+    _mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(c)),
+                    _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(d))))));
+#elif defined(__SSE2__) || defined(_M_X64)
+  uint32_t matches = 0;
+  for(std::size_t half = 0; half < block_size; half += 16)
+  {
+    const __m128i bytes =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + half));
+    matches |= static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(
+                 _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(a)),
+                              _mm_cmpeq_epi8(bytes, _mm_set1_epi8(b))),
+                 _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(c)),
+                              _mm_cmpeq_epi8(bytes, _mm_set1_epi8(d))))))
+               << half;
+  }
+  return matches;
+#else
+  uint32_t matches = 0;
+  for(std::size_t i = 0; i < block_size; i++)
+  {
+    const char byte = block[i];
+    matches |= static_cast<uint32_t>(byte == a || byte == b || byte == c ||
+                                     byte == d)
+               << i;
+  }
+  return matches;
+#endif
+}
+
+/// @brief Finds first byte of string, from position, equal to any of four
+///        characters, a block at a time.
+/// @return Returns size of string if there is none.
+static inline uint32_t find_any_of(const std::string& str,
+                                   uint32_t position,
+                                   const char& a,
+                                   const char& b,
+                                   const char& c,
+                                   const char& d) noexcept
+{
+  const uint32_t size = str.size();
+  for(; position + block_size <= size; position += block_size)
+  {
+    const uint32_t matches = match_block(str.data() + position, a, b, c, d);
+    if(matches != 0)
+    {
+      return position + std::countr_zero(matches);
+    }
+  }
+  while(position < size && str[position] != a && str[position] != b &&
+        str[position] != c && str[position] != d)
+  {
+    position++;
+  }
+  return position;
+}
+
+/// @brief Finds end of run of spaces starting at position, a block at a
+///        time.
+static inline uint32_t space_run_end(const std::string& str,
+                                     uint32_t position) noexcept
+{
+  const uint32_t size = str.size();
+  for(; position + block_size <= size; position += block_size)
+  {
+    const uint32_t others =
+      ~match_block(str.data() + position, ' ', ' ', ' ', ' ');
+    if(others != 0)
+    {
+      return position + std::countr_zero(others);
+    }
+  }
+  while(position < size && str[position] == ' ')
+  {
+    position++;
+  }
+  return position;
+}
+
+/// @brief Finds "*/" closing multiline comment, from position.
+/// @return Returns position after it, size of string if comment isn't
+///         closed in it.
+static inline uint32_t multiline_comment_end(const std::string& str,
+                                             uint32_t position,
+                                             bool& closed) noexcept
+{
+  const uint32_t size = str.size();
+  while((position = find_any_of(str, position, '*', '*', '*', '*')) < size)
+  {
+    position++;
+    if(position < size && str[position] == '/')
+    {
+      closed = true;
+      return position + 1;
+    }
+  }
+  closed = false;
+  return size;
+}
 
 std::string token_type_to_string(const CppTokenizer::TokenType& type)
 {
@@ -193,594 +454,341 @@ namespace CppTokenizer
 {
 
 Token::Token() noexcept
-  : type(TokenType::UNKNOWN), start_offset(0), end_offset(0), value("")
+  : type(TokenType::UNKNOWN), start_offset(0), length(0)
 {}
 
 Token::Token(const TokenType& token_type) noexcept
-  : type(token_type), start_offset(0), end_offset(0), value("")
+  : type(token_type), start_offset(0), length(0)
+{}
+
+Token::Token(const TokenType& token_type,
+             const uint32_t& start_offset,
+             const uint32_t& length) noexcept
+  : type(token_type), start_offset(start_offset), length(length)
 {}
 
 bool Token::operator!=(const Token& other) const noexcept
 {
   return type != other.type || start_offset != other.start_offset ||
-         end_offset != other.end_offset || value != other.value;
+         length != other.length;
+}
+
+std::string_view Token::value(std::string_view str) const noexcept
+{
+  return str.substr(start_offset, length);
 }
 
 Tokenizer::Tokenizer() noexcept
-  : _current_token(Token())
-  , _tokens({})
-  , _inside_char(false)
-  , _inside_string(false)
-  , _inside_comment(false)
-  , _inside_multiline_comment(false)
-  , _position(0)
+  : _tokens({}), _inside_char(false), _position(0), _char_start_offset(0)
 {}
 
 const std::vector<Token>& Tokenizer::tokenize(const std::string& str) noexcept
 {
-  while(_position < str.size())
+  // each token is lexed by a state picked by class of its first character,
+  // states only move position and emit token boundaries
+  // position is kept in a register, tokens emitted can't alias it
+  const uint32_t size = str.size();
+  uint32_t position = _position;
+  while(position < size)
   {
-    char character = str[_position];
-
-    /// Preprocessor Directive
-    if(character == '#')
+    const uint32_t start = position;
+    switch(char_table.classes[static_cast<unsigned char>(str[position])])
     {
-      // mathcing with preprocessor directives
-      for(const std::string directive : preprocessor_directives)
+    case CharClass::HASH:
+    {
+      /// Preprocessor Directive
+      const std::string_view directive = word_at(str, position);
+      if(is_word_of(
+           preprocessor_directives_table, preprocessor_directives, directive))
       {
-        if(str.compare(_position, directive.size(), directive) == 0)
-        {
-          // found directive match
-          _current_token = Token(TokenType::PREPROCESSOR_DIRECTIVE);
-          _current_token.start_offset = _position;
-          _current_token.end_offset = _position + directive.size() - 1;
-          _current_token.value = directive;
-          _tokens.emplace_back(_current_token);
-          _position += directive.size();
-          goto while_loop_continue;
-        }
+        _tokens.emplace_back(
+          TokenType::PREPROCESSOR_DIRECTIVE, start, directive.size());
+        position += directive.size();
+        break;
       }
+      [[fallthrough]];
     }
-
-    /// Separator
-    if(seperators.find(character) != std::string::npos)
+    case CharClass::WORD:
+    case CharClass::DIGIT:
     {
-      if(character == '\'')
+      /// Keyword
+      // word followed by a non separator is an identifier
+      const std::string_view word = word_at(str, position);
+      if(has_flag(word[0], KEYWORD_START) &&
+         is_word_of(keywords_table, keywords, word))
       {
-        if(_inside_char)
-        {
-          _inside_char = false;
-          _current_token.value.push_back(character);
-          _current_token.end_offset = _position;
-          _tokens.emplace_back(_current_token);
-          _position++;
-          continue;
-        }
-        _inside_char = true;
-        _current_token = Token(TokenType::CHARACTER);
-        _current_token.value.push_back(character);
-        _current_token.start_offset = _position;
-        _position++;
-        continue;
+        _tokens.emplace_back(TokenType::KEYWORD, start, word.size());
+        position += word.size();
+        break;
       }
-      else if(character == '"')
+      if(_inside_char)
       {
-        if(this->inside_include_declaration())
-        {
-          _current_token = Token(TokenType::HEADER);
-          _current_token.start_offset = _position;
-          _current_token.value.push_back(str[_position]);
-          _position++;
-          // move forward until we encounter '"'
-          std::string header_string_separators =
-            " \n\r!\t;:+*&%<>=(){}[]\"',|~^";
-          while(_position < str.size() &&
-                header_string_separators.find(str[_position]) ==
-                  std::string::npos)
-          {
-            _current_token.value.push_back(str[_position]);
-            _position++;
-          }
-          if(str[_position] == '"')
-          {
-            _current_token.value.push_back(str[_position]);
-            _position++;
-          }
-          _current_token.end_offset = _position - 1;
-          _tokens.emplace_back(_current_token);
-          goto while_loop_continue;
-        }
-
-        // it is just a string, move forward until u find a string separator
-        _current_token = Token(TokenType::STRING);
-        _current_token.start_offset = _position;
-        _current_token.value.push_back('"');
-        _position++;
-        while(_position < str.size() && str[_position] != '\n' &&
-              str[_position] != '\t' && str[_position] != '\r' &&
-              str[_position] != '"')
-        {
-          _current_token.value.push_back(str[_position]);
-          _position++;
-        }
-        if(str[_position] == '"')
-        {
-          _current_token.value.push_back(str[_position]);
-          _position++;
-        }
-        _current_token.end_offset = _position - 1;
-        _tokens.emplace_back(_current_token);
-        goto while_loop_continue;
+        position++;
+        break;
       }
-      else if(character == '<')
+      if(str[position] >= '0' && str[position] <= '9')
       {
-        // check if it is include declaration
-        if(this->inside_include_declaration())
+        // character is number - '0' to '9'
+        position++;
+        while(position < size && (has_flag(str[position], NUMBER_PART) ||
+                                   (str[position] == '-' &&
+                                    str[position - 1] == 'e')))
         {
-          _current_token = Token(TokenType::HEADER);
-          _current_token.start_offset = _position;
-          // move forward until we encounter '>'
-          while(_position < str.size() && str[_position] != '>' &&
-                str[_position] != '\n' && str[_position] != '\t' &&
-                str[_position] != '\r' && str[_position] != ' ')
-          {
-            _current_token.value.push_back(str[_position]);
-            _position++;
-          }
-          if(str[_position] == '>')
-          {
-            _current_token.value.push_back(str[_position]);
-            _position++;
-          }
-          _current_token.end_offset = _position - 1;
-          _tokens.emplace_back(_current_token);
-          goto while_loop_continue;
+          position++;
         }
-        // else consider it as operator
+        _tokens.emplace_back(TokenType::NUMBER, start, position - start);
+        break;
       }
-      else if(character == '/')
+      position += word.size();
+      _tokens.emplace_back(TokenType::IDENTIFIER, start, word.size());
+      break;
+    }
+    case CharClass::BACKSLASH:
+    {
+      if(_inside_char)
       {
-        if(_inside_multiline_comment)
-        {
-          if(_current_token.value.back() == '*')
-          {
-            _inside_multiline_comment = false;
-            _current_token.end_offset = _position;
-            _current_token.value.push_back(character);
-            _tokens.emplace_back(_current_token);
-            _position++;
-            goto while_loop_continue;
-          }
-          _current_token.value.push_back(character);
-          _position++;
-          goto while_loop_continue;
-        }
-        if(_position + 1 < str.size() && str[_position + 1] == '/')
-        {
-          // single line comment
-          _current_token = Token(TokenType::COMMENT);
-          _current_token.start_offset = _position;
-          while(_position < str.size() && str[_position] != '\r' &&
-                str[_position] != '\n')
-          {
-            _current_token.value.push_back(str[_position]);
-            _position++;
-          }
-          _current_token.end_offset = _position - 1;
-          _tokens.push_back(_current_token);
-          goto while_loop_continue;
-        }
-        if(_position + 1 < str.size() && str[_position + 1] == '*')
-        {
-          // multiline comment
-          _current_token = Token(TokenType::MULTILINE_COMMENT);
-          _current_token.start_offset = _position;
-          _current_token.value = "/*";
-          _position += 2;
-          bool inserted_multiline_comment_token = false;
-          while(_position < str.size())
-          {
-            if(str[_position] == '*' && _position + 1 < str.size() &&
-               str[_position + 1] == '/')
-            {
-              // multiline comment ended
-              _current_token.value.append("*/");
-              _position += 2;
-              _current_token.end_offset = _position - 1;
-              _tokens.push_back(_current_token);
-              inserted_multiline_comment_token = true;
-              break;
-            }
-            if(str[_position] == '\r')
-            {
-              // skipping these characters for now
-              // as this is geared towards syntax highlighting
-              // while rendering these characters there will be glitches
-              _position++;
-              continue;
-            }
-            _current_token.value.push_back(str[_position]);
-            _position++;
-          }
-          if(_position >= str.size() && !inserted_multiline_comment_token)
-          {
-            // end of string
-            // although the miltiline comment is unclosed,
-            // with token as incomplete type
-            _current_token.type = TokenType::MULTILINE_COMMENT_INCOMPLETE;
-            _current_token.end_offset = _position - 1;
-            _tokens.push_back(_current_token);
-          }
-          goto while_loop_continue;
-        }
+        position++;
+        break;
       }
-      else if(character == '\n')
+      // moving forward until a separator is encountered
+      position += 1 + word_at(str, position + 1).size();
+      _tokens.emplace_back(TokenType::IDENTIFIER, start, position - start);
+      break;
+    }
+    case CharClass::WHITESPACE:
+    {
+      if(_inside_char)
       {
-        if(_inside_comment)
-        {
-          _inside_comment = false;
-          _current_token.end_offset = _position - 1;
-          _tokens.emplace_back(_current_token);
-          _position++;
-          goto while_loop_continue;
-        }
-        if(_inside_multiline_comment || _inside_string)
-        {
-          _current_token.value.push_back(character);
-          _position++;
-          goto while_loop_continue;
-        }
-        if(_current_token.type == TokenType::IDENTIFIER &&
-           _tokens.back() != _current_token)
-        {
-          _current_token.end_offset = _position - 1;
-          _tokens.emplace_back(_current_token);
-          _position++;
-          goto while_loop_continue;
-        }
-        // ignore
-        _position++;
-        goto while_loop_continue;
+        position++;
+        break;
       }
-      else if(character == '\r')
+      // each space is a token, runs of them (indentation) are emitted
+      // without going back to the dispatch, single spaces between words
+      // aren't scanned for a run
+      const uint32_t end = position + 1 < size && str[position + 1] == ' '
+                             ? space_run_end(str, position)
+                             : position + 1;
+      for(; position < end; position++)
       {
-        // ignore carriage return characters
-        _position++;
-        goto while_loop_continue;
+        _tokens.emplace_back(TokenType::WHITESPACE, position, 1);
       }
-      else if(character == ' ')
+      break;
+    }
+    case CharClass::TAB:
+    {
+      do
       {
-        if(_inside_comment || _inside_multiline_comment || _inside_char || _inside_string)
-        {
-          _current_token.value.push_back(character);
-          _position++;
-          goto while_loop_continue;
-        }
-        _current_token = Token(TokenType::WHITESPACE);
-        _current_token.start_offset = _position;
-        _current_token.end_offset = _position;
-        _current_token.value.push_back(character);
-        _tokens.emplace_back(_current_token);
-        _position++;
-        goto while_loop_continue;
-      }
-      else if(character == '\t')
+        _tokens.emplace_back(TokenType::TAB, position, 1);
+        position++;
+      } while(position < size && str[position] == '\t');
+      break;
+    }
+    case CharClass::IGNORED:
+    {
+      // ignore carriage return (and newline) characters
+      position++;
+      break;
+    }
+    case CharClass::QUOTE:
+    {
+      position++;
+      if(!_inside_char)
       {
-        if(_inside_comment || _inside_multiline_comment || _inside_string)
-        {
-          _current_token.value.push_back(character);
-          _position++;
-          goto while_loop_continue;
-        }
-
-        _current_token = Token(TokenType::TAB);
-        _current_token.start_offset = _position;
-        _current_token.end_offset = _position;
-        _current_token.value.push_back(character);
-        _tokens.emplace_back(_current_token);
-        _position++;
-        goto while_loop_continue;
+        _inside_char = true;
+        _char_start_offset = start;
+        break;
       }
-      else if(character == '.')
+      // operators (and keywords) matched inside the character are
+      // part of it
+      while(!_tokens.empty() &&
+            _tokens.back().start_offset > _char_start_offset)
       {
-        if(_inside_comment || _inside_multiline_comment || _inside_char ||
-           _inside_string)
-        {
-          _current_token.value.push_back(character);
-          _position++;
-          goto while_loop_continue;
-        }
+        _tokens.pop_back();
       }
-      else if(character == ',')
+      _inside_char = false;
+      _tokens.emplace_back(TokenType::CHARACTER,
+                           _char_start_offset,
+                           position - _char_start_offset);
+      break;
+    }
+    case CharClass::DOUBLE_QUOTE:
+    {
+      position++;
+      if(this->inside_include_declaration(str))
       {
-        if(_inside_comment || _inside_multiline_comment || _inside_char ||
-           _inside_string)
+        // move forward until we encounter '"'
+        while(position < size && !has_flag(str[position], QUOTED_HEADER_END))
         {
-          _current_token.value.push_back(character);
-          _position++;
-          goto while_loop_continue;
+          position++;
         }
-        _current_token = Token(TokenType::COMMA);
-        _current_token.start_offset = _position;
-        _current_token.end_offset = _position;
-        _current_token.value.push_back(character);
-        _tokens.emplace_back(_current_token);
-        _position++;
-        goto while_loop_continue;
-      }
-      else if(character == ';')
-      {
-        if(_inside_comment || _inside_multiline_comment || _inside_char ||
-           _inside_string)
+        if(str[position] == '"')
         {
-          _current_token.value.push_back(character);
-          _position++;
-          goto while_loop_continue;
+          position++;
         }
-        _current_token = Token(TokenType::SEMICOLON);
-        _current_token.start_offset = _position;
-        _current_token.end_offset = _position;
-        _current_token.value.push_back(character);
-        _tokens.emplace_back(_current_token);
-        _position++;
-        goto while_loop_continue;
+        _tokens.emplace_back(TokenType::HEADER, start, position - start);
+        break;
       }
-      else if(character == '(')
+
+      // it is just a string, move forward until u find a string separator
+      position = find_any_of(str, position, '"', '\n', '\r', '\t');
+      if(str[position] == '"')
       {
-        if(_inside_comment || _inside_multiline_comment || _inside_char ||
-           _inside_string)
-        {
-          _current_token.value.push_back(character);
-          _position++;
-          goto while_loop_continue;
-        }
-        if(_tokens.back().type == TokenType::IDENTIFIER)
-        {
-          // this identifier should definitely be function
-          _tokens.back().type = TokenType::FUNCTION;
-        }
-        _current_token = Token(TokenType::BRACKET_OPEN);
-        _current_token.start_offset = _position;
-        _current_token.end_offset = _position;
-        _current_token.value.push_back(character);
-        _tokens.emplace_back(_current_token);
-        _position++;
-        goto while_loop_continue;
+        position++;
       }
-      else if(character == ')')
+      _tokens.emplace_back(TokenType::STRING, start, position - start);
+      break;
+    }
+    case CharClass::LESS_THAN:
+    {
+      // check if it is include declaration, else consider it as operator
+      if(!this->inside_include_declaration(str))
       {
-        if(_inside_comment || _inside_multiline_comment || _inside_char ||
-           _inside_string)
-        {
-          _current_token.value.push_back(character);
-          _position++;
-          goto while_loop_continue;
-        }
-        _current_token = Token(TokenType::BRACKET_CLOSE);
-        _current_token.start_offset = _position;
-        _current_token.end_offset = _position;
-        _current_token.value.push_back(character);
-        _tokens.emplace_back(_current_token);
-        _position++;
-        goto while_loop_continue;
+        position = this->_lex_operator(str, position);
+        break;
       }
-      else if(character == '[')
+      // move forward until we encounter '>'
+      while(position < size && !has_flag(str[position], ANGLE_HEADER_END))
       {
-        if(_inside_comment || _inside_multiline_comment || _inside_char ||
-           _inside_string)
-        {
-          _current_token.value.push_back(character);
-          _position++;
-          goto while_loop_continue;
-        }
-        _current_token = Token(TokenType::SQUARE_BRACKET_OPEN);
-        _current_token.start_offset = _position;
-        _current_token.end_offset = _position;
-        _current_token.value.push_back(character);
-        _tokens.emplace_back(_current_token);
-        _position++;
-        goto while_loop_continue;
+        position++;
       }
-      else if(character == ']')
+      if(str[position] == '>')
       {
-        if(_inside_comment || _inside_multiline_comment || _inside_char ||
-           _inside_string)
-        {
-          _current_token.value.push_back(character);
-          _position++;
-          goto while_loop_continue;
-        }
-        _current_token = Token(TokenType::SQUARE_BRACKET_CLOSE);
-        _current_token.start_offset = _position;
-        _current_token.end_offset = _position;
-        _current_token.value.push_back(character);
-        _tokens.emplace_back(_current_token);
-        _position++;
-        goto while_loop_continue;
+        position++;
       }
-      else if(character == '{')
+      _tokens.emplace_back(TokenType::HEADER, start, position - start);
+      break;
+    }
+    case CharClass::SLASH:
+    {
+      if(position + 1 < size && str[position + 1] == '/')
       {
-        if(_inside_comment || _inside_multiline_comment || _inside_char ||
-           _inside_string)
-        {
-          _current_token.value.push_back(character);
-          _position++;
-          goto while_loop_continue;
-        }
-        _current_token = Token(TokenType::CURLY_BRACE_OPEN);
-        _current_token.start_offset = _position;
-        _current_token.end_offset = _position;
-        _current_token.value.push_back(character);
-        _tokens.emplace_back(_current_token);
-        _position++;
-        goto while_loop_continue;
+        // single line comment
+        position = find_any_of(str, position, '\r', '\n', '\r', '\n');
+        _tokens.emplace_back(TokenType::COMMENT, start, position - start);
+        break;
       }
-      else if(character == '}')
+      if(position + 1 < size && str[position + 1] == '*')
       {
-        if(_inside_comment || _inside_multiline_comment || _inside_char ||
-           _inside_string)
-        {
-          _current_token.value.push_back(character);
-          _position++;
-          goto while_loop_continue;
-        }
-        _current_token = Token(TokenType::CURLY_BRACE_CLOSE);
-        _current_token.start_offset = _position;
-        _current_token.end_offset = _position;
-        _current_token.value.push_back(character);
-        _tokens.emplace_back(_current_token);
-        _position++;
-        goto while_loop_continue;
+        // multiline comment, unclosed one is incomplete
+        bool closed;
+        position = multiline_comment_end(str, position + 2, closed);
+        _tokens.emplace_back(closed ? TokenType::MULTILINE_COMMENT
+                                    : TokenType::MULTILINE_COMMENT_INCOMPLETE,
+                             start,
+                             position - start);
+        break;
       }
+      position = this->_lex_operator(str, position);
+      break;
     }
-
-    /// continuing if inside comment
-    if(_inside_comment)
+    case CharClass::DOT:
     {
-      while(_position < str.size() && str[_position] != '\n')
+      if(_inside_char)
       {
-        _current_token.value.push_back(str[_position]);
-        _position++;
+        position++;
+        break;
       }
-      goto while_loop_continue;
+      position = this->_lex_operator(str, position);
+      break;
     }
-
-    /// continuing if inside multiline comment
-    if(_inside_multiline_comment)
+    case CharClass::OPERATOR:
     {
-      while(_position < str.size() && str[_position] != '*')
-      {
-        _current_token.value.push_back(str[_position]);
-        _position++;
-      }
-      goto while_loop_continue;
+      position = this->_lex_operator(str, position);
+      break;
     }
-
-    /// Operator
-    for(const std::string& op : operators)
+    case CharClass::COMMA:
     {
-      if(str.compare(_position, op.size(), op) == 0)
-      {
-        // found operator match
-        _current_token = Token(TokenType::OPERATOR);
-        _current_token.start_offset = _position;
-        _current_token.end_offset = _position + op.size() - 1;
-        _current_token.value = op;
-        _tokens.emplace_back(_current_token);
-        _position += op.size();
-        goto while_loop_continue;
-      }
+      position = this->_lex_punctuation(TokenType::COMMA, position);
+      break;
     }
-
-    /// Keyword
-    for(const std::string keyword : keywords)
+    case CharClass::SEMICOLON:
+    {
+      position = this->_lex_punctuation(TokenType::SEMICOLON, position);
+      break;
+    }
+    case CharClass::BRACKET_OPEN:
     {
-      if(str.compare(_position, keyword.size(), keyword) == 0)
+      if(!_inside_char && !_tokens.empty() &&
+         _tokens.back().type == TokenType::IDENTIFIER)
       {
-        if(_position + keyword.size() != str.size() &&
-           seperators.find(str[_position + keyword.size()]) ==
-             std::string::npos)
-        {
-          // next character after this keyword is not separator
-          // so this must be an indentifier
-          break;
-        }
-        // found keyword match
-        _current_token = Token(TokenType::KEYWORD);
-        _current_token.start_offset = _position;
-        _current_token.end_offset = _position + keyword.size() - 1;
-        _current_token.value = keyword;
-        _tokens.emplace_back(_current_token);
-        _position += keyword.size();
-        goto while_loop_continue;
+        // this identifier should definitely be function
+        _tokens.back().type = TokenType::FUNCTION;
       }
+      position = this->_lex_punctuation(TokenType::BRACKET_OPEN, position);
+      break;
     }
-
-    /// Alphabets
-    if(_inside_comment || _inside_multiline_comment || _inside_string ||
-       _inside_char)
+    case CharClass::BRACKET_CLOSE:
     {
-      _current_token.value.push_back(character);
-      _position++;
-      goto while_loop_continue;
+      position = this->_lex_punctuation(TokenType::BRACKET_CLOSE, position);
+      break;
     }
-    if(isdigit(character))
+    case CharClass::SQUARE_BRACKET_OPEN:
     {
-      // character is number - '0' to '9'
-      _current_token = Token(TokenType::NUMBER);
-      _current_token.start_offset = _position;
-      while(_position < str.size())
-      {
-        if(isdigit(str[_position]) || str[_position] == '.' ||
-           str[_position] == 'e' || str[_position] == 'f' ||
-           (str[_position] == '-' && _current_token.value.back() == 'e'))
-        {
-          _current_token.value.push_back(str[_position]);
-          _position++;
-          continue;
-        }
-        break;
-      }
-      _current_token.end_offset = _position - 1;
-      _tokens.emplace_back(_current_token);
-      goto while_loop_continue;
+      position =
+        this->_lex_punctuation(TokenType::SQUARE_BRACKET_OPEN, position);
+      break;
     }
-    _current_token = Token(TokenType::IDENTIFIER);
-    _current_token.start_offset = _position;
-    _current_token.value = character;
-    _position++;
-    // moving forward until a separator is encountered
-    while(_position < str.size() &&
-          seperators.find(str[_position]) == std::string::npos)
+    case CharClass::SQUARE_BRACKET_CLOSE:
     {
-      _current_token.value.push_back(str[_position]);
-      _position++;
+      position =
+        this->_lex_punctuation(TokenType::SQUARE_BRACKET_CLOSE, position);
+      break;
+    }
+    case CharClass::CURLY_BRACE_OPEN:
+    {
+      position = this->_lex_punctuation(TokenType::CURLY_BRACE_OPEN, position);
+      break;
+    }
+    case CharClass::CURLY_BRACE_CLOSE:
+    {
+      position = this->_lex_punctuation(TokenType::CURLY_BRACE_CLOSE, position);
+      break;
+    }
     }
-    _current_token.end_offset = _position - 1;
-    _tokens.emplace_back(_current_token);
-
-  while_loop_continue:
-    continue;
   }
 
+  _position = position;
   return _tokens;
 }
 
+uint32_t Tokenizer::_lex_operator(const std::string& str,
+                                 const uint32_t& position) noexcept
+{
+  const unsigned char first = str[position];
+  const unsigned char second =
+    position + 1 < str.size() ? str[position + 1] : '\0';
+  const uint32_t length = char_table.operator_seconds[first] &
+                              char_table.operator_second_bit[second]
+                            ? 2
+                            : 1;
+  _tokens.emplace_back(TokenType::OPERATOR, position, length);
+  return position + length;
+}
+
+uint32_t Tokenizer::_lex_punctuation(const TokenType& type,
+                                     const uint32_t& position) noexcept
+{
+  // single character tokens are part of character being tokenized
+  if(!_inside_char)
+  {
+    _tokens.emplace_back(type, position, 1);
+  }
+  return position + 1;
+}
+
 const std::vector<Token>& Tokenizer::tokenize_from_imcomplete_token(
   const std::string& str, const Token& incomplete_token) noexcept
 {
   if(incomplete_token.type == TokenType::MULTILINE_COMMENT_INCOMPLETE)
   {
-    _current_token = Token(TokenType::MULTILINE_COMMENT_INCOMPLETE);
-    bool inserted_multiline_comment_token = false;
-    while(_position < str.size())
-    {
-      if(str[_position] == '*' && _position + 1 < str.size() &&
-         str[_position + 1] == '/')
-      {
-        // multiline comment ended.
-        _current_token.value.append("*/");
-        _current_token.end_offset = _position + 1;
-        _position += 2;
-        _current_token.type = TokenType::MULTILINE_COMMENT;
-        _tokens.push_back(_current_token);
-        inserted_multiline_comment_token = true;
-        break;
-      }
-      if(str[_position] == '\r')
-      {
-        _position++;
-        continue;
-      }
-      _current_token.value.push_back(str[_position]);
-      _position++;
-    }
-    if(_position >= str.size() && !inserted_multiline_comment_token)
-    {
-      _current_token.end_offset = _position - 1;
-      _tokens.push_back(_current_token);
-      return _tokens;
-    }
+    // multiline comment continues till "*/", or end of string
+    const uint32_t start = _position;
+    bool closed;
+    _position = multiline_comment_end(str, _position, closed);
+    _tokens.emplace_back(closed ? TokenType::MULTILINE_COMMENT
+                                : TokenType::MULTILINE_COMMENT_INCOMPLETE,
+                         start,
+                         _position - start);
   }
 
   return this->tokenize(str);
@@ -789,15 +797,13 @@ const std::vector<Token>& Tokenizer::tokenize_from_imcomplete_token(
 void Tokenizer::clear_tokens() noexcept
 {
   _inside_char = false;
-  _inside_string = false;
-  _inside_comment = false;
-  _inside_multiline_comment = false;
   _position = 0;
-  _current_token = Token();
+  _char_start_offset = 0;
   _tokens.clear();
 }
 
-bool Tokenizer::inside_include_declaration() const noexcept
+bool Tokenizer::inside_include_declaration(
+  const std::string& str) const noexcept
 {
   // first token backwards which is not whitespace
   // if it is #include, it is include declaration
@@ -806,7 +812,7 @@ bool Tokenizer::inside_include_declaration() const noexcept
     if(it->type != TokenType::WHITESPACE)
     {
       if(it->type == TokenType::PREPROCESSOR_DIRECTIVE &&
-         it->value == "#include")
+         it->value(str) == "#include")
       {
         return true;
       }
@@ -816,7 +822,8 @@ bool Tokenizer::inside_include_declaration() const noexcept
   return false;
 }
 
-void log_tokens(const std::vector<Token>& tokens) noexcept
+void log_tokens(const std::string& str,
+                const std::vector<Token>& tokens) noexcept
 {
   printf("Tokens: [");
   for(uint32_t i = 0; i < tokens.size(); i++)
@@ -824,21 +831,23 @@ void log_tokens(const std::vector<Token>& tokens) noexcept
     Token token = tokens[i];
     if(i != tokens.size() - 1)
     {
-      printf("\n  {\n    type: %s,\n    start_offset: %lu,\n    end_offset: "
-             "%lu,\n    value: \"%s\"\n  },",
+      printf("\n  {\n    type: %s,\n    start_offset: %lu,\n    length: "
+             "%lu,\n    value: \"%.*s\"\n  },",
              token_type_to_string(token.type).c_str(),
              (unsigned long)token.start_offset,
-             (unsigned long)token.end_offset,
-             token.value.c_str());
+             (unsigned long)token.length,
+             (int)token.length,
+             token.value(str).data());
     }
     else
     {
-      printf("\n  {\n    type: %s,\n    start_offset: %lu,\n    end_offset: "
-             "%lu,\n    value: \"%s\"\n  }",
+      printf("\n  {\n    type: %s,\n    start_offset: %lu,\n    length: "
+             "%lu,\n    value: \"%.*s\"\n  }",
              token_type_to_string(token.type).c_str(),
              (unsigned long)token.start_offset,
-             (unsigned long)token.end_offset,
-             token.value.c_str());
+             (unsigned long)token.length,
+             (int)token.length,
+             token.value(str).data());
     }
   }
   printf("\n]\n");
@@ -2,6 +2,7 @@
 
 #include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <cstdint>
 
@@ -10,7 +11,7 @@ namespace CppTokenizer
 {
 
 /// @brief TokenType - enum of all token types.
-typedef enum class TokenType
+typedef enum class TokenType : uint8_t
 {
   /// @brief Whitespace - ' ' character.
   WHITESPACE,
@@ -72,7 +73,9 @@ typedef enum class TokenType
   UNKNOWN
 } TokenType;
 
-/// @brief Token - consists of type, start & end offsets, token string value.
+/// @brief Token - consists of type, start offset & length of token in
+///        tokenized string. Tokens don't own their string, it's a view
+///        into tokenized string, so they are small and cheap to copy.
 class Token
 {
 public:
@@ -83,22 +86,32 @@ public:
   /// @param token_type the type of token to construct.
   Token(const TokenType& token_type) noexcept;
 
+  /// @brief Constructor with token type, start offset & length arguments.
+  /// @param token_type the type of token to construct.
+  /// @param start_offset starting offset of token in string.
+  /// @param length length of token in string.
+  Token(const TokenType& token_type,
+        const uint32_t& start_offset,
+        const uint32_t& length) noexcept;
+
   /// @brief Checks if given token is not equal to this token.
   /// @param other the token to compare with this token.
   /// @return Returns true if the tokens are not equal.
   bool operator!=(const Token& other) const noexcept;
 
+  /// @brief Gives token string.
+  /// @param str the string this token is of.
+  /// @return Returns view into str.
+  [[nodiscard]] std::string_view value(std::string_view str) const noexcept;
+
   /// @brief Type of token.
   TokenType type;
 
   /// @brief Starting offset or position of token in string.
   uint32_t start_offset;
 
-  /// @brief Ending offset or position of token in string.
-  uint32_t end_offset;
-
-  /// @brief Token string.
-  std::string value;
+  /// @brief Length of token in string.
+  uint32_t length;
 };
 
 class Tokenizer
@@ -108,7 +121,8 @@ public:
   Tokenizer() noexcept;
 
   /// @brief Tokenizes the given string into tokens.
-  /// @param str const reference to the string to tokenize.
+  /// @param str const reference to the string to tokenize, tokens are
+  ///            spans of it.
   /// @return Const reference to vector of Tokens.
   [[nodiscard]] const std::vector<Token>&
   tokenize(const std::string& str) noexcept;
@@ -121,16 +135,37 @@ public:
   void clear_tokens() noexcept;
 
 private:
-  Token _current_token;
   std::vector<Token> _tokens;
-  bool _inside_string, _inside_char, _inside_comment, _inside_multiline_comment;
+  bool _inside_char;
   uint32_t _position;
 
-  [[nodiscard]] bool inside_include_declaration() const noexcept;
+  /// @brief Starting offset of character being tokenized.
+  uint32_t _char_start_offset;
+
+  [[nodiscard]] bool
+  inside_include_declaration(const std::string& str) const noexcept;
+
+  /// @brief Lexes operator at position, two character operators are
+  ///        matched first.
+  /// @param str const reference to the string being tokenized.
+  /// @param position position of operator.
+  /// @return Returns position after operator.
+  [[nodiscard]] uint32_t _lex_operator(const std::string& str,
+                                       const uint32_t& position) noexcept;
+
+  /// @brief Lexes single character token at position, skipping it inside
+  ///        a character.
+  /// @param type the type of token.
+  /// @param position position of token.
+  /// @return Returns position after token.
+  [[nodiscard]] uint32_t _lex_punctuation(const TokenType& type,
+                                          const uint32_t& position) noexcept;
 };
 
 /// @brief Logs tokens to STDOUT with pretty format.
+/// @param str const reference to the tokenized string.
 /// @param tokens const reference to vector of tokens.
-void log_tokens(const std::vector<Token>& tokens) noexcept;
+void log_tokens(const std::string& str,
+                const std::vector<Token>& tokens) noexcept;
 
 }; // namespace CppTokenizer
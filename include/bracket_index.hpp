@@ -0,0 +1,190 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+#include "../cpp-tokenizer/cpp_tokenizer.hpp"
+#include "types.hpp"
+
+/// @brief Gives change in nesting depth by token, 1 for opening brackets,
+///        -1 for closing brackets, 0 for other tokens. Round, square
+///        brackets and curly braces nest together.
+/// @param token token.
+/// @throws No exceptions.
+[[nodiscard]] int32
+bracket_depth_change(const CppTokenizer::Token& token) noexcept;
+
+/// @brief Nesting depth of brackets at start of each tokenized line, for
+///        matching brackets and colouring them by depth without scanning
+///        lines before them. Each line is summarized by change in depth
+///        over it, and lowest depth at its boundaries (start of line and
+///        after each bracket). Summaries are nodes of an implicit treap
+///        (ordered by row), each node has sum and lowest prefix of its
+///        subtree, so depth at a line, and first (or last) line dipping
+///        below a depth, are found in O(log n). Replacing lines splits
+///        and merges only the paths to them.
+class BracketIndex
+{
+public:
+  /// @brief Creates empty index.
+  /// @throws No exceptions.
+  BracketIndex() noexcept;
+
+  /// @brief Removes all lines.
+  /// @throws No exceptions.
+  void clear() noexcept;
+
+  /// @brief Number of lines.
+  /// @throws No exceptions.
+  [[nodiscard]] uint32 size() const noexcept;
+
+  /// @brief Replaces lines [row, row + count) with lines.
+  /// @param row index of first replaced line.
+  /// @param count number of replaced lines.
+  /// @param lines tokens of lines replacing them.
+  /// @throws No exceptions.
+  void replace_lines(
+    const uint32& row,
+    const uint32& count,
+    std::span<const std::vector<CppTokenizer::Token>> lines) noexcept;
+
+  /// @brief Gives nesting depth at start of line.
+  /// @param row index of line, size() gives depth at end of last line.
+  /// @throws No exceptions.
+  [[nodiscard]] int32 depth_before(const uint32& row) const noexcept;
+
+  /// @brief Finds first line, from first_row, with depth at one of its
+  ///        boundaries below depth.
+  /// @param first_row index of first line to look in.
+  /// @param depth nesting depth.
+  /// @return Returns std::nullopt if there is none.
+  /// @throws No exceptions.
+  [[nodiscard]] std::optional<uint32>
+  first_line_below(const uint32& first_row, const int32& depth) const noexcept;
+
+  /// @brief Finds last line, till last_row, with depth at one of its
+  ///        boundaries not above depth.
+  /// @param last_row index of last line to look in.
+  /// @param depth nesting depth.
+  /// @return Returns std::nullopt if there is none.
+  /// @throws No exceptions.
+  [[nodiscard]] std::optional<uint32>
+  last_line_not_above(const uint32& last_row,
+                      const int32& depth) const noexcept;
+
+private:
+  /// @brief Node of treap, summary of a line.
+  struct Node
+  {
+    /// @brief Change in depth over line.
+    int32 depth_change;
+
+    /// @brief Lowest depth at boundaries of line, from its start.
+    int32 min_depth;
+
+    /// @brief Change in depth over lines of subtree.
+    int32 subtree_depth_change;
+
+    /// @brief Lowest depth at boundaries of lines of subtree, from start
+    ///        of its first line.
+    int32 subtree_min_depth;
+
+    /// @brief Number of lines in subtree.
+    uint32 size;
+
+    /// @brief Index of left child, 0 if there is none.
+    uint32 left;
+
+    /// @brief Index of right child, 0 if there is none.
+    uint32 right;
+
+    /// @brief Heap priority, random.
+    uint32 priority;
+  };
+
+  /// @brief Nodes, first one stands for empty subtrees.
+  std::vector<Node> _nodes;
+
+  /// @brief Indices of removed nodes, reused.
+  std::vector<uint32> _free_nodes;
+
+  /// @brief Index of root, 0 if there are no lines.
+  uint32 _root;
+
+  /// @brief State of random priorities.
+  std::uint32_t _seed;
+
+  /// @brief Creates node summarizing line.
+  /// @param tokens tokens of line.
+  /// @return Returns index of node.
+  /// @throws No exceptions.
+  [[nodiscard]] uint32
+  _create_node(const std::vector<CppTokenizer::Token>& tokens) noexcept;
+
+  /// @brief Builds treap of lines, in linear time.
+  /// @param lines tokens of lines.
+  /// @return Returns index of root.
+  /// @throws No exceptions.
+  [[nodiscard]] uint32
+  _build(std::span<const std::vector<CppTokenizer::Token>> lines) noexcept;
+
+  /// @brief Frees nodes of subtree.
+  /// @param node index of root of subtree.
+  /// @throws No exceptions.
+  void _free(const uint32& node) noexcept;
+
+  /// @brief Updates subtree summary of node from its children.
+  /// @param node index of node.
+  /// @throws No exceptions.
+  void _update(const uint32& node) noexcept;
+
+  /// @brief Splits subtree into its first count lines and the rest.
+  /// @param node index of root of subtree.
+  /// @param count number of lines in first part.
+  /// @param first index of root of first part.
+  /// @param rest index of root of rest.
+  /// @throws No exceptions.
+  void _split(const uint32& node,
+              const uint32& count,
+              uint32& first,
+              uint32& rest) noexcept;
+
+  /// @brief Merges subtrees, lines of first come before lines of second.
+  /// @param first index of root of first subtree.
+  /// @param second index of root of second subtree.
+  /// @return Returns index of root of merged subtree.
+  /// @throws No exceptions.
+  [[nodiscard]] uint32 _merge(const uint32& first,
+                              const uint32& second) noexcept;
+
+  /// @brief Finds first line of subtree, from first_row, with depth at
+  ///        one of its boundaries below depth.
+  /// @param node index of root of subtree.
+  /// @param row index of first line of subtree.
+  /// @param start_depth depth at start of subtree.
+  /// @param first_row index of first line to look in.
+  /// @param depth nesting depth.
+  /// @throws No exceptions.
+  [[nodiscard]] std::optional<uint32>
+  _first_line_below(const uint32& node,
+                    const uint32& row,
+                    const int32& start_depth,
+                    const uint32& first_row,
+                    const int32& depth) const noexcept;
+
+  /// @brief Finds last line of subtree, till last_row, with depth at one
+  ///        of its boundaries not above depth.
+  /// @param node index of root of subtree.
+  /// @param row index of first line of subtree.
+  /// @param start_depth depth at start of subtree.
+  /// @param last_row index of last line to look in.
+  /// @param depth nesting depth.
+  /// @throws No exceptions.
+  [[nodiscard]] std::optional<uint32>
+  _last_line_not_above(const uint32& node,
+                       const uint32& row,
+                       const int32& start_depth,
+                       const uint32& last_row,
+                       const int32& depth) const noexcept;
+};
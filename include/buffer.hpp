@@ -3,9 +3,18 @@
 #include <deque>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 #include "cpp_tokenizer_cache.hpp"
+#include "file_saver.hpp"
+#include "line_indexer.hpp"
+#include "line_layout.hpp"
+#include "piece_table.hpp"
+#include "regex_search.hpp"
+#include "text_search.hpp"
+#include "trigram_index.hpp"
 #include "types.hpp"
+#include "undo_history.hpp"
 
 /// @brief Cursor commands to process on buffer.
 typedef enum class BufferCursorCommand
@@ -138,16 +147,70 @@ public:
   ~Buffer() = default;
 
   /// @brief Loads file contents into buffer.
+  ///        Files larger than large_file_threshold are memory mapped,
+  ///        only the first lines are loaded right away, the rest are
+  ///        indexed in background and appended by
+  ///        append_background_loaded_lines().
   /// @param filepath path to file.
   /// @return Returns false if unable to load file.
   /// @throws No exceptions.
   [[nodiscard]] bool load_from_file(const std::string& filepath) noexcept;
 
-  /// @brief Saves contents to the file.
-  /// @returns Returns false if unable to write to file.
+  /// @brief Replaces contents with lines not backed by a file,
+  ///        like results of a search.
+  /// @param lines lines, without tabs and line breaks.
+  /// @throws No exceptions.
+  void load_from_lines(const std::vector<std::string>& lines) noexcept;
+
+  /// @brief Appends lines at end, without recording an edit. For lines
+  ///        streamed into buffer, like results of a search.
+  /// @param lines lines, without tabs and line breaks.
+  /// @throws No exceptions.
+  void append_lines(const std::vector<std::string>& lines) noexcept;
+
+  /// @brief Appends lines indexed in background since last call, and
+  ///        takes trigram index of file once it's built.
+  ///        Call this every frame.
+  /// @return Returns true if lines are appended.
+  /// @throws No exceptions.
+  bool append_background_loaded_lines() noexcept;
+
+  /// @brief Tells if loaded file is valid UTF-8.
+  /// @return Returns false if file has invalid UTF-8 sequences.
+  /// @throws No exceptions.
+  [[nodiscard]] bool is_valid_utf8() const noexcept;
+
+  /// @brief Tells if lines of file are still being loaded in background.
+  /// @return Returns false if all lines are loaded.
+  /// @throws No exceptions.
+  [[nodiscard]] bool is_loading() const noexcept;
+
+  /// @brief Saves contents to the file, on a background thread.
+  ///        Lines are snapshotted, so editing can continue while saving.
+  ///        While lines of a large file are loading, saving starts when
+  ///        they are all appended (append_background_loaded_lines()).
+  ///        Result is given by get_save_result().
+  /// @returns Returns false if there is no file, or a save is already
+  ///          running.
   /// @throws No exceptions.
   [[nodiscard]] bool save() noexcept;
 
+  /// @brief Tells if file is being saved.
+  /// @return Returns true while save is running, or waits for loading.
+  /// @throws No exceptions.
+  [[nodiscard]] bool is_saving() const noexcept;
+
+  /// @brief Progress of running save.
+  /// @return Returns fraction of file written, from 0 to 1.
+  /// @throws No exceptions.
+  [[nodiscard]] float32 save_progress() const noexcept;
+
+  /// @brief Gives result of completed save, only once.
+  /// @return Returns std::nullopt if no save completed since last call,
+  ///         else returns false if unable to write to file.
+  /// @throws No exceptions.
+  [[nodiscard]] std::optional<bool> get_save_result() noexcept;
+
   /// @brief Length of buffer (or) number of lines in buffer.
   /// @return Returns number of lines in unsigned int32 type.
   /// @throws No exceptions.
@@ -160,19 +223,61 @@ public:
   [[nodiscard]] std::optional<uint32>
   line_length(const uint32& line_index) const noexcept;
 
+  /// @brief Offset of position in text, counting a newline character
+  ///        after each line. Costs O(log n).
+  /// @param row row of position.
+  /// @param column column of position, -1 is start of line.
+  /// @return Returns std::nullopt if position is out of bounds.
+  /// @throws No exceptions.
+  [[nodiscard]] std::optional<std::size_t>
+  offset_of(const uint32& row, const int32& column) const noexcept;
+
+  /// @brief Position of offset in text, counting a newline character
+  ///        after each line. Costs O(log n).
+  /// @param offset offset in text, clamped to end of text.
+  /// @return Returns pair of row (uint32), column (int32).
+  /// @throws No exceptions.
+  [[nodiscard]] std::pair<uint32, int32>
+  position_of(const std::size_t& offset) const noexcept;
+
+  /// @brief Width of longest line, kept up to date with edits,
+  ///        so it costs O(1).
+  /// @return Returns number of characters in longest line.
+  /// @throws No exceptions.
+  [[nodiscard]] uint32 max_line_width() const noexcept;
+
+  /// @brief Gives grapheme clusters and display widths of line, cached
+  ///        till the line is edited. Check line_index before query.
+  /// @param line_index index of line in buffer.
+  /// @return Returns reference valid until next call.
+  /// @throws No exceptions.
+  [[nodiscard]] const LineLayout&
+  line_layout(const uint32& line_index) const noexcept;
+
   /// @brief Gives buffer in lines format, would be easy for the frontend.
-  /// @return Returns const reference to vector of strings.
+  /// @return Returns const reference to piece table of lines.
+  /// @throws No exceptions.
+  [[nodiscard]] const PieceTable& lines() const noexcept;
+
+  /// @brief Takes an immutable snapshot of lines in O(1), for reading
+  ///        them on a worker thread while buffer is edited.
+  /// @return Returns snapshot, versioned like version().
+  /// @throws No exceptions.
+  [[nodiscard]] PieceTableSnapshot snapshot() const noexcept;
+
+  /// @brief Revision of text, incremented by every edit, undo, redo
+  ///        and reload. Results computed from a snapshot are current
+  ///        while its version matches.
   /// @throws No exceptions.
-  [[nodiscard]] const std::vector<std::string>& lines() const noexcept;
+  [[nodiscard]] std::uint64_t version() const noexcept;
 
   /// @brief Gives content of line in buffer.
   /// @param line_index index of line in buffer (0 based index).
   ///        Check line_index before query.
   /// @return Returns std::nullopt if line_index is out of bounds.
-  // [[nodiscard]] const std::string&
-  // line(const uint32& line_index) const noexcept;
+  ///         The view is valid until the buffer is edited or reloaded.
   /// @throws No exceptions.
-  [[nodiscard]] std::optional<const std::reference_wrapper<std::string>>
+  [[nodiscard]] std::optional<std::string_view>
   line(const uint32& line_index) const noexcept;
 
   /// @brief Gives content of line in buffer, with leading spaces converted
@@ -298,6 +403,125 @@ public:
   /// @throws No exceptions.
   void insert_string(const std::string& str) noexcept;
 
+  /// @brief Undoes last edit (or) group of typed characters, in one step.
+  /// @return Returns false if there is nothing to undo.
+  /// @throws No exceptions.
+  bool undo() noexcept;
+
+  /// @brief Redoes last undone edit.
+  /// @return Returns false if there is nothing to redo.
+  /// @throws No exceptions.
+  bool redo() noexcept;
+
+  /// @brief Starts a transaction, edits made till it is committed queue
+  ///        one merged set of render updates and one token cache update.
+  ///        Transactions nest, every edit runs in one.
+  /// @throws No exceptions.
+  void begin_transaction() noexcept;
+
+  /// @brief Commits transaction, queueing updates for lines changed in it.
+  ///        Render updates of lines outside visible rows are dropped.
+  /// @throws No exceptions.
+  void commit_transaction() noexcept;
+
+  /// @brief Finds query in lines, as it is typed. Literal matches are
+  ///        refined while query grows, regex matches are found in
+  ///        background and taken by append_found_matches(). Matches are
+  ///        kept up to date while lines are edited.
+  /// @param query text (or regex) to find, empty query clears matches.
+  /// @param case_sensitive false to ignore case of ASCII letters.
+  /// @param regex true to find query as a regular expression.
+  /// @throws No exceptions.
+  void find(const std::string& query,
+            const bool& case_sensitive,
+            const bool& regex) noexcept;
+
+  /// @brief Appends regex matches found in background since last call,
+  ///        selecting nearest match if it was waiting for it.
+  ///        Call this every frame.
+  /// @return Returns true if matches are appended.
+  /// @throws No exceptions.
+  bool append_found_matches() noexcept;
+
+  /// @brief Gives matches of query, in order of position.
+  /// @throws No exceptions.
+  [[nodiscard]] const std::vector<TextMatch>& matches() const noexcept;
+
+  /// @brief Number of matches found so far, including regex matches not
+  ///        appended yet.
+  /// @throws No exceptions.
+  [[nodiscard]] std::size_t found_matches_count() const noexcept;
+
+  /// @brief Tells if query is valid, regex query may not be.
+  /// @throws No exceptions.
+  [[nodiscard]] bool is_find_query_valid() const noexcept;
+
+  /// @brief Tells if regex is still being found in background.
+  /// @throws No exceptions.
+  [[nodiscard]] bool is_finding() const noexcept;
+
+  /// @brief Gives progress of finding regex in background.
+  /// @return Returns fraction of lines scanned, 1 when not finding.
+  /// @throws No exceptions.
+  [[nodiscard]] float32 find_progress() const noexcept;
+
+  /// @brief Tells if nearest match will be selected when it's found.
+  /// @throws No exceptions.
+  [[nodiscard]] bool is_match_selection_pending() const noexcept;
+
+  /// @brief Selects first match starting at or after selection start
+  ///        (or cursor), wrapping around to first match. Cursor is moved to
+  ///        end of match. Used while typing query, so growing match stays
+  ///        selected. While regex is found in background and there is no
+  ///        match after selection yet, match is selected when it's found.
+  /// @return Returns false if there are no matches.
+  /// @throws No exceptions.
+  bool select_nearest_match() noexcept;
+
+  /// @brief Selects first match starting after selection start (or
+  ///        cursor), wrapping around to first match.
+  /// @return Returns false if there are no matches.
+  /// @throws No exceptions.
+  bool select_next_match() noexcept;
+
+  /// @brief Selects last match starting before selection start (or
+  ///        cursor), wrapping around to last match.
+  /// @return Returns false if there are no matches.
+  /// @throws No exceptions.
+  bool select_previous_match() noexcept;
+
+  /// @brief Replaces all matches with replacement in one edit, undone in
+  ///        one step. New lines are built in one pass over matched lines
+  ///        and swapped in at once, so render and token cache updates are
+  ///        queued once. Matches overlapping a replaced match are skipped.
+  /// @param replacement text replacing matches (without newline
+  ///                    characters).
+  /// @return Returns false if there are no matches, or regex matches are
+  ///         still being found.
+  /// @throws No exceptions.
+  bool replace_all(const std::string& replacement) noexcept;
+
+  /// @brief Replaces text of ranges with replacement in one edit, undone in
+  ///        one step, like replace_all(). Used to rename all occurrences
+  ///        of an identifier without searching the buffer.
+  /// @param ranges ranges of text, sorted by row and column. Ranges
+  ///               overlapping a replaced range, out of order, or not
+  ///               inside current lines (stale) are skipped.
+  /// @param replacement text replacing ranges (without newline
+  ///                    characters).
+  /// @return Returns false if no range is inside current lines.
+  /// @throws No exceptions.
+  bool replace_ranges(const std::vector<TextMatch>& ranges,
+                      const std::string& replacement) noexcept;
+
+  /// @brief Sets rows shown in window, lines outside them are redrawn
+  ///        when scrolled into view, not when edited.
+  /// @param first_row index of first visible line.
+  /// @param last_row index of last visible line.
+  /// @throws No exceptions.
+  void set_visible_rows(const uint32& first_row,
+                        const uint32& last_row) noexcept;
+
   // /// @brief Gets next view update command.
   // /// @return Returns std::nullopt if there are no commands.
   // /// @throws No exceptions.
@@ -328,7 +552,7 @@ private:
   /// @brief Cursor column.
   int32 _cursor_col;
 
-  /// @brief Target cursor column.
+  /// @brief Target cursor column, in display cells (-1 is start of line).
   ///        For natural or expected cursor movement.
   ///        Trust your instincts ^_^
   int32 _cursor_col_target;
@@ -346,7 +570,25 @@ private:
   uint32 _selected_line;
 
   /// @brief Lines of buffer.
-  std::vector<std::string> _lines;
+  PieceTable _lines;
+
+  /// @brief Tells if lines end with "\r\n", detected from majority of
+  ///        line endings in start of file. Used when saving.
+  bool _crlf_line_endings;
+
+  /// @brief Tells if loaded file is valid UTF-8.
+  bool _valid_utf8;
+
+  /// @brief Indexes lines of large files in background.
+  ///        Declared after lines, as it reads their original buffer.
+  LineIndexer _line_indexer;
+
+  /// @brief Writes snapshots of lines to file in background.
+  ///        Declared after lines, as it reads their buffers.
+  FileSaver _file_saver;
+
+  /// @brief Tells if a save waits for lines loaded in background.
+  bool _save_pending;
 
   // /// @brief View updates queue.
   // std::deque<BufferViewUpdateCommand> _buffer_view_update_commands_queue;
@@ -358,6 +600,139 @@ private:
   /// @brief Token cahce updates queue.
   std::deque<TokenCacheUpdateCommand> _token_cache_update_commands_queue;
 
+  /// @brief Layouts of lines with multibyte characters.
+  mutable LineLayoutCache _line_layouts;
+
+  /// @brief Edits which can be undone and redone.
+  UndoHistory _undo_history;
+
+  /// @brief Edit being recorded, lines before it and cursor before it.
+  EditDelta _pending_edit;
+
+  /// @brief Number of lines in buffer when pending edit started.
+  uint32 _pending_edit_buffer_length;
+
+  /// @brief Nesting depth of edits, edits made by other edits
+  ///        (like deleting selection before inserting) are part of them.
+  uint32 _edit_depth;
+
+  /// @brief Search of find bar, updated with edits.
+  TextSearch _search;
+
+  /// @brief Regex search of find bar, updated with edits.
+  RegexSearch _regex_search;
+
+  /// @brief Trigram index of large file, narrowing find bar search.
+  TrigramIndex _trigram_index;
+
+  /// @brief Version of lines when they were last same as lines of file.
+  std::uint64_t _file_version;
+
+  /// @brief Tells if find bar query is a regex.
+  bool _find_regex;
+
+  /// @brief Tells if nearest match is selected when it's found.
+  bool _match_selection_pending;
+
+  /// @brief Selects match, moving cursor to its end.
+  /// @param index index of match.
+  /// @throws No exceptions.
+  void _select_match(const std::size_t& index) noexcept;
+
+  /// @brief Nesting depth of transactions.
+  uint32 _transaction_depth;
+
+  /// @brief Rows to render when transaction commits, sorted
+  ///        non-overlapping ranges of first and last row.
+  std::vector<std::pair<uint32, uint32>> _transaction_render_rows;
+
+  /// @brief Tells if transaction changed lines, which need re-tokenization.
+  bool _transaction_changed_lines;
+
+  /// @brief Lines [first_row, end_row) changed by transaction, which
+  ///        replaced lines [first_row, old_end_row) before it.
+  uint32 _transaction_first_row;
+  uint32 _transaction_end_row;
+  uint32 _transaction_old_end_row;
+
+  /// @brief First and last rows shown in window.
+  std::pair<uint32, uint32> _visible_rows;
+
+  /// @brief Queues render update, or merges it into transaction.
+  /// @param command render update command.
+  /// @throws No exceptions.
+  void
+  _queue_render_update(const IncrementalRenderUpdateCommand& command) noexcept;
+
+  /// @brief Queues token cache update, or merges it into transaction.
+  /// @param command token cache update command.
+  /// @throws No exceptions.
+  void
+  _queue_token_cache_update(const TokenCacheUpdateCommand& command) noexcept;
+
+  /// @brief Merges rows into rows to render when transaction commits.
+  /// @param first_row index of first row.
+  /// @param last_row index of last row.
+  /// @throws No exceptions.
+  void _add_transaction_render_rows(const uint32& first_row,
+                                    const uint32& last_row) noexcept;
+
+  /// @brief Merges replacement of lines into lines changed by transaction.
+  /// @param row index of first replaced line.
+  /// @param count number of replaced lines.
+  /// @param new_count number of lines replacing them.
+  /// @throws No exceptions.
+  void _add_transaction_lines(const uint32& row,
+                              const uint32& count,
+                              const uint32& new_count) noexcept;
+
+  /// @brief Starts recording an edit, which changes lines
+  ///        [first_row, last_row). Lines can be inserted or erased by
+  ///        the edit after last_row - 1.
+  /// @param first_row index of first line edited.
+  /// @param last_row index after the last line edited.
+  /// @throws No exceptions.
+  void _begin_edit(const uint32& first_row, const uint32& last_row) noexcept;
+
+  /// @brief Finishes recording edit, and adds it to undo history.
+  /// @param kind kind of edit.
+  /// @throws No exceptions.
+  void _end_edit(const EditKind& kind) noexcept;
+
+  /// @brief Replaces lines for undo & redo, and queues token cache
+  ///        and render updates for them.
+  /// @param row index of first line to replace.
+  /// @param count number of lines to replace.
+  /// @param lines pieces of new lines.
+  /// @param cursor cursor position after replacing.
+  /// @throws No exceptions.
+  void _apply_edit(const uint32& row,
+                   const uint32& count,
+                   const std::vector<Piece>& lines,
+                   const std::pair<uint32, int32>& cursor) noexcept;
+
+  /// @brief Resets cursor, selection, history and searches, and stops
+  ///        background work on lines, before loading new lines.
+  /// @param filepath path to file of new lines, empty if there is none.
+  /// @throws No exceptions.
+  void _reset(const std::string& filepath) noexcept;
+
+  /// @brief Starts building trigram index of loaded large file,
+  ///        if it's enabled.
+  /// @throws No exceptions.
+  void _start_trigram_index() noexcept;
+
+  /// @brief Starts writing snapshot of lines to the file.
+  /// @return Returns false if a save is already running.
+  /// @throws No exceptions.
+  [[nodiscard]] bool _start_save() noexcept;
+
+  /// @brief Compacts text of lines when enough of it was replaced or
+  ///        erased, returning its memory. Not done while snapshots of
+  ///        lines are alive, as they hold the text.
+  /// @throws No exceptions.
+  void _compact_lines() noexcept;
+
   /// @brief Base function for moving cursor to left.
   ///        Public functions of Buffer do some additional operations
   ///        on top of this function.
@@ -400,6 +775,15 @@ private:
   /// @throws No exceptions.
   bool _base_move_cursor_to_next_word_end() noexcept;
 
+  /// @brief Sets target column from cursor position.
+  /// @throws No exceptions.
+  void _update_cursor_column_target() noexcept;
+
+  /// @brief Column nearest to target column, in cursor's line.
+  /// @return Returns cursor column.
+  /// @throws No exceptions.
+  [[nodiscard]] int32 _cursor_column_for_target() const noexcept;
+
   /// @brief Deletes selection from text buffer.
   /// @throws No exceptions.
   void _delete_selection() noexcept;
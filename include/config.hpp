@@ -1,7 +1,9 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include "types.hpp"
+#include "word_classes.hpp"
 
 typedef struct config
 {
@@ -21,6 +23,12 @@ typedef struct config
 
   std::string word_separators;
 
+  WordClasses word_classes;
+
+  uint32 large_file_threshold;
+
+  bool trigram_index;
+
   struct window
   {
     uint16 width, height;
@@ -45,9 +53,20 @@ typedef struct config
       keyword, preprocessor_directive, identifier, number, function, header;
   } cpp_token_colors;
 
+  struct bracket_colors
+  {
+    bool enabled;
+    std::vector<std::string> colors;
+  } bracket_colors;
+
   struct caret
   {
     std::string color, style;
     uint8 ibeam_width;
   } caret;
+
+  struct undo
+  {
+    uint32 memory_limit;
+  } undo;
 } config;
\ No newline at end of file
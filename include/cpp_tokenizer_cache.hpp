@@ -2,7 +2,12 @@
 
 #include <deque>
 #include <optional>
+#include <string>
+#include <utility>
 #include "../cpp-tokenizer/cpp_tokenizer.hpp"
+#include "bracket_index.hpp"
+#include "identifier_index.hpp"
+#include "identifier_postings.hpp"
 //#include "incremental_render_update.hpp"
 #include "types.hpp"
 
@@ -11,6 +16,7 @@
 class Buffer;
 
 struct IncrementalRenderUpdateCommand;
+struct TextMatch;
 
 /// @brief Token cache update command type.
 enum class TokenCacheUpdateCommandType
@@ -18,14 +24,31 @@ enum class TokenCacheUpdateCommandType
   /// @brief Re-tokenize whole line - row.
   RETOKENIZE_LINE,
 
-  /// @brief Insert new line after given row, and tokenize it.
+  /// @brief Insert new line after given row, and tokenize it. Only queued
+  ///        inside edits, which merge it into RETOKENIZE_LINES.
   INSERT_NEW_LINE_CACHE_AND_TOKENIZE,
 
   /// @brief Delete cache for line - row.
   DELETE_LINE_CACHE,
 
   /// @brief Delete cache for line from - start_row to end_row.
-  DELETE_LINES_CACHE
+  DELETE_LINES_CACHE,
+
+  /// @brief Replace cache for lines from - start_row, before end_row with
+  ///        tokens of line_count lines now there. Batched edits queue one
+  ///        of these for all lines they changed.
+  RETOKENIZE_LINES
+};
+
+/// @brief State of lexer at start (or end) of a line. Lines continuing a
+///        token from lines before them are tokenized starting in it.
+enum class LineLexerState : uchar8
+{
+  /// @brief Not inside a token spanning lines.
+  NONE,
+
+  /// @brief Inside a multiline comment.
+  MULTILINE_COMMENT
 };
 
 /// @brief Token cache update command.
@@ -45,8 +68,13 @@ struct TokenCacheUpdateCommand
   uint32 start_row;
 
   /// @brief Ending row to delete lines cache (for DELETE_LINES_CACHE
-  ///        command type).
+  ///        command type), row after last replaced line (for
+  ///        RETOKENIZE_LINES command type).
   uint32 end_row;
+
+  /// @brief Number of lines replacing them (for RETOKENIZE_LINES
+  ///        command type).
+  uint32 line_count;
 };
 
 class CppTokenizerCache
@@ -54,21 +82,82 @@ class CppTokenizerCache
 public:
   CppTokenizerCache() = default;
 
-  /// @brief Builds intial token cache for all lines in buffer.
-  ///        This is an EXPENSIVE operation! Consumes lot of memory to store
-  ///        the tokens, and maybe blocks the UI for some milliseconds.
-  ///        Better offload this to another thread.
-  ///        TODO: Deprecate this function, build cache incrementally!
-  /// @param buffer const reference to buffer.
+  /// @brief Resets token cache for a newly loaded buffer.
+  ///        Lines are tokenized on demand with build_cache_till(),
+  ///        so opening large files doesn't block the UI, the buffer is
+  ///        not read here.
+  /// @param buffer const reference to buffer, unused.
   /// @throws No exceptions.
   void build_cache(const Buffer& buffer) noexcept;
 
+  /// @brief Tokenizes lines not yet in token cache, till the given row.
+  ///        Lines are tokenized in order, as tokens of a line depend on
+  ///        the lines before it (multiline comments). Tokenized lines
+  ///        till the row, left tokenized in an outdated state by edits
+  ///        before them, are tokenized again.
+  /// @param buffer const reference to buffer.
+  /// @param row index of last line to tokenize, clamped to buffer length.
+  /// @throws No exceptions.
+  void build_cache_till(const Buffer& buffer, const uint32& row) noexcept;
+
   /// @brief Incrementally updates the token cache
-  ///        from lines updated in buffer.
+  ///        from lines updated in buffer. Only edited lines are tokenized,
+  ///        lines after them whose state at start changed are tokenized
+  ///        again when they are needed (build_cache_till()).
   /// @param buffer const reference to buffer.
   /// @throws No exceptions.
   void update_cache(Buffer& buffer) noexcept;
 
+  /// @brief Gives counts of identifiers (and function names) in tokenized
+  ///        lines, kept up to date with them, for completion.
+  /// @throws No exceptions.
+  [[nodiscard]] const IdentifierIndex& identifiers() const noexcept;
+
+  /// @brief Gives identifier (or function name) under position in line.
+  /// @param row index of line.
+  /// @param column index of byte in line.
+  /// @return Returns std::nullopt if there is none, or line isn't
+  ///         tokenized.
+  /// @throws No exceptions.
+  [[nodiscard]] std::optional<std::string>
+  identifier_at(const uint32& row, const uint32& column) const noexcept;
+
+  /// @brief Finds occurrences of identifier (or function name) in
+  ///        tokenized lines, from its postings instead of scanning lines.
+  /// @param identifier identifier.
+  /// @param first_row index of first line to find them in.
+  /// @param last_row index of last line to find them in.
+  /// @param occurrences occurrences are appended to it, sorted by row
+  ///                    and column.
+  /// @throws No exceptions.
+  void find_identifier(const std::string& identifier,
+                       const uint32& first_row,
+                       const uint32& last_row,
+                       std::vector<TextMatch>& occurrences) noexcept;
+
+  /// @brief Gives nesting depth of brackets in tokenized lines.
+  /// @throws No exceptions.
+  [[nodiscard]] const BracketIndex& brackets() const noexcept;
+
+  /// @brief Finds bracket matching bracket at position, with nesting depth
+  ///        from bracket index, lines between them aren't scanned. Lines
+  ///        after tokenized ones are tokenized, in growing chunks, while
+  ///        looking for a closing bracket.
+  /// @param buffer const reference to buffer.
+  /// @param row index of line of bracket.
+  /// @param column index of byte of bracket in line.
+  /// @param last_row index of last line to look in.
+  /// @return Returns row and column of matching bracket, std::nullopt if
+  ///         there is no bracket at position, or it's unmatched. Brackets
+  ///         of all kinds nest together, a bracket paired by depth with
+  ///         one of another kind (like ( with ]) is unmatched.
+  /// @throws No exceptions.
+  [[nodiscard]] std::optional<std::pair<uint32, uint32>>
+  matching_bracket(const Buffer& buffer,
+                   const uint32& row,
+                   const uint32& column,
+                   const uint32& last_row) noexcept;
+
   /// @brief Gives tokens line-wise.
   /// @return const reference to lines of tokens.
   /// @throws No exceptions.
@@ -82,13 +171,132 @@ public:
   [[nodiscard]] const std::vector<CppTokenizer::Token>*
   tokens_for_line(const uint32& line_index) const noexcept;
 
+  /// @brief Gives text tokens of line are spans of, line with leading
+  ///        spaces converted to tabs (or as it is, if it continues a
+  ///        multiline comment). Line must be tokenized.
+  /// @param line_index index of line.
+  /// @throws No exceptions.
+  [[nodiscard]] const std::string&
+  text_for_line(const uint32& line_index) const noexcept;
+
   std::optional<IncrementalRenderUpdateCommand>
   get_next_incremental_render_update() noexcept;
 
 private:
-  /// @brief Token cache.
+  /// @brief Tokenizes line, without updating token cache.
+  /// @param buffer const reference to buffer.
+  /// @param row index of line.
+  /// @param state state of lexer at start of line.
+  /// @param text replaced with tokenized text of line.
+  /// @param tokens replaced with tokens of line.
+  /// @throws No exceptions.
+  void _tokenize_line(const Buffer& buffer,
+                      const uint32& row,
+                      const LineLexerState& state,
+                      std::string& text,
+                      std::vector<CppTokenizer::Token>& tokens) noexcept;
+
+  /// @brief Tokenizes line again, in state at end of line before it,
+  ///        replacing its tokens, updating identifier counts, postings and
+  ///        bracket index.
+  /// @param buffer const reference to buffer.
+  /// @param row index of line.
+  /// @throws No exceptions.
+  void _retokenize_line(const Buffer& buffer, const uint32& row) noexcept;
+
+  /// @brief Tokenizes again lines, from first stale line till end_row,
+  ///        whose state at start isn't the state they were tokenized in.
+  ///        Tokenizing stops going down at first line whose state at end
+  ///        didn't change, lines after it aren't tokenized.
+  /// @param buffer const reference to buffer.
+  /// @param end_row index after the last line, at most number of lines
+  ///                in token cache.
+  /// @throws No exceptions.
+  void _update_stale_lines(const Buffer& buffer,
+                           const uint32& end_row) noexcept;
+
+  /// @brief Gives state of lexer at start of line, state at end of line
+  ///        before it.
+  /// @param row index of line, line before it must be in token cache.
+  /// @throws No exceptions.
+  [[nodiscard]] LineLexerState _state_before(const uint32& row) const noexcept;
+
+  /// @brief Marks lines from row as possibly tokenized in an outdated
+  ///        state.
+  /// @param row index of line.
+  /// @throws No exceptions.
+  void _mark_stale(const uint32& row) noexcept;
+
+  /// @brief Erases tokens of lines [first_row, last_row), updating
+  ///        identifier counts, postings and bracket index.
+  /// @param first_row index of first line.
+  /// @param last_row index after the last line.
+  /// @throws No exceptions.
+  void _erase_line_tokens(const uint32& first_row,
+                          const uint32& last_row) noexcept;
+
+  /// @brief Tokenizes lines whose tokens are empty, in order, adding
+  ///        their identifiers to counts and postings, and their brackets
+  ///        to bracket index, at once.
+  /// @param buffer const reference to buffer.
+  /// @param first_row index of first line.
+  /// @param last_row index after the last line.
+  /// @throws No exceptions.
+  void _tokenize_lines(const Buffer& buffer,
+                       const uint32& first_row,
+                       const uint32& last_row) noexcept;
+
+  /// @brief Inserts empty tokens of lines, shifting postings after them
+  ///        and adding them to bracket index.
+  /// @param row index of first inserted line.
+  /// @param count number of inserted lines.
+  /// @throws No exceptions.
+  void _insert_line_tokens(const uint32& row, const uint32& count) noexcept;
+
+  /// @brief Gives index of first byte of token in line, tokens are of line
+  ///        with leading spaces converted to tabs.
+  /// @param row index of line.
+  /// @param index index of token.
+  /// @throws No exceptions.
+  [[nodiscard]] uint32 _token_column(const uint32& row,
+                                     const std::size_t& index) const noexcept;
+
+  /// @brief Counts (or uncounts) identifiers among tokens of a line.
+  /// @param text tokenized text of line.
+  /// @param tokens tokens of line.
+  /// @param add false to uncount them.
+  /// @throws No exceptions.
+  void _count_identifiers(const std::string& text,
+                          const std::vector<CppTokenizer::Token>& tokens,
+                          const bool& add) noexcept;
+
+  /// @brief Token cache, of lines from start of buffer.
+  ///        Lines after these are not tokenized yet, edits to them
+  ///        don't need cache updates.
   std::vector<std::vector<CppTokenizer::Token>> _tokens;
 
+  /// @brief Tokenized text of lines in token cache, tokens are spans of
+  ///        it.
+  std::vector<std::string> _texts;
+
+  /// @brief State of lexer each line in token cache was tokenized in, at
+  ///        its start. State at its end is given by its last token.
+  std::vector<LineLexerState> _states;
+
+  /// @brief Index of first line which may have been tokenized in a state
+  ///        other than state at end of line before it, lines before it
+  ///        are up to date.
+  uint32 _stale_row;
+
+  /// @brief Identifiers of tokenized lines.
+  IdentifierIndex _identifiers;
+
+  /// @brief Lines containing each identifier, of tokenized lines.
+  IdentifierPostings _postings;
+
+  /// @brief Nesting depth of brackets, of tokenized lines.
+  BracketIndex _brackets;
+
   /// @brief CPP Tokenizer.
   CppTokenizer::Tokenizer _tokenizer;
 
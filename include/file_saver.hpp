@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "piece_table.hpp"
+#include "types.hpp"
+
+/// @brief Writes lines to a file on a background thread.
+///        Lines are written to a temporary file next to the file, which is
+///        flushed to disk and then renamed over the file, so a crash while
+///        saving never leaves a half written file behind. On Windows a
+///        memory mapped file is renamed aside first, as it can't be
+///        replaced while mapped.
+///        Lines are read from a snapshot, so they can be edited meanwhile.
+class FileSaver
+{
+public:
+  /// @brief Creates idle file saver.
+  /// @throws No exceptions.
+  FileSaver() noexcept;
+
+  FileSaver(const FileSaver& saver) = delete;
+  FileSaver& operator=(const FileSaver& saver) = delete;
+
+  /// @brief Waits for saving to complete, if running.
+  /// @throws No exceptions.
+  ~FileSaver() noexcept;
+
+  /// @brief Starts writing lines to file on background thread.
+  /// @param filepath path to file.
+  /// @param lines snapshot of lines to write.
+  /// @param line_ending line ending written between lines.
+  /// @return Returns false if a save is already running.
+  /// @throws No exceptions.
+  [[nodiscard]] bool start(const std::string& filepath,
+                           PieceTableSnapshot&& lines,
+                           const std::string_view& line_ending) noexcept;
+
+  /// @brief Waits for saving to complete.
+  /// @throws No exceptions.
+  void wait() noexcept;
+
+  /// @brief Tells if saving is running.
+  /// @return Returns true while lines are being written.
+  /// @throws No exceptions.
+  [[nodiscard]] bool saving() const noexcept;
+
+  /// @brief Progress of running save.
+  /// @return Returns fraction of bytes written, from 0 to 1.
+  /// @throws No exceptions.
+  [[nodiscard]] float32 progress() const noexcept;
+
+  /// @brief Gives result of completed save, only once.
+  /// @return Returns std::nullopt if saving is running or no save
+  ///         completed since last call, else returns true if file is saved.
+  /// @throws No exceptions.
+  [[nodiscard]] std::optional<bool> get_result() noexcept;
+
+private:
+  /// @brief Thread writing the lines.
+  std::thread _thread;
+
+  /// @brief Set while lines are being written.
+  std::atomic<bool> _saving;
+
+  /// @brief Result of last save.
+  std::atomic<bool> _saved;
+
+  /// @brief Tells if result of last save is not taken yet.
+  bool _result_pending;
+
+  /// @brief Bytes written in running save.
+  std::atomic<std::size_t> _bytes_written;
+
+  /// @brief Bytes to write in running save.
+  std::size_t _bytes_total;
+
+  /// @brief Writes lines to temporary file, flushes it and renames it
+  ///        over the file.
+  /// @return Returns false if unable to write or replace the file.
+  /// @throws No exceptions.
+  [[nodiscard]] bool _write(const std::string& filepath,
+                            const std::vector<Piece>& lines,
+                            const std::string& line_ending) noexcept;
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "types.hpp"
+
+/// @brief Counts of identifiers in tokenized lines, for completing
+///        identifiers by prefix without scanning lines. Identifiers are
+///        kept in a trie, its nodes live in one vector and siblings are
+///        linked in order of their byte, so completions come out sorted.
+///        Nodes of removed identifiers are kept, and skipped while their
+///        subtree is empty.
+class IdentifierIndex
+{
+public:
+  /// @brief Creates empty index.
+  /// @throws No exceptions.
+  IdentifierIndex() noexcept;
+
+  /// @brief Counts an occurrence of identifier.
+  /// @param identifier identifier.
+  /// @throws No exceptions.
+  void add(std::string_view identifier) noexcept;
+
+  /// @brief Uncounts an occurrence of identifier, which must be counted.
+  /// @param identifier identifier.
+  /// @throws No exceptions.
+  void remove(std::string_view identifier) noexcept;
+
+  /// @brief Removes all identifiers.
+  /// @throws No exceptions.
+  void clear() noexcept;
+
+  /// @brief Number of distinct identifiers counted.
+  /// @throws No exceptions.
+  [[nodiscard]] std::size_t size() const noexcept;
+
+  /// @brief Gives identifiers starting with prefix, longer than it.
+  /// @param prefix start of identifiers.
+  /// @param max_count maximum number of identifiers to give.
+  /// @param completions identifiers are appended to it, in sorted order.
+  /// @throws No exceptions.
+  void complete(std::string_view prefix,
+                const std::size_t& max_count,
+                std::vector<std::string>& completions) const noexcept;
+
+private:
+  /// @brief Node of trie, for byte of identifier after its parent's.
+  struct Node
+  {
+    /// @brief Byte of identifier.
+    char byte;
+
+    /// @brief Index of child with smallest byte, 0 if there is none.
+    uint32 first_child;
+
+    /// @brief Index of sibling with next larger byte, 0 if there is none.
+    uint32 next_sibling;
+
+    /// @brief Occurrences of identifier ending at this node.
+    uint32 count;
+
+    /// @brief Occurrences of identifiers ending in subtree of this node.
+    uint32 subtree_count;
+  };
+
+  /// @brief Nodes of trie, first one is the root.
+  std::vector<Node> _nodes;
+
+  /// @brief Number of distinct identifiers counted.
+  std::size_t _size;
+
+  /// @brief Finds node of identifier or prefix.
+  /// @param text identifier or prefix.
+  /// @return Returns 0 if it isn't in trie, or text is empty.
+  /// @throws No exceptions.
+  [[nodiscard]] uint32 _find(std::string_view text) const noexcept;
+
+  /// @brief Appends identifiers in subtree of node, in sorted order.
+  /// @param node index of node.
+  /// @param text bytes of identifiers before node, bytes of subtree are
+  ///             appended to it while collecting.
+  /// @param max_size completions stop growing at this size.
+  /// @param completions identifiers are appended to it.
+  /// @throws No exceptions.
+  void _collect(const uint32& node,
+                std::string& text,
+                const std::size_t& max_size,
+                std::vector<std::string>& completions) const noexcept;
+};
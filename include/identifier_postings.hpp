@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <span>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "../cpp-tokenizer/cpp_tokenizer.hpp"
+#include "types.hpp"
+
+/// @brief Lines containing each identifier (and function name), for
+///        finding all occurrences of an identifier without scanning lines.
+///        Identifiers are interned, each has a sorted postings list of
+///        rows. Lines inserted or erased before rows of a list shift them,
+///        shifts are logged and applied to a list when it's next used, so
+///        an edit doesn't touch every list.
+class IdentifierPostings
+{
+public:
+  /// @brief Creates empty postings.
+  /// @throws No exceptions.
+  IdentifierPostings() noexcept;
+
+  /// @brief Removes all identifiers.
+  /// @throws No exceptions.
+  void clear() noexcept;
+
+  /// @brief Adds rows of lines to postings of identifiers among their
+  ///        tokens. Rows of each identifier are inserted into its
+  ///        postings at once.
+  /// @param first_row index of first line.
+  /// @param texts tokenized text of lines.
+  /// @param lines tokens of lines, not in postings.
+  /// @throws No exceptions.
+  void add_lines(
+    const uint32& first_row,
+    std::span<const std::string> texts,
+    std::span<const std::vector<CppTokenizer::Token>> lines) noexcept;
+
+  /// @brief Removes rows of lines from postings of identifiers among their
+  ///        tokens, the tokens they were added with.
+  /// @param first_row index of first line.
+  /// @param texts tokenized text of lines.
+  /// @param lines tokens of lines.
+  /// @throws No exceptions.
+  void remove_lines(
+    const uint32& first_row,
+    std::span<const std::string> texts,
+    std::span<const std::vector<CppTokenizer::Token>> lines) noexcept;
+
+  /// @brief Updates postings of line whose tokens changed, only
+  ///        identifiers added to (or removed from) line are updated.
+  /// @param row index of line.
+  /// @param old_text tokenized text line was added with.
+  /// @param old_tokens tokens line was added with.
+  /// @param new_text new tokenized text of line.
+  /// @param new_tokens new tokens of line.
+  /// @throws No exceptions.
+  void replace_line(
+    const uint32& row,
+    const std::string& old_text,
+    const std::vector<CppTokenizer::Token>& old_tokens,
+    const std::string& new_text,
+    const std::vector<CppTokenizer::Token>& new_tokens) noexcept;
+
+  /// @brief Shifts rows after lines [row, row + count) are replaced by
+  ///        new_count lines. Replaced lines must be removed before.
+  /// @param row index of first replaced line.
+  /// @param count number of replaced lines.
+  /// @param new_count number of lines replacing them.
+  /// @throws No exceptions.
+  void shift_rows(const uint32& row,
+                  const uint32& count,
+                  const uint32& new_count) noexcept;
+
+  /// @brief Gives rows of lines containing identifier.
+  /// @param identifier identifier.
+  /// @return Returns sorted rows, valid till postings are next changed.
+  /// @throws No exceptions.
+  [[nodiscard]] const std::vector<uint32>&
+  rows(const std::string& identifier) noexcept;
+
+private:
+  /// @brief Rows containing an identifier.
+  struct Postings
+  {
+    /// @brief Sorted rows of lines.
+    std::vector<uint32> rows;
+
+    /// @brief Number of logged shifts applied to rows.
+    std::size_t applied_shifts;
+
+    /// @brief Last batch of lines added (or removed) touching it.
+    std::size_t batch;
+
+    /// @brief Number of rows added in batch, then index of next one.
+    std::size_t batch_position;
+  };
+
+  /// @brief Hash of identifiers, looking up views of them without
+  ///        copying them to strings.
+  struct IdentifierHash
+  {
+    using is_transparent = void;
+
+    std::size_t operator()(std::string_view identifier) const noexcept
+    {
+      return std::hash<std::string_view>()(identifier);
+    }
+  };
+
+  /// @brief Index of postings of each identifier.
+  std::unordered_map<std::string, uint32, IdentifierHash, std::equal_to<>>
+    _ids;
+
+  /// @brief Postings, by index.
+  std::vector<Postings> _postings;
+
+  /// @brief Logged shifts, as row, count and new count of replaced lines.
+  std::vector<std::tuple<uint32, uint32, uint32>> _shifts;
+
+  /// @brief Number of batches of lines added (or removed).
+  std::size_t _batches;
+
+  /// @brief Interned indices of identifiers and rows of lines containing
+  ///        them, in order of rows, reused.
+  std::vector<std::pair<uint32, uint32>> _id_rows;
+
+  /// @brief Interned indices of identifiers touched by a batch, and of
+  ///        identifiers in old and new tokens of a line, reused.
+  std::vector<uint32> _batch_ids, _old_ids, _new_ids;
+
+  /// @brief Gives distinct interned indices of identifiers among tokens,
+  ///        sorted, interning new identifiers.
+  /// @param text tokenized text of line.
+  /// @param tokens tokens of line.
+  /// @param ids replaced with indices.
+  /// @throws No exceptions.
+  void _collect_ids(const std::string& text,
+                    const std::vector<CppTokenizer::Token>& tokens,
+                    std::vector<uint32>& ids) noexcept;
+
+  /// @brief Gives interned index of identifier, interning it if new.
+  /// @param identifier identifier.
+  /// @throws No exceptions.
+  [[nodiscard]] uint32 _intern(std::string_view identifier) noexcept;
+
+  /// @brief Applies logged shifts to rows of postings.
+  /// @param postings postings.
+  /// @throws No exceptions.
+  void _apply_shifts(Postings& postings) noexcept;
+};
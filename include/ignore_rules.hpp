@@ -0,0 +1,74 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// @brief Patterns of a .gitignore file, applied to paths under its
+///        directory. Rules of parent directories are chained, patterns of
+///        deeper files take precedence, and later patterns of a file
+///        take precedence over earlier ones, as in git.
+class IgnoreRules
+{
+public:
+  /// @brief Creates rules without patterns.
+  /// @param parent rules of parent directories, can be nullptr.
+  /// @param directory path of directory of rules, relative to root of
+  ///                  search, with trailing '/' (empty for root).
+  /// @throws No exceptions.
+  IgnoreRules(std::shared_ptr<const IgnoreRules> parent,
+              const std::string& directory) noexcept;
+
+  /// @brief Reads patterns of .gitignore file.
+  /// @param filepath path to .gitignore file.
+  /// @return Returns false if unable to read the file.
+  /// @throws No exceptions.
+  [[nodiscard]] bool load(const std::string& filepath) noexcept;
+
+  /// @brief Tells if file or directory is ignored.
+  /// @param path path relative to root of search, without trailing '/'.
+  /// @param directory true if path is a directory.
+  /// @return Returns true if last matching pattern isn't negated.
+  /// @throws No exceptions.
+  [[nodiscard]] bool ignored(std::string_view path,
+                             const bool& directory) const noexcept;
+
+private:
+  /// @brief Pattern of a line of .gitignore file.
+  struct Pattern
+  {
+    /// @brief Glob, without '!', leading and trailing '/'.
+    std::string glob;
+
+    /// @brief Tells if pattern starts with '!', re-including paths.
+    bool negated;
+
+    /// @brief Tells if pattern ends with '/', matching only directories.
+    bool directory_only;
+
+    /// @brief Tells if pattern has a '/' before its end, then it's matched
+    ///        with path relative to directory of rules, else with name.
+    bool anchored;
+  };
+
+  /// @brief Rules of parent directories.
+  std::shared_ptr<const IgnoreRules> _parent;
+
+  /// @brief Path of directory of rules, with trailing '/'.
+  std::string _directory;
+
+  /// @brief Patterns, in order of lines.
+  std::vector<Pattern> _patterns;
+
+  /// @brief Matches glob with text. '*' matches any characters except '/',
+  ///        '**' matches any characters, "**/" matches zero or more
+  ///        directories, '?' matches a character except '/', "[a-z]" and
+  ///        "[!a-z]" match classes, '\' escapes a character.
+  /// @param glob glob.
+  /// @param text text.
+  /// @return Returns true if whole text matches.
+  /// @throws No exceptions.
+  [[nodiscard]] static bool _match(std::string_view glob,
+                                   std::string_view text) noexcept;
+};
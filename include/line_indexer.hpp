@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+#include "piece_table.hpp"
+#include "types.hpp"
+
+/// @brief Lines indexed from a part of text.
+struct LineBatch
+{
+  /// @brief Pieces of lines, in order.
+  std::vector<Piece> pieces;
+
+  /// @brief Storage of lines whose tabs are expanded, pieces of
+  ///        those lines point into these slabs.
+  std::vector<std::unique_ptr<char[]>> slabs;
+
+  /// @brief Number of lines ending with "\r\n", the '\r' is not
+  ///        part of their pieces.
+  std::size_t crlf_line_endings = 0;
+
+  /// @brief Number of lines ending with "\n".
+  std::size_t lf_line_endings = 0;
+
+  /// @brief Tells if text of lines is valid UTF-8.
+  bool valid_utf8 = true;
+};
+
+/// @brief Splits text into lines, on a background thread.
+///        Lines are published in batches, which are taken by the main
+///        thread with get_next_batch(). Text must stay valid (and unchanged)
+///        until indexing is done or cancelled.
+class LineIndexer
+{
+public:
+  /// @brief Creates idle line indexer.
+  /// @throws No exceptions.
+  LineIndexer() noexcept;
+
+  LineIndexer(const LineIndexer& indexer) = delete;
+  LineIndexer& operator=(const LineIndexer& indexer) = delete;
+
+  /// @brief Cancels indexing, if running.
+  /// @throws No exceptions.
+  ~LineIndexer() noexcept;
+
+  /// @brief Indexes lines of text synchronously, starting from offset,
+  ///        until atleast bytes_limit bytes are indexed or text ends.
+  ///        Text is scanned once, with SIMD where available, finding line
+  ///        ends, tabs and validating UTF-8. CR of CRLF line endings is
+  ///        dropped. Tabs are expanded to spaces, such lines are copied
+  ///        into slabs of batch, other lines point into the text.
+  /// @param text pointer to text.
+  /// @param size size of text in bytes.
+  /// @param offset offset of first line to index, set to offset of
+  ///               first line not indexed.
+  /// @param bytes_limit number of bytes after which indexing stops,
+  ///                    indexing always stops at end of line.
+  /// @param tab_width number of spaces a tab is expanded into.
+  /// @param batch batch to which lines are appended.
+  /// @return Returns true if the last line of text is indexed.
+  /// @throws No exceptions.
+  static bool index_lines(const char* text,
+                          const std::size_t& size,
+                          std::size_t& offset,
+                          const std::size_t& bytes_limit,
+                          const uint8& tab_width,
+                          LineBatch& batch) noexcept;
+
+  /// @brief Starts indexing lines of text from offset on background thread.
+  ///        Cancels previous indexing, if running.
+  /// @param text pointer to text.
+  /// @param size size of text in bytes.
+  /// @param offset offset of first line to index.
+  /// @param tab_width number of spaces a tab is expanded into.
+  /// @throws No exceptions.
+  void start(const char* text,
+             const std::size_t& size,
+             const std::size_t& offset,
+             const uint8& tab_width) noexcept;
+
+  /// @brief Stops indexing and drops batches not taken yet.
+  /// @throws No exceptions.
+  void cancel() noexcept;
+
+  /// @brief Waits till all lines are indexed.
+  /// @throws No exceptions.
+  void wait() noexcept;
+
+  /// @brief Tells if there are lines yet to be taken.
+  /// @return Returns false when all lines are indexed and taken.
+  /// @throws No exceptions.
+  [[nodiscard]] bool running() const noexcept;
+
+  /// @brief Gives next batch of indexed lines.
+  /// @return Returns std::nullopt if no batch is ready.
+  /// @throws No exceptions.
+  [[nodiscard]] std::optional<LineBatch> get_next_batch() noexcept;
+
+private:
+  /// @brief Thread indexing the lines.
+  std::thread _thread;
+
+  /// @brief Set to stop the indexing thread.
+  std::atomic<bool> _cancelled;
+
+  /// @brief Set by indexing thread after publishing last batch.
+  std::atomic<bool> _finished;
+
+  /// @brief Guards batches queue.
+  mutable std::mutex _batches_mutex;
+
+  /// @brief Indexed batches, not yet taken by main thread.
+  std::deque<LineBatch> _batches;
+};
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "types.hpp"
+
+/// @brief Grapheme clusters and display widths of a line.
+///        Columns are byte columns as used by the cursor: column c is after
+///        the byte at index c, -1 is start of line. Cells are monospace
+///        cells, wide characters (CJK, emoji) take two cells.
+///        Pure ASCII lines take the fast path, one byte is one cell and
+///        nothing is stored for them.
+class LineLayout
+{
+public:
+  /// @brief Creates layout of empty line.
+  /// @throws No exceptions.
+  LineLayout() noexcept;
+
+  /// @brief Creates layout of the given line.
+  /// @param line text of line.
+  /// @throws No exceptions.
+  explicit LineLayout(const std::string_view& line) noexcept;
+
+  /// @brief Tells if line is pure ASCII.
+  /// @throws No exceptions.
+  [[nodiscard]] bool is_ascii() const noexcept;
+
+  /// @brief Length of line, in bytes.
+  /// @throws No exceptions.
+  [[nodiscard]] std::size_t length() const noexcept;
+
+  /// @brief Width of line, in cells.
+  /// @throws No exceptions.
+  [[nodiscard]] uint32 width() const noexcept;
+
+  /// @brief Cells before the cursor at column. Costs O(1).
+  /// @param column cursor column, clamped to line.
+  /// @return Returns number of cells before column.
+  /// @throws No exceptions.
+  [[nodiscard]] uint32 cells_before(const int32& column) const noexcept;
+
+  /// @brief Column of cursor at a cell. Costs O(1).
+  /// @param cells number of cells before cursor, if it falls inside a wide
+  ///              character, cursor is placed before the character.
+  /// @return Returns cursor column, clamped to end of line.
+  /// @throws No exceptions.
+  [[nodiscard]] int32 column_at(const uint32& cells) const noexcept;
+
+  /// @brief Column of cursor moved one grapheme cluster left.
+  /// @param column cursor column, must be > -1.
+  /// @throws No exceptions.
+  [[nodiscard]] int32 previous_column(const int32& column) const noexcept;
+
+  /// @brief Column of cursor moved one grapheme cluster right.
+  /// @param column cursor column, must be before end of line.
+  /// @throws No exceptions.
+  [[nodiscard]] int32 next_column(const int32& column) const noexcept;
+
+  /// @brief Width of text in cells, without building its layout.
+  /// @param text UTF-8 text.
+  /// @return Returns number of cells text takes.
+  /// @throws No exceptions.
+  [[nodiscard]] static uint32 width_of(const std::string_view& text) noexcept;
+
+  /// @brief Finds end of grapheme cluster starting at a byte, for drawing
+  ///        text a cluster at a time. An invalid UTF-8 byte is a cluster
+  ///        of its own.
+  /// @param text UTF-8 text.
+  /// @param start index of first byte of cluster, before end of text.
+  /// @param cells set to cells cluster takes.
+  /// @return Returns index of byte after cluster.
+  /// @throws No exceptions.
+  [[nodiscard]] static std::size_t cluster_end(const std::string_view& text,
+                                               const std::size_t& start,
+                                               uint32& cells) noexcept;
+
+private:
+  /// @brief Tells if line is pure ASCII, other members are empty then.
+  bool _ascii;
+
+  /// @brief Length of line, in bytes.
+  std::size_t _length;
+
+  /// @brief Width of line, in cells.
+  uint32 _width;
+
+  /// @brief Byte index where each cluster starts, followed by length.
+  std::vector<uint32> _cluster_starts;
+
+  /// @brief Cells before each cluster, followed by width.
+  std::vector<uint32> _cluster_cells;
+
+  /// @brief Cluster of each byte.
+  std::vector<uint32> _byte_clusters;
+
+  /// @brief Cluster of each cell.
+  std::vector<uint32> _cell_clusters;
+};
+
+/// @brief Cache of line layouts, keyed by address of line's text.
+///        Text of piece table lines is never modified, an edited line gets
+///        new text, so only edited lines miss the cache. Clear it when
+///        buffers of lines are freed (file is reloaded).
+class LineLayoutCache
+{
+public:
+  /// @brief Gives layout of line, building it on a miss.
+  /// @param line text of line, pointing into piece table buffers.
+  /// @return Returns reference valid until next call.
+  /// @throws No exceptions.
+  [[nodiscard]] const LineLayout& layout(const std::string_view& line) noexcept;
+
+  /// @brief Removes all layouts.
+  /// @throws No exceptions.
+  void clear() noexcept;
+
+private:
+  /// @brief Layouts of lines.
+  std::unordered_map<const char*, LineLayout> _layouts;
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/// @brief Read-only memory mapping of a file.
+class MappedFile
+{
+public:
+  /// @brief Creates an empty mapping, open() maps a file.
+  /// @throws No exceptions.
+  MappedFile() noexcept;
+
+  MappedFile(const MappedFile& file) = delete;
+  MappedFile& operator=(const MappedFile& file) = delete;
+
+  /// @brief Moves mapping from other file, other file becomes empty.
+  /// @throws No exceptions.
+  MappedFile(MappedFile&& file) noexcept;
+
+  /// @brief Unmaps current file and moves mapping from other file.
+  /// @throws No exceptions.
+  MappedFile& operator=(MappedFile&& file) noexcept;
+
+  /// @brief Unmaps the file.
+  /// @throws No exceptions.
+  ~MappedFile() noexcept;
+
+  /// @brief Maps whole file into memory, read-only.
+  /// @param filepath path to file.
+  /// @return Returns false if unable to open or map the file.
+  /// @throws No exceptions.
+  [[nodiscard]] bool open(const std::string& filepath) noexcept;
+
+  /// @brief Unmaps the file, if mapped.
+  /// @throws No exceptions.
+  void close() noexcept;
+
+  /// @brief Tells if a file is mapped.
+  /// @return Returns false if no file is mapped.
+  /// @throws No exceptions.
+  [[nodiscard]] bool is_open() const noexcept;
+
+  /// @brief Contents of mapped file.
+  /// @return Returns pointer to first byte, nullptr for empty files.
+  /// @throws No exceptions.
+  [[nodiscard]] const char* data() const noexcept;
+
+  /// @brief Size of mapped file.
+  /// @return Returns size of file in bytes.
+  /// @throws No exceptions.
+  [[nodiscard]] std::size_t size() const noexcept;
+
+private:
+  /// @brief Pointer to mapped contents.
+  const char* _data;
+
+  /// @brief Size of mapped contents.
+  std::size_t _size;
+
+  /// @brief Tells if a file is open (empty files are not mapped).
+  bool _open;
+
+#if defined(WIN32) || defined(_WIN32) || defined(_WIN64)
+  /// @brief File handle, kept open while file is mapped.
+  void* _file_handle;
+
+  /// @brief File mapping handle.
+  void* _mapping_handle;
+#endif
+};
@@ -0,0 +1,430 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "mapped_file.hpp"
+#include "types.hpp"
+
+/// @brief Piece - span of one line's text inside the original buffer or
+///        the add buffer of piece table. Doesn't include the newline.
+struct Piece
+{
+  /// @brief Pointer to first character of line.
+  const char* data;
+
+  /// @brief Length of line (without newline character).
+  std::size_t length;
+};
+
+struct LineBatch;
+
+class PieceTableSnapshot;
+
+/// @brief Line oriented piece table.
+///        Text of file is kept in an immutable original buffer, and text of
+///        edited lines is appended to an append-only add buffer. Lines are
+///        pieces pointing into these buffers, stored in a counted B+tree, so
+///        looking up a line, inserting lines and deleting lines cost
+///        O(log n) instead of shifting all the lines after it.
+///        Nodes and buffers are shared with snapshots, a node shared with
+///        a snapshot is copied before it is modified (copy on write).
+class PieceTable
+{
+public:
+  /// @brief Creates piece table with one empty line.
+  /// @throws No exceptions.
+  PieceTable() noexcept;
+
+  /// @brief Creates piece table with the given lines.
+  /// @param lines const reference to vector of strings.
+  /// @throws No exceptions.
+  explicit PieceTable(const std::vector<std::string>& lines) noexcept;
+
+  PieceTable(const PieceTable& table) = delete;
+  PieceTable& operator=(const PieceTable& table) = delete;
+
+  PieceTable(PieceTable&& table) noexcept = default;
+  PieceTable& operator=(PieceTable&& table) noexcept = default;
+
+  ~PieceTable() = default;
+
+  /// @brief Replaces contents of piece table with the given text,
+  ///        which becomes the original buffer.
+  /// @param text text of file, ownership is taken by piece table.
+  /// @param size size of text in bytes.
+  /// @param batch lines of text, atleast one, pieces point into text
+  ///              or slabs of batch.
+  /// @throws No exceptions.
+  void load(std::unique_ptr<char[]> text,
+            const std::size_t& size,
+            LineBatch&& batch) noexcept;
+
+  /// @brief Replaces contents of piece table with the given mapped file,
+  ///        which becomes the original buffer. Lines not yet indexed can
+  ///        be added later with append_lines().
+  /// @param file mapped file, ownership is taken by piece table.
+  /// @param batch lines of file, atleast one, pieces point into file
+  ///              or slabs of batch.
+  /// @throws No exceptions.
+  void load(MappedFile&& file, LineBatch&& batch) noexcept;
+
+  /// @brief Appends lines at end, taking ownership of slabs of batch.
+  /// @param batch lines to append, pieces point into original buffer
+  ///              or slabs of batch.
+  /// @throws No exceptions.
+  void append_lines(LineBatch&& batch) noexcept;
+
+  /// @brief Tells if original buffer is a mapped file.
+  /// @return Returns true if lines were loaded from a mapped file.
+  /// @throws No exceptions.
+  [[nodiscard]] bool is_mapped() const noexcept;
+
+  /// @brief Version of text, incremented by every modification.
+  /// @throws No exceptions.
+  [[nodiscard]] std::uint64_t version() const noexcept;
+
+  /// @brief Takes an immutable snapshot of lines in O(1), which can be
+  ///        read on another thread while piece table is modified.
+  ///        Nodes are shared until they are modified, text buffers are
+  ///        kept alive by snapshot.
+  /// @throws No exceptions.
+  [[nodiscard]] PieceTableSnapshot snapshot() const noexcept;
+
+  /// @brief Number of lines.
+  /// @return Returns number of lines in piece table.
+  /// @throws No exceptions.
+  [[nodiscard]] uint32 size() const noexcept;
+
+  /// @brief Total size of text, excluding newline characters.
+  /// @return Returns sum of lengths of all lines.
+  /// @throws No exceptions.
+  [[nodiscard]] std::size_t bytes() const noexcept;
+
+  /// @brief Length of longest line.
+  /// @return Returns length of longest line, excluding newline character.
+  /// @throws No exceptions.
+  [[nodiscard]] std::size_t max_line_length() const noexcept;
+
+  /// @brief Offset of start of line in text, where each line is followed
+  ///        by a newline character. Costs O(log n).
+  /// @param row index of line, clamped to size().
+  /// @return Returns offset of first character of line.
+  /// @throws No exceptions.
+  [[nodiscard]] std::size_t offset_of(const uint32& row) const noexcept;
+
+  /// @brief Position of offset in text, where each line is followed by a
+  ///        newline character. Costs O(log n).
+  /// @param offset offset in text, clamped to end of text.
+  /// @return Returns pair of row and index of character in line,
+  ///         index equal to line length is the newline.
+  /// @throws No exceptions.
+  [[nodiscard]] std::pair<uint32, std::size_t>
+  position_of(std::size_t offset) const noexcept;
+
+  /// @brief Gives text of line. Check row before query.
+  ///        The view stays valid until piece table is reloaded or compacted.
+  /// @param row index of line.
+  /// @return Returns view of line's text.
+  /// @throws No exceptions.
+  [[nodiscard]] std::string_view operator[](const uint32& row) const noexcept;
+
+  /// @brief Gives pieces of all lines, in order. Text of pieces stays
+  ///        valid until piece table is reloaded or compacted, as buffers
+  ///        are never modified.
+  /// @return Returns copy of pieces.
+  /// @throws No exceptions.
+  [[nodiscard]] std::vector<Piece> pieces() const noexcept;
+
+  /// @brief Gives pieces of lines in range [first_row, last_row).
+  /// @param first_row index of first line.
+  /// @param last_row index after the last line, clamped to size().
+  /// @return Returns copy of pieces.
+  /// @throws No exceptions.
+  [[nodiscard]] std::vector<Piece>
+  pieces(const uint32& first_row, const uint32& last_row) const noexcept;
+
+  /// @brief Replaces text of line, the text is copied to add buffer.
+  /// @param row index of line.
+  /// @param text new text of line (without newline character).
+  /// @throws No exceptions.
+  void set_line(const uint32& row, std::string_view text) noexcept;
+
+  /// @brief Inserts a line before the given row.
+  /// @param row index at which the line is inserted, can be size().
+  /// @param text text of line (without newline character).
+  /// @throws No exceptions.
+  void insert_line(const uint32& row, std::string_view text) noexcept;
+
+  /// @brief Inserts lines before the given row.
+  /// @param row index at which the lines are inserted, can be size().
+  /// @param lines texts of lines (without newline characters).
+  /// @throws No exceptions.
+  void insert_lines(const uint32& row,
+                    const std::vector<std::string_view>& lines) noexcept;
+
+  /// @brief Erases lines in range [first_row, last_row).
+  /// @param first_row index of first line to erase.
+  /// @param last_row index after the last line to erase.
+  /// @throws No exceptions.
+  void erase_lines(const uint32& first_row, const uint32& last_row) noexcept;
+
+  /// @brief Copies text to add buffer, without changing lines, for
+  ///        building pieces of new lines given to replace_lines().
+  /// @param text text of line (without newline character).
+  /// @return Returns piece pointing to the copied text.
+  /// @throws No exceptions.
+  [[nodiscard]] Piece add_text(std::string_view text) noexcept;
+
+  /// @brief Replaces count lines starting at row with the given pieces,
+  ///        in one batched update. Text of pieces is not copied, they must
+  ///        point into buffers of this piece table, like pieces given by
+  ///        pieces().
+  /// @param row index of first line to replace.
+  /// @param count number of lines to replace.
+  /// @param pieces pieces of new lines.
+  /// @throws No exceptions.
+  void replace_lines(const uint32& row,
+                     const uint32& count,
+                     const std::vector<Piece>& pieces) noexcept;
+
+  /// @brief Tells if enough text was replaced or erased since last
+  ///        compaction for compact() to be worth its cost, which is
+  ///        amortized over the bytes replaced. Buffers held by snapshots
+  ///        can't be freed, so it is false while snapshots are alive.
+  /// @throws No exceptions.
+  [[nodiscard]] bool should_compact() const noexcept;
+
+  /// @brief Copies text of lines into fresh add buffer slabs, freeing old
+  ///        slabs in bulk, so text of replaced and erased lines is returned
+  ///        to the system. Original buffer is freed too once most of it
+  ///        was erased, text of mapped files stays in place. Views and
+  ///        pieces given before are invalidated.
+  /// @param pieces pieces pointing into this piece table kept elsewhere
+  ///               (like in undo history), moved along with the lines.
+  /// @throws No exceptions.
+  void compact(const std::vector<Piece*>& pieces) noexcept;
+
+private:
+  friend class PieceTableSnapshot;
+
+  /// @brief B+tree node. Leaves hold pieces, internal nodes hold children.
+  struct Node
+  {
+    /// @brief Tells if node is leaf.
+    bool leaf;
+
+    /// @brief Number of lines in this subtree.
+    uint32 lines;
+
+    /// @brief Sum of line lengths in this subtree.
+    std::size_t bytes;
+
+    /// @brief Length of longest line in this subtree.
+    std::size_t max_length;
+
+    /// @brief Pieces of leaf node.
+    std::vector<Piece> pieces;
+
+    /// @brief Children of internal node, shared with snapshots.
+    std::vector<std::shared_ptr<Node>> children;
+  };
+
+  /// @brief Buffers holding text of lines. Replaced as a whole when
+  ///        reloading or compacting, snapshots keep the old ones alive.
+  struct TextBuffers
+  {
+    /// @brief Original buffer, contents of loaded file. Never modified.
+    std::shared_ptr<char[]> original;
+
+    /// @brief Size of original buffer.
+    std::size_t original_size = 0;
+
+    /// @brief Original buffer of large files, mapped instead of read.
+    std::shared_ptr<MappedFile> original_mapping;
+
+    /// @brief Add buffer slabs. Slabs are never reallocated, so pieces
+    ///        pointing into them stay valid while text is appended.
+    std::vector<std::unique_ptr<char[]>> add_slabs;
+  };
+
+  /// @brief Root of B+tree, never null.
+  std::shared_ptr<Node> _root;
+
+  /// @brief Buffers holding text of lines, never null.
+  std::shared_ptr<TextBuffers> _buffers;
+
+  /// @brief Version of text.
+  std::uint64_t _version;
+
+  /// @brief Bytes used in last add buffer slab.
+  std::size_t _add_slab_used;
+
+  /// @brief Capacity of last add buffer slab.
+  std::size_t _add_slab_capacity;
+
+  /// @brief Bytes of lines replaced or erased since last compaction,
+  ///        an upper bound of the text that compaction can free.
+  std::size_t _reclaimable_bytes;
+
+  /// @brief Bytes of text owned by piece table after last compaction
+  ///        (or load), the cost of next compaction.
+  std::size_t _compacted_bytes;
+
+  /// @brief Copies text to the end of add buffer.
+  /// @param text text to append.
+  /// @return Returns piece pointing to the appended text.
+  /// @throws No exceptions.
+  [[nodiscard]] Piece _append(std::string_view text) noexcept;
+
+  /// @brief Takes ownership of slabs holding text of pieces.
+  /// @param slabs slabs to add before the current add buffer slab.
+  /// @throws No exceptions.
+  void _adopt_slabs(std::vector<std::unique_ptr<char[]>>&& slabs) noexcept;
+
+  /// @brief Builds B+tree bottom-up from the given pieces.
+  /// @param pieces pieces of all lines, in order.
+  /// @throws No exceptions.
+  void _build(std::vector<Piece>&& pieces) noexcept;
+
+  /// @brief Gives node to modify, copying it first if it is shared with
+  ///        a snapshot.
+  /// @param node node, replaced by its copy if shared.
+  /// @return Returns node which isn't shared.
+  /// @throws No exceptions.
+  static Node* _unshare(std::shared_ptr<Node>& node) noexcept;
+
+  /// @brief Gives text of row in subtree.
+  /// @throws No exceptions.
+  [[nodiscard]] static std::string_view _line(const Node* node,
+                                              uint32 row) noexcept;
+
+  /// @brief Inserts pieces into subtree before the given row.
+  /// @throws No exceptions.
+  static void _insert(Node* node,
+                      uint32 row,
+                      const Piece* first,
+                      const Piece* last) noexcept;
+
+  /// @brief Erases rows [first_row, last_row) from subtree.
+  /// @throws No exceptions.
+  static void
+  _erase(Node* node, const uint32& first_row, const uint32& last_row) noexcept;
+
+  /// @brief Replaces piece of the given row in subtree.
+  /// @throws No exceptions.
+  static void _set(Node* node, uint32 row, const Piece& piece) noexcept;
+
+  /// @brief Splits overfull node into balanced nodes.
+  /// @throws No exceptions.
+  [[nodiscard]] static std::vector<std::shared_ptr<Node>>
+  _split(std::shared_ptr<Node> node) noexcept;
+
+  /// @brief Merges underfull children of node with their neighbours.
+  /// @throws No exceptions.
+  static void _fix_underflow(Node* node) noexcept;
+
+  /// @brief Appends pieces of subtree to the given vector.
+  /// @throws No exceptions.
+  static void _collect(const Node* node, std::vector<Piece>& pieces) noexcept;
+
+  /// @brief Appends pieces of rows [first_row, last_row) of subtree
+  ///        to the given vector.
+  /// @throws No exceptions.
+  static void _collect(const Node* node,
+                       const uint32& first_row,
+                       const uint32& last_row,
+                       std::vector<Piece>& pieces) noexcept;
+
+  /// @brief Appends pointers to pieces of subtree which don't point into
+  ///        mapped file, to the given vector. Empty pieces are cleared
+  ///        instead, as they point at no text.
+  /// @throws No exceptions.
+  static void _collect_owned(std::shared_ptr<Node>& node,
+                             const MappedFile& mapping,
+                             std::vector<Piece*>& pieces) noexcept;
+
+  /// @brief Recomputes line count, bytes and longest line length
+  ///        of node from its contents.
+  /// @throws No exceptions.
+  static void _update_counts(Node* node) noexcept;
+
+  /// @brief Number of pieces (leaf) or children (internal) in node.
+  /// @throws No exceptions.
+  [[nodiscard]] static std::size_t _fill(const Node* node) noexcept;
+
+  /// @brief Collapses root while it is an internal node with one child.
+  /// @throws No exceptions.
+  void _shrink_root() noexcept;
+
+  /// @brief Splits root while it is overfull.
+  /// @throws No exceptions.
+  void _grow_root() noexcept;
+};
+
+/// @brief Immutable snapshot of lines of a piece table, taken in O(1).
+///        Can be read on another thread while piece table is modified,
+///        and keeps text of its lines alive. Empty snapshot has no lines.
+class PieceTableSnapshot
+{
+public:
+  /// @brief Creates empty snapshot.
+  /// @throws No exceptions.
+  PieceTableSnapshot() noexcept;
+
+  /// @brief Version of piece table when snapshot was taken, compare with
+  ///        PieceTable::version() to tell if results are out of date.
+  /// @throws No exceptions.
+  [[nodiscard]] std::uint64_t version() const noexcept;
+
+  /// @brief Number of lines.
+  /// @throws No exceptions.
+  [[nodiscard]] uint32 size() const noexcept;
+
+  /// @brief Total size of text, excluding newline characters.
+  /// @throws No exceptions.
+  [[nodiscard]] std::size_t bytes() const noexcept;
+
+  /// @brief Gives text of line. Check row before query.
+  ///        The view stays valid while snapshot is alive.
+  /// @param row index of line.
+  /// @throws No exceptions.
+  [[nodiscard]] std::string_view operator[](const uint32& row) const noexcept;
+
+  /// @brief Gives pieces of all lines, in order. Text of pieces stays
+  ///        valid while snapshot is alive.
+  /// @throws No exceptions.
+  [[nodiscard]] std::vector<Piece> pieces() const noexcept;
+
+  /// @brief Gives pieces of lines in range [first_row, last_row).
+  /// @param first_row index of first line.
+  /// @param last_row index after the last line, clamped to size().
+  /// @throws No exceptions.
+  [[nodiscard]] std::vector<Piece>
+  pieces(const uint32& first_row, const uint32& last_row) const noexcept;
+
+  /// @brief Gives pieces of lines from row to end of the leaf holding it,
+  ///        without copying. Costs O(log n), so lines can be read chunk by
+  ///        chunk. Check row before query.
+  /// @param row index of first line.
+  /// @throws No exceptions.
+  [[nodiscard]] std::span<const Piece>
+  pieces_from(const uint32& row) const noexcept;
+
+private:
+  friend class PieceTable;
+
+  /// @brief Root of B+tree, shared with piece table.
+  std::shared_ptr<const PieceTable::Node> _root;
+
+  /// @brief Buffers holding text of lines.
+  std::shared_ptr<const PieceTable::TextBuffers> _buffers;
+
+  /// @brief Version of piece table when snapshot was taken.
+  std::uint64_t _version;
+};
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "ignore_rules.hpp"
+#include "regex.hpp"
+#include "types.hpp"
+
+/// @brief Location of a match, parsed from a line of results.
+struct ProjectMatch
+{
+  /// @brief Path of file, relative to searched directory.
+  std::string path;
+
+  /// @brief Index of line.
+  uint32 row;
+
+  /// @brief Index of first matched byte in line, with tabs expanded.
+  int32 column;
+};
+
+/// @brief Finds a literal query or a regex in files of a directory tree,
+///        on all cores. Directories are walked in parallel, each thread
+///        takes tasks (directories to list, files to search) from its own
+///        queue, and steals from the others when it runs out.
+///        Paths ignored by .gitignore files and binary files are skipped,
+///        files are memory mapped. Matched lines are published as lines
+///        of results, "path:line:column: text", in batches taken by the
+///        main thread with get_next_batch().
+class ProjectSearch
+{
+public:
+  /// @brief Creates idle search.
+  /// @throws No exceptions.
+  ProjectSearch() noexcept;
+
+  ProjectSearch(const ProjectSearch& search) = delete;
+  ProjectSearch& operator=(const ProjectSearch& search) = delete;
+
+  /// @brief Cancels search, if running.
+  /// @throws No exceptions.
+  ~ProjectSearch() noexcept;
+
+  /// @brief Starts finding query in files under directory, cancelling
+  ///        previous search.
+  /// @param directory path to directory.
+  /// @param query text or regular expression to find.
+  /// @param case_sensitive false to ignore case of ASCII letters.
+  /// @param regex true if query is a regular expression.
+  /// @param tab_width number of spaces a tab is expanded into, in lines
+  ///                  of results.
+  /// @param threads_count number of searching threads, 0 for one per core.
+  /// @return Returns false if query is empty, an invalid regex, or text
+  ///         with line breaks.
+  /// @throws No exceptions.
+  [[nodiscard]] bool start(const std::string& directory,
+                           const std::string& query,
+                           const bool& case_sensitive,
+                           const bool& regex,
+                           const uint8& tab_width,
+                           const uint32& threads_count) noexcept;
+
+  /// @brief Stops search and drops batches not taken yet.
+  /// @throws No exceptions.
+  void cancel() noexcept;
+
+  /// @brief Waits till all files are searched.
+  /// @throws No exceptions.
+  void wait() noexcept;
+
+  /// @brief Tells if there are results yet to be taken.
+  /// @return Returns false when all files are searched and results taken.
+  /// @throws No exceptions.
+  [[nodiscard]] bool running() const noexcept;
+
+  /// @brief Gives next batch of lines of results, matched lines of a file
+  ///        are in the same batch.
+  /// @return Returns std::nullopt if no batch is ready.
+  /// @throws No exceptions.
+  [[nodiscard]] std::optional<std::vector<std::string>>
+  get_next_batch() noexcept;
+
+  /// @brief Directory being searched.
+  /// @throws No exceptions.
+  [[nodiscard]] const std::string& directory() const noexcept;
+
+  /// @brief Number of files searched so far, skipped files aren't counted.
+  /// @throws No exceptions.
+  [[nodiscard]] std::size_t searched_files_count() const noexcept;
+
+  /// @brief Number of bytes searched so far.
+  /// @throws No exceptions.
+  [[nodiscard]] std::size_t searched_bytes_count() const noexcept;
+
+  /// @brief Parses location of match from line of results.
+  /// @param line line of results.
+  /// @return Returns std::nullopt if line isn't a result.
+  /// @throws No exceptions.
+  [[nodiscard]] static std::optional<ProjectMatch>
+  parse_result(std::string_view line) noexcept;
+
+private:
+  /// @brief Directory to list, or file to search.
+  struct Task
+  {
+    /// @brief Path relative to searched directory, directories have
+    ///        trailing '/' (empty for searched directory).
+    std::string path;
+
+    /// @brief Ignore rules of directory containing path.
+    std::shared_ptr<const IgnoreRules> rules;
+  };
+
+  /// @brief Tasks of a thread, it takes tasks from back, others steal
+  ///        from front.
+  struct TaskQueue
+  {
+    /// @brief Guards tasks.
+    std::mutex mutex;
+
+    /// @brief Tasks not yet taken.
+    std::deque<Task> tasks;
+  };
+
+  /// @brief Directory being searched, with trailing '/'.
+  std::string _directory;
+
+  /// @brief Query, lowered when ignoring case, if it's not a regex.
+  std::string _query;
+
+  /// @brief Tells if case of letters is matched.
+  bool _case_sensitive;
+
+  /// @brief Compiled query, if it's a regex, copied by each thread.
+  std::optional<Regex> _regex;
+
+  /// @brief Number of spaces a tab is expanded into.
+  uint8 _tab_width;
+
+  /// @brief Searching threads.
+  std::vector<std::thread> _threads;
+
+  /// @brief Task queue of each thread.
+  std::vector<std::unique_ptr<TaskQueue>> _queues;
+
+  /// @brief Number of tasks queued or being done, search is done
+  ///        when it drops to 0.
+  std::atomic<std::size_t> _pending_tasks;
+
+  /// @brief Number of threads still searching.
+  std::atomic<uint32> _running_threads;
+
+  /// @brief Set to stop the searching threads.
+  std::atomic<bool> _cancelled;
+
+  /// @brief Number of files searched.
+  std::atomic<std::size_t> _searched_files;
+
+  /// @brief Number of bytes searched.
+  std::atomic<std::size_t> _searched_bytes;
+
+  /// @brief Guards batches queue.
+  mutable std::mutex _batches_mutex;
+
+  /// @brief Batches of lines of results, not yet taken by main thread.
+  std::deque<std::vector<std::string>> _batches;
+
+  /// @brief Takes and does tasks until all are done.
+  /// @param index index of thread.
+  /// @throws No exceptions.
+  void _run(const std::size_t& index) noexcept;
+
+  /// @brief Takes a task from back of queue of thread, else steals one
+  ///        from front of queue of another thread.
+  /// @param index index of thread.
+  /// @return Returns std::nullopt if all queues are empty.
+  /// @throws No exceptions.
+  [[nodiscard]] std::optional<Task>
+  _take_task(const std::size_t& index) noexcept;
+
+  /// @brief Queues task in queue of thread.
+  /// @param index index of thread.
+  /// @param task task.
+  /// @throws No exceptions.
+  void _queue_task(const std::size_t& index, Task&& task) noexcept;
+
+  /// @brief Queues entries of directory which aren't ignored.
+  /// @param index index of thread.
+  /// @param task directory to list.
+  /// @throws No exceptions.
+  void _list_directory(const std::size_t& index, const Task& task) noexcept;
+
+  /// @brief Finds query in file, publishing its matched lines.
+  /// @param regex compiled query of thread, if query is a regex.
+  /// @param path path of file, relative to searched directory.
+  /// @throws No exceptions.
+  void _search_file(const std::optional<Regex>& regex,
+                    const std::string& path) noexcept;
+};
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "types.hpp"
+
+struct RegexNode;
+
+/// @brief Regular expression matched by a lazily built DFA, without
+///        backtracking, so matching time is linear in length of text.
+///        Supports literals, '.', classes ("[a-z]", "[^,]", \d \w \s and
+///        their negations), groups, '|', '*', '+', '?', "{m,n}" and line
+///        anchors '^' '$'. Matching is done per line, on UTF-8 text, '.'
+///        and negated classes match whole characters. Matches are
+///        leftmost-longest, lazy quantifiers match like greedy ones.
+///        Not thread safe, DFA states are built while matching, so each
+///        thread needs its own copy.
+class Regex
+{
+public:
+  /// @brief Creates regex without pattern, which matches nothing.
+  /// @throws No exceptions.
+  Regex() noexcept;
+
+  /// @brief Compiles pattern, replacing the previous one.
+  /// @param pattern regular expression.
+  /// @param case_sensitive false to ignore case of ASCII letters.
+  /// @return Returns false if pattern is invalid, regex matches
+  ///         nothing then.
+  /// @throws No exceptions.
+  [[nodiscard]] bool compile(const std::string& pattern,
+                             const bool& case_sensitive) noexcept;
+
+  /// @brief Tells if regex has a valid pattern.
+  /// @throws No exceptions.
+  [[nodiscard]] bool valid() const noexcept;
+
+  /// @brief Finds non-empty matches in line, which don't overlap.
+  ///        Starts of matches are found with one backward pass over line,
+  ///        end of each match with a forward pass from its start.
+  /// @param line text of line, without line break.
+  /// @param matches [start, end) byte offsets of matches are appended
+  ///                to it, in order.
+  /// @throws No exceptions.
+  void find_all(std::string_view line,
+                std::vector<std::pair<std::size_t, std::size_t>>& matches)
+    const noexcept;
+
+private:
+  /// @brief Kinds of NFA states.
+  enum class NfaStateType
+  {
+    /// @brief Consumes a byte of the set, goes to out.
+    BYTES,
+    /// @brief Goes to out and out1 without consuming.
+    SPLIT,
+    /// @brief Goes to out at the edge of line scanning starts from.
+    BEGIN,
+    /// @brief Goes to out at the edge of line scanning ends at.
+    END,
+    /// @brief Pattern is matched.
+    MATCH
+  };
+
+  /// @brief State of NFA (Thompson construction).
+  struct NfaState
+  {
+    /// @brief Kind of state.
+    NfaStateType type;
+
+    /// @brief Bytes consumed by BYTES state.
+    std::bitset<256> bytes;
+
+    /// @brief Next state.
+    uint32 out;
+
+    /// @brief Second next state of SPLIT state.
+    uint32 out1;
+  };
+
+  /// @brief State of DFA, a set of NFA states.
+  struct DfaState
+  {
+    /// @brief NFA states, sorted, empty for the dead state.
+    std::vector<uint32> nfa_states;
+
+    /// @brief Tells if pattern is matched at this state.
+    bool accepting;
+
+    /// @brief Tells if pattern is matched at this state,
+    ///        when it's reached at the edge of line.
+    bool accepting_at_end;
+
+    /// @brief Index of next DFA state for each byte, -1 if not built yet.
+    std::array<int32, 256> next;
+  };
+
+  /// @brief DFA built lazily from NFA, states are built the first time
+  ///        they are reached.
+  struct Dfa
+  {
+    /// @brief States of NFA.
+    std::vector<NfaState> nfa;
+
+    /// @brief Start state of NFA.
+    uint32 nfa_start = 0;
+
+    /// @brief Tells if a match can start at any position, NFA start state
+    ///        is added after every byte.
+    bool unanchored = false;
+
+    /// @brief Built states.
+    std::vector<DfaState> states;
+
+    /// @brief Index of state for set of NFA states.
+    std::map<std::vector<uint32>, uint32> ids;
+
+    /// @brief Start states, when scanning starts at (and not at) the
+    ///        edge of line, -1 if not built yet.
+    std::array<int32, 2> starts = {-1, -1};
+  };
+
+  /// @brief Tells if pattern is valid.
+  bool _valid;
+
+  /// @brief DFA finding ends of matches, from their start.
+  mutable Dfa _forward;
+
+  /// @brief DFA of reversed pattern, finding starts of matches
+  ///        scanning line backwards from its end.
+  mutable Dfa _reverse;
+
+  /// @brief Positions of line where a match starts, reused between lines.
+  mutable std::vector<bool> _match_starts;
+
+  /// @brief Adds NFA states matching node, followed by state next.
+  ///        States are added from the end of pattern, so each
+  ///        state is added after the states it goes to.
+  /// @param nfa states of NFA.
+  /// @param node node of parsed pattern.
+  /// @param next state after node.
+  /// @param reversed true to match reversed text, concatenations are
+  ///                 reversed and line anchors swapped.
+  /// @return Returns first state of node.
+  /// @throws No exceptions.
+  static uint32 _compile(std::vector<NfaState>& nfa,
+                         const RegexNode& node,
+                         const uint32& next,
+                         const bool& reversed) noexcept;
+
+  /// @brief Gives start state of DFA.
+  /// @param dfa DFA.
+  /// @param at_edge tells if scanning starts at the edge of line.
+  /// @return Returns index of start state.
+  /// @throws No exceptions.
+  static uint32 _start(Dfa& dfa, const bool& at_edge) noexcept;
+
+  /// @brief Gives state reached from state after consuming byte,
+  ///        building it if needed.
+  /// @param dfa DFA.
+  /// @param state index of state.
+  /// @param byte consumed byte.
+  /// @return Returns index of next state.
+  /// @throws No exceptions.
+  static uint32
+  _step(Dfa& dfa, uint32 state, const unsigned char& byte) noexcept;
+
+  /// @brief Gives index of state for set of NFA states, adding it
+  ///        if it isn't built yet.
+  /// @param dfa DFA.
+  /// @param nfa_states NFA states, with their closure.
+  /// @return Returns index of state.
+  /// @throws No exceptions.
+  static uint32 _state(Dfa& dfa, std::vector<uint32>&& nfa_states) noexcept;
+
+  /// @brief Adds states reached from NFA state without consuming bytes.
+  /// @param nfa states of NFA.
+  /// @param state NFA state.
+  /// @param at_edge tells if BEGIN states can be passed.
+  /// @param pass_end tells if END states can be passed.
+  /// @param visited states already added.
+  /// @param states closure is appended to it.
+  /// @throws No exceptions.
+  static void _closure(const std::vector<NfaState>& nfa,
+                       const uint32& state,
+                       const bool& at_edge,
+                       const bool& pass_end,
+                       std::vector<bool>& visited,
+                       std::vector<uint32>& states) noexcept;
+};
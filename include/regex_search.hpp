@@ -0,0 +1,171 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "piece_table.hpp"
+#include "regex.hpp"
+#include "text_search.hpp"
+#include "types.hpp"
+
+/// @brief Finds a regex in lines on a background thread, scanning a
+///        snapshot of lines chunk by chunk. Matches are published in
+///        batches, the first ones as soon as they are found, and taken by
+///        the main thread with take_matches(). Searching a new pattern
+///        cancels the previous scan.
+class RegexSearch
+{
+public:
+  /// @brief Creates search without pattern.
+  /// @throws No exceptions.
+  RegexSearch() noexcept;
+
+  RegexSearch(const RegexSearch& search) = delete;
+  RegexSearch& operator=(const RegexSearch& search) = delete;
+
+  /// @brief Cancels scan, if running.
+  /// @throws No exceptions.
+  ~RegexSearch() noexcept;
+
+  /// @brief Starts finding pattern in lines, dropping previous matches.
+  /// @param lines snapshot of lines.
+  /// @param pattern regular expression, empty pattern clears matches.
+  /// @param case_sensitive false to ignore case of ASCII letters.
+  /// @return Returns false if pattern is invalid, nothing is matched then.
+  /// @throws No exceptions.
+  bool search(const PieceTableSnapshot& lines,
+              const std::string& pattern,
+              const bool& case_sensitive) noexcept;
+
+  /// @brief Updates matches after lines [row, row + count) are replaced
+  ///        by new_count lines, matches after them are shifted. Few new
+  ///        lines are scanned right away, many on background thread.
+  ///        Lines changed while scanning restart the scan, lines appended
+  ///        after scanned lines are scanned after it.
+  /// @param lines snapshot of lines, after replacing.
+  /// @param row index of first replaced line.
+  /// @param count number of replaced lines.
+  /// @param new_count number of lines replacing them.
+  /// @throws No exceptions.
+  void replace_lines(const PieceTableSnapshot& lines,
+                     const uint32& row,
+                     const uint32& count,
+                     const uint32& new_count) noexcept;
+
+  /// @brief Takes matches published since last call, and starts scanning
+  ///        lines appended while scanning, once scan is done.
+  ///        Call this every frame.
+  /// @param lines snapshot of lines.
+  /// @return Returns true if matches are added.
+  /// @throws No exceptions.
+  bool take_matches(const PieceTableSnapshot& lines) noexcept;
+
+  /// @brief Cancels scan and removes pattern and matches.
+  /// @throws No exceptions.
+  void clear() noexcept;
+
+  /// @brief Tells if lines are still being scanned.
+  /// @return Returns false when all lines are scanned and matches taken.
+  /// @throws No exceptions.
+  [[nodiscard]] bool running() const noexcept;
+
+  /// @brief Gives progress of scan.
+  /// @return Returns fraction of lines scanned, 1 when not running.
+  /// @throws No exceptions.
+  [[nodiscard]] float32 progress() const noexcept;
+
+  /// @brief Number of matches found so far, including the ones not
+  ///        taken yet.
+  /// @throws No exceptions.
+  [[nodiscard]] std::size_t found_count() const noexcept;
+
+  /// @brief Pattern being searched, empty if there is none.
+  /// @throws No exceptions.
+  [[nodiscard]] const std::string& pattern() const noexcept;
+
+  /// @brief Tells if pattern is valid.
+  /// @throws No exceptions.
+  [[nodiscard]] bool valid() const noexcept;
+
+  /// @brief Taken matches of pattern, in order of position.
+  /// @throws No exceptions.
+  [[nodiscard]] const std::vector<TextMatch>& matches() const noexcept;
+
+private:
+  /// @brief Compiled pattern.
+  Regex _regex;
+
+  /// @brief Pattern being searched.
+  std::string _pattern;
+
+  /// @brief Taken matches, in order of position.
+  std::vector<TextMatch> _matches;
+
+  /// @brief Lines being scanned in background, [first, last).
+  std::pair<uint32, uint32> _scan_rows;
+
+  /// @brief Lines appended while scanning, to be scanned after it.
+  std::pair<uint32, uint32> _pending_rows;
+
+  /// @brief Thread scanning lines.
+  std::thread _thread;
+
+  /// @brief Set to stop the scanning thread.
+  std::atomic<bool> _cancelled;
+
+  /// @brief Set by scanning thread after publishing last batch.
+  std::atomic<bool> _finished;
+
+  /// @brief Number of lines scanned by scanning thread.
+  std::atomic<uint32> _scanned_rows;
+
+  /// @brief Number of matches published, not yet taken.
+  std::atomic<std::size_t> _untaken_count;
+
+  /// @brief Guards batches queue.
+  mutable std::mutex _batches_mutex;
+
+  /// @brief Published batches of matches, not yet taken by main thread.
+  std::deque<std::vector<TextMatch>> _batches;
+
+  /// @brief Starts scanning lines [first_row, last_row) on background
+  ///        thread, cancelling previous scan. Matches in those lines
+  ///        must be removed before.
+  /// @param lines snapshot of lines.
+  /// @param first_row index of first line.
+  /// @param last_row index after the last line.
+  /// @throws No exceptions.
+  void _start(const PieceTableSnapshot& lines,
+              const uint32& first_row,
+              const uint32& last_row) noexcept;
+
+  /// @brief Reserves matches for rest of the scan, estimated from matches
+  ///        in scanned lines, when count more matches don't fit.
+  /// @param lines snapshot of lines.
+  /// @param count number of matches to be added.
+  /// @throws No exceptions.
+  void _reserve(const PieceTableSnapshot& lines,
+                const std::size_t& count) noexcept;
+
+  /// @brief Stops scanning and drops batches not taken yet.
+  /// @throws No exceptions.
+  void _cancel() noexcept;
+
+  /// @brief Finds regex in lines [first_row, last_row), appending matches.
+  /// @param regex compiled pattern.
+  /// @param lines snapshot of lines.
+  /// @param first_row index of first line.
+  /// @param last_row index after the last line.
+  /// @param matches matches to append to.
+  /// @throws No exceptions.
+  static void _scan(const Regex& regex,
+                    const PieceTableSnapshot& lines,
+                    const uint32& first_row,
+                    const uint32& last_row,
+                    std::vector<TextMatch>& matches) noexcept;
+};
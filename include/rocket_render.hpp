@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include "sdl2.hpp"
 #include "types.hpp"
 
@@ -72,14 +73,15 @@ void rectangle_outlined_rounded(const int32& x,
                                 const uint16& radius,
                                 const SDL_Color& outline_color);
 
-/// @brief Draws text.
+/// @brief Draws text, a grapheme cluster per cell (two for wide ones).
+///        Invalid UTF-8 bytes are drawn as replacement characters.
 /// @param x x-coordinate of top-left corner.
 /// @param y y-coordinate of top-left corner.
-/// @param text text to render.
+/// @param text UTF-8 text to render.
 /// @param color color of text.
 void text(const int32& x,
           const int32& y,
-          const std::string& text,
+          const std::string_view& text,
           const SDL_Color& color);
 
 }; // namespace RocketRender
\ No newline at end of file
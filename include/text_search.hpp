@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "piece_table.hpp"
+#include "types.hpp"
+
+/// @brief Match of search query in lines.
+struct TextMatch
+{
+  /// @brief Index of line.
+  uint32 row;
+
+  /// @brief Index of first matched byte in line.
+  uint32 column;
+
+  /// @brief Number of matched bytes.
+  uint32 length;
+};
+
+/// @brief Finds every occurrence of query in text, with SIMD where
+///        available.
+/// @param text pointer to text.
+/// @param size size of text in bytes.
+/// @param query query, lowered when ignoring case.
+/// @param case_sensitive false to ignore case of ASCII letters.
+/// @param offsets offsets of occurrences are appended to it, in order.
+/// @throws No exceptions.
+void find_occurrences(const char* text,
+                      const std::size_t& size,
+                      const std::string& query,
+                      const bool& case_sensitive,
+                      std::vector<std::size_t>& offsets) noexcept;
+
+/// @brief Index of first match at or after position.
+/// @param matches matches, in order of position.
+/// @param row index of line.
+/// @param column index of byte in line.
+/// @return Returns number of matches if there is no such match.
+/// @throws No exceptions.
+[[nodiscard]] std::size_t
+first_match_from(const std::vector<TextMatch>& matches,
+                 const uint32& row,
+                 const uint32& column) noexcept;
+
+/// @brief Replaces matches in lines [row, row + count) with matches of
+///        new_count lines replacing them, matches after them are shifted.
+/// @param matches matches, in order of position.
+/// @param row index of first replaced line.
+/// @param count number of replaced lines.
+/// @param new_count number of lines replacing them.
+/// @param new_matches matches in new lines, in order of position.
+/// @throws No exceptions.
+void replace_matches(std::vector<TextMatch>& matches,
+                     const uint32& row,
+                     const uint32& count,
+                     const uint32& new_count,
+                     const std::vector<TextMatch>& new_matches) noexcept;
+
+/// @brief Finds a literal query in lines, for find as you type.
+///        Text is scanned with SIMD where available, testing first and last
+///        byte of query at every position of a block at once, and verifying
+///        the candidates. Lines lying one after another in memory (lines of
+///        loaded file) are scanned as one block of text.
+class TextSearch
+{
+public:
+  /// @brief Creates search without query.
+  /// @throws No exceptions.
+  TextSearch() noexcept;
+
+  /// @brief Finds query in lines. When query extends previous query and
+  ///        lines are unchanged, previous matches are refined instead of
+  ///        scanning lines again.
+  /// @param lines snapshot of lines.
+  /// @param query text to find, queries with line breaks match nothing.
+  /// @param case_sensitive false to ignore case of ASCII letters.
+  /// @param row_ranges sorted [first, last) ranges of rows which can have
+  ///                   matches, other lines aren't scanned.
+  /// @throws No exceptions.
+  void search(const PieceTableSnapshot& lines,
+              const std::string& query,
+              const bool& case_sensitive,
+              const std::vector<std::pair<uint32, uint32>>& row_ranges)
+    noexcept;
+
+  /// @brief Updates matches after lines [row, row + count) are replaced
+  ///        by new_count lines, matches after them are shifted.
+  /// @param lines snapshot of lines, after replacing.
+  /// @param row index of first replaced line.
+  /// @param count number of replaced lines.
+  /// @param new_count number of lines replacing them.
+  /// @throws No exceptions.
+  void replace_lines(const PieceTableSnapshot& lines,
+                     const uint32& row,
+                     const uint32& count,
+                     const uint32& new_count) noexcept;
+
+  /// @brief Removes query and matches.
+  /// @throws No exceptions.
+  void clear() noexcept;
+
+  /// @brief Query being searched, empty if there is none.
+  /// @throws No exceptions.
+  [[nodiscard]] const std::string& query() const noexcept;
+
+  /// @brief Tells if case of letters is matched.
+  /// @throws No exceptions.
+  [[nodiscard]] bool case_sensitive() const noexcept;
+
+  /// @brief Matches of query, in order of position. Every occurrence is a
+  ///        match, so matches can overlap ("aa" matches twice in "aaa").
+  /// @throws No exceptions.
+  [[nodiscard]] const std::vector<TextMatch>& matches() const noexcept;
+
+private:
+  /// @brief Query being searched.
+  std::string _query;
+
+  /// @brief Query with ASCII letters lowered, for ignoring case.
+  std::string _lowered_query;
+
+  /// @brief Tells if case of letters is matched.
+  bool _case_sensitive;
+
+  /// @brief Version of lines which matches are of.
+  std::uint64_t _version;
+
+  /// @brief Matches of query, in order of position.
+  std::vector<TextMatch> _matches;
+
+  /// @brief Finds query in lines [first_row, last_row), appending matches.
+  /// @param lines snapshot of lines.
+  /// @param first_row index of first line.
+  /// @param last_row index after the last line.
+  /// @param matches matches to append to.
+  /// @throws No exceptions.
+  void _scan(const PieceTableSnapshot& lines,
+             const uint32& first_row,
+             const uint32& last_row,
+             std::vector<TextMatch>& matches) const noexcept;
+};
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "piece_table.hpp"
+#include "types.hpp"
+
+/// @brief Index of trigrams (3 byte sequences, ASCII letters lowered) in
+///        chunks of lines, for narrowing search of large files to chunks
+///        which can have matches. Each chunk of about a megabyte of lines
+///        keeps a bitmap of hashed trigrams of its lines, a query can only
+///        match in chunks having all its trigrams. Built on a background
+///        thread and saved next to the file, so reopening the file loads
+///        it instead. Edited chunks are merged and re-indexed when next
+///        searched.
+class TrigramIndex
+{
+public:
+  /// @brief Creates empty index.
+  /// @throws No exceptions.
+  TrigramIndex() noexcept;
+
+  TrigramIndex(const TrigramIndex& index) = delete;
+  TrigramIndex& operator=(const TrigramIndex& index) = delete;
+
+  /// @brief Cancels building, if running.
+  /// @throws No exceptions.
+  ~TrigramIndex() noexcept;
+
+  /// @brief Starts loading index saved next to file, or building it if
+  ///        there is no valid saved index, on background thread.
+  ///        Cancels previous build.
+  /// @param lines snapshot of all lines of file.
+  /// @param filepath path to file.
+  /// @param tab_width number of spaces tabs of lines are expanded into.
+  /// @param save true to save built index next to file, lines must be
+  ///             unedited lines of file then.
+  /// @throws No exceptions.
+  void build(const PieceTableSnapshot& lines,
+             const std::string& filepath,
+             const uint8& tab_width,
+             const bool& save) noexcept;
+
+  /// @brief Takes built index, applying edits made while building.
+  ///        Call this every frame.
+  /// @return Returns true if index became ready.
+  /// @throws No exceptions.
+  bool take_built_index() noexcept;
+
+  /// @brief Cancels building and drops index.
+  /// @throws No exceptions.
+  void clear() noexcept;
+
+  /// @brief Tells if index can be used for searching.
+  /// @throws No exceptions.
+  [[nodiscard]] bool ready() const noexcept;
+
+  /// @brief Updates index after lines [row, row + count) are replaced by
+  ///        new_count lines. Chunks of those lines are merged, and
+  ///        re-indexed when next searched.
+  /// @param row index of first replaced line.
+  /// @param count number of replaced lines.
+  /// @param new_count number of lines replacing them.
+  /// @throws No exceptions.
+  void replace_lines(const uint32& row,
+                     const uint32& count,
+                     const uint32& new_count) noexcept;
+
+  /// @brief Gives lines which can have query, re-indexing edited chunks.
+  /// @param lines snapshot of lines.
+  /// @param query text to find.
+  /// @return Returns sorted [first, last) ranges of rows, all lines if
+  ///         index isn't ready or query is shorter than a trigram.
+  /// @throws No exceptions.
+  [[nodiscard]] std::vector<std::pair<uint32, uint32>>
+  candidate_rows(const PieceTableSnapshot& lines,
+                 const std::string& query) noexcept;
+
+private:
+  /// @brief Lines of a chunk and their trigrams.
+  struct Chunk
+  {
+    /// @brief Number of lines.
+    uint32 rows;
+
+    /// @brief Bitmap of hashed trigrams, empty if chunk is edited and
+    ///        not re-indexed yet.
+    std::vector<std::uint64_t> trigrams;
+  };
+
+  /// @brief Chunks of lines, in order.
+  std::vector<Chunk> _chunks;
+
+  /// @brief Tells if chunks can be used for searching.
+  bool _ready;
+
+  /// @brief Thread building the index.
+  std::thread _thread;
+
+  /// @brief Set to stop the building thread.
+  std::atomic<bool> _cancelled;
+
+  /// @brief Set by building thread after index is built.
+  std::atomic<bool> _finished;
+
+  /// @brief Guards built chunks.
+  std::mutex _built_mutex;
+
+  /// @brief Chunks built by building thread, not taken yet.
+  std::vector<Chunk> _built_chunks;
+
+  /// @brief Edits made while building, as row, count and new count.
+  std::vector<std::tuple<uint32, uint32, uint32>> _pending_edits;
+
+  /// @brief Stops building thread.
+  /// @throws No exceptions.
+  void _cancel() noexcept;
+
+  /// @brief Merges chunks of replaced lines, marking them edited.
+  /// @param row index of first replaced line.
+  /// @param count number of replaced lines.
+  /// @param new_count number of lines replacing them.
+  /// @throws No exceptions.
+  void _replace_lines(const uint32& row,
+                      const uint32& count,
+                      const uint32& new_count) noexcept;
+
+  /// @brief Indexes lines [first_row, last_row) into chunks.
+  /// @param lines snapshot of lines.
+  /// @param first_row index of first line.
+  /// @param last_row index after the last line.
+  /// @param chunks chunks are appended to it.
+  /// @param cancelled stops indexing when set, can be nullptr.
+  /// @throws No exceptions.
+  static void _index(const PieceTableSnapshot& lines,
+                     const uint32& first_row,
+                     const uint32& last_row,
+                     std::vector<Chunk>& chunks,
+                     const std::atomic<bool>* cancelled) noexcept;
+
+  /// @brief Reads index saved next to file.
+  /// @param path path to saved index.
+  /// @param stamp size, modification time and tab width of file.
+  /// @param rows number of lines of file.
+  /// @param chunks chunks are read into it.
+  /// @return Returns false if there is no saved index, or it's of other
+  ///         contents of file.
+  /// @throws No exceptions.
+  [[nodiscard]] static bool _load(const std::string& path,
+                                  const std::vector<std::int64_t>& stamp,
+                                  const uint32& rows,
+                                  std::vector<Chunk>& chunks) noexcept;
+
+  /// @brief Writes index next to file, replacing saved index atomically.
+  /// @param path path to saved index.
+  /// @param stamp size, modification time and tab width of file.
+  /// @param chunks chunks to write.
+  /// @return Returns false if unable to write.
+  /// @throws No exceptions.
+  static bool _save(const std::string& path,
+                    const std::vector<std::int64_t>& stamp,
+                    const std::vector<Chunk>& chunks) noexcept;
+};
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <utility>
+#include <vector>
+#include "piece_table.hpp"
+#include "types.hpp"
+
+/// @brief Kind of edit, used to decide which edits are coalesced.
+enum class EditKind
+{
+  /// @brief Characters typed into a line.
+  INSERT_CHARACTERS,
+
+  /// @brief Characters deleted from a line with backspace.
+  DELETE_CHARACTERS,
+
+  /// @brief Any other edit, never coalesced.
+  OTHER
+};
+
+/// @brief Edit of a range of lines, with both the lines it replaced and the
+///        lines it produced. Lines are pieces of piece table, as its buffers
+///        are never modified, so no text is copied.
+struct EditDelta
+{
+  /// @brief Index of first edited line.
+  uint32 row;
+
+  /// @brief Lines before edit, starting at row.
+  std::vector<Piece> old_lines;
+
+  /// @brief Lines after edit, starting at row.
+  std::vector<Piece> new_lines;
+
+  /// @brief Cursor position before edit.
+  std::pair<uint32, int32> cursor_before;
+
+  /// @brief Cursor position after edit.
+  std::pair<uint32, int32> cursor_after;
+
+  /// @brief Kind of edit.
+  EditKind kind;
+};
+
+/// @brief Journal of edits for undo & redo.
+///        Consecutive keystrokes are coalesced into word sized entries.
+///        When journal exceeds undo memory_limit, the oldest entries are
+///        composed into one entry when they touch, else dropped.
+class UndoHistory
+{
+public:
+  /// @brief Creates empty history.
+  /// @throws No exceptions.
+  UndoHistory() noexcept;
+
+  /// @brief Records an edit, dropping entries which could be redone.
+  /// @param delta the edit.
+  /// @throws No exceptions.
+  void record(EditDelta&& delta) noexcept;
+
+  /// @brief Gives edit to undo, and steps back in history.
+  ///        Apply it by replacing new_lines with old_lines.
+  /// @return Returns nullptr if there is nothing to undo.
+  /// @throws No exceptions.
+  [[nodiscard]] const EditDelta* undo() noexcept;
+
+  /// @brief Gives edit to redo, and steps forward in history.
+  ///        Apply it by replacing old_lines with new_lines.
+  /// @return Returns nullptr if there is nothing to redo.
+  /// @throws No exceptions.
+  [[nodiscard]] const EditDelta* redo() noexcept;
+
+  /// @brief Stops next edit from being coalesced with the last one.
+  ///        Call this when cursor is moved by other means than editing.
+  /// @throws No exceptions.
+  void break_coalescing() noexcept;
+
+  /// @brief Removes all entries, call this when lines are reloaded.
+  /// @throws No exceptions.
+  void clear() noexcept;
+
+  /// @brief Memory used by entries.
+  /// @return Returns approximate size of entries in bytes.
+  /// @throws No exceptions.
+  [[nodiscard]] std::size_t memory_usage() const noexcept;
+
+  /// @brief Appends pointers to pieces of all entries to the given vector,
+  ///        so piece table can move their text while compacting.
+  /// @param pieces vector to append to.
+  /// @throws No exceptions.
+  void collect_pieces(std::vector<Piece*>& pieces) noexcept;
+
+private:
+  /// @brief Entries, the ones before position can be undone,
+  ///        the ones from position can be redone.
+  std::deque<EditDelta> _entries;
+
+  /// @brief Index of entry to redo next.
+  std::size_t _position;
+
+  /// @brief Memory used by entries, in bytes.
+  std::size_t _memory_usage;
+
+  /// @brief Tells if next edit can be coalesced with the last entry.
+  bool _coalescing;
+
+  /// @brief Tries to merge delta into last entry.
+  /// @return Returns false if delta can't be coalesced.
+  /// @throws No exceptions.
+  [[nodiscard]] bool _coalesce(const EditDelta& delta) noexcept;
+
+  /// @brief Drops or composes oldest entries, till entries fit in
+  ///        undo memory_limit. Last entry is always kept.
+  /// @throws No exceptions.
+  void _compact() noexcept;
+
+  /// @brief Composes edit second, made after edit first, into one edit.
+  ///        Edits must touch or overlap.
+  /// @return Returns edit which has effect of both.
+  /// @throws No exceptions.
+  [[nodiscard]] static EditDelta _compose(const EditDelta& first,
+                                          const EditDelta& second) noexcept;
+
+  /// @brief Memory used by an entry, including text of its lines.
+  /// @throws No exceptions.
+  [[nodiscard]] static std::size_t _cost(const EditDelta& delta) noexcept;
+};
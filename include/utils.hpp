@@ -4,6 +4,8 @@
 #include <vector>
 #include "buffer.hpp"
 #include "cairo.hpp"
+#include "cpp_tokenizer_cache.hpp"
+#include "identifier_index.hpp"
 #include "sdl2.hpp"
 #include "types.hpp"
 
@@ -12,11 +14,73 @@ hexcode_to_SDL_Color(const std::string& hexcode) noexcept;
 
 bool animator(float32* animatable, const float32* target) noexcept;
 
+/// @brief Scrolls just enough to show the line of cursor.
+/// @param buffer const reference to buffer.
+/// @param line_height height of line.
+/// @param window_height height of window.
+/// @param scroll_y_offset scroll offset, changed if cursor is out of view.
+/// @param scroll_y_target target of scroll animation, set with offset.
+/// @return Returns true if scrolled.
+bool scroll_to_cursor(const Buffer& buffer,
+                      const float32& line_height,
+                      const float32& window_height,
+                      float32* scroll_y_offset,
+                      float32* scroll_y_target) noexcept;
+
+/// @brief Gives completions of identifier being typed, the bytes of
+///        identifier before cursor.
+/// @param buffer const reference to buffer.
+/// @param identifiers identifiers of tokenized lines.
+/// @param max_count maximum number of completions.
+/// @param completions replaced with completions, empty if identifier
+///                    before cursor is shorter than 2 bytes.
+/// @return Returns identifier before cursor.
+std::string complete_identifier(const Buffer& buffer,
+                                const IdentifierIndex& identifiers,
+                                const std::size_t& max_count,
+                                std::vector<std::string>& completions) noexcept;
+
+/// @brief Gives identifier under cursor, or ending at cursor.
+/// @param buffer const reference to buffer.
+/// @param tokenizer_cache const reference to token cache.
+/// @return Returns std::nullopt if there is none, or line of cursor isn't
+///         tokenized.
+[[nodiscard]] std::optional<std::string>
+identifier_at_cursor(const Buffer& buffer,
+                     const CppTokenizerCache& tokenizer_cache) noexcept;
+
+/// @brief Finds bracket under cursor (or ending at cursor), and bracket
+///        matching it.
+/// @param buffer const reference to buffer.
+/// @param tokenizer_cache reference to token cache, lines are tokenized
+///                        while looking for a closing bracket.
+/// @param last_row index of last line to look for matching bracket in.
+/// @return Returns row and column of bracket, and of matching bracket,
+///         std::nullopt if there is no bracket at cursor, or it's
+///         unmatched (or paired with a bracket of another kind).
+[[nodiscard]] std::optional<
+  std::pair<std::pair<uint32, uint32>, std::pair<uint32, uint32>>>
+bracket_pair_at_cursor(const Buffer& buffer,
+                       CppTokenizerCache& tokenizer_cache,
+                       const uint32& last_row) noexcept;
+
+/// @brief Renders tokens of line, brackets are coloured by their nesting
+///        depth.
+/// @param x x-coordinate of line.
+/// @param y y-coordinate of line.
+/// @param tokens tokens of line.
+/// @param text tokenized text of line, tokens are spans of it.
+/// @param buffer const reference to buffer.
+/// @param line_index index of line.
+/// @param bracket_depth nesting depth of brackets at start of line.
+/// @param font_extents font extents.
 void render_tokens(int32 x,
                    int32 y,
                    const std::vector<CppTokenizer::Token>& tokens,
+                   const std::string& text,
                    const Buffer& buffer,
                    const uint32& line_index,
+                   const int32& bracket_depth,
                    const cairo_font_extents_t& font_extents) noexcept;
 
 /// @brief Gives buffer grid position from mouse coordinates.
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/// @brief Maximum number of runs of ASCII separators classified with SSE2,
+///        blocks are classified byte by byte beyond it.
+inline constexpr std::size_t max_separator_runs = 8;
+
+/// @brief Classes of bytes for finding word boundaries, built from word
+///        separators of config, so a byte is classified by a table lookup
+///        instead of searching the separators.
+struct WordClasses
+{
+  /// @brief Tells if byte separates words, indexed by unsigned byte.
+  std::array<bool, 256> separator;
+
+  /// @brief Separators among ASCII bytes, as bit (byte >> 4) of entry
+  ///        (byte & 0xF), for classifying blocks of bytes with AVX2.
+  std::array<std::uint8_t, 16> ascii_separator_bits;
+
+  /// @brief First byte of each run of consecutive ASCII separators,
+  ///        repeated 16 times, for classifying blocks of bytes with SSE2.
+  std::array<std::array<std::uint8_t, 16>, max_separator_runs>
+    separator_run_starts;
+
+  /// @brief Length of each run of ASCII separators minus one, repeated 16
+  ///        times.
+  std::array<std::array<std::uint8_t, 16>, max_separator_runs>
+    separator_run_spans;
+
+  /// @brief Number of runs of ASCII separators, more than
+  ///        max_separator_runs if they don't fit.
+  std::size_t separator_runs;
+
+  /// @brief Tells if all non ASCII bytes are of the same class, blocks of
+  ///        bytes are classified with SIMD only then.
+  bool uniform_non_ascii;
+
+  /// @brief Tells if non ASCII bytes separate words, when they are of the
+  ///        same class.
+  bool non_ascii_separator;
+};
+
+/// @brief Builds classes of bytes from word separators.
+/// @param separators bytes which separate words.
+/// @throws No exceptions.
+[[nodiscard]] WordClasses
+build_word_classes(std::string_view separators) noexcept;
+
+/// @brief Finds end of word, skipping runs of word bytes with SIMD where
+///        available.
+/// @param classes classes of bytes.
+/// @param text text of line.
+/// @param position index of byte to start at.
+/// @return Returns index of first separator at or after position, size of
+///         text if there is none.
+/// @throws No exceptions.
+[[nodiscard]] std::size_t word_end(const WordClasses& classes,
+                                   std::string_view text,
+                                   std::size_t position) noexcept;
+
+/// @brief Finds start of word, skipping runs of word bytes backwards with
+///        SIMD where available.
+/// @param classes classes of bytes.
+/// @param text text of line.
+/// @param position index after the byte to start at.
+/// @return Returns index after the last separator before position, 0 if
+///         there is none.
+/// @throws No exceptions.
+[[nodiscard]] std::size_t word_start(const WordClasses& classes,
+                                     std::string_view text,
+                                     std::size_t position) noexcept;
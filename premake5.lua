@@ -47,7 +47,7 @@ workspace("text-editor-software-rendering")
 			})
 			libdirs({ "SDL2-2.26.5/x86_64-w64-mingw32/lib", "cairo-windows-1.17.2/lib/x64", "freetype/lib/x86_64" })
 		filter({ "system:linux" })
-			links({ "SDL2main", "SDL2", "cairo", "freetype" })
+			links({ "SDL2main", "SDL2", "cairo", "freetype", "pthread" })
 		filter({ "system:macos" })
 			links({ "SDL2main", "SDL2", "cairo", "freetype" })
 		filter({})
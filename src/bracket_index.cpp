@@ -0,0 +1,304 @@
+#include "../include/bracket_index.hpp"
+#include <algorithm>
+
+int32 bracket_depth_change(const CppTokenizer::Token& token) noexcept
+{
+  switch(token.type)
+  {
+  case CppTokenizer::TokenType::BRACKET_OPEN:
+  case CppTokenizer::TokenType::SQUARE_BRACKET_OPEN:
+  case CppTokenizer::TokenType::CURLY_BRACE_OPEN:
+    return 1;
+  case CppTokenizer::TokenType::BRACKET_CLOSE:
+  case CppTokenizer::TokenType::SQUARE_BRACKET_CLOSE:
+  case CppTokenizer::TokenType::CURLY_BRACE_CLOSE:
+    return -1;
+  default:
+    return 0;
+  }
+}
+
+BracketIndex::BracketIndex() noexcept
+  : _nodes({Node{0, 0, 0, 0, 0, 0, 0, 0}})
+  , _root(0)
+  , _seed(2463534242)
+{}
+
+void BracketIndex::clear() noexcept
+{
+  _nodes.assign(1, Node{0, 0, 0, 0, 0, 0, 0, 0});
+  _free_nodes.clear();
+  _root = 0;
+}
+
+uint32 BracketIndex::size() const noexcept
+{
+  return _nodes[_root].size;
+}
+
+void BracketIndex::replace_lines(
+  const uint32& row,
+  const uint32& count,
+  std::span<const std::vector<CppTokenizer::Token>> lines) noexcept
+{
+  uint32 first = 0, middle = 0, replaced = 0, rest = 0;
+  this->_split(_root, row, first, middle);
+  this->_split(middle, count, replaced, rest);
+  this->_free(replaced);
+  _root = this->_merge(this->_merge(first, this->_build(lines)), rest);
+}
+
+int32 BracketIndex::depth_before(const uint32& row) const noexcept
+{
+  int32 depth = 0;
+  uint32 node = _root, remaining = row;
+  while(node != 0)
+  {
+    const Node& left = _nodes[_nodes[node].left];
+    if(remaining <= left.size)
+    {
+      node = _nodes[node].left;
+    }
+    else
+    {
+      depth += left.subtree_depth_change + _nodes[node].depth_change;
+      remaining -= left.size + 1;
+      node = _nodes[node].right;
+    }
+  }
+  return depth;
+}
+
+std::optional<uint32>
+BracketIndex::first_line_below(const uint32& first_row,
+                               const int32& depth) const noexcept
+{
+  return this->_first_line_below(_root, 0, 0, first_row, depth);
+}
+
+std::optional<uint32>
+BracketIndex::last_line_not_above(const uint32& last_row,
+                                  const int32& depth) const noexcept
+{
+  return this->_last_line_not_above(_root, 0, 0, last_row, depth);
+}
+
+uint32 BracketIndex::_create_node(
+  const std::vector<CppTokenizer::Token>& tokens) noexcept
+{
+  Node node{0, 0, 0, 0, 1, 0, 0, 0};
+  for(const CppTokenizer::Token& token : tokens)
+  {
+    node.depth_change += bracket_depth_change(token);
+    node.min_depth = std::min(node.min_depth, node.depth_change);
+  }
+  node.subtree_depth_change = node.depth_change;
+  node.subtree_min_depth = node.min_depth;
+
+  // xorshift
+  _seed ^= _seed << 13;
+  _seed ^= _seed >> 17;
+  _seed ^= _seed << 5;
+  node.priority = _seed;
+
+  if(_free_nodes.empty())
+  {
+    _nodes.push_back(node);
+    return _nodes.size() - 1;
+  }
+  const uint32 index = _free_nodes.back();
+  _free_nodes.pop_back();
+  _nodes[index] = node;
+  return index;
+}
+
+uint32 BracketIndex::_build(
+  std::span<const std::vector<CppTokenizer::Token>> lines) noexcept
+{
+  // right spine of treap built so far, nodes popped off it are complete
+  std::vector<uint32> spine;
+  for(const std::vector<CppTokenizer::Token>& tokens : lines)
+  {
+    const uint32 node = this->_create_node(tokens);
+    uint32 last_popped = 0;
+    while(!spine.empty() &&
+          _nodes[spine.back()].priority < _nodes[node].priority)
+    {
+      last_popped = spine.back();
+      spine.pop_back();
+      this->_update(last_popped);
+    }
+    _nodes[node].left = last_popped;
+    if(!spine.empty())
+    {
+      _nodes[spine.back()].right = node;
+    }
+    spine.push_back(node);
+  }
+
+  for(auto node = spine.rbegin(); node != spine.rend(); node++)
+  {
+    this->_update(*node);
+  }
+  return spine.empty() ? 0 : spine.front();
+}
+
+void BracketIndex::_free(const uint32& node) noexcept
+{
+  if(node == 0)
+  {
+    return;
+  }
+
+  std::vector<uint32> nodes = {node};
+  while(!nodes.empty())
+  {
+    const uint32 freed = nodes.back();
+    nodes.pop_back();
+    if(_nodes[freed].left != 0)
+    {
+      nodes.push_back(_nodes[freed].left);
+    }
+    if(_nodes[freed].right != 0)
+    {
+      nodes.push_back(_nodes[freed].right);
+    }
+    _free_nodes.push_back(freed);
+  }
+}
+
+void BracketIndex::_update(const uint32& node) noexcept
+{
+  Node& n = _nodes[node];
+  const Node& left = _nodes[n.left];
+  const Node& right = _nodes[n.right];
+  n.size = left.size + 1 + right.size;
+  n.subtree_depth_change =
+    left.subtree_depth_change + n.depth_change + right.subtree_depth_change;
+  n.subtree_min_depth = left.subtree_depth_change + n.min_depth;
+  if(n.left != 0)
+  {
+    n.subtree_min_depth = std::min(n.subtree_min_depth, left.subtree_min_depth);
+  }
+  if(n.right != 0)
+  {
+    n.subtree_min_depth =
+      std::min(n.subtree_min_depth,
+               left.subtree_depth_change + n.depth_change +
+                 right.subtree_min_depth);
+  }
+}
+
+void BracketIndex::_split(const uint32& node,
+                          const uint32& count,
+                          uint32& first,
+                          uint32& rest) noexcept
+{
+  if(node == 0)
+  {
+    first = 0;
+    rest = 0;
+    return;
+  }
+
+  const uint32 left = _nodes[node].left, right = _nodes[node].right;
+  if(count <= _nodes[left].size)
+  {
+    this->_split(left, count, first, _nodes[node].left);
+    rest = node;
+  }
+  else
+  {
+    this->_split(
+      right, count - _nodes[left].size - 1, _nodes[node].right, rest);
+    first = node;
+  }
+  this->_update(node);
+}
+
+uint32 BracketIndex::_merge(const uint32& first, const uint32& second) noexcept
+{
+  if(first == 0 || second == 0)
+  {
+    return first == 0 ? second : first;
+  }
+
+  if(_nodes[first].priority > _nodes[second].priority)
+  {
+    const uint32 right = this->_merge(_nodes[first].right, second);
+    _nodes[first].right = right;
+    this->_update(first);
+    return first;
+  }
+  const uint32 left = this->_merge(first, _nodes[second].left);
+  _nodes[second].left = left;
+  this->_update(second);
+  return second;
+}
+
+std::optional<uint32>
+BracketIndex::_first_line_below(const uint32& node,
+                                const uint32& row,
+                                const int32& start_depth,
+                                const uint32& first_row,
+                                const int32& depth) const noexcept
+{
+  const Node& n = _nodes[node];
+  // subtrees before first_row, or not dipping below depth, are skipped
+  if(node == 0 || row + n.size <= first_row ||
+     (row >= first_row && start_depth + n.subtree_min_depth >= depth))
+  {
+    return std::nullopt;
+  }
+
+  const Node& left = _nodes[n.left];
+  std::optional<uint32> line =
+    this->_first_line_below(n.left, row, start_depth, first_row, depth);
+  if(line)
+  {
+    return line;
+  }
+
+  const uint32 own_row = row + left.size;
+  const int32 own_depth = start_depth + left.subtree_depth_change;
+  if(own_row >= first_row && own_depth + n.min_depth < depth)
+  {
+    return own_row;
+  }
+  return this->_first_line_below(
+    n.right, own_row + 1, own_depth + n.depth_change, first_row, depth);
+}
+
+std::optional<uint32>
+BracketIndex::_last_line_not_above(const uint32& node,
+                                   const uint32& row,
+                                   const int32& start_depth,
+                                   const uint32& last_row,
+                                   const int32& depth) const noexcept
+{
+  const Node& n = _nodes[node];
+  // subtrees after last_row, or not reaching depth, are skipped
+  if(node == 0 || row > last_row ||
+     (row + n.size - 1 <= last_row &&
+      start_depth + n.subtree_min_depth > depth))
+  {
+    return std::nullopt;
+  }
+
+  const Node& left = _nodes[n.left];
+  const uint32 own_row = row + left.size;
+  const int32 own_depth = start_depth + left.subtree_depth_change;
+  std::optional<uint32> line = this->_last_line_not_above(
+    n.right, own_row + 1, own_depth + n.depth_change, last_row, depth);
+  if(line)
+  {
+    return line;
+  }
+
+  if(own_row <= last_row && own_depth + n.min_depth <= depth)
+  {
+    return own_row;
+  }
+  return this->_last_line_not_above(
+    n.left, row, start_depth, last_row, depth);
+}
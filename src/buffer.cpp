@@ -1,18 +1,39 @@
 #include "../include/buffer.hpp"
 #include <algorithm>
+#include <filesystem>
 #include <fstream>
+#include <limits>
+#include <memory>
 #include <string_view>
 #include "../include/config_manager.hpp"
 #include "../include/incremental_render_update.hpp"
 #include "../include/macros.hpp"
 
+/// Bytes of a large file loaded before showing it, rest of the lines
+/// are indexed in background.
+static constexpr std::size_t first_screen_bytes = 256 * 1024;
+
 Buffer::Buffer() noexcept
   : _cursor_row(0)
   , _cursor_col(-1)
   , _cursor_col_target(-1)
   , _has_selection(false)
   , _selection({{0, -1}, {0, -1}})
-  , _lines({""})
+  , _lines()
+  , _crlf_line_endings(false)
+  , _valid_utf8(true)
+  , _save_pending(false)
+  , _pending_edit_buffer_length(0)
+  , _edit_depth(0)
+  , _file_version(0)
+  , _find_regex(false)
+  , _match_selection_pending(false)
+  , _transaction_depth(0)
+  , _transaction_changed_lines(false)
+  , _transaction_first_row(0)
+  , _transaction_end_row(0)
+  , _transaction_old_end_row(0)
+  , _visible_rows(0, std::numeric_limits<uint32>::max())
 // , _buffer_incremental_render_update_commands(std::deque<BufferViewUpdateCommand>())
 {}
 
@@ -22,7 +43,21 @@ Buffer::Buffer(const std::string& init_string) noexcept
   , _cursor_col_target(-1)
   , _has_selection(false)
   , _selection({{0, -1}, {0, -1}})
-  , _lines({init_string})
+  , _lines(std::vector<std::string>{init_string})
+  , _crlf_line_endings(false)
+  , _valid_utf8(true)
+  , _save_pending(false)
+  , _pending_edit_buffer_length(0)
+  , _edit_depth(0)
+  , _file_version(0)
+  , _find_regex(false)
+  , _match_selection_pending(false)
+  , _transaction_depth(0)
+  , _transaction_changed_lines(false)
+  , _transaction_first_row(0)
+  , _transaction_end_row(0)
+  , _transaction_old_end_row(0)
+  , _visible_rows(0, std::numeric_limits<uint32>::max())
 // , _buffer_incremental_render_update_commands(std::deque<BufferViewUpdateCommand>())
 {}
 
@@ -33,68 +68,228 @@ Buffer::Buffer(const std::vector<std::string>& lines) noexcept
   , _has_selection(false)
   , _selection({{0, -1}, {0, -1}})
   , _lines(lines)
+  , _crlf_line_endings(false)
+  , _valid_utf8(true)
+  , _save_pending(false)
+  , _pending_edit_buffer_length(0)
+  , _edit_depth(0)
+  , _file_version(0)
+  , _find_regex(false)
+  , _match_selection_pending(false)
+  , _transaction_depth(0)
+  , _transaction_changed_lines(false)
+  , _transaction_first_row(0)
+  , _transaction_end_row(0)
+  , _transaction_old_end_row(0)
+  , _visible_rows(0, std::numeric_limits<uint32>::max())
 // , _buffer_incremental_render_update_commands(std::deque<BufferViewUpdateCommand>())
 {}
 
 bool Buffer::load_from_file(const std::string& filepath) noexcept
 {
-  std::ifstream file(filepath);
-  if(file.is_open()) [[likely]]
+  std::error_code error;
+  const std::uintmax_t file_size = std::filesystem::file_size(filepath, error);
+  if(error) [[unlikely]]
   {
-    _file_path = filepath;
-    // setting to defaults
-    _cursor_row = 0;
-    _cursor_col = -1;
-    _cursor_col_target = -1;
-    _has_selection = false;
-    _selection = {{0, -1}, {0, -1}};
-    _lines.clear();
-    // _buffer_incremental_render_update_commands.clear();
-    _buffer_incremental_render_update_commands.clear();
+    ERROR_BOII("Unable to open file: %s", filepath.c_str());
+    return false;
+  }
 
-    while(file.good())
+  const uint8 tab_width =
+    ConfigManager::get_instance()->get_config_struct().tab_width;
+  const uint32 large_file_threshold =
+    ConfigManager::get_instance()->get_config_struct().large_file_threshold;
+  const bool large_file =
+    file_size >=
+    static_cast<std::uintmax_t>(large_file_threshold) * 1024 * 1024;
+
+  // reading whole small files into the original buffer of piece table,
+  // in binary mode, line endings are handled while indexing
+  std::unique_ptr<char[]> text;
+  std::size_t text_size = 0;
+  MappedFile mapped_file;
+  if(large_file)
+  {
+    if(!mapped_file.open(filepath)) [[unlikely]]
     {
-      _lines.emplace_back("");
-      std::getline(file, _lines.back());
-
-      // replace all tabs with corresponding amount of spaces
-      uint8 tab_width =
-        ConfigManager::get_instance()->get_config_struct().tab_width;
-      auto it = _lines.back().find('\t');
-      while(it != std::string::npos)
-      {
-        _lines.back().replace(it, 1, std::string(tab_width, ' '));
-        it = _lines.back().find('\t');
-      }
+      return false;
+    }
+    text_size = mapped_file.size();
+  }
+  else
+  {
+    std::ifstream file(filepath, std::ios::binary);
+    if(!file.is_open()) [[unlikely]]
+    {
+      ERROR_BOII("Unable to open file: %s", filepath.c_str());
+      return false;
     }
+    text = std::make_unique<char[]>(file_size > 0 ? file_size : 1);
+    file.read(text.get(), static_cast<std::streamsize>(file_size));
+    text_size = file.gcount();
     file.close();
-    return true;
   }
-  else [[unlikely]]
+
+  this->_reset(filepath);
+
+  // tabs are replaced with corresponding amount of spaces while indexing,
+  // only lines with tabs are copied, others point into the original buffer
+  const char* data = large_file ? mapped_file.data() : text.get();
+  // small files are indexed completely
+  const std::size_t bytes_limit =
+    large_file ? first_screen_bytes : std::numeric_limits<std::size_t>::max();
+  std::size_t offset = 0;
+  LineBatch batch;
+  const bool indexed = LineIndexer::index_lines(
+    data, text_size, offset, bytes_limit, tab_width, batch);
+  _crlf_line_endings = batch.crlf_line_endings > batch.lf_line_endings;
+  _valid_utf8 = batch.valid_utf8;
+  if(!_valid_utf8)
   {
-    ERROR_BOII("Unable to open file: %s", filepath.c_str());
-    return false;
+    WARN_BOII("File is not valid UTF-8: %s", filepath.c_str());
+  }
+  if(large_file)
+  {
+    _lines.load(std::move(mapped_file), std::move(batch));
+    if(!indexed)
+    {
+      _line_indexer.start(data, text_size, offset, tab_width);
+    }
+  }
+  else
+  {
+    _lines.load(std::move(text), text_size, std::move(batch));
+  }
+  _file_version = _lines.version();
+  if(large_file && indexed)
+  {
+    this->_start_trigram_index();
   }
+  return true;
 }
 
-bool Buffer::save() noexcept
+bool Buffer::append_background_loaded_lines() noexcept
 {
-  std::ofstream file(_file_path);
-  if(file.is_open()) [[likely]]
+  _trigram_index.take_built_index();
+
+  bool appended = false;
+  const uint32 length = _lines.size();
+  const bool unedited = _lines.version() == _file_version;
+  while(std::optional<LineBatch> batch = _line_indexer.get_next_batch())
   {
-    for(const std::string& line : _lines)
+    if(_valid_utf8 && !batch.value().valid_utf8)
     {
-      file << line << "\n";
+      WARN_BOII("File is not valid UTF-8: %s", _file_path.c_str());
     }
-    file.close();
-    return true;
+    _valid_utf8 = _valid_utf8 && batch.value().valid_utf8;
+    _lines.append_lines(std::move(batch.value()));
+    appended = true;
   }
-  else
+  if(appended && unedited)
+  {
+    _file_version = _lines.version();
+  }
+  // only large files are loaded in background
+  if(appended && !_line_indexer.running())
+  {
+    this->_start_trigram_index();
+  }
+  // query can be searched before file is loaded
+  if(appended && !_search.query().empty())
+  {
+    _search.replace_lines(_lines.snapshot(), length, 0, _lines.size() - length);
+  }
+  if(appended && !_regex_search.pattern().empty())
+  {
+    _regex_search.replace_lines(
+      _lines.snapshot(), length, 0, _lines.size() - length);
+  }
+  // indexer isn't running only once all its lines are taken
+  if(_save_pending && !_line_indexer.running())
+  {
+    _save_pending = false;
+    if(!this->_start_save())
+    {
+      ERROR_BOII("Unable to start saving file: %s", _file_path.c_str());
+    }
+  }
+  return appended;
+}
+
+void Buffer::load_from_lines(const std::vector<std::string>& lines) noexcept
+{
+  this->_reset("");
+  _crlf_line_endings = false;
+  _valid_utf8 = true;
+  _lines = PieceTable(lines);
+}
+
+void Buffer::append_lines(const std::vector<std::string>& lines) noexcept
+{
+  if(lines.empty())
+  {
+    return;
+  }
+
+  const uint32 length = _lines.size();
+  _lines.insert_lines(
+    length, std::vector<std::string_view>(lines.begin(), lines.end()));
+  if(!_search.query().empty())
   {
-    ERROR_BOII("Unable to open file: %s, when trying to save.",
-               _file_path.c_str());
+    _search.replace_lines(_lines.snapshot(), length, 0, lines.size());
+  }
+  if(!_regex_search.pattern().empty())
+  {
+    _regex_search.replace_lines(_lines.snapshot(), length, 0, lines.size());
+  }
+}
+
+bool Buffer::is_valid_utf8() const noexcept
+{
+  return _valid_utf8;
+}
+
+bool Buffer::is_loading() const noexcept
+{
+  return _line_indexer.running();
+}
+
+bool Buffer::save() noexcept
+{
+  if(_file_path.empty())
+  {
+    ERROR_BOII("No file to save to!");
     return false;
   }
+  if(_file_saver.saving() || _save_pending)
+  {
+    ERROR_BOII("Already saving file: %s", _file_path.c_str());
+    return false;
+  }
+
+  // all lines are needed for writing, waiting for them here would
+  // freeze UI while a large file is loading
+  if(_line_indexer.running())
+  {
+    _save_pending = true;
+    return true;
+  }
+  return this->_start_save();
+}
+
+bool Buffer::is_saving() const noexcept
+{
+  return _save_pending || _file_saver.saving();
+}
+
+float32 Buffer::save_progress() const noexcept
+{
+  return _file_saver.progress();
+}
+
+std::optional<bool> Buffer::get_save_result() noexcept
+{
+  return _file_saver.get_result();
 }
 
 uint32 Buffer::length() const noexcept
@@ -116,12 +311,52 @@ Buffer::line_length(const uint32& line_index) const noexcept
   }
 }
 
-const std::vector<std::string>& Buffer::lines() const noexcept
+std::optional<std::size_t>
+Buffer::offset_of(const uint32& row, const int32& column) const noexcept
+{
+  if(row >= _lines.size() || column < -1 ||
+     column >= static_cast<int32>(_lines[row].size())) [[unlikely]]
+  {
+    ERROR_BOII("Accessing offset with position out of bounds!");
+    return std::nullopt;
+  }
+
+  return _lines.offset_of(row) + (column + 1);
+}
+
+std::pair<uint32, int32>
+Buffer::position_of(const std::size_t& offset) const noexcept
+{
+  const std::pair<uint32, std::size_t> position = _lines.position_of(offset);
+  return {position.first, static_cast<int32>(position.second) - 1};
+}
+
+uint32 Buffer::max_line_width() const noexcept
+{
+  return _lines.max_line_length();
+}
+
+const LineLayout& Buffer::line_layout(const uint32& line_index) const noexcept
+{
+  return _line_layouts.layout(_lines[line_index]);
+}
+
+const PieceTable& Buffer::lines() const noexcept
 {
   return _lines;
 }
 
-std::optional<const std::reference_wrapper<std::string>>
+PieceTableSnapshot Buffer::snapshot() const noexcept
+{
+  return _lines.snapshot();
+}
+
+std::uint64_t Buffer::version() const noexcept
+{
+  return _lines.version();
+}
+
+std::optional<std::string_view>
 Buffer::line(const uint32& line_index) const noexcept
 {
   if(line_index >= _lines.size()) [[unlikely]]
@@ -132,7 +367,7 @@ Buffer::line(const uint32& line_index) const noexcept
   }
   else [[likely]]
   {
-    return const_cast<std::string&>(_lines[line_index]);
+    return _lines[line_index];
   }
 }
 
@@ -214,6 +449,8 @@ uint32& Buffer::cursor_row() noexcept
 
 void Buffer::set_cursor_row(const uint32& row) noexcept
 {
+  _undo_history.break_coalescing();
+
   // early return if new row is same as current row
   if(row == _cursor_row)
   {
@@ -234,7 +471,7 @@ void Buffer::set_cursor_row(const uint32& row) noexcept
   cmd.type = IncrementalRenderUpdateType::RENDER_LINES;
   cmd.row_start = _cursor_row;
   cmd.row_end = row;
-  _buffer_incremental_render_update_commands.push_back(cmd);
+  this->_queue_render_update(cmd);
 
   // less optimized one
   // IncrementalRenderUpdateCommand cmd;
@@ -259,6 +496,8 @@ int32& Buffer::cursor_column() noexcept
 
 void Buffer::set_cursor_column(const int32& column) noexcept
 {
+  _undo_history.break_coalescing();
+
   // early return if new column is same as current column
   //  if(column == _cursor_col)
   //  {
@@ -268,13 +507,16 @@ void Buffer::set_cursor_column(const int32& column) noexcept
   IncrementalRenderUpdateCommand cmd;
   cmd.type = IncrementalRenderUpdateType::RENDER_LINE;
   cmd.row_start = _cursor_row;
-  _buffer_incremental_render_update_commands.push_back(cmd);
+  this->_queue_render_update(cmd);
   _cursor_col = column;
 }
 
 void Buffer::set_cursor_column_target(const int32& column_target) noexcept
 {
-  _cursor_col_target = column_target;
+  _cursor_col_target =
+    static_cast<int32>(
+      this->line_layout(_cursor_row).cells_before(column_target)) -
+    1;
 }
 
 bool Buffer::has_selection() const noexcept
@@ -294,7 +536,7 @@ void Buffer::clear_selection() noexcept
   cmd.type = IncrementalRenderUpdateType::RENDER_LINES_IN_RANGE;
   cmd.row_start = selection.first.first;
   cmd.row_end = selection.second.first;
-  _buffer_incremental_render_update_commands.push_back(cmd);
+  this->_queue_render_update(cmd);
   _has_selection = false;
 }
 
@@ -402,7 +644,7 @@ void Buffer::set_selection_end_coordinate(
     IncrementalRenderUpdateCommand cmd{};
     cmd.type = IncrementalRenderUpdateType::RENDER_LINE;
     cmd.row_start = _selection.first.first;
-    _buffer_incremental_render_update_commands.emplace_back(cmd);
+    this->_queue_render_update(cmd);
   }
   else
   {
@@ -417,7 +659,7 @@ void Buffer::set_selection_end_coordinate(
       cmd.type = IncrementalRenderUpdateType::RENDER_LINES_IN_RANGE;
       cmd.row_start = std::min(_selection.first.first, coordinate.first);
       cmd.row_end = std::max(_selection.first.first, coordinate.first);
-      _buffer_incremental_render_update_commands.emplace_back(cmd);
+      this->_queue_render_update(cmd);
     }
     else
     {
@@ -427,7 +669,7 @@ void Buffer::set_selection_end_coordinate(
       cmd.type = IncrementalRenderUpdateType::RENDER_LINES_IN_RANGE;
       cmd.row_start = std::min(_selection.second.first, coordinate.first);
       cmd.row_end = std::max(_selection.second.first, coordinate.first);
-      _buffer_incremental_render_update_commands.emplace_back(cmd);
+      this->_queue_render_update(cmd);
     }
   }
 
@@ -437,6 +679,7 @@ void Buffer::set_selection_end_coordinate(
 
 void Buffer::execute_cursor_command(const BufferCursorCommand& command) noexcept
 {
+  _undo_history.break_coalescing();
   switch(command)
   {
   case BufferCursorCommand::MOVE_LEFT: {
@@ -445,11 +688,11 @@ void Buffer::execute_cursor_command(const BufferCursorCommand& command) noexcept
       auto selection = this->selection().value();
       _cursor_row = selection.first.first;
       _cursor_col = selection.first.second;
-      _cursor_col_target = _cursor_col;
+      this->_update_cursor_column_target();
       _has_selection = false;
       IncrementalRenderUpdateCommand cmd;
       cmd.type = IncrementalRenderUpdateType::RENDER_CURSOR;
-      _buffer_incremental_render_update_commands.push_back(cmd);
+      this->_queue_render_update(cmd);
       cmd.type = IncrementalRenderUpdateType::RENDER_CHARACTER;
       cmd.row_start = selection.first.first;
       cmd.row_end = selection.second.first;
@@ -466,13 +709,13 @@ void Buffer::execute_cursor_command(const BufferCursorCommand& command) noexcept
       auto selection = this->selection().value();
       _cursor_row = selection.second.first;
       _cursor_col = selection.second.second;
-      _cursor_col_target = _cursor_col;
+      this->_update_cursor_column_target();
       _has_selection = false;
       IncrementalRenderUpdateCommand cmd;
       cmd.type = IncrementalRenderUpdateType::RENDER_LINES_IN_RANGE;
       cmd.row_start = selection.first.first;
       cmd.row_end = selection.second.first;
-      _buffer_incremental_render_update_commands.push_back(cmd);
+      this->_queue_render_update(cmd);
       return;
     }
 
@@ -486,7 +729,7 @@ void Buffer::execute_cursor_command(const BufferCursorCommand& command) noexcept
       auto selection = this->selection().value();
       _cursor_row = selection.first.first;
       _cursor_col = selection.first.second;
-      _cursor_col_target = _cursor_col;
+      this->_update_cursor_column_target();
       _has_selection = false;
       IncrementalRenderUpdateCommand cmd;
       cmd.type = IncrementalRenderUpdateType::RENDER_LINES_IN_RANGE;
@@ -494,17 +737,13 @@ void Buffer::execute_cursor_command(const BufferCursorCommand& command) noexcept
       if(_cursor_row == 0)
       {
         cmd.row_start = selection.first.first;
-        _buffer_incremental_render_update_commands.push_back(cmd);
+        this->_queue_render_update(cmd);
         return;
       }
       --_cursor_row;
       cmd.row_start = _cursor_row;
-      if(static_cast<int32>(_lines[_cursor_row].size() - 1) <
-         _cursor_col_target)
-      {
-        _cursor_col = _lines[_cursor_row].size() - 1;
-      }
-      _buffer_incremental_render_update_commands.push_back(cmd);
+      _cursor_col = this->_cursor_column_for_target();
+      this->_queue_render_update(cmd);
       return;
     }
 
@@ -518,7 +757,7 @@ void Buffer::execute_cursor_command(const BufferCursorCommand& command) noexcept
       auto selection = this->selection().value();
       _cursor_row = selection.second.first;
       _cursor_col = selection.second.second;
-      _cursor_col_target = _cursor_col;
+      this->_update_cursor_column_target();
       _has_selection = false;
       IncrementalRenderUpdateCommand cmd;
       cmd.type = IncrementalRenderUpdateType::RENDER_LINES_IN_RANGE;
@@ -526,17 +765,13 @@ void Buffer::execute_cursor_command(const BufferCursorCommand& command) noexcept
       if(_cursor_row == _lines.size() - 1)
       {
         cmd.row_end = selection.second.first;
-        _buffer_incremental_render_update_commands.push_back(cmd);
+        this->_queue_render_update(cmd);
         return;
       }
       ++_cursor_row;
       cmd.row_end = _cursor_row;
-      if(static_cast<int32>(_lines[_cursor_row].size() - 1) <
-         _cursor_col_target)
-      {
-        _cursor_col = _lines[_cursor_row].size() - 1;
-      }
-      _buffer_incremental_render_update_commands.push_back(cmd);
+      _cursor_col = this->_cursor_column_for_target();
+      this->_queue_render_update(cmd);
       return;
     }
 
@@ -584,6 +819,7 @@ void Buffer::execute_cursor_command(const BufferCursorCommand& command) noexcept
 void Buffer::execute_selection_command(
   const BufferSelectionCommand& command) noexcept
 {
+  _undo_history.break_coalescing();
   switch(command)
   {
   case BufferSelectionCommand::MOVE_LEFT: {
@@ -747,41 +983,29 @@ void Buffer::execute_selection_command(
     break;
   }
   case BufferSelectionCommand::SELECT_WORD: {
-    std::string word_delimiters = " \t\n/\\()\"':,.;<>~!@#$%^&*|+=[]{}`?-";
-    int16 left = 0, right = 1;
-    while(_cursor_col - left != -1)
-    {
-      if(word_delimiters.find(_lines[_cursor_row][_cursor_col - left]) !=
-         std::string::npos)
-      {
-        break;
-      }
-      left++;
-    }
-    while(_cursor_col + right < _lines[_cursor_row].size())
-    {
-      if(word_delimiters.find(_lines[_cursor_row][_cursor_col + right]) !=
-         std::string::npos)
-      {
-        break;
-      }
-      right++;
-    }
-    if(left == 0 && right == 0)
+    // word around cursor, bytes before and after it
+    const std::string_view line = _lines[_cursor_row];
+    const WordClasses& word_classes =
+      ConfigManager::get_instance()->get_config_struct().word_classes;
+    const int32 first =
+      static_cast<int32>(word_start(word_classes, line, _cursor_col + 1));
+    const int32 end =
+      static_cast<int32>(word_end(word_classes, line, _cursor_col + 1));
+    if(first == end)
     {
       return;
     }
 
     _has_selection = true;
     _selection.first.first = _cursor_row;
-    _selection.first.second = _cursor_col - left;
+    _selection.first.second = first - 1;
     _selection.second.first = _cursor_row;
-    _selection.second.second = _cursor_col + right - 1;
-    _cursor_col += right - 1;
+    _selection.second.second = end - 1;
+    _cursor_col = end - 1;
     IncrementalRenderUpdateCommand cmd;
     cmd.type = IncrementalRenderUpdateType::RENDER_LINE;
     cmd.row_start = _cursor_row;
-    _buffer_incremental_render_update_commands.push_back(cmd);
+    this->_queue_render_update(cmd);
     break;
   }
   case BufferSelectionCommand::SELECT_LINE: {
@@ -798,7 +1022,7 @@ void Buffer::execute_selection_command(
       IncrementalRenderUpdateCommand cmd;
       cmd.type = IncrementalRenderUpdateType::RENDER_LINE;
       cmd.row_start = _cursor_row;
-      _buffer_incremental_render_update_commands.push_back(cmd);
+      this->_queue_render_update(cmd);
     }
     else
     {
@@ -810,7 +1034,7 @@ void Buffer::execute_selection_command(
       cmd.row_start = _cursor_row;
       _cursor_row += 1;
       cmd.row_end = _cursor_row;
-      _buffer_incremental_render_update_commands.push_back(cmd);
+      this->_queue_render_update(cmd);
     }
     break;
   }
@@ -899,65 +1123,75 @@ bool Buffer::process_backspace() noexcept
 
   if(_cursor_col != -1)
   {
+    this->_begin_edit(_cursor_row, _cursor_row + 1);
     int32 leading_spaces_count = this->_line_leading_spaces_count(_cursor_row);
     int32 tab_width =
       ConfigManager::get_instance()->get_config_struct().tab_width;
 
+    std::string line(_lines[_cursor_row]);
     if(_cursor_col < leading_spaces_count && (_cursor_col + 1) % tab_width == 0)
     {
       // delete tab width amount of spaces
-      _lines[_cursor_row].erase(0, tab_width);
+      line.erase(0, tab_width);
       _cursor_col -= tab_width;
     }
     else if(this->_cursor_between_brackets())
     {
       // auto deleting closing bracket
-      _lines[_cursor_row].erase(_cursor_col, 2);
+      line.erase(_cursor_col, 2);
       _cursor_col -= 1;
     }
     else
     {
-      // remove character before cursor
-      _lines[_cursor_row].erase(_cursor_col, 1);
-      _cursor_col -= 1;
+      // remove character (whole grapheme cluster) before cursor
+      const int32 previous_column =
+        this->line_layout(_cursor_row).previous_column(_cursor_col);
+      line.erase(previous_column + 1, _cursor_col - previous_column);
+      _cursor_col = previous_column;
     }
+    _lines.set_line(_cursor_row, line);
 
     {
       IncrementalRenderUpdateCommand cmd;
       cmd.type = IncrementalRenderUpdateType::RENDER_LINE;
       cmd.row_start = _cursor_row;
-      _buffer_incremental_render_update_commands.emplace_back(cmd);
+      this->_queue_render_update(cmd);
     }
     {
       TokenCacheUpdateCommand cmd{};
       cmd.type = TokenCacheUpdateCommandType::RETOKENIZE_LINE;
       cmd.row = _cursor_row;
-      _token_cache_update_commands_queue.emplace_back(cmd);
+      this->_queue_token_cache_update(cmd);
     }
+    this->_end_edit(EditKind::DELETE_CHARACTERS);
     return true;
   }
 
   // append the contents of this string to above line
+  this->_begin_edit(_cursor_row - 1, _cursor_row + 1);
   _cursor_col = _lines[_cursor_row - 1].size() - 1;
-  _lines[_cursor_row - 1].append(_lines[_cursor_row]);
+  _lines.set_line(_cursor_row - 1,
+                  std::string(_lines[_cursor_row - 1])
+                    .append(_lines[_cursor_row]));
   {
     TokenCacheUpdateCommand cmd{};
     cmd.type = TokenCacheUpdateCommandType::DELETE_LINE_CACHE;
     cmd.row = _cursor_row;
-    _token_cache_update_commands_queue.emplace_back(cmd);
+    this->_queue_token_cache_update(cmd);
     cmd.type = TokenCacheUpdateCommandType::RETOKENIZE_LINE;
     cmd.row = _cursor_row - 1;
-    _token_cache_update_commands_queue.emplace_back(cmd);
+    this->_queue_token_cache_update(cmd);
   }
-  _lines.erase(_lines.begin() + _cursor_row);
+  _lines.erase_lines(_cursor_row, _cursor_row + 1);
   _cursor_row -= 1;
   {
     IncrementalRenderUpdateCommand cmd;
     cmd.type = IncrementalRenderUpdateType::RENDER_LINES_IN_RANGE;
     cmd.row_start = _cursor_row;
     cmd.row_end = _lines.size() - 1;
-    _buffer_incremental_render_update_commands.push_back(cmd);
+    this->_queue_render_update(cmd);
   }
+  this->_end_edit(EditKind::OTHER);
   return true;
 }
 
@@ -965,8 +1199,14 @@ void Buffer::process_enter() noexcept
 {
   if(_has_selection)
   {
+    auto sel = this->selection().value();
+    this->_begin_edit(sel.first.first, sel.second.first + 1);
     this->_delete_selection();
   }
+  else
+  {
+    this->_begin_edit(_cursor_row, _cursor_row + 1);
+  }
 
   uint32 leading_spaces = this->_line_leading_spaces_count(_cursor_row);
   uint8 tab_width =
@@ -978,26 +1218,28 @@ void Buffer::process_enter() noexcept
     // insert leading space of this line + extra indent into new line
     // insert another new line, with same amount if leading spaces as this line
     // and append contents of this line after the cursor to another new line
-    _lines.insert(_lines.begin() + _cursor_row + 1,
-                  std::string(leading_spaces + tab_width, ' '));
-    _lines.insert(_lines.begin() + _cursor_row + 2,
-                  std::string(leading_spaces, ' '));
-    _lines[_cursor_row + 2].append(_lines[_cursor_row].substr(_cursor_col + 1));
-    _lines[_cursor_row].erase(_cursor_col + 1);
+    const std::string line(_lines[_cursor_row]);
+    const std::string indented_line(leading_spaces + tab_width, ' ');
+    const std::string closing_line =
+      std::string(leading_spaces, ' ').append(line, _cursor_col + 1);
+    _lines.set_line(_cursor_row,
+                    std::string_view(line).substr(0, _cursor_col + 1));
+    _lines.insert_lines(_cursor_row + 1, {indented_line, closing_line});
 
     // updating token cache
     TokenCacheUpdateCommand cmd{};
     cmd.type = TokenCacheUpdateCommandType::RETOKENIZE_LINE;
     cmd.row = _cursor_row;
-    _token_cache_update_commands_queue.emplace_back(cmd);
+    this->_queue_token_cache_update(cmd);
     cmd.type = TokenCacheUpdateCommandType::INSERT_NEW_LINE_CACHE_AND_TOKENIZE;
-    _token_cache_update_commands_queue.emplace_back(cmd);
+    this->_queue_token_cache_update(cmd);
     cmd.row = _cursor_row + 1;
-    _token_cache_update_commands_queue.emplace_back(cmd);
+    this->_queue_token_cache_update(cmd);
 
     // updating cursor position
     _cursor_row += 1;
     _cursor_col = leading_spaces + tab_width - 1;
+    this->_end_edit(EditKind::OTHER);
     return;
   }
 
@@ -1006,10 +1248,12 @@ void Buffer::process_enter() noexcept
     // insert new line after this line
     // insert leading space of this line + extra indent into new line
     // and append contents of this line after the cursor to new line
-    _lines.insert(_lines.begin() + _cursor_row + 1,
-                  std::string(leading_spaces + tab_width, ' '));
-    _lines[_cursor_row + 1].append(_lines[_cursor_row].substr(_cursor_col + 1));
-    _lines[_cursor_row].erase(_cursor_col + 1);
+    const std::string line(_lines[_cursor_row]);
+    _lines.set_line(_cursor_row,
+                    std::string_view(line).substr(0, _cursor_col + 1));
+    _lines.insert_line(
+      _cursor_row + 1,
+      std::string(leading_spaces + tab_width, ' ').append(line, _cursor_col + 1));
 
     // updating cursor column
     _cursor_col = leading_spaces + tab_width - 1;
@@ -1019,10 +1263,12 @@ void Buffer::process_enter() noexcept
     // insert new line after this line
     // insert leading spaces of this line into new line
     // and append contents of this line after the cursor to new line
-    _lines.insert(_lines.begin() + _cursor_row + 1,
-                  std::string(leading_spaces, ' '));
-    _lines[_cursor_row + 1].append(_lines[_cursor_row].substr(_cursor_col + 1));
-    _lines[_cursor_row].erase(_cursor_col + 1);
+    const std::string line(_lines[_cursor_row]);
+    _lines.set_line(_cursor_row,
+                    std::string_view(line).substr(0, _cursor_col + 1));
+    _lines.insert_line(
+      _cursor_row + 1,
+      std::string(leading_spaces, ' ').append(line, _cursor_col + 1));
 
     // updating cursor column
     _cursor_col = leading_spaces - 1;
@@ -1033,9 +1279,9 @@ void Buffer::process_enter() noexcept
     TokenCacheUpdateCommand cmd{};
     cmd.type = TokenCacheUpdateCommandType::RETOKENIZE_LINE;
     cmd.row = _cursor_row;
-    _token_cache_update_commands_queue.emplace_back(cmd);
+    this->_queue_token_cache_update(cmd);
     cmd.type = TokenCacheUpdateCommandType::INSERT_NEW_LINE_CACHE_AND_TOKENIZE;
-    _token_cache_update_commands_queue.emplace_back(cmd);
+    this->_queue_token_cache_update(cmd);
   }
   {
     IncrementalRenderUpdateCommand cmd;
@@ -1043,14 +1289,20 @@ void Buffer::process_enter() noexcept
     cmd.row_start = _cursor_row;
     _cursor_row += 1;
     cmd.row_end = _lines.size() - 1;
-    _buffer_incremental_render_update_commands.push_back(cmd);
+    this->_queue_render_update(cmd);
   }
+  this->_end_edit(EditKind::OTHER);
 }
 
 void Buffer::insert_string(const std::string& str) noexcept
 {
+  // typing over a selection replaces it, which isn't coalesced
+  const EditKind edit_kind =
+    _has_selection ? EditKind::OTHER : EditKind::INSERT_CHARACTERS;
   if(_has_selection)
   {
+    auto sel = this->selection().value();
+    this->_begin_edit(sel.first.first, sel.second.first + 1);
     if(str == "(" || str == "[" || str == "{" || str == "\"" || str == "'")
     {
       if(str == "(")
@@ -1082,16 +1334,17 @@ void Buffer::insert_string(const std::string& str) noexcept
         TokenCacheUpdateCommand cmd{};
         cmd.type = TokenCacheUpdateCommandType::RETOKENIZE_LINE;
         cmd.row = sel.first.first;
-        _token_cache_update_commands_queue.emplace_back(cmd);
+        this->_queue_token_cache_update(cmd);
 
         // for multiline selection
         // re-tokenization of selection ending line is also needed
         if(sel.first.first != sel.second.first)
         {
           cmd.row = sel.second.first;
-          _token_cache_update_commands_queue.emplace_back(cmd);
+          this->_queue_token_cache_update(cmd);
         }
       }
+      this->_end_edit(EditKind::OTHER);
       return;
     }
     else
@@ -1099,57 +1352,409 @@ void Buffer::insert_string(const std::string& str) noexcept
       this->_delete_selection();
     }
   }
+  else
+  {
+    this->_begin_edit(_cursor_row, _cursor_row + 1);
+  }
 
   // auto closing open brackets
+  std::string line(_lines[_cursor_row]);
   if(str == "(")
   {
     std::string str_to_insert("()");
-    _lines[_cursor_row].insert(_cursor_col + 1, str_to_insert);
+    line.insert(_cursor_col + 1, str_to_insert);
     _cursor_col += 1;
   }
   else if(str == "[")
   {
     std::string str_to_insert("[]");
-    _lines[_cursor_row].insert(_cursor_col + 1, str_to_insert);
+    line.insert(_cursor_col + 1, str_to_insert);
     _cursor_col += 1;
   }
   else if(str == "{")
   {
     std::string str_to_insert("{}");
-    _lines[_cursor_row].insert(_cursor_col + 1, str_to_insert);
+    line.insert(_cursor_col + 1, str_to_insert);
     _cursor_col += 1;
   }
   else if(str == "\"")
   {
     std::string str_to_insert("\"\"");
-    _lines[_cursor_row].insert(_cursor_col + 1, str_to_insert);
+    line.insert(_cursor_col + 1, str_to_insert);
     _cursor_col += 1;
   }
   else if(str == "'")
   {
     std::string str_to_insert("''");
-    _lines[_cursor_row].insert(_cursor_col + 1, str_to_insert);
+    line.insert(_cursor_col + 1, str_to_insert);
     _cursor_col += 1;
   }
   // else inserting string normally
   else
   {
-    _lines[_cursor_row].insert(_cursor_col + 1, str);
+    line.insert(_cursor_col + 1, str);
     _cursor_col += str.size();
   }
+  _lines.set_line(_cursor_row, line);
 
   {
     IncrementalRenderUpdateCommand cmd;
     cmd.type = IncrementalRenderUpdateType::RENDER_LINE;
     cmd.row_start = _cursor_row;
-    _buffer_incremental_render_update_commands.push_back(cmd);
+    this->_queue_render_update(cmd);
   }
   {
     TokenCacheUpdateCommand cmd{};
     cmd.type = TokenCacheUpdateCommandType::RETOKENIZE_LINE;
     cmd.row = _cursor_row;
+    this->_queue_token_cache_update(cmd);
+  }
+  this->_end_edit(edit_kind);
+}
+
+bool Buffer::undo() noexcept
+{
+  const EditDelta* delta = _undo_history.undo();
+  if(!delta)
+  {
+    return false;
+  }
+
+  this->begin_transaction();
+  this->_apply_edit(delta->row,
+                    delta->new_lines.size(),
+                    delta->old_lines,
+                    delta->cursor_before);
+  this->commit_transaction();
+  this->_compact_lines();
+  return true;
+}
+
+bool Buffer::redo() noexcept
+{
+  const EditDelta* delta = _undo_history.redo();
+  if(!delta)
+  {
+    return false;
+  }
+
+  this->begin_transaction();
+  this->_apply_edit(delta->row,
+                    delta->old_lines.size(),
+                    delta->new_lines,
+                    delta->cursor_after);
+  this->commit_transaction();
+  this->_compact_lines();
+  return true;
+}
+
+void Buffer::begin_transaction() noexcept
+{
+  if(_transaction_depth++ > 0)
+  {
+    return;
+  }
+
+  _transaction_render_rows.clear();
+  _transaction_changed_lines = false;
+}
+
+void Buffer::commit_transaction() noexcept
+{
+  if(--_transaction_depth > 0)
+  {
+    return;
+  }
+
+  // one re-tokenization for all changed lines
+  if(_transaction_changed_lines)
+  {
+    TokenCacheUpdateCommand cmd{};
+    cmd.type = TokenCacheUpdateCommandType::RETOKENIZE_LINES;
+    cmd.start_row = _transaction_first_row;
+    cmd.end_row = _transaction_old_end_row;
+    cmd.line_count = _transaction_end_row - _transaction_first_row;
     _token_cache_update_commands_queue.emplace_back(cmd);
   }
+
+  if(_transaction_changed_lines && !_search.query().empty())
+  {
+    _search.replace_lines(_lines.snapshot(),
+                          _transaction_first_row,
+                          _transaction_old_end_row - _transaction_first_row,
+                          _transaction_end_row - _transaction_first_row);
+  }
+  if(_transaction_changed_lines && !_regex_search.pattern().empty())
+  {
+    _regex_search.replace_lines(
+      _lines.snapshot(),
+      _transaction_first_row,
+      _transaction_old_end_row - _transaction_first_row,
+      _transaction_end_row - _transaction_first_row);
+  }
+  if(_transaction_changed_lines)
+  {
+    _trigram_index.replace_lines(
+      _transaction_first_row,
+      _transaction_old_end_row - _transaction_first_row,
+      _transaction_end_row - _transaction_first_row);
+  }
+
+  // ranges are merged, lines erased by the transaction
+  // and lines outside window are dropped
+  const uint32 last_row = std::min<uint32>(_visible_rows.second,
+                                           _lines.size() - 1);
+  for(const std::pair<uint32, uint32>& rows : _transaction_render_rows)
+  {
+    if(rows.second < _visible_rows.first || rows.first > last_row)
+    {
+      continue;
+    }
+
+    IncrementalRenderUpdateCommand cmd;
+    cmd.type = IncrementalRenderUpdateType::RENDER_LINES_IN_RANGE;
+    cmd.row_start = std::max(rows.first, _visible_rows.first);
+    cmd.row_end = std::min(rows.second, last_row);
+    _buffer_incremental_render_update_commands.push_back(cmd);
+  }
+  _transaction_render_rows.clear();
+}
+
+void Buffer::find(const std::string& query,
+                  const bool& case_sensitive,
+                  const bool& regex) noexcept
+{
+  _find_regex = regex;
+  _match_selection_pending = false;
+  if(regex)
+  {
+    _search.clear();
+    _regex_search.search(_lines.snapshot(), query, case_sensitive);
+  }
+  else
+  {
+    _regex_search.clear();
+    const PieceTableSnapshot lines = _lines.snapshot();
+    _search.search(lines,
+                   query,
+                   case_sensitive,
+                   _trigram_index.candidate_rows(lines, query));
+  }
+}
+
+bool Buffer::append_found_matches() noexcept
+{
+  if(_regex_search.pattern().empty() ||
+     !_regex_search.take_matches(_lines.snapshot()))
+  {
+    return false;
+  }
+
+  if(_match_selection_pending)
+  {
+    this->select_nearest_match();
+  }
+  return true;
+}
+
+const std::vector<TextMatch>& Buffer::matches() const noexcept
+{
+  return _find_regex ? _regex_search.matches() : _search.matches();
+}
+
+std::size_t Buffer::found_matches_count() const noexcept
+{
+  return _find_regex ? _regex_search.found_count() : _search.matches().size();
+}
+
+bool Buffer::is_find_query_valid() const noexcept
+{
+  return !_find_regex || _regex_search.pattern().empty() ||
+         _regex_search.valid();
+}
+
+bool Buffer::is_finding() const noexcept
+{
+  return _find_regex && _regex_search.running();
+}
+
+float32 Buffer::find_progress() const noexcept
+{
+  return _find_regex ? _regex_search.progress() : 1.0f;
+}
+
+bool Buffer::is_match_selection_pending() const noexcept
+{
+  return _match_selection_pending;
+}
+
+bool Buffer::select_nearest_match() noexcept
+{
+  const std::vector<TextMatch>& matches = this->matches();
+  const std::pair<uint32, int32> start =
+    _has_selection ? this->selection().value().first
+                   : std::make_pair(_cursor_row, _cursor_col);
+  const std::size_t index =
+    first_match_from(matches, start.first, start.second + 1);
+
+  // match after selection may not be found yet
+  _match_selection_pending = index == matches.size() && this->is_finding();
+  if(matches.empty() || _match_selection_pending)
+  {
+    return false;
+  }
+
+  this->_select_match(index == matches.size() ? 0 : index);
+  return true;
+}
+
+bool Buffer::select_next_match() noexcept
+{
+  const std::vector<TextMatch>& matches = this->matches();
+  if(matches.empty())
+  {
+    return false;
+  }
+
+  // selected match is skipped, match at cursor isn't
+  const std::pair<uint32, int32> start =
+    _has_selection ? std::make_pair(this->selection().value().first.first,
+                                    this->selection().value().first.second + 1)
+                   : std::make_pair(_cursor_row, _cursor_col);
+  const std::size_t index =
+    first_match_from(matches, start.first, start.second + 1);
+  _match_selection_pending = false;
+  this->_select_match(index == matches.size() ? 0 : index);
+  return true;
+}
+
+bool Buffer::select_previous_match() noexcept
+{
+  const std::vector<TextMatch>& matches = this->matches();
+  if(matches.empty())
+  {
+    return false;
+  }
+
+  const std::pair<uint32, int32> start =
+    _has_selection ? this->selection().value().first
+                   : std::make_pair(_cursor_row, _cursor_col);
+  const std::size_t index =
+    first_match_from(matches, start.first, start.second + 1);
+  _match_selection_pending = false;
+  this->_select_match(index == 0 ? matches.size() - 1 : index - 1);
+  return true;
+}
+
+bool Buffer::replace_all(const std::string& replacement) noexcept
+{
+  if(this->is_finding())
+  {
+    return false;
+  }
+
+  return this->replace_ranges(this->matches(), replacement);
+}
+
+bool Buffer::replace_ranges(const std::vector<TextMatch>& ranges,
+                            const std::string& replacement) noexcept
+{
+  // ranges may be stale (found before lines were edited), ones outside
+  // current lines are dropped
+  const uint32 line_count = this->length();
+  uint32 first_row = line_count, last_row = 0;
+  for(const TextMatch& range : ranges)
+  {
+    if(range.row < line_count)
+    {
+      first_row = std::min(first_row, range.row);
+      last_row = std::max(last_row, range.row);
+    }
+  }
+  if(first_row == line_count)
+  {
+    return false;
+  }
+
+  // lines between first and last lines of ranges are replaced in one edit,
+  // lines without ranges keep their pieces, so their text isn't copied
+  EditDelta delta;
+  delta.row = first_row;
+  delta.old_lines = _lines.pieces(first_row, last_row + 1);
+  delta.new_lines = delta.old_lines;
+  delta.cursor_before = {_cursor_row, _cursor_col};
+  delta.cursor_after = delta.cursor_before;
+  delta.kind = EditKind::OTHER;
+
+  std::string line;
+  uint32 next_row = first_row;
+  bool replaced = false;
+  auto range = ranges.cbegin();
+  while(range != ranges.cend())
+  {
+    const uint32 row = range->row;
+    if(row < next_row || row >= line_count)
+    {
+      // out of order, or outside lines
+      range++;
+      continue;
+    }
+
+    const Piece& piece = delta.old_lines[row - delta.row];
+    const std::string_view text(piece.data, piece.length);
+    line.clear();
+    std::size_t column = 0;
+    bool line_replaced = false;
+    for(; range != ranges.cend() && range->row == row; range++)
+    {
+      if(range->column < column || range->column > text.size() ||
+         range->length > text.size() - range->column)
+      {
+        // overlapping a replaced range, or past end of line
+        continue;
+      }
+      line.append(text.substr(column, range->column - column));
+      line.append(replacement);
+      column = range->column + range->length;
+      line_replaced = true;
+    }
+    next_row = row + 1;
+    if(!line_replaced)
+    {
+      // no range of line is inside it
+      continue;
+    }
+    line.append(text.substr(column));
+    delta.new_lines[row - delta.row] = _lines.add_text(line);
+    replaced = true;
+
+    // cursor could be inside a replaced range
+    if(row == _cursor_row)
+    {
+      delta.cursor_after.second = -1;
+    }
+  }
+  if(!replaced)
+  {
+    return false;
+  }
+
+  // one render update and one re-tokenization for all replaced lines
+  this->begin_transaction();
+  this->_apply_edit(delta.row,
+                    delta.old_lines.size(),
+                    delta.new_lines,
+                    delta.cursor_after);
+  this->commit_transaction();
+  _undo_history.record(std::move(delta));
+  this->_compact_lines();
+  return true;
+}
+
+void Buffer::set_visible_rows(const uint32& first_row,
+                              const uint32& last_row) noexcept
+{
+  _visible_rows = {first_row, last_row};
 }
 
 // std::optional<BufferViewUpdateCommand>
@@ -1202,16 +1807,143 @@ Buffer::get_next_token_cache_update_command() noexcept
   return cmd;
 }
 
+void Buffer::_select_match(const std::size_t& index) noexcept
+{
+  const TextMatch& match = this->matches()[index];
+  const int32 start = static_cast<int32>(match.column) - 1;
+  const int32 end = start + static_cast<int32>(match.length);
+  if(_has_selection)
+  {
+    this->clear_selection();
+  }
+
+  this->set_cursor_row(match.row);
+  this->set_cursor_column(end);
+  this->_update_cursor_column_target();
+  _selection = {{match.row, start}, {match.row, end}};
+  _has_selection = true;
+
+  IncrementalRenderUpdateCommand cmd;
+  cmd.type = IncrementalRenderUpdateType::RENDER_LINE;
+  cmd.row_start = match.row;
+  this->_queue_render_update(cmd);
+}
+
+void Buffer::_queue_render_update(
+  const IncrementalRenderUpdateCommand& command) noexcept
+{
+  if(_transaction_depth == 0)
+  {
+    _buffer_incremental_render_update_commands.push_back(command);
+    return;
+  }
+
+  if(command.type == IncrementalRenderUpdateType::RENDER_LINES_IN_RANGE)
+  {
+    this->_add_transaction_render_rows(command.row_start, command.row_end);
+  }
+  else if(command.type == IncrementalRenderUpdateType::RENDER_LINES)
+  {
+    this->_add_transaction_render_rows(command.row_start, command.row_start);
+    this->_add_transaction_render_rows(command.row_end, command.row_end);
+  }
+  else
+  {
+    // slices, characters and cursor are rendered with their line
+    this->_add_transaction_render_rows(command.row_start, command.row_start);
+  }
+}
+
+void Buffer::_queue_token_cache_update(
+  const TokenCacheUpdateCommand& command) noexcept
+{
+  if(_transaction_depth == 0)
+  {
+    _token_cache_update_commands_queue.push_back(command);
+    return;
+  }
+
+  // commands are applied in order, so rows of each command are rows
+  // of lines after commands before it
+  switch(command.type)
+  {
+    case TokenCacheUpdateCommandType::RETOKENIZE_LINE:
+      this->_add_transaction_lines(command.row, 1, 1);
+      break;
+    case TokenCacheUpdateCommandType::INSERT_NEW_LINE_CACHE_AND_TOKENIZE:
+      this->_add_transaction_lines(command.row, 1, 2);
+      break;
+    case TokenCacheUpdateCommandType::DELETE_LINE_CACHE:
+      this->_add_transaction_lines(command.row, 1, 0);
+      break;
+    case TokenCacheUpdateCommandType::DELETE_LINES_CACHE:
+      this->_add_transaction_lines(
+        command.start_row, command.end_row + 1 - command.start_row, 0);
+      break;
+    case TokenCacheUpdateCommandType::RETOKENIZE_LINES:
+      this->_add_transaction_lines(command.start_row,
+                                   command.end_row - command.start_row,
+                                   command.line_count);
+      break;
+  }
+}
+
+void Buffer::_add_transaction_render_rows(const uint32& first_row,
+                                          const uint32& last_row) noexcept
+{
+  // rows touching the new rows are merged into them
+  std::pair<uint32, uint32> rows(first_row, last_row);
+  auto it = std::lower_bound(_transaction_render_rows.begin(),
+                             _transaction_render_rows.end(),
+                             rows.first,
+                             [](const std::pair<uint32, uint32>& range,
+                                const uint32& row)
+                             {
+                               return range.second + 1 < row;
+                             });
+  auto end = it;
+  while(end != _transaction_render_rows.end() &&
+        end->first <= rows.second + 1)
+  {
+    rows.first = std::min(rows.first, end->first);
+    rows.second = std::max(rows.second, end->second);
+    end++;
+  }
+  it = _transaction_render_rows.erase(it, end);
+  _transaction_render_rows.insert(it, rows);
+}
+
+void Buffer::_add_transaction_lines(const uint32& row,
+                                    const uint32& count,
+                                    const uint32& new_count) noexcept
+{
+  if(!_transaction_changed_lines)
+  {
+    _transaction_changed_lines = true;
+    _transaction_first_row = row;
+    _transaction_end_row = row + new_count;
+    _transaction_old_end_row = row + count;
+    return;
+  }
+
+  // changed lines grow to cover replaced lines, lines after changed
+  // lines are at their old index shifted by lines inserted before them
+  const uint32 end_row = std::max(_transaction_end_row, row + count);
+  _transaction_old_end_row += end_row - _transaction_end_row;
+  _transaction_end_row = end_row + new_count - count;
+  _transaction_first_row = std::min(_transaction_first_row, row);
+}
+
 bool Buffer::_base_move_cursor_left() noexcept
 {
   if(_cursor_col > -1) [[likely]]
   {
-    _cursor_col--;
-    _cursor_col_target = _cursor_col;
+    _cursor_col = this->line_layout(_cursor_row).previous_column(_cursor_col);
+    this->_update_cursor_column_target();
     IncrementalRenderUpdateCommand cmd;
     cmd.type = IncrementalRenderUpdateType::RENDER_LINE;
     cmd.row_start = _cursor_row;
-    _buffer_incremental_render_update_commands.push_back(cmd);
+    this->_queue_render_update(cmd);
     return true;
   }
 
@@ -1225,9 +1957,9 @@ bool Buffer::_base_move_cursor_left() noexcept
   cmd.row_start = _cursor_row;
   --_cursor_row;
   _cursor_col = _lines[_cursor_row].size() - 1;
-  _cursor_col_target = _cursor_col;
+  this->_update_cursor_column_target();
   cmd.row_end = _cursor_row;
-  _buffer_incremental_render_update_commands.push_back(cmd);
+  this->_queue_render_update(cmd);
 
   return true;
 }
@@ -1237,12 +1969,12 @@ bool Buffer::_base_move_cursor_right() noexcept
   if(_cursor_col < static_cast<int32>(_lines[_cursor_row].size() - 1))
     [[likely]]
   {
-    _cursor_col++;
-    _cursor_col_target = _cursor_col;
+    _cursor_col = this->line_layout(_cursor_row).next_column(_cursor_col);
+    this->_update_cursor_column_target();
     IncrementalRenderUpdateCommand cmd;
     cmd.type = IncrementalRenderUpdateType::RENDER_LINE;
     cmd.row_start = _cursor_row;
-    _buffer_incremental_render_update_commands.push_back(cmd);
+    this->_queue_render_update(cmd);
     return true;
   }
 
@@ -1256,9 +1988,9 @@ bool Buffer::_base_move_cursor_right() noexcept
   cmd.row_start = _cursor_row;
   ++_cursor_row;
   _cursor_col = -1;
-  _cursor_col_target = _cursor_col;
+  this->_update_cursor_column_target();
   cmd.row_end = _cursor_row;
-  _buffer_incremental_render_update_commands.push_back(cmd);
+  this->_queue_render_update(cmd);
 
   return true;
 }
@@ -1274,16 +2006,9 @@ bool Buffer::_base_move_cursor_up() noexcept
   cmd.type = IncrementalRenderUpdateType::RENDER_LINES_IN_RANGE;
   cmd.row_start = _cursor_row;
   --_cursor_row;
-  if(static_cast<int32>(_lines[_cursor_row].size() - 1) < _cursor_col_target)
-  {
-    _cursor_col = _lines[_cursor_row].size() - 1;
-  }
-  else
-  {
-    _cursor_col = _cursor_col_target;
-  }
+  _cursor_col = this->_cursor_column_for_target();
   cmd.row_end = _cursor_row;
-  _buffer_incremental_render_update_commands.push_back(cmd);
+  this->_queue_render_update(cmd);
 
   return true;
 }
@@ -1299,103 +2024,69 @@ bool Buffer::_base_move_cursor_down() noexcept
   cmd.type = IncrementalRenderUpdateType::RENDER_LINES_IN_RANGE;
   cmd.row_start = _cursor_row;
   ++_cursor_row;
-  if(static_cast<int32>(_lines[_cursor_row].size() - 1) < _cursor_col_target)
-  {
-    _cursor_col = _lines[_cursor_row].size() - 1;
-  }
-  else
-  {
-    _cursor_col = _cursor_col_target;
-  }
+  _cursor_col = this->_cursor_column_for_target();
   cmd.row_end = _cursor_row;
-  _buffer_incremental_render_update_commands.push_back(cmd);
+  this->_queue_render_update(cmd);
 
   return true;
 }
 
 bool Buffer::_base_move_cursor_to_previous_word_start() noexcept
 {
-  const std::string_view word_separators =
-    ConfigManager::get_instance()->get_config_struct().word_separators;
-
-  int32 row = _cursor_row, col = _cursor_col;
-  bool found_word = false;
-  while(true)
+  // start of line is a word boundary, moving to end of previous line
+  if(_cursor_col == -1)
   {
-    if(col == -1)
+    if(_cursor_row == 0)
     {
-      if(row == 0)
-      {
-        return false;
-      }
-      row -= 1;
-      col = _lines[row].size() - 1;
+      return false;
     }
-    if(col != -1 && word_separators.find(_lines[row][col]) == std::string::npos)
-    {
-      found_word = true;
-    }
-    else
-    {
-      if(found_word)
-      {
-        _cursor_row = row;
-        _cursor_col = col;
-        return true;
-      }
+    _cursor_row -= 1;
+    _cursor_col = _lines[_cursor_row].size() - 1;
+    return true;
+  }
 
-      _cursor_row = row;
-      _cursor_col = col - 1;
-      return true;
-    }
-    col -= 1;
+  // separators are skipped one at a time, words at once
+  const WordClasses& word_classes =
+    ConfigManager::get_instance()->get_config_struct().word_classes;
+  const std::string_view line = _lines[_cursor_row];
+  if(word_classes.separator[static_cast<unsigned char>(line[_cursor_col])])
+  {
+    _cursor_col -= 1;
+    return true;
   }
+
+  _cursor_col =
+    static_cast<int32>(word_start(word_classes, line, _cursor_col + 1)) - 1;
+  return true;
 }
 
 bool Buffer::_base_move_cursor_to_next_word_end() noexcept
 {
-  const std::string_view word_separators =
-    ConfigManager::get_instance()->get_config_struct().word_separators;
-
-  int32 row = _cursor_row, col = _cursor_col;
-  bool found_word = false;
-  while(true)
+  // end of line is a word boundary, moving to start of next line
+  const std::string_view line = _lines[_cursor_row];
+  if(_cursor_col + 1 == static_cast<int32>(line.size()))
   {
-    if(col == _lines[row].size())
-    {
-      if(row == _lines.size() - 1)
-      {
-        return false;
-      }
-      row += 1;
-      col = -1;
-    }
-    if(col != -1 && word_separators.find(_lines[row][col]) == std::string::npos)
+    if(_cursor_row == _lines.size() - 1)
     {
-      if(row != _cursor_row || col != _cursor_col)
-      {
-        found_word = true;
-      }
-      // cursor maybe at just the end of the word
+      return false;
     }
-    else
-    {
-      if(found_word)
-      {
-        _cursor_row = row;
-        _cursor_col = col - 1;
-        return true;
-      }
+    _cursor_row += 1;
+    _cursor_col = -1;
+    return true;
+  }
 
-      if(row != _cursor_row || col != _cursor_col)
-      {
-        _cursor_row = row;
-        _cursor_col = col;
-        return true;
-      }
-    }
-    col += 1;
+  // separators are skipped one at a time, words at once
+  const WordClasses& word_classes =
+    ConfigManager::get_instance()->get_config_struct().word_classes;
+  if(word_classes.separator[static_cast<unsigned char>(line[_cursor_col + 1])])
+  {
+    _cursor_col += 1;
+    return true;
   }
+
+  _cursor_col =
+    static_cast<int32>(word_end(word_classes, line, _cursor_col + 1)) - 1;
+  return true;
 }
 
 void Buffer::_delete_selection() noexcept
@@ -1406,40 +2097,43 @@ void Buffer::_delete_selection() noexcept
   }
 
   auto selection = this->selection().value();
+  this->_begin_edit(selection.first.first, selection.second.first + 1);
   if(selection.first.first == selection.second.first)
   {
     // deletion happens in same line
-    _lines[selection.first.first].erase(selection.first.second + 1,
-                                        selection.second.second -
-                                          selection.first.second);
+    _lines.set_line(selection.first.first,
+                    std::string(_lines[selection.first.first])
+                      .erase(selection.first.second + 1,
+                             selection.second.second - selection.first.second));
     {
       IncrementalRenderUpdateCommand cmd;
       cmd.type = IncrementalRenderUpdateType::RENDER_LINE;
-      cmd.row_start = _cursor_row;
-      _buffer_incremental_render_update_commands.push_back(cmd);
+      cmd.row_start = selection.first.first;
+      this->_queue_render_update(cmd);
     }
     {
       TokenCacheUpdateCommand cmd{};
       cmd.type = TokenCacheUpdateCommandType::RETOKENIZE_LINE;
-      cmd.row = _cursor_row;
-      _token_cache_update_commands_queue.emplace_back(cmd);
+      cmd.row = selection.first.first;
+      this->_queue_token_cache_update(cmd);
     }
   }
   else
   {
-    _lines[selection.first.first].erase(selection.first.second + 1);
-    _lines[selection.second.first].erase(0, selection.second.second + 1);
-    _lines[selection.first.first].append(_lines[selection.second.first]);
+    std::string line(
+      _lines[selection.first.first].substr(0, selection.first.second + 1));
+    line.append(
+      _lines[selection.second.first].substr(selection.second.second + 1));
+    _lines.set_line(selection.first.first, line);
     // deleting lines btw selection start end, which are fully selected
-    _lines.erase(_lines.begin() + selection.first.first + 1,
-                 _lines.begin() + selection.second.first + 1);
+    _lines.erase_lines(selection.first.first + 1, selection.second.first + 1);
 
     {
       IncrementalRenderUpdateCommand cmd;
       cmd.type = IncrementalRenderUpdateType::RENDER_LINES_IN_RANGE;
       cmd.row_start = selection.first.first;
       cmd.row_end = _lines.size() - 1;
-      _buffer_incremental_render_update_commands.push_back(cmd);
+      this->_queue_render_update(cmd);
     }
 
     {
@@ -1447,16 +2141,17 @@ void Buffer::_delete_selection() noexcept
       cmd.type = TokenCacheUpdateCommandType::DELETE_LINES_CACHE;
       cmd.start_row = selection.first.first + 1;
       cmd.end_row = selection.second.first;
-      _token_cache_update_commands_queue.emplace_back(cmd);
+      this->_queue_token_cache_update(cmd);
       cmd.type = TokenCacheUpdateCommandType::RETOKENIZE_LINE;
       cmd.row = selection.first.first;
-      _token_cache_update_commands_queue.emplace_back(cmd);
+      this->_queue_token_cache_update(cmd);
     }
   }
 
   _cursor_row = selection.first.first;
   _cursor_col = selection.first.second;
   _has_selection = false;
+  this->_end_edit(EditKind::OTHER);
 }
 
 uint32
@@ -1506,14 +2201,16 @@ void Buffer::_wrap_selection_with_character(
 {
   auto sel = this->selection().value();
 
-  _lines[sel.first.first].insert(sel.first.second + 1,
-                                 std::string(1, wrap_begin_character));
+  _lines.set_line(sel.first.first,
+                  std::string(_lines[sel.first.first])
+                    .insert(sel.first.second + 1, 1, wrap_begin_character));
 
   // inline selection
   if(_selection.first.first == _selection.second.first)
   {
-    _lines[sel.second.first].insert(sel.second.second + 2,
-                                    std::string(1, wrap_end_character));
+    _lines.set_line(sel.second.first,
+                    std::string(_lines[sel.second.first])
+                      .insert(sel.second.second + 2, 1, wrap_end_character));
     _selection.first.second += 1;
     _selection.second.second += 1;
     _cursor_col += 1;
@@ -1521,8 +2218,9 @@ void Buffer::_wrap_selection_with_character(
   }
 
   // multiline selection
-  _lines[sel.second.first].insert(sel.second.second + 1,
-                                  std::string(1, wrap_end_character));
+  _lines.set_line(sel.second.first,
+                  std::string(_lines[sel.second.first])
+                    .insert(sel.second.second + 1, 1, wrap_end_character));
   if(_selection.first < _selection.second)
   {
     _selection.first.second += 1;
@@ -1571,3 +2269,170 @@ bool Buffer::_cursor_between_brackets() const noexcept
 
   return false;
 }
+
+void Buffer::_begin_edit(const uint32& first_row,
+                         const uint32& last_row) noexcept
+{
+  // updates queued by the edit are merged when it ends
+  this->begin_transaction();
+
+  // nested edits are recorded as part of the outer edit
+  if(_edit_depth++ > 0)
+  {
+    return;
+  }
+
+  _pending_edit.row = first_row;
+  _pending_edit.old_lines = _lines.pieces(first_row, last_row);
+  _pending_edit.cursor_before = {_cursor_row, _cursor_col};
+  _pending_edit_buffer_length = _lines.size();
+}
+
+void Buffer::_end_edit(const EditKind& kind) noexcept
+{
+  this->commit_transaction();
+  if(--_edit_depth > 0)
+  {
+    return;
+  }
+
+  // edited range grows (or shrinks) by the lines inserted (or erased)
+  const uint32 new_lines_count = _pending_edit.old_lines.size() +
+                                 _lines.size() - _pending_edit_buffer_length;
+  _pending_edit.new_lines =
+    _lines.pieces(_pending_edit.row, _pending_edit.row + new_lines_count);
+  _pending_edit.cursor_after = {_cursor_row, _cursor_col};
+  _pending_edit.kind = kind;
+
+  // edits which changed nothing (like deleting an empty selection)
+  // would make undo appear to do nothing
+  const bool changed =
+    _pending_edit.cursor_before != _pending_edit.cursor_after ||
+    !std::equal(_pending_edit.old_lines.cbegin(),
+                _pending_edit.old_lines.cend(),
+                _pending_edit.new_lines.cbegin(),
+                _pending_edit.new_lines.cend(),
+                [](const Piece& a, const Piece& b)
+                {
+                  return std::string_view(a.data, a.length) ==
+                         std::string_view(b.data, b.length);
+                });
+  if(changed)
+  {
+    _undo_history.record(std::move(_pending_edit));
+  }
+  _pending_edit = EditDelta{};
+  this->_compact_lines();
+}
+
+void Buffer::_apply_edit(const uint32& row,
+                         const uint32& count,
+                         const std::vector<Piece>& lines,
+                         const std::pair<uint32, int32>& cursor) noexcept
+{
+  const uint32 buffer_length = _lines.size();
+  _lines.replace_lines(row, count, lines);
+
+  _cursor_row = cursor.first;
+  _cursor_col = cursor.second;
+  this->_update_cursor_column_target();
+  _has_selection = false;
+
+  // token cache of replaced lines is replaced, large edits drop it from
+  // first replaced line, and lines are re-tokenized when they are shown
+  {
+    TokenCacheUpdateCommand cmd{};
+    cmd.type = TokenCacheUpdateCommandType::RETOKENIZE_LINES;
+    cmd.start_row = row;
+    cmd.end_row = row + count;
+    cmd.line_count = lines.size();
+    this->_queue_token_cache_update(cmd);
+  }
+  // lines after replaced lines move only if number of lines changed
+  {
+    IncrementalRenderUpdateCommand cmd;
+    cmd.type = IncrementalRenderUpdateType::RENDER_LINES_IN_RANGE;
+    cmd.row_start = row;
+    cmd.row_end = _lines.size() - 1;
+    if(_lines.size() == buffer_length && !lines.empty())
+    {
+      cmd.row_end = row + lines.size() - 1;
+    }
+    this->_queue_render_update(cmd);
+  }
+}
+
+void Buffer::_reset(const std::string& filepath) noexcept
+{
+  _file_path = filepath;
+  // setting to defaults
+  _cursor_row = 0;
+  _cursor_col = -1;
+  _cursor_col_target = -1;
+  _has_selection = false;
+  _selection = {{0, -1}, {0, -1}};
+  // _buffer_incremental_render_update_commands.clear();
+  _buffer_incremental_render_update_commands.clear();
+
+  // indexer reads the buffers being replaced, and a running save could
+  // replace the file being loaded, stopping them first
+  _line_indexer.cancel();
+  _file_saver.wait();
+  _save_pending = false;
+  // undo history and line layouts point into the buffers being replaced
+  _undo_history.clear();
+  _line_layouts.clear();
+  _search.clear();
+  _regex_search.clear();
+  _trigram_index.clear();
+  _match_selection_pending = false;
+}
+
+void Buffer::_start_trigram_index() noexcept
+{
+  if(!ConfigManager::get_instance()->get_config_struct().trigram_index)
+  {
+    return;
+  }
+
+  // index saved from edited lines wouldn't match the file
+  _trigram_index.build(
+    _lines.snapshot(),
+    _file_path,
+    ConfigManager::get_instance()->get_config_struct().tab_width,
+    _lines.version() == _file_version);
+}
+
+bool Buffer::_start_save() noexcept
+{
+  // edits after this don't affect the save
+  return _file_saver.start(
+    _file_path, _lines.snapshot(), _crlf_line_endings ? "\r\n" : "\n");
+}
+
+void Buffer::_compact_lines() noexcept
+{
+  if(!_lines.should_compact())
+  {
+    return;
+  }
+
+  std::vector<Piece*> pieces;
+  _undo_history.collect_pieces(pieces);
+  _lines.compact(pieces);
+  // layouts are keyed by addresses of text, which has moved
+  _line_layouts.clear();
+}
+
+void Buffer::_update_cursor_column_target() noexcept
+{
+  _cursor_col_target =
+    static_cast<int32>(
+      this->line_layout(_cursor_row).cells_before(_cursor_col)) -
+    1;
+}
+
+int32 Buffer::_cursor_column_for_target() const noexcept
+{
+  return this->line_layout(_cursor_row).column_at(_cursor_col_target + 1);
+}
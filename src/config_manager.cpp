@@ -67,9 +67,15 @@ bool ConfigManager::load_config(const std::string& config_file_path) noexcept
 
   _config.font_size = parsed_config["font_size"].value_or<uint8>(14);
 
+  _config.large_file_threshold =
+    parsed_config["large_file_threshold"].value_or<uint32>(64);
+
+  _config.trigram_index = parsed_config["trigram_index"].value_or<bool>(true);
+
   _config.word_separators =
     parsed_config["word_separators"].value_or<std::string>(
       " \n\r.!\t;:\\/+-*&%<>=(){}[]\"',|~^");
+  _config.word_classes = build_word_classes(_config.word_separators);
 
   _config.window.width =
     parsed_config["window"]["width"].value_or<uint16>(1080);
@@ -163,6 +169,26 @@ bool ConfigManager::load_config(const std::string& config_file_path) noexcept
     parsed_config["cpp_token_colors"]["header"].value_or<std::string>(
       "#ffffff");
 
+  // brackets are coloured by nesting depth, cycling through colors
+  _config.bracket_colors.enabled =
+    parsed_config["bracket_colors"]["enabled"].value_or<bool>(true);
+  _config.bracket_colors.colors.clear();
+  if(const toml::array* colors =
+       parsed_config["bracket_colors"]["colors"].as_array())
+  {
+    for(const toml::node& color : *colors)
+    {
+      if(std::optional<std::string> hexcode = color.value<std::string>())
+      {
+        _config.bracket_colors.colors.push_back(hexcode.value());
+      }
+    }
+  }
+  else
+  {
+    _config.bracket_colors.colors = {"#e5c07b", "#c678dd", "#61afef"};
+  }
+
   _config.caret.color =
     parsed_config["caret"]["color"].value_or<std::string>("#ffffff");
   _config.caret.style =
@@ -170,6 +196,9 @@ bool ConfigManager::load_config(const std::string& config_file_path) noexcept
   _config.caret.ibeam_width =
     parsed_config["caret"]["ibeam_width"].value_or<uint8>(2);
 
+  _config.undo.memory_limit =
+    parsed_config["undo"]["memory_limit"].value_or<uint32>(64);
+
   return true;
 }
 
@@ -1,27 +1,66 @@
 #include "../include/cpp_tokenizer_cache.hpp"
 #include <algorithm>
 #include "../include/buffer.hpp"
+#include "../include/config_manager.hpp"
 #include "../include/incremental_render_update.hpp"
 #include "../include/macros.hpp"
+#include "../include/text_search.hpp"
 
-void CppTokenizerCache::build_cache(const Buffer& buffer) noexcept
+/// @brief Gives state of lexer at end of line.
+/// @throws No exceptions.
+static LineLexerState
+state_after(const std::vector<CppTokenizer::Token>& tokens) noexcept
+{
+  return !tokens.empty() &&
+             tokens.back().type ==
+               CppTokenizer::TokenType::MULTILINE_COMMENT_INCOMPLETE
+           ? LineLexerState::MULTILINE_COMMENT
+           : LineLexerState::NONE;
+}
+
+/// @brief Gives type of opening bracket of the same kind as bracket, so
+///        brackets pair if they give the same type.
+/// @throws No exceptions.
+static CppTokenizer::TokenType
+opening_bracket(const CppTokenizer::Token& bracket) noexcept
+{
+  switch(bracket.type)
+  {
+  case CppTokenizer::TokenType::BRACKET_CLOSE:
+    return CppTokenizer::TokenType::BRACKET_OPEN;
+  case CppTokenizer::TokenType::SQUARE_BRACKET_CLOSE:
+    return CppTokenizer::TokenType::SQUARE_BRACKET_OPEN;
+  case CppTokenizer::TokenType::CURLY_BRACE_CLOSE:
+    return CppTokenizer::TokenType::CURLY_BRACE_OPEN;
+  default:
+    return bracket.type;
+  }
+}
+
+void CppTokenizerCache::build_cache(const Buffer&) noexcept
 {
   _tokens.clear();
-  for(uint32 i = 0; i < buffer.length(); i++)
+  _texts.clear();
+  _states.clear();
+  _stale_row = 0;
+  _identifiers.clear();
+  _postings.clear();
+  _brackets.clear();
+  _re_tokenized_lines.clear();
+  _incremental_render_updates_queue.clear();
+}
+
+void CppTokenizerCache::build_cache_till(const Buffer& buffer,
+                                         const uint32& row) noexcept
+{
+  const uint32 end_row = std::min(row + 1, buffer.length());
+  this->_update_stale_lines(
+    buffer, std::min<std::size_t>(end_row, _tokens.size()));
+  if(_tokens.size() < end_row)
   {
-    if(!_tokens.empty() && !_tokens.back().empty() &&
-       _tokens.back().back().type ==
-         CppTokenizer::TokenType::MULTILINE_COMMENT_INCOMPLETE)
-    {
-      _tokens.push_back(_tokenizer.tokenize_from_imcomplete_token(
-        buffer.line(i).value().get(), _tokens.back().back()));
-    }
-    else
-    {
-      _tokens.push_back(_tokenizer.tokenize(
-        buffer.line_with_spaces_converted_to_tabs(i).value()));
-    }
-    _tokenizer.clear_tokens();
+    const uint32 start_row = _tokens.size();
+    this->_insert_line_tokens(start_row, end_row - start_row);
+    this->_tokenize_lines(buffer, start_row, end_row);
   }
 }
 
@@ -30,284 +69,458 @@ void CppTokenizerCache::update_cache(Buffer& buffer) noexcept
   // clearing re-tokenized lines in last cache update
   _re_tokenized_lines.clear();
 
+  // edited lines are tokenized in state at end of line before them, lines
+  // after them are marked stale if state at their end changed, and are
+  // tokenized again when shown
   auto cmd = buffer.get_next_token_cache_update_command();
   while(cmd != std::nullopt)
   {
     TokenCacheUpdateCommand command = cmd.value();
-    if(command.type == TokenCacheUpdateCommandType::RETOKENIZE_LINE)
+    if(command.type == TokenCacheUpdateCommandType::RETOKENIZE_LINE &&
+       command.row < _tokens.size())
+    {
+      this->_retokenize_line(buffer, command.row);
+      _re_tokenized_lines.push_back(command.row);
+    }
+    else if(command.type == TokenCacheUpdateCommandType::DELETE_LINE_CACHE &&
+            command.row < _tokens.size())
+    {
+      // line after it may now continue (or not) a multiline comment,
+      // erasing marks it stale
+      this->_erase_line_tokens(command.row, command.row + 1);
+    }
+    else if(command.type == TokenCacheUpdateCommandType::DELETE_LINES_CACHE &&
+            command.start_row < _tokens.size())
+    {
+      this->_erase_line_tokens(
+        command.start_row,
+        std::min<std::size_t>(command.end_row + 1, _tokens.size()));
+    }
+    else if(command.type == TokenCacheUpdateCommandType::RETOKENIZE_LINES &&
+            command.start_row < _tokens.size())
     {
-      uint32 row = command.row;
-      if(row != 0 && !_tokens[row - 1].empty() &&
-         _tokens[row - 1].back().type ==
-           CppTokenizer::TokenType::MULTILINE_COMMENT_INCOMPLETE)
+      if(command.end_row >= _tokens.size() ||
+         command.line_count > _tokens.size() - command.end_row)
       {
-        // before line is an incomplete multiline comment
-        // so either this line is still a incomplete multiline comment
-        // or multiline comment ends in this line (as it is edited)
-        std::vector<CppTokenizer::Token> tokens_ =
-          _tokenizer.tokenize_from_imcomplete_token(
-            buffer.line(row).value().get(), _tokens[row - 1].back());
-        {
-          uint32 i = 0;
-          //          while(i < std::min(tokens_.size(), _tokens[row].size()))
-          //          {
-          //            if(tokens_[i] != _tokens[row][i])
-          //            {
-          //              IncrementalRenderUpdateCommand cmd;
-          //              cmd.type = IncrementalRenderUpdateType::RENDER_LINE_SLICE;
-          //              cmd.row_start = row;
-          //              cmd.token_start = i;
-          //              cmd.token_end = tokens_.size() - 1;
-          //              _incremental_render_updates_queue.emplace_back(cmd);
-          //              break;
-          //            }
-          //            i++;
-          //          }
-          //          // new token is added to pervious tokens
-          //          if(i == std::min(tokens_.size(), _tokens[row].size()))
-          //          {
-          //            IncrementalRenderUpdateCommand cmd;
-          //            cmd.type = IncrementalRenderUpdateType::RENDER_LINE_SLICE;
-          //            cmd.row = row;
-          //            cmd.token_start = i;
-          //            cmd.token_end = tokens_.size() - 1;
-          //            _incremental_render_updates_queue.emplace_back(cmd);
-          //          }
-        }
-        _tokens[row] = tokens_;
-        _tokenizer.clear_tokens();
-        _re_tokenized_lines.push_back(row);
-        if(!_tokens.empty() &&
-           _tokens[row].back().type !=
-             CppTokenizer::TokenType::MULTILINE_COMMENT_INCOMPLETE)
-        {
-          // after this line is edited, multiline comment ended here
-          // so lines after this should be retokenized till we encounter
-          // a line which is not incomplettely tokenized.
-          uint32 next_row = row + 1;
-          while(next_row < buffer.length())
-          {
-            if(_tokens[next_row].back().type ==
-               CppTokenizer::TokenType::MULTILINE_COMMENT_INCOMPLETE)
-            {
-              _tokens[next_row] = _tokenizer.tokenize(
-                buffer.line_with_spaces_converted_to_tabs(next_row).value());
-              {
-                IncrementalRenderUpdateCommand cmd;
-                cmd.type = IncrementalRenderUpdateType::RENDER_LINE;
-                cmd.row_start = next_row;
-                _incremental_render_updates_queue.emplace_back(cmd);
-              }
-              _tokenizer.clear_tokens();
-              _re_tokenized_lines.push_back(next_row);
-            }
-            else
-            {
-              break;
-            }
-            next_row++;
-          }
-        }
+        // tokenizing new lines would cost more than tokenizing
+        // lines after them again, when they are shown
+        this->_erase_line_tokens(command.start_row, _tokens.size());
       }
       else
       {
-        // as previous line is not incompletely tokenized
-        // we re-tokenize this line normally
-        std::vector<CppTokenizer::Token> tokens_ = _tokenizer.tokenize(
-          buffer.line_with_spaces_converted_to_tabs(row).value());
+        this->_erase_line_tokens(command.start_row, command.end_row);
+        this->_insert_line_tokens(command.start_row, command.line_count);
+        const uint32 end_row = command.start_row + command.line_count;
+        this->_tokenize_lines(buffer, command.start_row, end_row);
+        for(uint32 row = command.start_row; row < end_row; row++)
         {
-          uint32 i = 0;
-          //          while(i < std::min(tokens_.size(), _tokens[row].size()))
-          //          {
-          //            if(tokens_[i] != _tokens[row][i])
-          //            {
-          //              IncrementalRenderUpdateCommand cmd;
-          //              cmd.type = IncrementalRenderUpdateType::RENDER_LINE_SLICE;
-          //              cmd.row = row;
-          //              cmd.token_start = i;
-          //              cmd.token_end = tokens_.size() - 1;
-          //              _incremental_render_updates_queue.emplace_back(cmd);
-          //              break;
-          //            }
-          //            i++;
-          //          }
-          //          // new token is added to pervious tokens
-          //          if(i == std::min(tokens_.size(), _tokens[row].size()))
-          //          {
-          //            IncrementalRenderUpdateCommand cmd;
-          //            cmd.type = IncrementalRenderUpdateType::RENDER_LINE_SLICE;
-          //            cmd.row = row;
-          //            cmd.token_start = i;
-          //            cmd.token_end = tokens_.size() - 1;
-          //            _incremental_render_updates_queue.emplace_back(cmd);
-          //          }
-        }
-        _tokens[row] = tokens_;
-        _tokenizer.clear_tokens();
-        _re_tokenized_lines.push_back(row);
-
-        if(!_tokens.empty() && !_tokens[row].empty() &&
-           _tokens[row].back().type ==
-             CppTokenizer::TokenType::MULTILINE_COMMENT_INCOMPLETE)
-        {
-          // hekk it! we now need to re-tokenize all lines
-          // below this line as multiline comment
-          uint32 next_row = row + 1;
-          while(next_row < buffer.length())
-          {
-            _tokens[next_row] = _tokenizer.tokenize(
-              buffer.line_with_spaces_converted_to_tabs(next_row).value());
-            {
-              IncrementalRenderUpdateCommand cmd;
-              cmd.type = IncrementalRenderUpdateType::RENDER_LINE;
-              cmd.row_start = next_row;
-              _incremental_render_updates_queue.emplace_back(cmd);
-            }
-            _tokenizer.clear_tokens();
-            _re_tokenized_lines.push_back(next_row);
-            if(_tokens[next_row].back().type !=
-               CppTokenizer::TokenType::MULTILINE_COMMENT_INCOMPLETE)
-            {
-              break;
-            }
-            next_row++;
-          }
+          _re_tokenized_lines.push_back(row);
         }
       }
     }
-    else if(command.type ==
-            TokenCacheUpdateCommandType::INSERT_NEW_LINE_CACHE_AND_TOKENIZE)
+
+    cmd = buffer.get_next_token_cache_update_command();
+  }
+}
+
+void CppTokenizerCache::_retokenize_line(const Buffer& buffer,
+                                         const uint32& row) noexcept
+{
+  std::string text;
+  std::vector<CppTokenizer::Token> tokens;
+  const LineLexerState state = this->_state_before(row);
+  this->_tokenize_line(buffer, row, state, text, tokens);
+  this->_count_identifiers(_texts[row], _tokens[row], false);
+  _postings.replace_line(row, _texts[row], _tokens[row], text, tokens);
+  if(state_after(tokens) != state_after(_tokens[row]))
+  {
+    this->_mark_stale(row + 1);
+  }
+  _texts[row] = std::move(text);
+  _tokens[row] = std::move(tokens);
+  _states[row] = state;
+  this->_count_identifiers(_texts[row], _tokens[row], true);
+  _brackets.replace_lines(row, 1, std::span(_tokens).subspan(row, 1));
+}
+
+void CppTokenizerCache::_update_stale_lines(const Buffer& buffer,
+                                            const uint32& end_row) noexcept
+{
+  uint32 row = _stale_row;
+  while(row < end_row)
+  {
+    LineLexerState state = this->_state_before(row);
+    if(_states[row] == state)
+    {
+      row++;
+      continue;
+    }
+
+    // lines are tokenized again till state at end of one matches the
+    // state line after it was tokenized in, then replaced at once
+    std::vector<std::string> texts;
+    std::vector<std::vector<CppTokenizer::Token>> lines;
+    uint32 last_row = row;
+    do
+    {
+      texts.emplace_back();
+      lines.emplace_back();
+      this->_tokenize_line(buffer, last_row, state, texts.back(), lines.back());
+      _states[last_row] = state;
+      state = state_after(lines.back());
+      last_row++;
+    } while(last_row < end_row && _states[last_row] != state);
+
+    for(uint32 i = row; i < last_row; i++)
+    {
+      this->_count_identifiers(_texts[i], _tokens[i], false);
+    }
+    _postings.remove_lines(row,
+                           std::span(_texts).subspan(row, lines.size()),
+                           std::span(_tokens).subspan(row, lines.size()));
+    std::move(texts.begin(), texts.end(), _texts.begin() + row);
+    std::move(lines.begin(), lines.end(), _tokens.begin() + row);
+    for(uint32 i = row; i < last_row; i++)
+    {
+      this->_count_identifiers(_texts[i], _tokens[i], true);
+      _re_tokenized_lines.push_back(i);
+      IncrementalRenderUpdateCommand cmd;
+      cmd.type = IncrementalRenderUpdateType::RENDER_LINE;
+      cmd.row_start = i;
+      _incremental_render_updates_queue.emplace_back(cmd);
+    }
+    const std::span<const std::vector<CppTokenizer::Token>> new_lines =
+      std::span(_tokens).subspan(row, lines.size());
+    _postings.add_lines(
+      row, std::span(_texts).subspan(row, new_lines.size()), new_lines);
+    _brackets.replace_lines(row, new_lines.size(), new_lines);
+    row = last_row;
+  }
+  _stale_row = std::max(_stale_row, end_row);
+}
+
+LineLexerState
+CppTokenizerCache::_state_before(const uint32& row) const noexcept
+{
+  return row == 0 ? LineLexerState::NONE : state_after(_tokens[row - 1]);
+}
+
+void CppTokenizerCache::_mark_stale(const uint32& row) noexcept
+{
+  _stale_row = std::min(_stale_row, row);
+}
+
+void CppTokenizerCache::_tokenize_lines(const Buffer& buffer,
+                                        const uint32& first_row,
+                                        const uint32& last_row) noexcept
+{
+  for(uint32 row = first_row; row < last_row; row++)
+  {
+    _states[row] = this->_state_before(row);
+    this->_tokenize_line(buffer, row, _states[row], _texts[row], _tokens[row]);
+    this->_count_identifiers(_texts[row], _tokens[row], true);
+  }
+  const std::span<const std::vector<CppTokenizer::Token>> lines =
+    std::span(_tokens).subspan(first_row, last_row - first_row);
+  _postings.add_lines(
+    first_row, std::span(_texts).subspan(first_row, lines.size()), lines);
+  _brackets.replace_lines(first_row, lines.size(), lines);
+
+  // lines are tokenized in state at end of line before them, line after
+  // them may not be
+  if(_stale_row >= first_row)
+  {
+    _stale_row = last_row;
+  }
+}
+
+void CppTokenizerCache::_erase_line_tokens(const uint32& first_row,
+                                           const uint32& last_row) noexcept
+{
+  for(uint32 row = first_row; row < last_row; row++)
+  {
+    this->_count_identifiers(_texts[row], _tokens[row], false);
+  }
+  _postings.remove_lines(
+    first_row,
+    std::span(_texts).subspan(first_row, last_row - first_row),
+    std::span(_tokens).subspan(first_row, last_row - first_row));
+  _tokens.erase(_tokens.begin() + first_row, _tokens.begin() + last_row);
+  _texts.erase(_texts.begin() + first_row, _texts.begin() + last_row);
+  _states.erase(_states.begin() + first_row, _states.begin() + last_row);
+  this->_mark_stale(first_row);
+  _postings.shift_rows(first_row, last_row - first_row, 0);
+  _brackets.replace_lines(first_row, last_row - first_row, {});
+}
+
+void CppTokenizerCache::_insert_line_tokens(const uint32& row,
+                                            const uint32& count) noexcept
+{
+  _tokens.insert(
+    _tokens.begin() + row, count, std::vector<CppTokenizer::Token>());
+  _texts.insert(_texts.begin() + row, count, std::string());
+  _states.insert(_states.begin() + row, count, LineLexerState::NONE);
+  this->_mark_stale(row);
+  _postings.shift_rows(row, 0, count);
+  _brackets.replace_lines(row, 0, std::span(_tokens).subspan(row, count));
+}
+
+void CppTokenizerCache::_count_identifiers(
+  const std::string& text,
+  const std::vector<CppTokenizer::Token>& tokens,
+  const bool& add) noexcept
+{
+  for(const CppTokenizer::Token& token : tokens)
+  {
+    if(token.type != CppTokenizer::TokenType::IDENTIFIER &&
+       token.type != CppTokenizer::TokenType::FUNCTION)
+    {
+      continue;
+    }
+    if(add)
+    {
+      _identifiers.add(token.value(text));
+    }
+    else
     {
-      // re-tokenize line if its length is changed
-      uint32 line_length = 0;
-      for(auto it = _tokens[command.row].cbegin();
-          it != _tokens[command.row].cend();
-          it++)
+      _identifiers.remove(token.value(text));
+    }
+  }
+}
+
+void CppTokenizerCache::_tokenize_line(
+  const Buffer& buffer,
+  const uint32& row,
+  const LineLexerState& state,
+  std::string& text,
+  std::vector<CppTokenizer::Token>& tokens) noexcept
+{
+  if(state == LineLexerState::MULTILINE_COMMENT)
+  {
+    text = buffer.line(row).value();
+    tokens = _tokenizer.tokenize_from_imcomplete_token(
+      text,
+      CppTokenizer::Token(
+        CppTokenizer::TokenType::MULTILINE_COMMENT_INCOMPLETE));
+  }
+  else
+  {
+    text = buffer.line_with_spaces_converted_to_tabs(row).value();
+    tokens = _tokenizer.tokenize(text);
+  }
+  _tokenizer.clear_tokens();
+}
+
+const IdentifierIndex& CppTokenizerCache::identifiers() const noexcept
+{
+  return _identifiers;
+}
+
+std::optional<std::string>
+CppTokenizerCache::identifier_at(const uint32& row,
+                                 const uint32& column) const noexcept
+{
+  if(row >= _tokens.size())
+  {
+    return std::nullopt;
+  }
+
+  // offsets of tokens are in line with leading spaces converted to tabs
+  const uint8 tab_width =
+    ConfigManager::get_instance()->get_config_struct().tab_width;
+  uint32 indentation = 0;
+  for(const CppTokenizer::Token& token : _tokens[row])
+  {
+    if(token.type == CppTokenizer::TokenType::TAB)
+    {
+      indentation += tab_width - 1;
+      continue;
+    }
+    const uint32 start = token.start_offset + indentation;
+    if(column < start)
+    {
+      break;
+    }
+    if(column < start + token.length &&
+       (token.type == CppTokenizer::TokenType::IDENTIFIER ||
+        token.type == CppTokenizer::TokenType::FUNCTION))
+    {
+      return std::string(token.value(_texts[row]));
+    }
+  }
+  return std::nullopt;
+}
+
+void CppTokenizerCache::find_identifier(
+  const std::string& identifier,
+  const uint32& first_row,
+  const uint32& last_row,
+  std::vector<TextMatch>& occurrences) noexcept
+{
+  const uint8 tab_width =
+    ConfigManager::get_instance()->get_config_struct().tab_width;
+  const std::vector<uint32>& rows = _postings.rows(identifier);
+  for(auto row = std::lower_bound(rows.begin(), rows.end(), first_row);
+      row != rows.end() && *row <= last_row;
+      row++)
+  {
+    uint32 indentation = 0;
+    for(const CppTokenizer::Token& token : _tokens[*row])
+    {
+      if(token.type == CppTokenizer::TokenType::TAB)
       {
-        line_length += it->value.size();
+        indentation += tab_width - 1;
       }
-      if(line_length != buffer.line_length(command.row).value())
+      else if((token.type == CppTokenizer::TokenType::IDENTIFIER ||
+               token.type == CppTokenizer::TokenType::FUNCTION) &&
+              token.value(_texts[*row]) == identifier)
       {
-        // find nearest word to tokenize from
-        // then re-tokenize from it
-        uint32 token_index = _tokens[command.row].size() - 1;
-        while(token_index != 0 &&
-              line_length > buffer.line_length(command.row).value())
-        {
-          line_length -= _tokens[command.row][token_index].value.size();
-          token_index--;
-        }
+        occurrences.push_back(TextMatch{
+          *row, token.start_offset + indentation, identifier.size()});
+      }
+    }
+  }
+}
+
+const BracketIndex& CppTokenizerCache::brackets() const noexcept
+{
+  return _brackets;
+}
+
+std::optional<std::pair<uint32, uint32>>
+CppTokenizerCache::matching_bracket(const Buffer& buffer,
+                                    const uint32& row,
+                                    const uint32& column,
+                                    const uint32& last_row) noexcept
+{
+  if(row >= _tokens.size())
+  {
+    return std::nullopt;
+  }
+  // bracket index must be up to date over lines looked in
+  this->_update_stale_lines(
+    buffer, std::min<std::size_t>(last_row + 1, _tokens.size()));
 
-        /// FIXME: maybe be possibly missed some edge cases
+  // offsets of tokens are in line with leading spaces converted to tabs
+  const uint8 tab_width =
+    ConfigManager::get_instance()->get_config_struct().tab_width;
+  std::size_t index = 0;
+  uint32 indentation = 0;
+  int32 depth = _brackets.depth_before(row);
+  for(; index < _tokens[row].size(); index++)
+  {
+    const CppTokenizer::Token& token = _tokens[row][index];
+    if(token.type == CppTokenizer::TokenType::TAB)
+    {
+      indentation += tab_width - 1;
+    }
+    else if(token.start_offset + indentation == column)
+    {
+      break;
+    }
+    depth += bracket_depth_change(token);
+  }
+  if(index == _tokens[row].size() ||
+     bracket_depth_change(_tokens[row][index]) == 0)
+  {
+    return std::nullopt;
+  }
+  // brackets nest together, one closed by a bracket of another kind
+  // is unmatched
+  const CppTokenizer::TokenType kind = opening_bracket(_tokens[row][index]);
 
-        if(token_index == 0)
+  if(bracket_depth_change(_tokens[row][index]) > 0)
+  {
+    // closing bracket is first one after it, bringing depth back
+    uint32 match_row = row;
+    std::size_t first_index = index + 1;
+    depth++;
+    int32 line_depth = depth;
+    while(true)
+    {
+      // depth at start of line is below depth at its end
+      for(std::size_t i = first_index; i < _tokens[match_row].size(); i++)
+      {
+        line_depth += bracket_depth_change(_tokens[match_row][i]);
+        if(line_depth < depth)
         {
-          // just re-tokenize it
-          _tokens[command.row] = _tokenizer.tokenize(
-            buffer.line_with_spaces_converted_to_tabs(command.row).value());
-          _tokenizer.clear_tokens();
-          IncrementalRenderUpdateCommand cmd;
-          cmd.type = IncrementalRenderUpdateType::RENDER_LINE;
-          cmd.row_start = command.row;
-          _incremental_render_updates_queue.emplace_back(cmd);
+          if(opening_bracket(_tokens[match_row][i]) != kind)
+          {
+            return std::nullopt;
+          }
+          return std::pair<uint32, uint32>(
+            match_row, this->_token_column(match_row, i));
         }
-        //        else
-        //        {
-        //          auto tokens_ = _tokenizer.tokenize(
-        //            buffer.line_with_spaces_converted_to_tabs(command.row)
-        //              .value()
-        //              .substr(line_length));
-        //          _tokenizer.clear_tokens();
-        //          _tokens[command.row].insert(
-        //            _tokens[command.row].end(), tokens_.begin(), tokens_.end());
-        //          IncrementalRenderUpdateCommand cmd;
-        //          cmd.type = IncrementalRenderUpdateType::RENDER_LINE_SLICE;
-        //          cmd.row = command.row;
-        //          cmd.token_start = token_index + 1;
-        //          cmd.token_end = _tokens[command.row].size() - 1;
-        //          _incremental_render_updates_queue.emplace_back(cmd);
-        //        }
       }
-      _tokens.insert(_tokens.begin() + command.row + 1,
-                     std::vector<CppTokenizer::Token>());
-      if(!_tokens[command.row].empty() &&
-         _tokens[command.row].back().type ==
-           CppTokenizer::TokenType::MULTILINE_COMMENT_INCOMPLETE)
+
+      // looking in lines after, tokenizing more of them if needed
+      std::optional<uint32> line =
+        _brackets.first_line_below(match_row + 1, depth);
+      while(!line && _tokens.size() < buffer.length() &&
+            _tokens.size() <= last_row)
       {
-        _tokens[command.row + 1] = _tokenizer.tokenize_from_imcomplete_token(
-          buffer.line(command.row + 1).value().get(),
-          _tokens[command.row].back());
+        const uint32 first_row = _tokens.size();
+        this->build_cache_till(
+          buffer, std::min(last_row, first_row + first_row - row + 1024));
+        line = _brackets.first_line_below(first_row, depth);
       }
-      else
+      if(!line || line.value() > last_row)
       {
-        _tokens[command.row + 1] = _tokenizer.tokenize(
-          buffer.line_with_spaces_converted_to_tabs(command.row + 1).value());
+        return std::nullopt;
       }
-      _tokenizer.clear_tokens();
-      //      IncrementalRenderUpdateCommand cmd;
-      //      cmd.type = IncrementalRenderUpdateType::RENDER_LINES_FROM;
-      //      cmd.row_start = command.row + 1;
-      //      _incremental_render_updates_queue.emplace_back(cmd);
+      match_row = line.value();
+      first_index = 0;
+      line_depth = _brackets.depth_before(match_row);
     }
-    else if(command.type == TokenCacheUpdateCommandType::DELETE_LINE_CACHE)
+  }
+
+  // opening bracket is last one before it, where depth was below it
+  uint32 match_row = row;
+  std::size_t end_index = index;
+  int32 line_depth = depth;
+  while(true)
+  {
+    for(std::size_t i = end_index; i > 0; i--)
     {
-      if(!_tokens.empty() && command.row != 0 &&
-         !_tokens[command.row - 1].empty() &&
-         _tokens[command.row - 1].back().type ==
-           CppTokenizer::TokenType::MULTILINE_COMMENT_INCOMPLETE &&
-         !_tokens[command.row].empty() &&
-         _tokens[command.row].back().type !=
-           CppTokenizer::TokenType::MULTILINE_COMMENT_INCOMPLETE)
+      line_depth -= bracket_depth_change(_tokens[match_row][i - 1]);
+      if(line_depth < depth)
       {
-        // deleted line consists the closing (*/) of multiline comment
-        // we should include all of lines next to this line in multline comment
-        _tokens.erase(_tokens.begin() + command.row);
-        uint32 next_row = command.row;
-        while(next_row < _tokens.size())
+        if(opening_bracket(_tokens[match_row][i - 1]) != kind)
         {
-          _tokens[next_row] = _tokenizer.tokenize_from_imcomplete_token(
-            buffer.line(next_row).value().get(), _tokens[next_row - 1].back());
-          {
-            IncrementalRenderUpdateCommand cmd;
-            cmd.type = IncrementalRenderUpdateType::RENDER_LINE;
-            cmd.row_start = next_row;
-            _incremental_render_updates_queue.emplace_back(cmd);
-          }
-          _tokenizer.clear_tokens();
-          _re_tokenized_lines.push_back(next_row);
-          if(_tokens[next_row].back().type !=
-             CppTokenizer::TokenType::MULTILINE_COMMENT_INCOMPLETE)
-          {
-            break;
-          }
-          next_row++;
+          return std::nullopt;
         }
-      }
-      else
-      {
-        // just delete the line
-        _tokens.erase(_tokens.begin() + command.row);
-        //        if(command.row < _tokens.size())
-        //        {
-        //          IncrementalRenderUpdateCommand cmd;
-        //          cmd.type = IncrementalRenderUpdateType::RENDER_LINES_FROM;
-        //          cmd.row = command.row;
-        //          _incremental_render_updates_queue.emplace_back(cmd);
-        //        }
+        return std::pair<uint32, uint32>(
+          match_row, this->_token_column(match_row, i - 1));
       }
     }
-    else
-    {
-      // TokenCacheUpdateCommandType::DELETE_LINES_CACHE
 
-      /// TODO: handle multiline comment shit
-
-      _tokens.erase(_tokens.begin() + command.start_row,
-                    _tokens.begin() + command.end_row + 1);
+    std::optional<uint32> line =
+      match_row == 0 ? std::nullopt
+                     : _brackets.last_line_not_above(match_row - 1, depth - 1);
+    if(!line)
+    {
+      return std::nullopt;
     }
+    match_row = line.value();
+    end_index = _tokens[match_row].size();
+    line_depth = _brackets.depth_before(match_row + 1);
+  }
+}
 
-    cmd = buffer.get_next_token_cache_update_command();
+uint32 CppTokenizerCache::_token_column(const uint32& row,
+                                        const std::size_t& index) const noexcept
+{
+  const uint8 tab_width =
+    ConfigManager::get_instance()->get_config_struct().tab_width;
+  uint32 indentation = 0;
+  for(std::size_t i = 0; i < index; i++)
+  {
+    if(_tokens[row][i].type == CppTokenizer::TokenType::TAB)
+    {
+      indentation += tab_width - 1;
+    }
   }
+  return _tokens[row][index].start_offset + indentation;
 }
 
 const std::vector<std::vector<CppTokenizer::Token>>&
@@ -316,6 +529,12 @@ CppTokenizerCache::tokens() const noexcept
   return _tokens;
 }
 
+const std::string&
+CppTokenizerCache::text_for_line(const uint32& line_index) const noexcept
+{
+  return _texts[line_index];
+}
+
 const std::vector<CppTokenizer::Token>*
 CppTokenizerCache::tokens_for_line(const uint32& line_index) const noexcept
 {
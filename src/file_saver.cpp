@@ -0,0 +1,335 @@
+#include "../include/file_saver.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include "../include/macros.hpp"
+#if defined(WIN32) || defined(_WIN32) || defined(_WIN64)
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/stat.h>
+#  include <sys/uio.h>
+#  include <unistd.h>
+#endif
+
+#if defined(WIN32) || defined(_WIN32) || defined(_WIN64)
+/// Size of buffer in which lines are gathered before a write.
+static constexpr std::size_t write_buffer_size = 1024 * 1024;
+#else
+/// Maximum number of buffers written with one writev call.
+static constexpr std::size_t max_write_buffers = 1024;
+#endif
+
+FileSaver::FileSaver() noexcept
+  : _saving(false)
+  , _saved(false)
+  , _result_pending(false)
+  , _bytes_written(0)
+  , _bytes_total(0)
+{}
+
+FileSaver::~FileSaver() noexcept
+{
+  this->wait();
+}
+
+bool FileSaver::start(const std::string& filepath,
+                      PieceTableSnapshot&& lines,
+                      const std::string_view& line_ending) noexcept
+{
+  if(_saving)
+  {
+    return false;
+  }
+  this->wait();
+
+  _bytes_written = 0;
+  _bytes_total =
+    lines.bytes() +
+    (lines.size() == 0 ? 0 : (lines.size() - 1) * line_ending.size());
+
+  _saving = true;
+  _result_pending = true;
+  _thread = std::thread(
+    [this,
+     filepath,
+     lines = std::move(lines),
+     line_ending = std::string(line_ending)]()
+    {
+      // pieces are gathered here, keeping UI thread free of O(n) work
+      _saved = this->_write(filepath, lines.pieces(), line_ending);
+      _saving = false;
+    });
+  return true;
+}
+
+void FileSaver::wait() noexcept
+{
+  if(_thread.joinable())
+  {
+    _thread.join();
+  }
+}
+
+bool FileSaver::saving() const noexcept
+{
+  return _saving;
+}
+
+float32 FileSaver::progress() const noexcept
+{
+  if(_bytes_total == 0)
+  {
+    return _saving ? 0.0f : 1.0f;
+  }
+  return static_cast<float32>(_bytes_written) / _bytes_total;
+}
+
+std::optional<bool> FileSaver::get_result() noexcept
+{
+  if(_saving || !_result_pending)
+  {
+    return std::nullopt;
+  }
+
+  this->wait();
+  _result_pending = false;
+  return _saved.load();
+}
+
+#if defined(WIN32) || defined(_WIN32) || defined(_WIN64)
+
+bool FileSaver::_write(const std::string& filepath,
+                       const std::vector<Piece>& lines,
+                       const std::string& line_ending) noexcept
+{
+  const std::string temp_path = filepath + ".tmp";
+  HANDLE file = CreateFileA(temp_path.c_str(),
+                            GENERIC_WRITE,
+                            0,
+                            nullptr,
+                            CREATE_ALWAYS,
+                            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+                            nullptr);
+  if(file == INVALID_HANDLE_VALUE)
+  {
+    ERROR_BOII("Unable to open file: %s, when trying to save.",
+               temp_path.c_str());
+    return false;
+  }
+
+  // gathering lines into a large buffer, as WriteFile has
+  // no gather variant for buffered files
+  std::unique_ptr<char[]> buffer =
+    std::make_unique<char[]>(write_buffer_size);
+  std::size_t buffer_used = 0;
+  auto flush = [&]() -> bool
+  {
+    std::size_t offset = 0;
+    while(offset < buffer_used)
+    {
+      DWORD written = 0;
+      if(!WriteFile(file,
+                    buffer.get() + offset,
+                    static_cast<DWORD>(buffer_used - offset),
+                    &written,
+                    nullptr))
+      {
+        return false;
+      }
+      offset += written;
+      _bytes_written += written;
+    }
+    buffer_used = 0;
+    return true;
+  };
+  auto append = [&](const char* data, std::size_t length) -> bool
+  {
+    while(length > 0)
+    {
+      if(buffer_used == write_buffer_size && !flush())
+      {
+        return false;
+      }
+      const std::size_t count =
+        std::min(length, write_buffer_size - buffer_used);
+      std::memcpy(buffer.get() + buffer_used, data, count);
+      buffer_used += count;
+      data += count;
+      length -= count;
+    }
+    return true;
+  };
+
+  bool written = true;
+  for(std::size_t i = 0; i < lines.size() && written; i++)
+  {
+    written = append(lines[i].data, lines[i].length);
+    if(written && i + 1 < lines.size())
+    {
+      written = append(line_ending.data(), line_ending.size());
+    }
+  }
+  written = written && flush() && FlushFileBuffers(file);
+  CloseHandle(file);
+  if(!written)
+  {
+    ERROR_BOII("Unable to write file: %s", temp_path.c_str());
+    DeleteFileA(temp_path.c_str());
+    return false;
+  }
+
+  if(MoveFileExA(temp_path.c_str(),
+                 filepath.c_str(),
+                 MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+  {
+    return true;
+  }
+
+  // a memory mapped file can't be replaced, but it's mapped with
+  // FILE_SHARE_DELETE, so it can be renamed aside before moving temporary
+  // file in its place
+  const std::string aside_path =
+    filepath + ".old." + std::to_string(GetTickCount64());
+  if(!MoveFileExA(
+       filepath.c_str(), aside_path.c_str(), MOVEFILE_WRITE_THROUGH))
+  {
+    ERROR_BOII("Unable to replace file: %s, contents are saved in: %s",
+               filepath.c_str(),
+               temp_path.c_str());
+    return false;
+  }
+  if(!MoveFileExA(
+       temp_path.c_str(), filepath.c_str(), MOVEFILE_WRITE_THROUGH))
+  {
+    MoveFileExA(aside_path.c_str(), filepath.c_str(), MOVEFILE_WRITE_THROUGH);
+    ERROR_BOII("Unable to replace file: %s, contents are saved in: %s",
+               filepath.c_str(),
+               temp_path.c_str());
+    return false;
+  }
+
+  // deleting it is pending till it's unmapped
+  if(!DeleteFileA(aside_path.c_str()))
+  {
+    WARN_BOII("Unable to delete replaced file: %s", aside_path.c_str());
+  }
+  return true;
+}
+
+#else
+
+bool FileSaver::_write(const std::string& filepath,
+                       const std::vector<Piece>& lines,
+                       const std::string& line_ending) noexcept
+{
+  // keeping permissions of the file being replaced
+  mode_t mode = 0644;
+  struct stat file_stat;
+  if(stat(filepath.c_str(), &file_stat) == 0)
+  {
+    mode = file_stat.st_mode & 07777;
+  }
+
+  const std::string temp_path = filepath + ".tmp";
+  const int file =
+    ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, mode);
+  if(file == -1)
+  {
+    ERROR_BOII("Unable to open file: %s, when trying to save.",
+               temp_path.c_str());
+    return false;
+  }
+
+  // writing lines and line endings with as few calls as possible
+  iovec buffers[max_write_buffers];
+  std::size_t buffers_count = 0;
+  auto flush = [&]() -> bool
+  {
+    iovec* buffer = buffers;
+    while(buffers_count > 0)
+    {
+      const ssize_t written =
+        writev(file, buffer, static_cast<int>(buffers_count));
+      if(written < 0 && errno == EINTR)
+      {
+        continue;
+      }
+      if(written < 0)
+      {
+        return false;
+      }
+      _bytes_written += written;
+
+      // skipping fully written buffers, and written part of the next
+      std::size_t remaining = static_cast<std::size_t>(written);
+      while(buffers_count > 0 && remaining >= buffer->iov_len)
+      {
+        remaining -= buffer->iov_len;
+        buffer++;
+        buffers_count--;
+      }
+      if(buffers_count > 0)
+      {
+        buffer->iov_base = static_cast<char*>(buffer->iov_base) + remaining;
+        buffer->iov_len -= remaining;
+      }
+    }
+    return true;
+  };
+  auto append = [&](const char* data, const std::size_t& length) -> bool
+  {
+    if(length == 0)
+    {
+      return true;
+    }
+    if(buffers_count == max_write_buffers && !flush())
+    {
+      return false;
+    }
+    buffers[buffers_count++] = iovec{const_cast<char*>(data), length};
+    return true;
+  };
+
+  bool written = true;
+  for(std::size_t i = 0; i < lines.size() && written; i++)
+  {
+    written = append(lines[i].data, lines[i].length);
+    if(written && i + 1 < lines.size())
+    {
+      written = append(line_ending.data(), line_ending.size());
+    }
+  }
+  written = written && flush() && fsync(file) == 0;
+  written = ::close(file) == 0 && written;
+  if(!written)
+  {
+    ERROR_BOII("Unable to write file: %s", temp_path.c_str());
+    unlink(temp_path.c_str());
+    return false;
+  }
+
+  if(rename(temp_path.c_str(), filepath.c_str()) != 0)
+  {
+    ERROR_BOII("Unable to replace file: %s, contents are saved in: %s",
+               filepath.c_str(),
+               temp_path.c_str());
+    return false;
+  }
+
+  // flushing directory, so that rename survives a crash
+  const std::string directory =
+    std::filesystem::path(filepath).parent_path().string();
+  const int directory_file =
+    ::open(directory.empty() ? "." : directory.c_str(), O_RDONLY);
+  if(directory_file != -1)
+  {
+    fsync(directory_file);
+    ::close(directory_file);
+  }
+  return true;
+}
+
+#endif
@@ -0,0 +1,154 @@
+#include "../include/identifier_index.hpp"
+
+IdentifierIndex::IdentifierIndex() noexcept
+  : _nodes({Node{'\0', 0, 0, 0, 0}})
+  , _size(0)
+{}
+
+void IdentifierIndex::add(std::string_view identifier) noexcept
+{
+  if(identifier.empty())
+  {
+    return;
+  }
+
+  uint32 node = 0;
+  _nodes[node].subtree_count++;
+  for(const char& byte : identifier)
+  {
+    // finding child of byte, or where it goes among siblings
+    uint32 previous = 0;
+    uint32 child = _nodes[node].first_child;
+    while(child != 0 && static_cast<unsigned char>(_nodes[child].byte) <
+                         static_cast<unsigned char>(byte))
+    {
+      previous = child;
+      child = _nodes[child].next_sibling;
+    }
+    if(child == 0 || _nodes[child].byte != byte)
+    {
+      const uint32 inserted = _nodes.size();
+      _nodes.push_back(Node{byte, 0, child, 0, 0});
+      if(previous == 0)
+      {
+        _nodes[node].first_child = inserted;
+      }
+      else
+      {
+        _nodes[previous].next_sibling = inserted;
+      }
+      child = inserted;
+    }
+    node = child;
+    _nodes[node].subtree_count++;
+  }
+
+  if(_nodes[node].count++ == 0)
+  {
+    _size++;
+  }
+}
+
+void IdentifierIndex::remove(std::string_view identifier) noexcept
+{
+  const uint32 end = this->_find(identifier);
+  if(end == 0 || _nodes[end].count == 0) [[unlikely]]
+  {
+    return;
+  }
+
+  uint32 node = 0;
+  _nodes[node].subtree_count--;
+  for(const char& byte : identifier)
+  {
+    node = _nodes[node].first_child;
+    while(_nodes[node].byte != byte)
+    {
+      node = _nodes[node].next_sibling;
+    }
+    _nodes[node].subtree_count--;
+  }
+
+  if(--_nodes[node].count == 0)
+  {
+    _size--;
+  }
+}
+
+void IdentifierIndex::clear() noexcept
+{
+  _nodes.assign(1, Node{'\0', 0, 0, 0, 0});
+  _size = 0;
+}
+
+std::size_t IdentifierIndex::size() const noexcept
+{
+  return _size;
+}
+
+void IdentifierIndex::complete(
+  std::string_view prefix,
+  const std::size_t& max_count,
+  std::vector<std::string>& completions) const noexcept
+{
+  const uint32 node = this->_find(prefix);
+  if(node == 0 || max_count == 0)
+  {
+    return;
+  }
+
+  // identifiers in subtree, except prefix itself
+  std::string text(prefix);
+  const std::size_t end = completions.size() + max_count;
+  for(uint32 child = _nodes[node].first_child;
+      child != 0 && completions.size() < end;
+      child = _nodes[child].next_sibling)
+  {
+    this->_collect(child, text, end, completions);
+  }
+}
+
+uint32 IdentifierIndex::_find(std::string_view text) const noexcept
+{
+  uint32 node = 0;
+  for(const char& byte : text)
+  {
+    node = _nodes[node].first_child;
+    while(node != 0 && static_cast<unsigned char>(_nodes[node].byte) <
+                        static_cast<unsigned char>(byte))
+    {
+      node = _nodes[node].next_sibling;
+    }
+    if(node == 0 || _nodes[node].byte != byte)
+    {
+      return 0;
+    }
+  }
+  return node;
+}
+
+void IdentifierIndex::_collect(
+  const uint32& node,
+  std::string& text,
+  const std::size_t& max_size,
+  std::vector<std::string>& completions) const noexcept
+{
+  // subtrees of removed identifiers are skipped
+  if(_nodes[node].subtree_count == 0)
+  {
+    return;
+  }
+
+  text.push_back(_nodes[node].byte);
+  if(_nodes[node].count != 0)
+  {
+    completions.push_back(text);
+  }
+  for(uint32 child = _nodes[node].first_child;
+      child != 0 && completions.size() < max_size;
+      child = _nodes[child].next_sibling)
+  {
+    this->_collect(child, text, max_size, completions);
+  }
+  text.pop_back();
+}
@@ -0,0 +1,222 @@
+#include "../include/identifier_postings.hpp"
+#include <algorithm>
+
+/// Logged shifts applied to all postings at once, when the log gets
+/// this long.
+static constexpr std::size_t max_logged_shifts = 4096;
+
+/// @brief Tells if token is an identifier (or function name).
+/// @throws No exceptions.
+static inline bool is_identifier(const CppTokenizer::Token& token) noexcept
+{
+  return token.type == CppTokenizer::TokenType::IDENTIFIER ||
+         token.type == CppTokenizer::TokenType::FUNCTION;
+}
+
+IdentifierPostings::IdentifierPostings() noexcept
+  : _batches(0)
+{}
+
+void IdentifierPostings::clear() noexcept
+{
+  _ids.clear();
+  _postings.clear();
+  _shifts.clear();
+}
+
+void IdentifierPostings::add_lines(
+  const uint32& first_row,
+  std::span<const std::string> texts,
+  std::span<const std::vector<CppTokenizer::Token>> lines) noexcept
+{
+  // counting rows of each identifier, then making room for them at once
+  _batches++;
+  _id_rows.clear();
+  _batch_ids.clear();
+  for(std::size_t i = 0; i < lines.size(); i++)
+  {
+    this->_collect_ids(texts[i], lines[i], _new_ids);
+    for(const uint32& id : _new_ids)
+    {
+      Postings& postings = _postings[id];
+      if(postings.batch != _batches)
+      {
+        postings.batch = _batches;
+        postings.batch_position = 0;
+        _batch_ids.push_back(id);
+      }
+      postings.batch_position++;
+      _id_rows.emplace_back(id, first_row + i);
+    }
+  }
+
+  // lines aren't in postings, so their rows go in one place
+  for(const uint32& id : _batch_ids)
+  {
+    Postings& postings = _postings[id];
+    this->_apply_shifts(postings);
+    const std::size_t position =
+      std::lower_bound(postings.rows.begin(), postings.rows.end(), first_row) -
+      postings.rows.begin();
+    postings.rows.insert(
+      postings.rows.begin() + position, postings.batch_position, 0);
+    postings.batch_position = position;
+  }
+  for(const auto& [id, row] : _id_rows)
+  {
+    Postings& postings = _postings[id];
+    postings.rows[postings.batch_position++] = row;
+  }
+}
+
+void IdentifierPostings::remove_lines(
+  const uint32& first_row,
+  std::span<const std::string> texts,
+  std::span<const std::vector<CppTokenizer::Token>> lines) noexcept
+{
+  // postings have rows of lines containing the identifier, and no others
+  // between them
+  _batches++;
+  const uint32 last_row = first_row + lines.size();
+  for(std::size_t i = 0; i < lines.size(); i++)
+  {
+    for(const CppTokenizer::Token& token : lines[i])
+    {
+      if(!is_identifier(token))
+      {
+        continue;
+      }
+      Postings& postings = _postings[this->_intern(token.value(texts[i]))];
+      if(postings.batch == _batches)
+      {
+        continue;
+      }
+      postings.batch = _batches;
+      this->_apply_shifts(postings);
+      postings.rows.erase(
+        std::lower_bound(postings.rows.begin(), postings.rows.end(), first_row),
+        std::lower_bound(postings.rows.begin(), postings.rows.end(), last_row));
+    }
+  }
+}
+
+void IdentifierPostings::replace_line(
+  const uint32& row,
+  const std::string& old_text,
+  const std::vector<CppTokenizer::Token>& old_tokens,
+  const std::string& new_text,
+  const std::vector<CppTokenizer::Token>& new_tokens) noexcept
+{
+  this->_collect_ids(old_text, old_tokens, _old_ids);
+  this->_collect_ids(new_text, new_tokens, _new_ids);
+  auto old_id = _old_ids.cbegin();
+  auto new_id = _new_ids.cbegin();
+  while(old_id != _old_ids.cend() || new_id != _new_ids.cend())
+  {
+    if(old_id != _old_ids.cend() && new_id != _new_ids.cend() &&
+       *old_id == *new_id)
+    {
+      // identifier is still in line
+      old_id++;
+      new_id++;
+      continue;
+    }
+
+    const bool removed = new_id == _new_ids.cend() ||
+                         (old_id != _old_ids.cend() && *old_id < *new_id);
+    Postings& postings = _postings[removed ? *old_id++ : *new_id++];
+    this->_apply_shifts(postings);
+    auto it = std::lower_bound(postings.rows.begin(), postings.rows.end(), row);
+    if(removed)
+    {
+      postings.rows.erase(it);
+    }
+    else
+    {
+      postings.rows.insert(it, row);
+    }
+  }
+}
+
+void IdentifierPostings::shift_rows(const uint32& row,
+                                    const uint32& count,
+                                    const uint32& new_count) noexcept
+{
+  if(count == new_count)
+  {
+    return;
+  }
+
+  _shifts.emplace_back(row, count, new_count);
+  if(_shifts.size() >= max_logged_shifts)
+  {
+    for(Postings& postings : _postings)
+    {
+      this->_apply_shifts(postings);
+      postings.applied_shifts = 0;
+    }
+    _shifts.clear();
+  }
+}
+
+const std::vector<uint32>&
+IdentifierPostings::rows(const std::string& identifier) noexcept
+{
+  static const std::vector<uint32> no_rows;
+  auto it = _ids.find(identifier);
+  if(it == _ids.end())
+  {
+    return no_rows;
+  }
+
+  Postings& postings = _postings[it->second];
+  this->_apply_shifts(postings);
+  return postings.rows;
+}
+
+void IdentifierPostings::_collect_ids(
+  const std::string& text,
+  const std::vector<CppTokenizer::Token>& tokens,
+  std::vector<uint32>& ids) noexcept
+{
+  ids.clear();
+  for(const CppTokenizer::Token& token : tokens)
+  {
+    if(is_identifier(token))
+    {
+      ids.push_back(this->_intern(token.value(text)));
+    }
+  }
+  std::sort(ids.begin(), ids.end());
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+}
+
+uint32 IdentifierPostings::_intern(std::string_view identifier) noexcept
+{
+  auto it = _ids.find(identifier);
+  if(it != _ids.end())
+  {
+    return it->second;
+  }
+
+  // new identifiers start with postings having all shifts applied
+  _ids.emplace(identifier, _postings.size());
+  _postings.push_back(Postings{{}, _shifts.size(), 0, 0});
+  return _postings.size() - 1;
+}
+
+void IdentifierPostings::_apply_shifts(Postings& postings) noexcept
+{
+  for(; postings.applied_shifts < _shifts.size(); postings.applied_shifts++)
+  {
+    const auto& [row, count, new_count] = _shifts[postings.applied_shifts];
+    // replaced lines were removed, rows after them move
+    for(auto it = std::lower_bound(
+          postings.rows.begin(), postings.rows.end(), row + count);
+        it != postings.rows.end();
+        it++)
+    {
+      *it = *it + new_count - count;
+    }
+  }
+}
@@ -0,0 +1,219 @@
+#include "../include/ignore_rules.hpp"
+#include <fstream>
+#include <utility>
+
+IgnoreRules::IgnoreRules(std::shared_ptr<const IgnoreRules> parent,
+                         const std::string& directory) noexcept
+  : _parent(std::move(parent))
+  , _directory(directory)
+{}
+
+bool IgnoreRules::load(const std::string& filepath) noexcept
+{
+  std::ifstream file(filepath, std::ios::binary);
+  if(!file.is_open())
+  {
+    return false;
+  }
+
+  std::string line;
+  while(std::getline(file, line))
+  {
+    if(!line.empty() && line.back() == '\r')
+    {
+      line.pop_back();
+    }
+    // trailing spaces are ignored, unless escaped
+    while(!line.empty() && line.back() == ' ' &&
+          (line.size() < 2 || line[line.size() - 2] != '\\'))
+    {
+      line.pop_back();
+    }
+    if(line.empty() || line.front() == '#')
+    {
+      continue;
+    }
+
+    Pattern pattern = {line, false, false, false};
+    if(pattern.glob.front() == '!')
+    {
+      pattern.negated = true;
+      pattern.glob.erase(0, 1);
+    }
+    else if(pattern.glob.starts_with("\\!") || pattern.glob.starts_with("\\#"))
+    {
+      pattern.glob.erase(0, 1);
+    }
+    if(!pattern.glob.empty() && pattern.glob.back() == '/')
+    {
+      pattern.directory_only = true;
+      pattern.glob.pop_back();
+    }
+    pattern.anchored = pattern.glob.find('/') != std::string::npos;
+    if(!pattern.glob.empty() && pattern.glob.front() == '/')
+    {
+      pattern.glob.erase(0, 1);
+    }
+    if(!pattern.glob.empty())
+    {
+      _patterns.push_back(std::move(pattern));
+    }
+  }
+  return true;
+}
+
+bool IgnoreRules::ignored(std::string_view path,
+                          const bool& directory) const noexcept
+{
+  for(const IgnoreRules* rules = this; rules; rules = rules->_parent.get())
+  {
+    if(!path.starts_with(rules->_directory))
+    {
+      continue;
+    }
+
+    const std::string_view relative_path =
+      path.substr(rules->_directory.size());
+    const std::size_t slash = relative_path.rfind('/');
+    const std::string_view name = slash == std::string_view::npos
+                                    ? relative_path
+                                    : relative_path.substr(slash + 1);
+    // last matching pattern decides
+    for(auto pattern = rules->_patterns.rbegin();
+        pattern != rules->_patterns.rend();
+        pattern++)
+    {
+      if(pattern->directory_only && !directory)
+      {
+        continue;
+      }
+      if(_match(pattern->glob, pattern->anchored ? relative_path : name))
+      {
+        return !pattern->negated;
+      }
+    }
+  }
+  return false;
+}
+
+bool IgnoreRules::_match(std::string_view glob, std::string_view text) noexcept
+{
+  while(!glob.empty())
+  {
+    if(glob.starts_with("**"))
+    {
+      glob.remove_prefix(2);
+      if(glob.starts_with('/'))
+      {
+        // zero or more directories
+        glob.remove_prefix(1);
+        if(_match(glob, text))
+        {
+          return true;
+        }
+        for(std::size_t i = 0; i < text.size(); i++)
+        {
+          if(text[i] == '/' && _match(glob, text.substr(i + 1)))
+          {
+            return true;
+          }
+        }
+        return false;
+      }
+      for(std::size_t i = 0; i <= text.size(); i++)
+      {
+        if(_match(glob, text.substr(i)))
+        {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    if(glob.front() == '*')
+    {
+      glob.remove_prefix(1);
+      for(std::size_t i = 0; i <= text.size(); i++)
+      {
+        if(_match(glob, text.substr(i)))
+        {
+          return true;
+        }
+        if(i < text.size() && text[i] == '/')
+        {
+          break;
+        }
+      }
+      return false;
+    }
+
+    if(text.empty())
+    {
+      return false;
+    }
+
+    if(glob.front() == '?')
+    {
+      if(text.front() == '/')
+      {
+        return false;
+      }
+      glob.remove_prefix(1);
+      text.remove_prefix(1);
+      continue;
+    }
+
+    if(glob.front() == '[')
+    {
+      // ']' right after '[' (or negation) is part of class
+      std::size_t index = 1;
+      const bool negated =
+        index < glob.size() && (glob[index] == '!' || glob[index] == '^');
+      if(negated)
+      {
+        index++;
+      }
+      const std::size_t close = glob.find(']', index + 1);
+      if(close != std::string_view::npos)
+      {
+        const unsigned char character = text.front();
+        bool matched = false;
+        for(std::size_t i = index; i < close; i++)
+        {
+          if(i + 2 < close && glob[i + 1] == '-')
+          {
+            matched = matched ||
+                      (character >= static_cast<unsigned char>(glob[i]) &&
+                       character <= static_cast<unsigned char>(glob[i + 2]));
+            i += 2;
+          }
+          else
+          {
+            matched =
+              matched || character == static_cast<unsigned char>(glob[i]);
+          }
+        }
+        if(matched == negated || text.front() == '/')
+        {
+          return false;
+        }
+        glob.remove_prefix(close + 1);
+        text.remove_prefix(1);
+        continue;
+      }
+      // unclosed '[' is a literal
+    }
+
+    if(glob.front() == '\\' && glob.size() > 1)
+    {
+      glob.remove_prefix(1);
+    }
+    if(glob.front() != text.front())
+    {
+      return false;
+    }
+    glob.remove_prefix(1);
+    text.remove_prefix(1);
+  }
+  return text.empty();
+}
@@ -1,4 +1,5 @@
 #include "../include/incremental_render_update.hpp"
+#include <algorithm>
 #include <cmath>
 #include "../include/config_manager.hpp"
 #include "../include/rocket_render.hpp"
@@ -102,25 +103,34 @@ void IncrementalUpdate_RenderLine(const IncrementalRenderUpdateCommand& command,
                                    active_line_color);
   }
   // rendering tokens of line
+  // lines not tokenized yet are rendered with next redraw
   const std::vector<CppTokenizer::Token>* tokens =
     tokenizer_cache.tokens_for_line(command.row_start);
-  render_tokens(line_numbers_width + 1,
-                line_y,
-                *tokens,
-                buffer,
-                command.row_start,
-                font_extents);
+  if(tokens)
+  {
+    render_tokens(line_numbers_width + 1,
+                  line_y,
+                  *tokens,
+                  tokenizer_cache.text_for_line(command.row_start),
+                  buffer,
+                  command.row_start,
+                  tokenizer_cache.brackets().depth_before(command.row_start),
+                  font_extents);
+  }
   // drawing selection
   auto selection_for_line_result =
     buffer.selection_slice_for_line(command.row_start);
   if(selection_for_line_result != std::nullopt)
   {
     auto selection = selection_for_line_result.value();
+    const LineLayout& layout = buffer.line_layout(command.row_start);
+    const uint32 selection_start_cells = layout.cells_before(selection.first);
     RocketRender::rectangle_filled(
       line_numbers_width + 1 +
-        (selection.first + 1) * font_extents.max_x_advance,
+        selection_start_cells * font_extents.max_x_advance,
       line_y,
-      (selection.second - selection.first) * font_extents.max_x_advance,
+      (layout.cells_before(selection.second) - selection_start_cells) *
+        font_extents.max_x_advance,
       font_extents.height,
       hexcode_to_SDL_Color(ConfigManager::get_instance()
                              ->get_config_struct()
@@ -132,7 +142,9 @@ void IncrementalUpdate_RenderLine(const IncrementalRenderUpdateCommand& command,
     ConfigManager::get_instance()->get_config_struct().caret.style;
   RocketRender::rectangle_filled(
     line_numbers_width + 1 +
-      font_extents.max_x_advance * (cursor_coords.second + 1),
+      font_extents.max_x_advance *
+        buffer.line_layout(cursor_coords.first)
+          .cells_before(cursor_coords.second),
     ceil(scroll_y_offset + font_extents.height * cursor_coords.first),
     (cursor_style == "ibeam"
        ? ConfigManager::get_instance()->get_config_struct().caret.ibeam_width
@@ -184,9 +196,16 @@ void IncrementalUpdate_RenderLinesInRange(
   const CppTokenizerCache& tokenizer_cache,
   std::vector<SDL_Rect>& update_rects) noexcept
 {
+  // rendering only lines on screen, ranges can span till end of buffer
+  const uint32 first_visible_row = static_cast<uint32>(
+    std::max(0.0f, -scroll_y_offset) / font_extents.height);
+  const uint32 last_visible_row =
+    first_visible_row + window->height() / font_extents.height + 1;
   IncrementalRenderUpdateCommand command_copy = command;
   command_copy.type = IncrementalRenderUpdateType::RENDER_LINE;
-  for(uint32 i = command_copy.row_start; i <= command.row_end; i++)
+  for(uint32 i = std::max(command.row_start, first_visible_row);
+      i <= std::min(command.row_end, last_visible_row);
+      i++)
   {
     command_copy.row_start = i;
     IncrementalUpdate_RenderLine(command_copy,
@@ -0,0 +1,359 @@
+#include "../include/line_indexer.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__)
+#  include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#  include <emmintrin.h>
+#endif
+
+/// Bytes of text indexed into one batch by the background thread.
+static constexpr std::size_t batch_bytes = 4 * 1024 * 1024;
+
+/// Size of a slab holding tab expanded lines.
+static constexpr std::size_t expanded_slab_size = 64 * 1024;
+
+/// Bytes of text scanned at once.
+static constexpr std::size_t block_size = 32;
+
+/// @brief Finds newlines, tabs and non-ASCII bytes in a block of text.
+/// @param block pointer to block_size bytes.
+/// @param newlines bitmask of '\n' bytes, bit i for byte i.
+/// @param tabs bitmask of '\t' bytes.
+/// @param non_ascii bitmask of bytes with high bit set.
+/// @throws No exceptions.
+static inline void scan_block(const char* block,
+                              std::uint32_t& newlines,
+                              std::uint32_t& tabs,
+                              std::uint32_t& non_ascii) noexcept
+{
+#if defined(__AVX2__)
+  const __m256i bytes =
+    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+  newlines = static_cast<std::uint32_t>(
+    _mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\n'))));
+  tabs = static_cast<std::uint32_t>(
+    _mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\t'))));
+  non_ascii = static_cast<std::uint32_t>(_mm256_movemask_epi8(bytes));
+#elif defined(__SSE2__) || defined(_M_X64)
+  const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+  const __m128i high =
+    _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16));
+  const __m128i newline = _mm_set1_epi8('\n');
+  const __m128i tab = _mm_set1_epi8('\t');
+  newlines =
+    static_cast<std::uint32_t>(
+      _mm_movemask_epi8(_mm_cmpeq_epi8(low, newline))) |
+    static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(high, newline)))
+      << 16;
+  tabs =
+    static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(low, tab))) |
+    static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(high, tab)))
+      << 16;
+  non_ascii = static_cast<std::uint32_t>(_mm_movemask_epi8(low)) |
+              static_cast<std::uint32_t>(_mm_movemask_epi8(high)) << 16;
+#else
+  newlines = 0;
+  tabs = 0;
+  non_ascii = 0;
+  for(std::size_t i = 0; i < block_size; i++)
+  {
+    const unsigned char byte = static_cast<unsigned char>(block[i]);
+    newlines |= static_cast<std::uint32_t>(byte == '\n') << i;
+    tabs |= static_cast<std::uint32_t>(byte == '\t') << i;
+    non_ascii |= static_cast<std::uint32_t>(byte >> 7) << i;
+  }
+#endif
+}
+
+/// @brief Validates UTF-8 sequence starting with a non-ASCII byte.
+/// @param text pointer to text.
+/// @param size size of text in bytes.
+/// @param offset offset of first byte of sequence.
+/// @return Returns length of sequence, 0 if sequence is invalid.
+/// @throws No exceptions.
+static std::size_t utf8_sequence_length(const char* text,
+                                        const std::size_t& size,
+                                        const std::size_t& offset) noexcept
+{
+  const unsigned char* bytes =
+    reinterpret_cast<const unsigned char*>(text + offset);
+  const unsigned char lead = bytes[0];
+
+  // allowed range of second byte excludes overlong encodings,
+  // surrogates and code points above U+10FFFF
+  std::size_t length = 0;
+  unsigned char second_min = 0x80, second_max = 0xBF;
+  if(lead >= 0xC2 && lead <= 0xDF)
+  {
+    length = 2;
+  }
+  else if(lead >= 0xE0 && lead <= 0xEF)
+  {
+    length = 3;
+    second_min = lead == 0xE0 ? 0xA0 : 0x80;
+    second_max = lead == 0xED ? 0x9F : 0xBF;
+  }
+  else if(lead >= 0xF0 && lead <= 0xF4)
+  {
+    length = 4;
+    second_min = lead == 0xF0 ? 0x90 : 0x80;
+    second_max = lead == 0xF4 ? 0x8F : 0xBF;
+  }
+  else
+  {
+    return 0;
+  }
+
+  if(size - offset < length || bytes[1] < second_min || bytes[1] > second_max)
+  {
+    return 0;
+  }
+  for(std::size_t i = 2; i < length; i++)
+  {
+    if((bytes[i] & 0xC0) != 0x80)
+    {
+      return 0;
+    }
+  }
+  return length;
+}
+
+LineIndexer::LineIndexer() noexcept : _cancelled(false), _finished(true) {}
+
+LineIndexer::~LineIndexer() noexcept
+{
+  this->cancel();
+}
+
+bool LineIndexer::index_lines(const char* text,
+                              const std::size_t& size,
+                              std::size_t& offset,
+                              const std::size_t& bytes_limit,
+                              const uint8& tab_width,
+                              LineBatch& batch) noexcept
+{
+  const std::size_t start_offset = offset;
+  std::size_t slab_used = 0;
+
+  // reserving for lines of average length, growing pieces of a large
+  // batch is costlier than scanning the text
+  batch.pieces.reserve(batch.pieces.size() +
+                       std::min(bytes_limit, size - offset) / 32);
+  std::size_t slab_capacity = 0;
+
+  // appends line [begin, end) to batch, expanding its tabs
+  auto add_line = [&](const std::size_t& begin,
+                      std::size_t end,
+                      const std::size_t& tabs_count,
+                      const bool& has_newline)
+  {
+    if(has_newline)
+    {
+      if(end > begin && text[end - 1] == '\r')
+      {
+        end--;
+        batch.crlf_line_endings++;
+      }
+      else
+      {
+        batch.lf_line_endings++;
+      }
+    }
+
+    const std::size_t length = end - begin;
+    if(tabs_count == 0)
+    {
+      batch.pieces.push_back(
+        Piece{length == 0 ? nullptr : text + begin, length});
+      return;
+    }
+
+    // tabs are expanded into spaces, so the line is copied into a slab,
+    // ended with a newline like lines of text, so lines copied one after
+    // another can be searched as one text
+    const std::size_t expanded_length = length + tabs_count * (tab_width - 1);
+    char* data = nullptr;
+    if(expanded_length + 1 > expanded_slab_size)
+    {
+      // large lines get a slab of their own, so the current slab
+      // can still be filled with small lines
+      std::unique_ptr<char[]> slab =
+        std::make_unique<char[]>(expanded_length + 1);
+      data = slab.get();
+      batch.slabs.insert(batch.slabs.end() - (slab_capacity == 0 ? 0 : 1),
+                         std::move(slab));
+    }
+    else
+    {
+      if(slab_capacity - slab_used < expanded_length + 1)
+      {
+        batch.slabs.push_back(std::make_unique<char[]>(expanded_slab_size));
+        slab_used = 0;
+        slab_capacity = expanded_slab_size;
+      }
+      data = batch.slabs.back().get() + slab_used;
+      slab_used += expanded_length + 1;
+    }
+    data[expanded_length] = '\n';
+
+    // copying runs between tabs
+    char* destination = data;
+    const char* source = text + begin;
+    const char* source_end = text + end;
+    while(source != source_end)
+    {
+      const std::size_t remaining =
+        static_cast<std::size_t>(source_end - source);
+      const char* tab =
+        static_cast<const char*>(std::memchr(source, '\t', remaining));
+      const std::size_t run_length =
+        tab ? static_cast<std::size_t>(tab - source) : remaining;
+      std::memcpy(destination, source, run_length);
+      destination += run_length;
+      source += run_length;
+      if(tab)
+      {
+        std::memset(destination, ' ', tab_width);
+        destination += tab_width;
+        source++;
+      }
+    }
+    batch.pieces.push_back(Piece{data, expanded_length});
+  };
+
+  // single pass over blocks, finding line ends and counting tabs of
+  // each line, and validating UTF-8 where blocks have non-ASCII bytes
+  std::size_t line_begin = offset;
+  std::size_t tabs_count = 0;
+  std::size_t utf8_validated = offset;
+  char tail[block_size];
+  for(std::size_t block = offset; block < size; block += block_size)
+  {
+    const char* block_data = text + block;
+    if(size - block < block_size)
+    {
+      // padding last block with zeros, they match nothing
+      std::memset(tail, 0, block_size);
+      std::memcpy(tail, text + block, size - block);
+      block_data = tail;
+    }
+
+    std::uint32_t newlines, tabs, non_ascii;
+    scan_block(block_data, newlines, tabs, non_ascii);
+    // validating sequences starting at non-ASCII bytes, bytes
+    // covered by a sequence from previous block are skipped
+    while(non_ascii != 0 && batch.valid_utf8)
+    {
+      const std::size_t sequence_offset = block + std::countr_zero(non_ascii);
+      non_ascii &= non_ascii - 1;
+      if(sequence_offset < utf8_validated)
+      {
+        continue;
+      }
+
+      const std::size_t length =
+        utf8_sequence_length(text, size, sequence_offset);
+      batch.valid_utf8 = length != 0;
+      utf8_validated = sequence_offset + length;
+    }
+
+    while(newlines != 0)
+    {
+      const std::uint32_t bit = std::countr_zero(newlines);
+      const std::uint32_t before_mask = (std::uint64_t(1) << bit) - 1;
+      tabs_count += std::popcount(tabs & before_mask);
+      tabs &= ~static_cast<std::uint32_t>((std::uint64_t(2) << bit) - 1);
+      newlines &= newlines - 1;
+
+      add_line(line_begin, block + bit, tabs_count, true);
+      line_begin = block + bit + 1;
+      tabs_count = 0;
+      if(line_begin - start_offset >= bytes_limit)
+      {
+        offset = line_begin;
+        return false;
+      }
+    }
+    tabs_count += std::popcount(tabs);
+  }
+
+  add_line(line_begin, size, tabs_count, false);
+  offset = size;
+  return true;
+}
+
+void LineIndexer::start(const char* text,
+                        const std::size_t& size,
+                        const std::size_t& offset,
+                        const uint8& tab_width) noexcept
+{
+  this->cancel();
+
+  _cancelled = false;
+  _finished = false;
+  _thread = std::thread(
+    [this, text, size, offset, tab_width]()
+    {
+      std::size_t current_offset = offset;
+      bool done = false;
+      while(!done && !_cancelled)
+      {
+        LineBatch batch;
+        done = index_lines(
+          text, size, current_offset, batch_bytes, tab_width, batch);
+
+        std::lock_guard<std::mutex> lock(_batches_mutex);
+        _batches.push_back(std::move(batch));
+      }
+      _finished = true;
+    });
+}
+
+void LineIndexer::cancel() noexcept
+{
+  _cancelled = true;
+  if(_thread.joinable())
+  {
+    _thread.join();
+  }
+  _finished = true;
+
+  std::lock_guard<std::mutex> lock(_batches_mutex);
+  _batches.clear();
+}
+
+void LineIndexer::wait() noexcept
+{
+  if(_thread.joinable())
+  {
+    _thread.join();
+  }
+}
+
+bool LineIndexer::running() const noexcept
+{
+  if(!_finished)
+  {
+    return true;
+  }
+
+  std::lock_guard<std::mutex> lock(_batches_mutex);
+  return !_batches.empty();
+}
+
+std::optional<LineBatch> LineIndexer::get_next_batch() noexcept
+{
+  std::lock_guard<std::mutex> lock(_batches_mutex);
+  if(_batches.empty())
+  {
+    return std::nullopt;
+  }
+
+  LineBatch batch = std::move(_batches.front());
+  _batches.pop_front();
+  return batch;
+}
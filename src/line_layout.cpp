@@ -0,0 +1,402 @@
+#include "../include/line_layout.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+/// Maximum number of line layouts kept in cache.
+static constexpr std::size_t max_cached_layouts = 4096;
+
+/// Range of code points.
+struct CodePointRange
+{
+  uint32 first, last;
+};
+
+/// Code points which take no cell and extend the previous cluster:
+/// combining marks, zero width joiners, variation selectors, Hangul
+/// medial and final jamo, emoji skin tone modifiers and tags.
+static constexpr CodePointRange extending_ranges[] = {
+  {0x0300, 0x036F},   {0x0483, 0x0489},   {0x0591, 0x05BD},
+  {0x0610, 0x061A},   {0x064B, 0x065F},   {0x0670, 0x0670},
+  {0x06D6, 0x06DC},   {0x06DF, 0x06E4},   {0x0900, 0x0903},
+  {0x093A, 0x094F},   {0x0951, 0x0957},   {0x0962, 0x0963},
+  {0x0981, 0x0983},   {0x09BC, 0x09D7},   {0x0E31, 0x0E31},
+  {0x0E34, 0x0E3A},   {0x0E47, 0x0E4E},   {0x1160, 0x11FF},
+  {0x1AB0, 0x1AFF},   {0x1DC0, 0x1DFF},   {0x200B, 0x200F},
+  {0x20D0, 0x20FF},   {0x302A, 0x302F},   {0x3099, 0x309A},
+  {0xFE00, 0xFE0F},   {0xFE20, 0xFE2F},   {0x1F3FB, 0x1F3FF},
+  {0xE0000, 0xE007F}, {0xE0100, 0xE01EF},
+};
+
+/// Code points which take two cells: East Asian wide and fullwidth
+/// characters, and emoji with emoji presentation.
+static constexpr CodePointRange wide_ranges[] = {
+  {0x1100, 0x115F},   {0x231A, 0x231B},   {0x2329, 0x232A},
+  {0x23E9, 0x23EC},   {0x23F0, 0x23F0},   {0x23F3, 0x23F3},
+  {0x25FD, 0x25FE},   {0x2614, 0x2615},   {0x2648, 0x2653},
+  {0x267F, 0x267F},   {0x2693, 0x2693},   {0x26A1, 0x26A1},
+  {0x26AA, 0x26AB},   {0x26BD, 0x26BE},   {0x26C4, 0x26C5},
+  {0x26CE, 0x26CE},   {0x26D4, 0x26D4},   {0x26EA, 0x26EA},
+  {0x26F2, 0x26F3},   {0x26F5, 0x26F5},   {0x26FA, 0x26FA},
+  {0x26FD, 0x26FD},   {0x2705, 0x2705},   {0x270A, 0x270B},
+  {0x2728, 0x2728},   {0x274C, 0x274C},   {0x274E, 0x274E},
+  {0x2753, 0x2755},   {0x2757, 0x2757},   {0x2795, 0x2797},
+  {0x27B0, 0x27B0},   {0x27BF, 0x27BF},   {0x2B1B, 0x2B1C},
+  {0x2B50, 0x2B50},   {0x2B55, 0x2B55},   {0x2E80, 0x303E},
+  {0x3041, 0x33FF},   {0x3400, 0x4DBF},   {0x4E00, 0x9FFF},
+  {0xA000, 0xA4CF},   {0xA960, 0xA97F},   {0xAC00, 0xD7A3},
+  {0xF900, 0xFAFF},   {0xFE10, 0xFE19},   {0xFE30, 0xFE6F},
+  {0xFF00, 0xFF60},   {0xFFE0, 0xFFE6},   {0x16FE0, 0x16FE4},
+  {0x17000, 0x18CFF}, {0x1B000, 0x1B16F}, {0x1F004, 0x1F004},
+  {0x1F0CF, 0x1F0CF}, {0x1F18E, 0x1F18E}, {0x1F191, 0x1F19A},
+  {0x1F200, 0x1F251}, {0x1F300, 0x1F320}, {0x1F32D, 0x1F335},
+  {0x1F337, 0x1F37C}, {0x1F37E, 0x1F393}, {0x1F3A0, 0x1F3CA},
+  {0x1F3CF, 0x1F3D3}, {0x1F3E0, 0x1F3F0}, {0x1F3F4, 0x1F3F4},
+  {0x1F3F8, 0x1F43E}, {0x1F440, 0x1F440}, {0x1F442, 0x1F4FC},
+  {0x1F4FF, 0x1F53D}, {0x1F54B, 0x1F54E}, {0x1F550, 0x1F567},
+  {0x1F57A, 0x1F57A}, {0x1F595, 0x1F596}, {0x1F5A4, 0x1F5A4},
+  {0x1F5FB, 0x1F64F}, {0x1F680, 0x1F6C5}, {0x1F6CC, 0x1F6CC},
+  {0x1F6D0, 0x1F6D2}, {0x1F6D5, 0x1F6D7}, {0x1F6DC, 0x1F6DF},
+  {0x1F6EB, 0x1F6EC}, {0x1F6F4, 0x1F6FC}, {0x1F7E0, 0x1F7EB},
+  {0x1F7F0, 0x1F7F0}, {0x1F90C, 0x1F93A}, {0x1F93C, 0x1F945},
+  {0x1F947, 0x1F9FF}, {0x1FA70, 0x1FAFF}, {0x20000, 0x2FFFD},
+  {0x30000, 0x3FFFD},
+};
+
+/// Zero width joiner, joins emoji into one cluster.
+static constexpr uint32 zero_width_joiner = 0x200D;
+
+/// Variation selector asking for emoji presentation, which is wide.
+static constexpr uint32 emoji_variation_selector = 0xFE0F;
+
+/// @brief Tells if code point lies in one of the sorted ranges.
+/// @throws No exceptions.
+template<std::size_t N>
+static bool in_ranges(const uint32& code_point,
+                      const CodePointRange (&ranges)[N]) noexcept
+{
+  const CodePointRange* range = std::upper_bound(
+    ranges,
+    ranges + N,
+    code_point,
+    [](const uint32& value, const CodePointRange& range)
+    { return value < range.first; });
+  return range != ranges && code_point <= (range - 1)->last;
+}
+
+/// @brief Tells if code point is a regional indicator (half of a flag).
+/// @throws No exceptions.
+static bool is_regional_indicator(const uint32& code_point) noexcept
+{
+  return code_point >= 0x1F1E6 && code_point <= 0x1F1FF;
+}
+
+/// @brief Decodes code point at start of text.
+/// @param text UTF-8 text.
+/// @param size number of bytes of text, atleast 1.
+/// @param code_point decoded code point.
+/// @return Returns length of code point's sequence, invalid sequences
+///         are decoded as a single byte.
+/// @throws No exceptions.
+static uint8 decode(const unsigned char* text,
+                    const std::size_t& size,
+                    uint32& code_point) noexcept
+{
+  const unsigned char lead = text[0];
+  uint8 length = 0;
+  uint32 min_code_point = 0;
+  if(lead >= 0xC2 && lead <= 0xDF)
+  {
+    length = 2;
+    code_point = lead & 0x1F;
+    min_code_point = 0x80;
+  }
+  else if(lead >= 0xE0 && lead <= 0xEF)
+  {
+    length = 3;
+    code_point = lead & 0x0F;
+    min_code_point = 0x800;
+  }
+  else if(lead >= 0xF0 && lead <= 0xF4)
+  {
+    length = 4;
+    code_point = lead & 0x07;
+    min_code_point = 0x10000;
+  }
+  if(length == 0 || length > size)
+  {
+    code_point = lead;
+    return 1;
+  }
+
+  for(uint8 i = 1; i < length; i++)
+  {
+    if((text[i] & 0xC0) != 0x80)
+    {
+      code_point = lead;
+      return 1;
+    }
+    code_point = (code_point << 6) | (text[i] & 0x3F);
+  }
+  if(code_point < min_code_point || code_point > 0x10FFFF ||
+     (code_point >= 0xD800 && code_point <= 0xDFFF))
+  {
+    code_point = lead;
+    return 1;
+  }
+  return length;
+}
+
+/// @brief Tells if text is pure ASCII, checking 8 bytes at a time.
+/// @throws No exceptions.
+static bool is_ascii_text(const std::string_view& text) noexcept
+{
+  std::size_t i = 0;
+  for(; i + 8 <= text.size(); i += 8)
+  {
+    uint64_t word;
+    std::memcpy(&word, text.data() + i, 8);
+    if(word & 0x8080808080808080ull)
+    {
+      return false;
+    }
+  }
+  for(; i < text.size(); i++)
+  {
+    if(static_cast<unsigned char>(text[i]) & 0x80)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// @brief Finds end of grapheme cluster starting at a byte.
+/// @param text UTF-8 text.
+/// @param start index of first byte of cluster.
+/// @param cells set to cells cluster takes.
+/// @return Returns index of byte after cluster.
+/// @throws No exceptions.
+static std::size_t find_cluster_end(const std::string_view& text,
+                                    std::size_t start,
+                                    uint32& cells) noexcept
+{
+  const unsigned char* data =
+    reinterpret_cast<const unsigned char*>(text.data());
+  uint32 code_point = 0;
+  std::size_t i = start + decode(data + start, text.size() - start, code_point);
+  if(i == start + 1 && code_point >= 0x80)
+  {
+    // invalid byte is a cluster of its own
+    cells = 1;
+    return i;
+  }
+
+  cells = in_ranges(code_point, wide_ranges) ? 2 : 1;
+  const bool regional_indicator = is_regional_indicator(code_point);
+  bool joined = false;
+  while(i < text.size())
+  {
+    uint32 next_code_point = 0;
+    const uint8 next_length =
+      decode(data + i, text.size() - i, next_code_point);
+    if(next_length == 1 && next_code_point >= 0x80)
+    {
+      break;
+    }
+
+    if(joined || in_ranges(next_code_point, extending_ranges) ||
+       next_code_point == zero_width_joiner ||
+       (regional_indicator && is_regional_indicator(next_code_point) &&
+        i - start == 4))
+    {
+      // emoji presentation, and flags of two regional indicators
+      // take two cells
+      if(next_code_point == emoji_variation_selector ||
+         is_regional_indicator(next_code_point))
+      {
+        cells = 2;
+      }
+      joined = next_code_point == zero_width_joiner;
+      i += next_length;
+      continue;
+    }
+    break;
+  }
+  return i;
+}
+
+/// @brief Walks grapheme clusters of text, calling callback with byte
+///        index and cells of each cluster.
+/// @throws No exceptions.
+template<typename Callback>
+static void for_each_cluster(const std::string_view& text,
+                             Callback&& callback) noexcept
+{
+  std::size_t i = 0;
+  while(i < text.size())
+  {
+    const std::size_t start = i;
+    uint32 cells = 0;
+    i = find_cluster_end(text, start, cells);
+    callback(start, cells);
+  }
+}
+
+LineLayout::LineLayout() noexcept
+  : _ascii(true)
+  , _length(0)
+  , _width(0)
+{}
+
+LineLayout::LineLayout(const std::string_view& line) noexcept
+  : _ascii(is_ascii_text(line))
+  , _length(line.size())
+  , _width(line.size())
+{
+  if(_ascii)
+  {
+    return;
+  }
+
+  _byte_clusters.resize(line.size());
+  uint32 cells = 0;
+  for_each_cluster(
+    line,
+    [&](const std::size_t& start, const uint32& cluster_cells)
+    {
+      _cluster_starts.push_back(start);
+      _cluster_cells.push_back(cells);
+      cells += cluster_cells;
+    });
+  _cluster_starts.push_back(line.size());
+  _cluster_cells.push_back(cells);
+  _width = cells;
+
+  _cell_clusters.resize(cells);
+  for(uint32 cluster = 0; cluster + 1 < _cluster_starts.size(); cluster++)
+  {
+    std::fill(_byte_clusters.begin() + _cluster_starts[cluster],
+              _byte_clusters.begin() + _cluster_starts[cluster + 1],
+              cluster);
+    std::fill(_cell_clusters.begin() + _cluster_cells[cluster],
+              _cell_clusters.begin() + _cluster_cells[cluster + 1],
+              cluster);
+  }
+}
+
+bool LineLayout::is_ascii() const noexcept
+{
+  return _ascii;
+}
+
+std::size_t LineLayout::length() const noexcept
+{
+  return _length;
+}
+
+uint32 LineLayout::width() const noexcept
+{
+  return _width;
+}
+
+uint32 LineLayout::cells_before(const int32& column) const noexcept
+{
+  const std::size_t byte =
+    std::min<std::size_t>(std::max<int32>(column + 1, 0), _length);
+  if(_ascii)
+  {
+    return byte;
+  }
+  if(byte == _length)
+  {
+    return _width;
+  }
+  return _cluster_cells[_byte_clusters[byte]];
+}
+
+int32 LineLayout::column_at(const uint32& cells) const noexcept
+{
+  if(cells >= _width)
+  {
+    return static_cast<int32>(_length) - 1;
+  }
+  if(_ascii)
+  {
+    return static_cast<int32>(cells) - 1;
+  }
+  return static_cast<int32>(_cluster_starts[_cell_clusters[cells]]) - 1;
+}
+
+int32 LineLayout::previous_column(const int32& column) const noexcept
+{
+  if(_ascii)
+  {
+    return column - 1;
+  }
+
+  const std::size_t byte = std::min<std::size_t>(column + 1, _length);
+  const uint32 cluster = byte == _length ? _cluster_starts.size() - 1
+                                         : _byte_clusters[byte];
+  if(_cluster_starts[cluster] < byte)
+  {
+    // cursor inside cluster, moving to its start
+    return static_cast<int32>(_cluster_starts[cluster]) - 1;
+  }
+  return static_cast<int32>(_cluster_starts[cluster - 1]) - 1;
+}
+
+int32 LineLayout::next_column(const int32& column) const noexcept
+{
+  if(_ascii)
+  {
+    return column + 1;
+  }
+
+  const std::size_t byte = column + 1;
+  return static_cast<int32>(_cluster_starts[_byte_clusters[byte] + 1]) - 1;
+}
+
+uint32 LineLayout::width_of(const std::string_view& text) noexcept
+{
+  if(is_ascii_text(text))
+  {
+    return text.size();
+  }
+
+  uint32 cells = 0;
+  for_each_cluster(text,
+                   [&](const std::size_t&, const uint32& cluster_cells)
+                   { cells += cluster_cells; });
+  return cells;
+}
+
+std::size_t LineLayout::cluster_end(const std::string_view& text,
+                                    const std::size_t& start,
+                                    uint32& cells) noexcept
+{
+  return find_cluster_end(text, start, cells);
+}
+
+const LineLayout&
+LineLayoutCache::layout(const std::string_view& line) noexcept
+{
+  auto it = _layouts.find(line.data());
+  if(it != _layouts.end() && it->second.length() == line.size())
+  {
+    return it->second;
+  }
+
+  // ASCII layouts hold no vectors, they are cached to skip the scan
+  if(_layouts.size() >= max_cached_layouts)
+  {
+    _layouts.clear();
+  }
+  return _layouts.insert_or_assign(line.data(), LineLayout(line))
+    .first->second;
+}
+
+void LineLayoutCache::clear() noexcept
+{
+  _layouts.clear();
+}
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cmath>
 #include <filesystem>
 #include <fstream>
@@ -11,6 +12,7 @@
 #include "../include/cursor_manager.hpp"
 #include "../include/incremental_render_update.hpp"
 #include "../include/macros.hpp"
+#include "../include/project_search.hpp"
 #include "../include/rocket_render.hpp"
 #include "../include/sdl2.hpp"
 #include "../include/utils.hpp"
@@ -63,11 +65,16 @@ int main(int argc, char** argv)
   // Enabling screen saver
   SDL_EnableScreenSaver();
 
+  // title of window without save progress
+  std::string window_title = "Rocket";
+  if(argc > 1)
+  {
+    window_title +=
+      " - " +
+      std::filesystem::absolute(std::filesystem::path(argv[1])).string();
+  }
   Window* window = new Window(
-    "Rocket" +
-      (argc > 1
-         ? std::filesystem::absolute(std::filesystem::path(argv[1])).string()
-         : ""),
+    window_title,
     ConfigManager::get_instance()->get_config_struct().window.width,
     ConfigManager::get_instance()->get_config_struct().window.height);
   {
@@ -109,6 +116,27 @@ int main(int argc, char** argv)
         wait_time = 250;
   bool redraw = true, mouse_single_tap_down = false,
        mouse_double_tap_down = false, mouse_triple_tap_down = false;
+  // find bar, typed text goes to its query while it's open
+  bool find_bar_open = false, find_case_sensitive = false, find_regex = false,
+       finding = false;
+  std::string find_query;
+  // replace bar is find bar with replacement, tab switches typing into it
+  bool replace_bar_open = false, replacement_focused = false;
+  std::string replacement;
+  // find in files, results are lines of buffer, enter opens a result
+  bool find_in_files = false, find_in_files_valid = true,
+       project_results_open = false;
+  ProjectSearch project_search;
+  // completion popup, of identifier typed before cursor
+  std::vector<std::string> completions;
+  std::string completion_prefix;
+  std::size_t completion_index = 0;
+  const std::size_t max_completions = 8;
+  // rename bar, typed name replaces every occurrence of identifier
+  bool rename_bar_open = false;
+  std::string rename_identifier, rename_text;
+  // occurrences of identifier under cursor, highlighted in visible lines
+  std::vector<TextMatch> occurrences;
   SDL_StartTextInput();
   while(true)
   {
@@ -214,12 +242,274 @@ int main(int argc, char** argv)
       }
       else if(event.type == SDL_KEYDOWN)
       {
+        // completion popup takes arrows, tab, enter and escape,
+        // other keys close it, backspace refines it
+        const bool completion_key =
+          !completions.empty() && (event.key.keysym.sym == SDLK_ESCAPE ||
+                                   event.key.keysym.sym == SDLK_UP ||
+                                   event.key.keysym.sym == SDLK_DOWN ||
+                                   event.key.keysym.sym == SDLK_TAB ||
+                                   event.key.keysym.sym == SDLK_RETURN ||
+                                   event.key.keysym.sym == SDLK_RETURN2);
+        if(!completion_key && event.key.keysym.sym != SDLK_BACKSPACE)
+        {
+          completions.clear();
+        }
+
+        // Completion popup events
+        if(completion_key && event.key.keysym.sym == SDLK_ESCAPE)
+        {
+          completions.clear();
+        }
+        else if(completion_key && (event.key.keysym.sym == SDLK_UP ||
+                                   event.key.keysym.sym == SDLK_DOWN))
+        {
+          completion_index =
+            (completion_index + (event.key.keysym.sym == SDLK_UP
+                                   ? completions.size() - 1
+                                   : 1)) %
+            completions.size();
+        }
+        else if(completion_key)
+        {
+          buffer.insert_string(
+            completions[completion_index].substr(completion_prefix.size()));
+          tokenizer_cache.update_cache(buffer);
+          completions.clear();
+        }
+        // Rename bar events
+        else if(!find_bar_open && event.key.keysym.sym == SDLK_F2)
+        {
+          std::optional<std::string> identifier =
+            identifier_at_cursor(buffer, tokenizer_cache);
+          if(identifier)
+          {
+            rename_bar_open = true;
+            rename_identifier = identifier.value();
+            rename_text = rename_identifier;
+          }
+        }
+        else if(rename_bar_open && event.key.keysym.sym == SDLK_ESCAPE)
+        {
+          rename_bar_open = false;
+        }
+        else if(rename_bar_open && event.key.keysym.sym == SDLK_BACKSPACE)
+        {
+          // removing last character, with its continuation bytes
+          while(!rename_text.empty() && (rename_text.back() & 0xC0) == 0x80)
+          {
+            rename_text.pop_back();
+          }
+          if(!rename_text.empty())
+          {
+            rename_text.pop_back();
+          }
+        }
+        else if(rename_bar_open && (event.key.keysym.sym == SDLK_RETURN ||
+                                    event.key.keysym.sym == SDLK_RETURN2))
+        {
+          // postings have occurrences of tokenized lines only,
+          // so all lines are tokenized first
+          tokenizer_cache.build_cache_till(buffer, buffer.length());
+          occurrences.clear();
+          tokenizer_cache.find_identifier(
+            rename_identifier, 0, buffer.length(), occurrences);
+          if(!rename_text.empty() &&
+             buffer.replace_ranges(occurrences, rename_text))
+          {
+            tokenizer_cache.update_cache(buffer);
+          }
+          rename_bar_open = false;
+        }
+        // Find bar events
+        else if((event.key.keysym.sym == SDLK_f ||
+            event.key.keysym.sym == SDLK_h) &&
+           (event.key.keysym.mod & KMOD_LCTRL))
+        {
+          find_bar_open = true;
+          rename_bar_open = false;
+          replace_bar_open = event.key.keysym.sym == SDLK_h;
+          replacement_focused = false;
+          find_in_files = !replace_bar_open &&
+                          (event.key.keysym.mod & KMOD_SHIFT) != 0;
+          find_in_files_valid = true;
+          if(find_in_files)
+          {
+            buffer.find("", find_case_sensitive, find_regex);
+          }
+          else
+          {
+            buffer.find(find_query, find_case_sensitive, find_regex);
+            buffer.select_nearest_match();
+          }
+        }
+        else if(find_bar_open && event.key.keysym.sym == SDLK_ESCAPE)
+        {
+          find_bar_open = false;
+          replace_bar_open = false;
+          buffer.find("", find_case_sensitive, find_regex);
+        }
+        else if(replace_bar_open && event.key.keysym.sym == SDLK_TAB)
+        {
+          replacement_focused = !replacement_focused;
+        }
+        else if(find_bar_open && event.key.keysym.sym == SDLK_BACKSPACE)
+        {
+          // removing last character, with its continuation bytes
+          std::string& text = replacement_focused ? replacement : find_query;
+          while(!text.empty() && (text.back() & 0xC0) == 0x80)
+          {
+            text.pop_back();
+          }
+          if(!text.empty())
+          {
+            text.pop_back();
+          }
+          find_in_files_valid = true;
+          if(!find_in_files && !replacement_focused)
+          {
+            buffer.find(find_query, find_case_sensitive, find_regex);
+            buffer.select_nearest_match();
+          }
+        }
+        else if(find_bar_open && (event.key.keysym.sym == SDLK_RETURN ||
+                                  event.key.keysym.sym == SDLK_RETURN2))
+        {
+          if(find_in_files)
+          {
+            // searching directory editor is started from,
+            // results are streamed into buffer
+            std::error_code error;
+            find_in_files_valid = project_search.start(
+              std::filesystem::current_path(error).string(),
+              find_query,
+              find_case_sensitive,
+              find_regex,
+              ConfigManager::get_instance()->get_config_struct().tab_width,
+              0);
+            if(find_in_files_valid)
+            {
+              buffer.load_from_lines({"Results of \"" + find_query + "\" in " +
+                                      project_search.directory() +
+                                      ", enter opens a result"});
+              tokenizer_cache.build_cache(buffer);
+              project_results_open = true;
+              find_bar_open = false;
+              window_title = "Rocket - Find in files: " + find_query;
+              window->title() = window_title;
+              window->update_title();
+              scroll_y_offset = 0;
+              scroll_y_target = 0;
+            }
+          }
+          else if(replace_bar_open && (event.key.keysym.mod & KMOD_CTRL))
+          {
+            // all matches are replaced in one edit, undone at once
+            if(buffer.replace_all(replacement))
+            {
+              tokenizer_cache.update_cache(buffer);
+            }
+          }
+          else if(event.key.keysym.mod & KMOD_SHIFT)
+          {
+            buffer.select_previous_match();
+          }
+          else
+          {
+            buffer.select_next_match();
+          }
+        }
+        else if(find_bar_open && event.key.keysym.sym == SDLK_c &&
+                (event.key.keysym.mod & KMOD_ALT))
+        {
+          find_case_sensitive = !find_case_sensitive;
+          if(!find_in_files)
+          {
+            buffer.find(find_query, find_case_sensitive, find_regex);
+            buffer.select_nearest_match();
+          }
+        }
+        else if(find_bar_open && event.key.keysym.sym == SDLK_r &&
+                (event.key.keysym.mod & KMOD_ALT))
+        {
+          find_regex = !find_regex;
+          find_in_files_valid = true;
+          if(!find_in_files)
+          {
+            buffer.find(find_query, find_case_sensitive, find_regex);
+            buffer.select_nearest_match();
+          }
+        }
+        else if(find_bar_open && !find_in_files &&
+                (event.key.keysym.sym == SDLK_UP ||
+                 event.key.keysym.sym == SDLK_DOWN))
+        {
+          if(event.key.keysym.sym == SDLK_UP)
+          {
+            buffer.select_previous_match();
+          }
+          else
+          {
+            buffer.select_next_match();
+          }
+        }
+        // bars have focus, navigation keys don't reach buffer
+        else if((find_bar_open || rename_bar_open) &&
+                (event.key.keysym.sym == SDLK_TAB ||
+                 event.key.keysym.sym == SDLK_LEFT ||
+                 event.key.keysym.sym == SDLK_RIGHT ||
+                 event.key.keysym.sym == SDLK_UP ||
+                 event.key.keysym.sym == SDLK_DOWN ||
+                 event.key.keysym.sym == SDLK_HOME ||
+                 event.key.keysym.sym == SDLK_END ||
+                 event.key.keysym.sym == SDLK_PAGEUP ||
+                 event.key.keysym.sym == SDLK_PAGEDOWN ||
+                 event.key.keysym.sym == SDLK_DELETE ||
+                 (event.key.keysym.sym == SDLK_m &&
+                  (event.key.keysym.mod & KMOD_LCTRL))))
+        {}
+        // Jump to matching bracket event
+        else if(event.key.keysym.sym == SDLK_m &&
+                (event.key.keysym.mod & KMOD_LCTRL))
+        {
+          // cursor goes before matching bracket
+          const auto bracket_pair =
+            bracket_pair_at_cursor(buffer, tokenizer_cache, buffer.length());
+          if(bracket_pair)
+          {
+            buffer.clear_selection();
+            buffer.set_cursor_row(bracket_pair.value().second.first);
+            buffer.set_cursor_column(
+              static_cast<int32>(bracket_pair.value().second.second) - 1);
+            buffer.set_cursor_column_target(buffer.cursor_coords().second);
+          }
+        }
         // Save file event
-        if(event.key.keysym.sym == SDLK_s &&
+        else if(event.key.keysym.sym == SDLK_s &&
            (event.key.keysym.mod & KMOD_LCTRL))
         {
           bool _ = buffer.save();
         }
+        // Undo & redo events
+        else if(event.key.keysym.sym == SDLK_z &&
+                (event.key.keysym.mod & KMOD_LCTRL))
+        {
+          if(event.key.keysym.mod & KMOD_LSHIFT)
+          {
+            buffer.redo();
+          }
+          else
+          {
+            buffer.undo();
+          }
+          tokenizer_cache.update_cache(buffer);
+        }
+        else if(event.key.keysym.sym == SDLK_y &&
+                (event.key.keysym.mod & KMOD_LCTRL))
+        {
+          buffer.redo();
+          tokenizer_cache.update_cache(buffer);
+        }
         else if(event.key.keysym.sym == SDLK_LEFT)
         {
           if((event.key.keysym.mod & KMOD_LCTRL) &&
@@ -335,6 +625,15 @@ int main(int argc, char** argv)
         {
           buffer.process_backspace();
           tokenizer_cache.update_cache(buffer);
+          if(!completions.empty())
+          {
+            completion_prefix =
+              complete_identifier(buffer,
+                                  tokenizer_cache.identifiers(),
+                                  max_completions,
+                                  completions);
+            completion_index = 0;
+          }
         }
         else if(event.key.keysym.sym == SDLK_TAB)
         {
@@ -342,6 +641,42 @@ int main(int argc, char** argv)
             ConfigManager::get_instance()->get_config_struct().tab_width, ' '));
           tokenizer_cache.update_cache(buffer);
         }
+        else if(project_results_open &&
+                (event.key.keysym.sym == SDLK_RETURN ||
+                 event.key.keysym.sym == SDLK_RETURN2))
+        {
+          // opening file of result at cursor, at its match
+          const std::optional<ProjectMatch> match = ProjectSearch::parse_result(
+            buffer.line(buffer.cursor_coords().first).value_or(""));
+          const std::string file_path =
+            match ? project_search.directory() + match.value().path : "";
+          if(match && buffer.load_from_file(file_path))
+          {
+            project_search.cancel();
+            project_results_open = false;
+            // lines of large files after first screen are loaded in
+            // background, waiting for line of match
+            while(buffer.length() <= match.value().row && buffer.is_loading())
+            {
+              SDL_Delay(1);
+              buffer.append_background_loaded_lines();
+            }
+            buffer.set_cursor_row(match.value().row);
+            buffer.set_cursor_column(std::min<int32>(
+              match.value().column - 1,
+              static_cast<int32>(
+                buffer.line_length(buffer.cursor_coords().first).value_or(0)) -
+                1));
+            buffer.set_cursor_column_target(buffer.cursor_coords().second);
+            window_title =
+              "Rocket - " +
+              std::filesystem::absolute(std::filesystem::path(file_path))
+                .string();
+            window->title() = window_title;
+            window->update_title();
+            tokenizer_cache.build_cache(buffer);
+          }
+        }
         else if(event.key.keysym.sym == SDLK_RETURN ||
                 event.key.keysym.sym == SDLK_RETURN2)
         {
@@ -354,29 +689,18 @@ int main(int argc, char** argv)
         }
 
         // calculating final scroll_y_offset
-        std::pair<uint32, int32> cursor_coords = buffer.cursor_coords();
-        float32 effective_cursor_y =
-          scroll_y_offset +
-          static_cast<int32>(cursor_coords.first) * font_extents.height;
-        if(effective_cursor_y < 0)
-        {
-          scroll_y_target = scroll_y_offset =
-            -static_cast<int32>(cursor_coords.first) * font_extents.height;
-          redraw = true;
-        }
-        else if(effective_cursor_y + font_extents.height > window->height())
-        {
-          scroll_y_offset -=
-            effective_cursor_y + font_extents.height - window->height();
-          scroll_y_target = scroll_y_offset;
-          redraw = true;
-        }
+        scroll_to_cursor(buffer,
+                         font_extents.height,
+                         window->height(),
+                         &scroll_y_offset,
+                         &scroll_y_target);
         redraw = true;
       }
       else if(event.type == SDL_MOUSEBUTTONDOWN)
       {
         // clearing buffer selection
         buffer.clear_selection();
+        completions.clear();
 
         float32 line_numbers_width =
           (std::to_string(buffer.length()).length() + 2) *
@@ -429,19 +753,56 @@ int main(int argc, char** argv)
       }
       else if(event.type == SDL_TEXTINPUT)
       {
-        buffer.insert_string(event.text.text);
-        tokenizer_cache.update_cache(buffer);
+        if(rename_bar_open)
+        {
+          rename_text.append(event.text.text);
+        }
+        else if(find_bar_open)
+        {
+          // alt + c and alt + r toggle options, they aren't typed
+          if(!(SDL_GetModState() & KMOD_ALT) && replacement_focused)
+          {
+            replacement.append(event.text.text);
+          }
+          else if(!(SDL_GetModState() & KMOD_ALT))
+          {
+            find_query.append(event.text.text);
+            find_in_files_valid = true;
+            if(!find_in_files)
+            {
+              buffer.find(find_query, find_case_sensitive, find_regex);
+              buffer.select_nearest_match();
+              scroll_to_cursor(buffer,
+                               font_extents.height,
+                               window->height(),
+                               &scroll_y_offset,
+                               &scroll_y_target);
+            }
+          }
+        }
+        else
+        {
+          buffer.insert_string(event.text.text);
+          tokenizer_cache.update_cache(buffer);
+          completion_prefix = complete_identifier(buffer,
+                                                  tokenizer_cache.identifiers(),
+                                                  max_completions,
+                                                  completions);
+          completion_index = 0;
+        }
         redraw = true;
       }
       else if(event.type == SDL_DROPFILE)
       {
         if(buffer.load_from_file(event.drop.file))
         {
-          window->title().erase();
-          window->title().append(
+          project_search.cancel();
+          project_results_open = false;
+          window_title =
             "Rocket - " +
             std::filesystem::absolute(std::filesystem::path(event.drop.file))
-              .string());
+              .string();
+          window->title() = window_title;
           window->update_title();
           tokenizer_cache.build_cache(buffer);
           scroll_y_offset = 0;
@@ -451,6 +812,77 @@ int main(int argc, char** argv)
       }
     }
 
+    // appending lines of large file indexed in background,
+    // line numbers and scrollbar change with them
+    if(buffer.append_background_loaded_lines())
+    {
+      redraw = true;
+    }
+
+    // appending results of find in files, title shows their count
+    if(project_results_open)
+    {
+      while(std::optional<std::vector<std::string>> batch =
+              project_search.get_next_batch())
+      {
+        buffer.append_lines(batch.value());
+        redraw = true;
+      }
+      const std::string results_title =
+        window_title + " - " + std::to_string(buffer.length() - 1) +
+        " results" +
+        (project_search.running()
+           ? "..."
+           : " in " + std::to_string(project_search.searched_files_count()) +
+               " files");
+      if(window->title() != results_title)
+      {
+        window->title() = results_title;
+        window->update_title();
+      }
+    }
+
+    // taking regex matches found in background, the nearest match is
+    // selected and scrolled to once it's found
+    const bool match_selection_pending = buffer.is_match_selection_pending();
+    if(buffer.append_found_matches())
+    {
+      if(match_selection_pending && !buffer.is_match_selection_pending())
+      {
+        scroll_to_cursor(buffer,
+                         font_extents.height,
+                         window->height(),
+                         &scroll_y_offset,
+                         &scroll_y_target);
+      }
+      redraw = true;
+    }
+    if(finding != buffer.is_finding())
+    {
+      finding = !finding;
+      redraw = true;
+    }
+
+    // showing save progress in title
+    if(buffer.is_saving())
+    {
+      const std::string progress_title =
+        window_title + " - Saving " +
+        std::to_string(static_cast<uint32>(buffer.save_progress() * 100)) +
+        "%";
+      if(window->title() != progress_title)
+      {
+        window->title() = progress_title;
+        window->update_title();
+      }
+    }
+    else if(std::optional<bool> saved = buffer.get_save_result())
+    {
+      window->title() =
+        saved.value() ? window_title : window_title + " - Unable to save!";
+      window->update_title();
+    }
+
     std::vector<SDL_Rect> rects;
     while(true)
     {
@@ -502,11 +934,18 @@ int main(int argc, char** argv)
                                                   .colorscheme.gray));
       }
 
-      // drawing contents
-      int32 y = scroll_y_offset;
+      // drawing contents, starting from first visible line
+      // lines are tokenized only till the last visible line
+      const uint32 first_visible_row = static_cast<uint32>(
+        std::max(0.0f, -scroll_y_offset) / font_extents.height);
+      const uint32 last_visible_row =
+        first_visible_row + window->height() / font_extents.height + 1;
+      tokenizer_cache.build_cache_till(buffer, last_visible_row);
+      buffer.set_visible_rows(first_visible_row, last_visible_row);
+      int32 y = scroll_y_offset + font_extents.height * first_visible_row;
       auto cursor_coord = buffer.cursor_coords();
-      uint32 row = 0;
-      for(uint32 i = 0; i < buffer.length(); i++)
+      uint32 row = first_visible_row;
+      for(uint32 i = first_visible_row; i < buffer.length(); i++)
       {
         if(y < 0 && -y > font_extents.height)
         {
@@ -540,12 +979,19 @@ int main(int argc, char** argv)
                                          font_extents.height,
                                          active_line_color);
         }
-        render_tokens(line_numbers_width + 1,
-                      y,
-                      *tokenizer_cache.tokens_for_line(i),
-                      buffer,
-                      i,
-                      font_extents);
+        const std::vector<CppTokenizer::Token>* tokens =
+          tokenizer_cache.tokens_for_line(i);
+        if(tokens)
+        {
+          render_tokens(line_numbers_width + 1,
+                        y,
+                        *tokens,
+                        tokenizer_cache.text_for_line(i),
+                        buffer,
+                        i,
+                        tokenizer_cache.brackets().depth_before(i),
+                        font_extents);
+        }
         y += font_extents.height;
         row++;
         if(y > static_cast<int32>(window->height()))
@@ -583,6 +1029,91 @@ int main(int argc, char** argv)
                                  .colorscheme.scrollbar));
       }
 
+      // drawing matches of find bar query, in visible lines
+      if(find_bar_open)
+      {
+        SDL_Color match_color =
+          hexcode_to_SDL_Color(ConfigManager::get_instance()
+                                 ->get_config_struct()
+                                 .colorscheme.highlight);
+        match_color.a = 96;
+        const std::vector<TextMatch>& matches = buffer.matches();
+        for(std::size_t i = first_match_from(matches, first_visible_row, 0);
+            i < matches.size() && matches[i].row <= last_visible_row;
+            i++)
+        {
+          const LineLayout& layout = buffer.line_layout(matches[i].row);
+          const int32 column = static_cast<int32>(matches[i].column) - 1;
+          const uint32 start_cells = layout.cells_before(column);
+          const uint32 end_cells =
+            layout.cells_before(column + static_cast<int32>(matches[i].length));
+          RocketRender::rectangle_filled(
+            line_numbers_width + 1 + start_cells * font_extents.max_x_advance,
+            ceil(scroll_y_offset + matches[i].row * font_extents.height),
+            (end_cells - start_cells) * font_extents.max_x_advance,
+            font_extents.height,
+            match_color);
+        }
+      }
+
+      // drawing occurrences of identifier under cursor (or being renamed),
+      // in visible lines
+      std::optional<std::string> highlighted_identifier =
+        rename_bar_open ? std::optional<std::string>(rename_identifier)
+        : find_bar_open ? std::nullopt
+                        : identifier_at_cursor(buffer, tokenizer_cache);
+      if(highlighted_identifier)
+      {
+        SDL_Color occurrence_color =
+          hexcode_to_SDL_Color(ConfigManager::get_instance()
+                                 ->get_config_struct()
+                                 .colorscheme.highlight);
+        occurrence_color.a = 64;
+        occurrences.clear();
+        tokenizer_cache.find_identifier(highlighted_identifier.value(),
+                                        first_visible_row,
+                                        last_visible_row,
+                                        occurrences);
+        for(const TextMatch& occurrence : occurrences)
+        {
+          const LineLayout& layout = buffer.line_layout(occurrence.row);
+          const int32 column = static_cast<int32>(occurrence.column) - 1;
+          const uint32 start_cells = layout.cells_before(column);
+          const uint32 end_cells = layout.cells_before(
+            column + static_cast<int32>(occurrence.length));
+          RocketRender::rectangle_filled(
+            line_numbers_width + 1 + start_cells * font_extents.max_x_advance,
+            ceil(scroll_y_offset + occurrence.row * font_extents.height),
+            (end_cells - start_cells) * font_extents.max_x_advance,
+            font_extents.height,
+            occurrence_color);
+        }
+      }
+
+      // drawing outlines of bracket at cursor and its match,
+      // if it's in visible lines
+      const auto bracket_pair =
+        bracket_pair_at_cursor(buffer, tokenizer_cache, last_visible_row);
+      if(bracket_pair)
+      {
+        for(const std::pair<uint32, uint32>& bracket :
+            {bracket_pair.value().first, bracket_pair.value().second})
+        {
+          const LineLayout& layout = buffer.line_layout(bracket.first);
+          const int32 column = static_cast<int32>(bracket.second) - 1;
+          const uint32 start_cells = layout.cells_before(column);
+          RocketRender::rectangle_outlined(
+            line_numbers_width + 1 + start_cells * font_extents.max_x_advance,
+            ceil(scroll_y_offset + bracket.first * font_extents.height),
+            (layout.cells_before(column + 1) - start_cells) *
+              font_extents.max_x_advance,
+            font_extents.height,
+            hexcode_to_SDL_Color(ConfigManager::get_instance()
+                                   ->get_config_struct()
+                                   .colorscheme.gray));
+        }
+      }
+
       // drawing selection
       if(buffer.has_selection())
       {
@@ -591,14 +1122,22 @@ int main(int argc, char** argv)
           hexcode_to_SDL_Color(ConfigManager::get_instance()
                                  ->get_config_struct()
                                  .colorscheme.highlight);
+        // selection columns are converted to cells,
+        // as wide characters take two cells
+        const uint32 selection_start_cells =
+          buffer.line_layout(selection.first.first)
+            .cells_before(selection.first.second);
         if(selection.first.first == selection.second.first)
         {
           // drawing only selections on single line
+          const uint32 selection_end_cells =
+            buffer.line_layout(selection.second.first)
+              .cells_before(selection.second.second);
           RocketRender::rectangle_filled(
             line_numbers_width + 1 +
-              (selection.first.second + 1) * font_extents.max_x_advance,
+              selection_start_cells * font_extents.max_x_advance,
             ceil(scroll_y_offset + selection.first.first * font_extents.height),
-            (selection.second.second - selection.first.second) *
+            (selection_end_cells - selection_start_cells) *
               font_extents.max_x_advance,
             font_extents.height,
             selection_color);
@@ -607,12 +1146,12 @@ int main(int argc, char** argv)
         {
           // multiline selection
           // drawing first line selection
-          uint16 selection_width =
-            buffer.line_length(selection.first.first).value() -
-            selection.first.second;
+          uint32 selection_width =
+            buffer.line_layout(selection.first.first).width() + 1 -
+            selection_start_cells;
           RocketRender::rectangle_filled(
             line_numbers_width + 1 +
-              (selection.first.second + 1) * font_extents.max_x_advance,
+              selection_start_cells * font_extents.max_x_advance,
             ceil(scroll_y_offset + selection.first.first * font_extents.height),
             selection_width * font_extents.max_x_advance,
             font_extents.height,
@@ -625,7 +1164,7 @@ int main(int argc, char** argv)
             RocketRender::rectangle_filled(
               line_numbers_width + 1,
               ceil(scroll_y_offset + line_index * font_extents.height),
-              (buffer.line_length(line_index).value() + 1) *
+              (buffer.line_layout(line_index).width() + 1) *
                 font_extents.max_x_advance,
               font_extents.height,
               selection_color);
@@ -635,7 +1174,9 @@ int main(int argc, char** argv)
             line_numbers_width + 1,
             ceil(scroll_y_offset +
                  selection.second.first * font_extents.height),
-            (selection.second.second + 1) * font_extents.max_x_advance,
+            buffer.line_layout(selection.second.first)
+                .cells_before(selection.second.second) *
+              font_extents.max_x_advance,
             font_extents.height,
             selection_color);
         }
@@ -647,7 +1188,8 @@ int main(int argc, char** argv)
         ConfigManager::get_instance()->get_config_struct().caret.style;
       RocketRender::rectangle_filled(
         line_numbers_width + 1 +
-          font_extents.max_x_advance * (cursor_coords.second + 1),
+          font_extents.max_x_advance * buffer.line_layout(cursor_coords.first)
+                                         .cells_before(cursor_coords.second),
         ceil(scroll_y_offset + font_extents.height * cursor_coords.first),
         (cursor_style == "ibeam" ? ConfigManager::get_instance()
                                      ->get_config_struct()
@@ -657,6 +1199,118 @@ int main(int argc, char** argv)
         hexcode_to_SDL_Color(
           ConfigManager::get_instance()->get_config_struct().caret.color));
 
+      // drawing completion popup, below identifier before cursor
+      if(!completions.empty())
+      {
+        std::size_t popup_columns = 0;
+        for(const std::string& completion : completions)
+        {
+          popup_columns = std::max(popup_columns, completion.size() + 2);
+        }
+        const float32 popup_x =
+          line_numbers_width + 1 +
+          font_extents.max_x_advance *
+            buffer.line_layout(cursor_coords.first)
+              .cells_before(cursor_coords.second -
+                            static_cast<int32>(completion_prefix.size()));
+        const float32 popup_y =
+          ceil(scroll_y_offset +
+               font_extents.height * (cursor_coords.first + 1));
+        RocketRender::rectangle_filled(
+          popup_x,
+          popup_y,
+          popup_columns * font_extents.max_x_advance,
+          completions.size() * font_extents.height,
+          hexcode_to_SDL_Color(
+            ConfigManager::get_instance()->get_config_struct().colorscheme.bg));
+        RocketRender::rectangle_outlined(
+          popup_x,
+          popup_y,
+          popup_columns * font_extents.max_x_advance,
+          completions.size() * font_extents.height,
+          hexcode_to_SDL_Color(ConfigManager::get_instance()
+                                 ->get_config_struct()
+                                 .colorscheme.gray));
+        for(std::size_t i = 0; i < completions.size(); i++)
+        {
+          if(i == completion_index)
+          {
+            RocketRender::rectangle_filled(
+              popup_x,
+              popup_y + i * font_extents.height,
+              popup_columns * font_extents.max_x_advance,
+              font_extents.height,
+              hexcode_to_SDL_Color(ConfigManager::get_instance()
+                                     ->get_config_struct()
+                                     .colorscheme.highlight));
+          }
+          RocketRender::text(popup_x + font_extents.max_x_advance,
+                             popup_y + i * font_extents.height,
+                             completions[i],
+                             hexcode_to_SDL_Color(ConfigManager::get_instance()
+                                                    ->get_config_struct()
+                                                    .colorscheme.white));
+        }
+      }
+
+      // drawing find bar (or rename bar), at bottom of window
+      if(find_bar_open || rename_bar_open)
+      {
+        std::string find_text =
+          (find_in_files ? "Find in files: " : "Find: ") + find_query + "  (";
+        if(replace_bar_open)
+        {
+          // typing goes to the text marked with '|'
+          find_text = "Find: " + find_query +
+                      (replacement_focused ? "  Replace: " : "|  Replace: ") +
+                      replacement + (replacement_focused ? "|  (" : "  (");
+        }
+        if(find_in_files)
+        {
+          find_text +=
+            find_in_files_valid ? "enter to search" : "invalid query";
+        }
+        else if(buffer.is_find_query_valid())
+        {
+          find_text += std::to_string(buffer.found_matches_count()) +
+                       (buffer.is_finding() ? "+" : "") + " matches" +
+                       (replace_bar_open ? ", ctrl+enter replaces all" : "");
+        }
+        else
+        {
+          find_text += "invalid regex";
+        }
+        find_text += std::string(find_case_sensitive ? ", match case" : "") +
+                     (find_regex ? ", regex)" : ")");
+        if(rename_bar_open)
+        {
+          find_text = "Rename " + rename_identifier + " to: " + rename_text +
+                      "|  (enter renames in file)";
+        }
+        const float32 find_bar_height = font_extents.height + 8;
+        const float32 find_bar_y = window->height() - find_bar_height;
+        RocketRender::rectangle_filled(
+          line_numbers_width + 1,
+          find_bar_y,
+          window->width(),
+          find_bar_height,
+          hexcode_to_SDL_Color(
+            ConfigManager::get_instance()->get_config_struct().colorscheme.bg));
+        RocketRender::line(line_numbers_width + 1,
+                           find_bar_y,
+                           window->width(),
+                           find_bar_y,
+                           hexcode_to_SDL_Color(ConfigManager::get_instance()
+                                                  ->get_config_struct()
+                                                  .colorscheme.gray));
+        RocketRender::text(line_numbers_width + 1 + font_extents.max_x_advance,
+                           find_bar_y + 4,
+                           find_text,
+                           hexcode_to_SDL_Color(ConfigManager::get_instance()
+                                                  ->get_config_struct()
+                                                  .colorscheme.white));
+      }
+
       window->update();
       redraw = false;
 
@@ -0,0 +1,212 @@
+#include "../include/mapped_file.hpp"
+#include <utility>
+#include "../include/macros.hpp"
+#if defined(WIN32) || defined(_WIN32) || defined(_WIN64)
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+MappedFile::MappedFile() noexcept
+  : _data(nullptr)
+  , _size(0)
+  , _open(false)
+#if defined(WIN32) || defined(_WIN32) || defined(_WIN64)
+  , _file_handle(nullptr)
+  , _mapping_handle(nullptr)
+#endif
+{}
+
+MappedFile::MappedFile(MappedFile&& file) noexcept
+  : _data(std::exchange(file._data, nullptr))
+  , _size(std::exchange(file._size, 0))
+  , _open(std::exchange(file._open, false))
+#if defined(WIN32) || defined(_WIN32) || defined(_WIN64)
+  , _file_handle(std::exchange(file._file_handle, nullptr))
+  , _mapping_handle(std::exchange(file._mapping_handle, nullptr))
+#endif
+{}
+
+MappedFile& MappedFile::operator=(MappedFile&& file) noexcept
+{
+  if(this != &file)
+  {
+    this->close();
+    _data = std::exchange(file._data, nullptr);
+    _size = std::exchange(file._size, 0);
+    _open = std::exchange(file._open, false);
+#if defined(WIN32) || defined(_WIN32) || defined(_WIN64)
+    _file_handle = std::exchange(file._file_handle, nullptr);
+    _mapping_handle = std::exchange(file._mapping_handle, nullptr);
+#endif
+  }
+  return *this;
+}
+
+MappedFile::~MappedFile() noexcept
+{
+  this->close();
+}
+
+#if defined(WIN32) || defined(_WIN32) || defined(_WIN64)
+
+bool MappedFile::open(const std::string& filepath) noexcept
+{
+  this->close();
+
+  HANDLE file = CreateFileA(filepath.c_str(),
+                            GENERIC_READ,
+                            FILE_SHARE_READ | FILE_SHARE_DELETE,
+                            nullptr,
+                            OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+                            nullptr);
+  if(file == INVALID_HANDLE_VALUE)
+  {
+    ERROR_BOII("Unable to open file for mapping: %s", filepath.c_str());
+    return false;
+  }
+
+  LARGE_INTEGER file_size;
+  if(!GetFileSizeEx(file, &file_size))
+  {
+    ERROR_BOII("Unable to get size of file: %s", filepath.c_str());
+    CloseHandle(file);
+    return false;
+  }
+
+  _open = true;
+  _size = static_cast<std::size_t>(file_size.QuadPart);
+  if(_size == 0)
+  {
+    // empty files cannot be mapped
+    CloseHandle(file);
+    return true;
+  }
+
+  HANDLE mapping =
+    CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if(mapping == nullptr)
+  {
+    ERROR_BOII("Unable to create file mapping: %s", filepath.c_str());
+    CloseHandle(file);
+    _open = false;
+    _size = 0;
+    return false;
+  }
+
+  void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if(data == nullptr)
+  {
+    ERROR_BOII("Unable to map view of file: %s", filepath.c_str());
+    CloseHandle(mapping);
+    CloseHandle(file);
+    _open = false;
+    _size = 0;
+    return false;
+  }
+
+  _data = static_cast<const char*>(data);
+  _file_handle = file;
+  _mapping_handle = mapping;
+  return true;
+}
+
+void MappedFile::close() noexcept
+{
+  if(_data)
+  {
+    UnmapViewOfFile(_data);
+  }
+  if(_mapping_handle)
+  {
+    CloseHandle(static_cast<HANDLE>(_mapping_handle));
+  }
+  if(_file_handle)
+  {
+    CloseHandle(static_cast<HANDLE>(_file_handle));
+  }
+  _data = nullptr;
+  _size = 0;
+  _open = false;
+  _file_handle = nullptr;
+  _mapping_handle = nullptr;
+}
+
+#else
+
+bool MappedFile::open(const std::string& filepath) noexcept
+{
+  this->close();
+
+  const int file = ::open(filepath.c_str(), O_RDONLY);
+  if(file == -1)
+  {
+    ERROR_BOII("Unable to open file for mapping: %s", filepath.c_str());
+    return false;
+  }
+
+  struct stat file_stat;
+  if(fstat(file, &file_stat) == -1)
+  {
+    ERROR_BOII("Unable to get size of file: %s", filepath.c_str());
+    ::close(file);
+    return false;
+  }
+
+  _open = true;
+  _size = static_cast<std::size_t>(file_stat.st_size);
+  if(_size == 0)
+  {
+    // empty files cannot be mapped
+    ::close(file);
+    return true;
+  }
+
+  void* data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, file, 0);
+  // mapping stays valid after closing the descriptor
+  ::close(file);
+  if(data == MAP_FAILED)
+  {
+    ERROR_BOII("Unable to map file: %s", filepath.c_str());
+    _open = false;
+    _size = 0;
+    return false;
+  }
+
+  // lines are indexed front to back
+  madvise(data, _size, MADV_SEQUENTIAL);
+  _data = static_cast<const char*>(data);
+  return true;
+}
+
+void MappedFile::close() noexcept
+{
+  if(_data)
+  {
+    munmap(const_cast<char*>(_data), _size);
+  }
+  _data = nullptr;
+  _size = 0;
+  _open = false;
+}
+
+#endif
+
+bool MappedFile::is_open() const noexcept
+{
+  return _open;
+}
+
+const char* MappedFile::data() const noexcept
+{
+  return _data;
+}
+
+std::size_t MappedFile::size() const noexcept
+{
+  return _size;
+}
@@ -0,0 +1,968 @@
+#include "../include/piece_table.hpp"
+#include "../include/line_indexer.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#if defined(__GLIBC__)
+#  include <malloc.h>
+#endif
+
+/// Maximum pieces in a leaf node.
+static constexpr std::size_t max_leaf_pieces = 256;
+
+/// Maximum children of an internal node.
+static constexpr std::size_t max_node_children = 64;
+
+/// Size of an add buffer slab, lines larger than this get their own slab.
+static constexpr std::size_t add_slab_size = 64 * 1024;
+
+/// Bytes which must be replaced or erased before compacting.
+static constexpr std::size_t min_reclaimable_bytes = 4 * 1024 * 1024;
+
+/// @brief Returns freed memory to the system.
+/// @throws No exceptions.
+static void release_free_memory() noexcept
+{
+#if defined(__GLIBC__)
+  // small slabs are carved from the heap, which glibc only shrinks from
+  // its top, asking it to return the free pages in the middle too
+  malloc_trim(0);
+#endif
+}
+
+/// @brief Tells if piece points into the given buffer.
+/// @throws No exceptions.
+static bool points_into(const Piece& piece,
+                        const char* buffer,
+                        const std::size_t& size) noexcept
+{
+  const std::uintptr_t data = reinterpret_cast<std::uintptr_t>(piece.data);
+  const std::uintptr_t begin = reinterpret_cast<std::uintptr_t>(buffer);
+  return buffer && data >= begin && data < begin + size;
+}
+
+PieceTable::PieceTable() noexcept
+  : _root(nullptr)
+  , _buffers(std::make_shared<TextBuffers>())
+  , _version(0)
+  , _add_slab_used(0)
+  , _add_slab_capacity(0)
+  , _reclaimable_bytes(0)
+  , _compacted_bytes(0)
+{
+  this->_build({Piece{nullptr, 0}});
+}
+
+PieceTable::PieceTable(const std::vector<std::string>& lines) noexcept
+  : _root(nullptr)
+  , _buffers(std::make_shared<TextBuffers>())
+  , _version(0)
+  , _add_slab_used(0)
+  , _add_slab_capacity(0)
+  , _reclaimable_bytes(0)
+  , _compacted_bytes(0)
+{
+  std::size_t size = 0;
+  for(const std::string& line : lines)
+  {
+    size += line.size();
+  }
+
+  std::unique_ptr<char[]> original =
+    std::make_unique<char[]>(size == 0 ? 1 : size);
+  std::vector<Piece> pieces;
+  pieces.reserve(lines.size());
+  std::size_t offset = 0;
+  for(const std::string& line : lines)
+  {
+    std::memcpy(original.get() + offset, line.data(), line.size());
+    pieces.push_back(Piece{original.get() + offset, line.size()});
+    offset += line.size();
+  }
+  _buffers->original = std::move(original);
+  _buffers->original_size = size;
+  if(pieces.empty())
+  {
+    pieces.push_back(Piece{nullptr, 0});
+  }
+  this->_build(std::move(pieces));
+}
+
+void PieceTable::load(std::unique_ptr<char[]> text,
+                      const std::size_t& size,
+                      LineBatch&& batch) noexcept
+{
+  // old buffers are freed in bulk, unless snapshots still hold them
+  _buffers = std::make_shared<TextBuffers>();
+  _buffers->original = std::move(text);
+  _buffers->original_size = size;
+  _add_slab_used = 0;
+  _add_slab_capacity = 0;
+  this->_adopt_slabs(std::move(batch.slabs));
+  this->_build(std::move(batch.pieces));
+  _reclaimable_bytes = 0;
+  _compacted_bytes = 0;
+  _version++;
+  release_free_memory();
+}
+
+void PieceTable::load(MappedFile&& file, LineBatch&& batch) noexcept
+{
+  _buffers = std::make_shared<TextBuffers>();
+  _buffers->original_mapping = std::make_shared<MappedFile>(std::move(file));
+  _add_slab_used = 0;
+  _add_slab_capacity = 0;
+  this->_adopt_slabs(std::move(batch.slabs));
+  this->_build(std::move(batch.pieces));
+  _reclaimable_bytes = 0;
+  _compacted_bytes = 0;
+  _version++;
+  release_free_memory();
+}
+
+void PieceTable::append_lines(LineBatch&& batch) noexcept
+{
+  this->_adopt_slabs(std::move(batch.slabs));
+  if(batch.pieces.empty())
+  {
+    return;
+  }
+
+  _insert(_unshare(_root),
+          _root->lines,
+          batch.pieces.data(),
+          batch.pieces.data() + batch.pieces.size());
+  this->_grow_root();
+  _version++;
+}
+
+bool PieceTable::is_mapped() const noexcept
+{
+  return _buffers->original_mapping != nullptr &&
+         _buffers->original_mapping->is_open();
+}
+
+std::uint64_t PieceTable::version() const noexcept
+{
+  return _version;
+}
+
+PieceTableSnapshot PieceTable::snapshot() const noexcept
+{
+  PieceTableSnapshot snapshot;
+  snapshot._root = _root;
+  snapshot._buffers = _buffers;
+  snapshot._version = _version;
+  return snapshot;
+}
+
+uint32 PieceTable::size() const noexcept
+{
+  return _root->lines;
+}
+
+std::size_t PieceTable::bytes() const noexcept
+{
+  return _root->bytes;
+}
+
+std::string_view PieceTable::operator[](const uint32& row) const noexcept
+{
+  return _line(_root.get(), row);
+}
+
+std::size_t PieceTable::max_line_length() const noexcept
+{
+  return _root->max_length;
+}
+
+std::size_t PieceTable::offset_of(const uint32& row) const noexcept
+{
+  // summing lines and bytes of subtrees before the row,
+  // each line is followed by a newline
+  std::size_t offset = 0;
+  const Node* node = _root.get();
+  uint32 local_row = std::min(row, _root->lines);
+  while(!node->leaf)
+  {
+    for(const std::shared_ptr<Node>& child : node->children)
+    {
+      if(local_row < child->lines)
+      {
+        node = child.get();
+        break;
+      }
+      local_row -= child->lines;
+      offset += child->bytes + child->lines;
+      if(&child == &node->children.back())
+      {
+        // row is size(), after the last line
+        return offset;
+      }
+    }
+  }
+
+  for(uint32 i = 0; i < local_row && i < node->pieces.size(); i++)
+  {
+    offset += node->pieces[i].length + 1;
+  }
+  return offset;
+}
+
+std::pair<uint32, std::size_t>
+PieceTable::position_of(std::size_t offset) const noexcept
+{
+  // skipping subtrees which end before the offset
+  uint32 row = 0;
+  const Node* node = _root.get();
+  while(!node->leaf)
+  {
+    const Node* next = node->children.back().get();
+    for(const std::shared_ptr<Node>& child : node->children)
+    {
+      if(offset < child->bytes + child->lines ||
+         &child == &node->children.back())
+      {
+        next = child.get();
+        break;
+      }
+      offset -= child->bytes + child->lines;
+      row += child->lines;
+    }
+    node = next;
+  }
+
+  for(std::size_t i = 0; i < node->pieces.size(); i++)
+  {
+    if(offset <= node->pieces[i].length || i + 1 == node->pieces.size())
+    {
+      return {row + i, std::min(offset, node->pieces[i].length)};
+    }
+    offset -= node->pieces[i].length + 1;
+  }
+  return {row, 0};
+}
+
+std::vector<Piece> PieceTable::pieces() const noexcept
+{
+  std::vector<Piece> pieces;
+  pieces.reserve(_root->lines);
+  _collect(_root.get(), pieces);
+  return pieces;
+}
+
+std::vector<Piece> PieceTable::pieces(const uint32& first_row,
+                                      const uint32& last_row) const noexcept
+{
+  std::vector<Piece> pieces;
+  const uint32 end_row = std::min(last_row, _root->lines);
+  if(first_row >= end_row)
+  {
+    return pieces;
+  }
+
+  pieces.reserve(end_row - first_row);
+  _collect(_root.get(), first_row, end_row, pieces);
+  return pieces;
+}
+
+void PieceTable::set_line(const uint32& row, std::string_view text) noexcept
+{
+  _reclaimable_bytes += (*this)[row].size();
+  _set(_unshare(_root), row, this->_append(text));
+  _version++;
+}
+
+void PieceTable::insert_line(const uint32& row, std::string_view text) noexcept
+{
+  const Piece piece = this->_append(text);
+  _insert(_unshare(_root), row, &piece, &piece + 1);
+  this->_grow_root();
+  _version++;
+}
+
+void PieceTable::insert_lines(
+  const uint32& row, const std::vector<std::string_view>& lines) noexcept
+{
+  if(lines.empty())
+  {
+    return;
+  }
+
+  std::vector<Piece> pieces;
+  pieces.reserve(lines.size());
+  for(const std::string_view& line : lines)
+  {
+    pieces.push_back(this->_append(line));
+  }
+  _insert(_unshare(_root), row, pieces.data(), pieces.data() + pieces.size());
+  this->_grow_root();
+  _version++;
+}
+
+void PieceTable::erase_lines(const uint32& first_row,
+                             const uint32& last_row) noexcept
+{
+  if(first_row >= last_row)
+  {
+    return;
+  }
+
+  const std::size_t bytes = _root->bytes;
+  _erase(_unshare(_root), first_row, std::min(last_row, _root->lines));
+  this->_shrink_root();
+  _reclaimable_bytes += bytes - _root->bytes;
+  _version++;
+}
+
+Piece PieceTable::add_text(std::string_view text) noexcept
+{
+  return this->_append(text);
+}
+
+void PieceTable::replace_lines(const uint32& row,
+                               const uint32& count,
+                               const std::vector<Piece>& pieces) noexcept
+{
+  // inserting before erasing, so tree never becomes empty
+  if(!pieces.empty())
+  {
+    _insert(
+      _unshare(_root), row, pieces.data(), pieces.data() + pieces.size());
+    this->_grow_root();
+  }
+  this->erase_lines(row + pieces.size(), row + pieces.size() + count);
+  _version++;
+}
+
+bool PieceTable::should_compact() const noexcept
+{
+  return _reclaimable_bytes >=
+           std::max(min_reclaimable_bytes, _compacted_bytes) &&
+         _buffers.use_count() == 1;
+}
+
+void PieceTable::compact(const std::vector<Piece*>& pieces) noexcept
+{
+  const MappedFile empty_mapping;
+  const MappedFile& mapping = _buffers->original_mapping
+                                ? *_buffers->original_mapping
+                                : empty_mapping;
+  std::vector<Piece*> owned;
+  _collect_owned(_root, mapping, owned);
+  for(Piece* piece : pieces)
+  {
+    if(piece->length == 0)
+    {
+      piece->data = nullptr;
+    }
+    else if(!points_into(*piece, mapping.data(), mapping.size()))
+    {
+      owned.push_back(piece);
+    }
+  }
+
+  // original buffer is only copied once most of it is erased, as copying
+  // all of it would stall for long
+  const char* original = _buffers->original.get();
+  const std::size_t original_size = _buffers->original_size;
+  std::size_t original_bytes = 0;
+  for(const Piece* piece : owned)
+  {
+    if(points_into(*piece, original, original_size))
+    {
+      original_bytes += piece->length;
+    }
+  }
+  const bool keep_original = original_bytes >= original_size / 2;
+  if(keep_original)
+  {
+    std::erase_if(owned,
+                  [&](const Piece* piece)
+                  { return points_into(*piece, original, original_size); });
+  }
+
+  // lines kept by undo history share text with lines of piece table,
+  // sorting by address groups them, so shared text is copied once.
+  // Lines never overlap partially, so the longest piece starting at an
+  // address covers the others. Sorting also keeps text of neighbouring
+  // lines together.
+  std::sort(owned.begin(),
+            owned.end(),
+            [](const Piece* a, const Piece* b)
+            {
+              return std::less<const char*>()(a->data, b->data);
+            });
+
+  // old buffers are freed in bulk when they go out of scope
+  std::shared_ptr<TextBuffers> old_buffers = std::move(_buffers);
+  _buffers = std::make_shared<TextBuffers>();
+  _buffers->original_mapping = old_buffers->original_mapping;
+  if(keep_original)
+  {
+    _buffers->original = old_buffers->original;
+    _buffers->original_size = old_buffers->original_size;
+  }
+  _add_slab_used = 0;
+  _add_slab_capacity = 0;
+
+  std::size_t compacted_bytes = 0;
+  for(std::size_t first = 0; first < owned.size();)
+  {
+    const char* data = owned[first]->data;
+    std::size_t length = 0;
+    std::size_t last = first;
+    for(; last < owned.size() && owned[last]->data == data; last++)
+    {
+      length = std::max(length, owned[last]->length);
+    }
+
+    const char* moved_data =
+      this->_append(std::string_view(data, length)).data;
+    compacted_bytes += length;
+    for(; first < last; first++)
+    {
+      owned[first]->data = moved_data;
+    }
+  }
+  _reclaimable_bytes = 0;
+  _compacted_bytes = compacted_bytes;
+
+  old_buffers.reset();
+  release_free_memory();
+}
+
+Piece PieceTable::_append(std::string_view text) noexcept
+{
+  if(text.empty())
+  {
+    return Piece{nullptr, 0};
+  }
+
+  std::vector<std::unique_ptr<char[]>>& slabs = _buffers->add_slabs;
+  if(text.size() > add_slab_size)
+  {
+    // large lines get a slab of their own, so the current slab
+    // can still be filled with small lines
+    std::unique_ptr<char[]> slab = std::make_unique<char[]>(text.size());
+    std::memcpy(slab.get(), text.data(), text.size());
+    const char* data = slab.get();
+    slabs.insert(slabs.end() - (slabs.empty() ? 0 : 1), std::move(slab));
+    return Piece{data, text.size()};
+  }
+
+  if(_add_slab_capacity - _add_slab_used < text.size())
+  {
+    slabs.push_back(std::make_unique<char[]>(add_slab_size));
+    _add_slab_used = 0;
+    _add_slab_capacity = add_slab_size;
+  }
+
+  char* data = slabs.back().get() + _add_slab_used;
+  std::memcpy(data, text.data(), text.size());
+  _add_slab_used += text.size();
+  return Piece{data, text.size()};
+}
+
+void PieceTable::_adopt_slabs(
+  std::vector<std::unique_ptr<char[]>>&& slabs) noexcept
+{
+  // current slab stays last, so it can still be filled
+  std::vector<std::unique_ptr<char[]>>& add_slabs = _buffers->add_slabs;
+  add_slabs.insert(add_slabs.end() - (_add_slab_capacity == 0 ? 0 : 1),
+                   std::make_move_iterator(slabs.begin()),
+                   std::make_move_iterator(slabs.end()));
+}
+
+void PieceTable::_build(std::vector<Piece>&& pieces) noexcept
+{
+  // packing pieces into leaves
+  std::vector<std::shared_ptr<Node>> level;
+  const std::size_t leaves_count =
+    std::max<std::size_t>(1, (pieces.size() + max_leaf_pieces - 1) /
+                               max_leaf_pieces);
+  level.reserve(leaves_count);
+  for(std::size_t i = 0; i < leaves_count; i++)
+  {
+    const std::size_t begin = pieces.size() * i / leaves_count;
+    const std::size_t end = pieces.size() * (i + 1) / leaves_count;
+    std::shared_ptr<Node> leaf = std::make_shared<Node>();
+    leaf->leaf = true;
+    leaf->pieces.assign(pieces.begin() + begin, pieces.begin() + end);
+    _update_counts(leaf.get());
+    level.push_back(std::move(leaf));
+  }
+
+  // packing nodes into parents, until a single root remains
+  while(level.size() > 1)
+  {
+    std::vector<std::shared_ptr<Node>> parents;
+    const std::size_t parents_count =
+      (level.size() + max_node_children - 1) / max_node_children;
+    parents.reserve(parents_count);
+    for(std::size_t i = 0; i < parents_count; i++)
+    {
+      const std::size_t begin = level.size() * i / parents_count;
+      const std::size_t end = level.size() * (i + 1) / parents_count;
+      std::shared_ptr<Node> parent = std::make_shared<Node>();
+      parent->leaf = false;
+      for(std::size_t j = begin; j < end; j++)
+      {
+        parent->children.push_back(std::move(level[j]));
+      }
+      _update_counts(parent.get());
+      parents.push_back(std::move(parent));
+    }
+    level = std::move(parents);
+  }
+
+  _root = std::move(level.front());
+}
+
+PieceTable::Node* PieceTable::_unshare(std::shared_ptr<Node>& node) noexcept
+{
+  if(node.use_count() > 1)
+  {
+    node = std::make_shared<Node>(*node);
+  }
+  else
+  {
+    // snapshot which shared the node could have been released on
+    // another thread, its reads must complete before node is modified
+    std::atomic_thread_fence(std::memory_order_acquire);
+  }
+  return node.get();
+}
+
+std::string_view PieceTable::_line(const Node* node, uint32 row) noexcept
+{
+  while(!node->leaf)
+  {
+    for(const std::shared_ptr<Node>& child : node->children)
+    {
+      if(row < child->lines)
+      {
+        node = child.get();
+        break;
+      }
+      row -= child->lines;
+    }
+  }
+
+  const Piece& piece = node->pieces[row];
+  return std::string_view(piece.data, piece.length);
+}
+
+void PieceTable::_insert(Node* node,
+                         uint32 row,
+                         const Piece* first,
+                         const Piece* last) noexcept
+{
+  if(node->leaf)
+  {
+    node->pieces.insert(node->pieces.begin() + row, first, last);
+    _update_counts(node);
+    return;
+  }
+
+  // finding child in which the row lies, rows at end of
+  // a child are appended to that child
+  std::size_t index = 0;
+  while(index + 1 < node->children.size() &&
+        row > node->children[index]->lines)
+  {
+    row -= node->children[index]->lines;
+    index++;
+  }
+
+  Node* child = _unshare(node->children[index]);
+  _insert(child, row, first, last);
+  if(_fill(child) > (child->leaf ? max_leaf_pieces : max_node_children))
+  {
+    std::vector<std::shared_ptr<Node>> parts =
+      _split(std::move(node->children[index]));
+    node->children.erase(node->children.begin() + index);
+    node->children.insert(node->children.begin() + index,
+                          std::make_move_iterator(parts.begin()),
+                          std::make_move_iterator(parts.end()));
+  }
+  _update_counts(node);
+}
+
+void PieceTable::_erase(Node* node,
+                        const uint32& first_row,
+                        const uint32& last_row) noexcept
+{
+  if(node->leaf)
+  {
+    node->pieces.erase(node->pieces.begin() + first_row,
+                       node->pieces.begin() + last_row);
+    _update_counts(node);
+    return;
+  }
+
+  uint32 child_first_row = 0;
+  std::size_t index = 0;
+  while(index < node->children.size() && child_first_row < last_row)
+  {
+    const Node* child = node->children[index].get();
+    const uint32 child_last_row = child_first_row + child->lines;
+    if(child_last_row <= first_row)
+    {
+      child_first_row = child_last_row;
+      index++;
+      continue;
+    }
+
+    if(first_row <= child_first_row && child_last_row <= last_row)
+    {
+      // whole subtree is erased, just drop it
+      node->children.erase(node->children.begin() + index);
+      child_first_row = child_last_row;
+      continue;
+    }
+
+    _erase(_unshare(node->children[index]),
+           std::max(first_row, child_first_row) - child_first_row,
+           std::min(last_row, child_last_row) - child_first_row);
+    child_first_row = child_last_row;
+    index++;
+  }
+
+  _fix_underflow(node);
+  _update_counts(node);
+}
+
+void PieceTable::_set(Node* node, uint32 row, const Piece& piece) noexcept
+{
+  if(node->leaf)
+  {
+    const std::size_t old_length = node->pieces[row].length;
+    node->bytes -= old_length;
+    node->pieces[row] = piece;
+    node->bytes += piece.length;
+    if(piece.length >= node->max_length)
+    {
+      node->max_length = piece.length;
+    }
+    else if(old_length == node->max_length)
+    {
+      // longest line got shorter
+      _update_counts(node);
+    }
+    return;
+  }
+
+  for(std::shared_ptr<Node>& child : node->children)
+  {
+    if(row < child->lines)
+    {
+      const std::size_t old_max_length = child->max_length;
+      node->bytes -= child->bytes;
+      _set(_unshare(child), row, piece);
+      node->bytes += child->bytes;
+      if(child->max_length >= node->max_length)
+      {
+        node->max_length = child->max_length;
+      }
+      else if(old_max_length == node->max_length)
+      {
+        _update_counts(node);
+      }
+      return;
+    }
+    row -= child->lines;
+  }
+}
+
+std::vector<std::shared_ptr<PieceTable::Node>>
+PieceTable::_split(std::shared_ptr<Node> node) noexcept
+{
+  const std::size_t max_fill = node->leaf ? max_leaf_pieces : max_node_children;
+  const std::size_t fill = _fill(node.get());
+  std::vector<std::shared_ptr<Node>> parts;
+  if(fill <= max_fill)
+  {
+    parts.push_back(std::move(node));
+    return parts;
+  }
+
+  // a node overflowing by a few entries is split into halves, so that
+  // following inserts don't split them again immediately
+  const std::size_t parts_count = (fill + max_fill - 1) / max_fill;
+  parts.reserve(parts_count);
+  for(std::size_t i = 0; i < parts_count; i++)
+  {
+    const std::size_t begin = fill * i / parts_count;
+    const std::size_t end = fill * (i + 1) / parts_count;
+    std::shared_ptr<Node> part = std::make_shared<Node>();
+    part->leaf = node->leaf;
+    if(node->leaf)
+    {
+      part->pieces.assign(node->pieces.begin() + begin,
+                          node->pieces.begin() + end);
+    }
+    else
+    {
+      part->children.assign(node->children.begin() + begin,
+                            node->children.begin() + end);
+    }
+    _update_counts(part.get());
+    parts.push_back(std::move(part));
+  }
+  return parts;
+}
+
+void PieceTable::_fix_underflow(Node* node) noexcept
+{
+  std::size_t index = 0;
+  while(index < node->children.size() && node->children.size() > 1)
+  {
+    const Node* child = node->children[index].get();
+    const std::size_t max_fill =
+      child->leaf ? max_leaf_pieces : max_node_children;
+    if(_fill(child) >= max_fill / 4)
+    {
+      index++;
+      continue;
+    }
+
+    // merging with right neighbour (or left one for the last child)
+    const std::size_t left =
+      index + 1 < node->children.size() ? index : index - 1;
+    Node* left_node = _unshare(node->children[left]);
+    const Node* right_node = node->children[left + 1].get();
+    if(left_node->leaf)
+    {
+      left_node->pieces.insert(left_node->pieces.end(),
+                               right_node->pieces.begin(),
+                               right_node->pieces.end());
+    }
+    else
+    {
+      left_node->children.insert(left_node->children.end(),
+                                 right_node->children.begin(),
+                                 right_node->children.end());
+    }
+    _update_counts(left_node);
+    node->children.erase(node->children.begin() + left + 1);
+
+    // merged node can be overfull, splitting it back
+    std::vector<std::shared_ptr<Node>> parts =
+      _split(std::move(node->children[left]));
+    node->children.erase(node->children.begin() + left);
+    node->children.insert(node->children.begin() + left,
+                          std::make_move_iterator(parts.begin()),
+                          std::make_move_iterator(parts.end()));
+    index = left + parts.size();
+  }
+}
+
+void PieceTable::_collect(const Node* node,
+                          std::vector<Piece>& pieces) noexcept
+{
+  if(node->leaf)
+  {
+    pieces.insert(pieces.end(), node->pieces.begin(), node->pieces.end());
+    return;
+  }
+
+  for(const std::shared_ptr<Node>& child : node->children)
+  {
+    _collect(child.get(), pieces);
+  }
+}
+
+void PieceTable::_collect(const Node* node,
+                          const uint32& first_row,
+                          const uint32& last_row,
+                          std::vector<Piece>& pieces) noexcept
+{
+  if(node->leaf)
+  {
+    pieces.insert(pieces.end(),
+                  node->pieces.begin() + first_row,
+                  node->pieces.begin() + last_row);
+    return;
+  }
+
+  // visiting only children overlapping the range
+  uint32 child_first_row = 0;
+  for(const std::shared_ptr<Node>& child : node->children)
+  {
+    const uint32 child_last_row = child_first_row + child->lines;
+    if(child_last_row > first_row && child_first_row < last_row)
+    {
+      _collect(child.get(),
+               std::max(first_row, child_first_row) - child_first_row,
+               std::min(last_row, child_last_row) - child_first_row,
+               pieces);
+    }
+    if(child_last_row >= last_row)
+    {
+      break;
+    }
+    child_first_row = child_last_row;
+  }
+}
+
+void PieceTable::_collect_owned(std::shared_ptr<Node>& node,
+                                const MappedFile& mapping,
+                                std::vector<Piece*>& pieces) noexcept
+{
+  Node* owned_node = _unshare(node);
+  if(!owned_node->leaf)
+  {
+    for(std::shared_ptr<Node>& child : owned_node->children)
+    {
+      _collect_owned(child, mapping, pieces);
+    }
+    return;
+  }
+
+  for(Piece& piece : owned_node->pieces)
+  {
+    if(piece.length == 0)
+    {
+      piece.data = nullptr;
+    }
+    else if(!points_into(piece, mapping.data(), mapping.size()))
+    {
+      pieces.push_back(&piece);
+    }
+  }
+}
+
+void PieceTable::_update_counts(Node* node) noexcept
+{
+  node->lines = 0;
+  node->bytes = 0;
+  node->max_length = 0;
+  if(node->leaf)
+  {
+    node->lines = node->pieces.size();
+    for(const Piece& piece : node->pieces)
+    {
+      node->bytes += piece.length;
+      node->max_length = std::max(node->max_length, piece.length);
+    }
+    return;
+  }
+
+  for(const std::shared_ptr<Node>& child : node->children)
+  {
+    node->lines += child->lines;
+    node->bytes += child->bytes;
+    node->max_length = std::max(node->max_length, child->max_length);
+  }
+}
+
+std::size_t PieceTable::_fill(const Node* node) noexcept
+{
+  return node->leaf ? node->pieces.size() : node->children.size();
+}
+
+void PieceTable::_shrink_root() noexcept
+{
+  while(!_root->leaf && _root->children.size() == 1)
+  {
+    std::shared_ptr<Node> child = _root->children.front();
+    _root = std::move(child);
+  }
+
+  if(_root->lines == 0)
+  {
+    // everything is erased, starting again with an empty leaf
+    _root = std::make_shared<Node>();
+    _root->leaf = true;
+  }
+}
+
+void PieceTable::_grow_root() noexcept
+{
+  while(_fill(_root.get()) >
+        (_root->leaf ? max_leaf_pieces : max_node_children))
+  {
+    std::shared_ptr<Node> root = std::make_shared<Node>();
+    root->leaf = false;
+    root->children = _split(std::move(_root));
+    _update_counts(root.get());
+    _root = std::move(root);
+  }
+}
+
+PieceTableSnapshot::PieceTableSnapshot() noexcept
+  : _root(nullptr)
+  , _buffers(nullptr)
+  , _version(0)
+{}
+
+std::uint64_t PieceTableSnapshot::version() const noexcept
+{
+  return _version;
+}
+
+uint32 PieceTableSnapshot::size() const noexcept
+{
+  return _root ? _root->lines : 0;
+}
+
+std::size_t PieceTableSnapshot::bytes() const noexcept
+{
+  return _root ? _root->bytes : 0;
+}
+
+std::string_view
+PieceTableSnapshot::operator[](const uint32& row) const noexcept
+{
+  return PieceTable::_line(_root.get(), row);
+}
+
+std::vector<Piece> PieceTableSnapshot::pieces() const noexcept
+{
+  std::vector<Piece> pieces;
+  if(_root)
+  {
+    pieces.reserve(_root->lines);
+    PieceTable::_collect(_root.get(), pieces);
+  }
+  return pieces;
+}
+
+std::vector<Piece>
+PieceTableSnapshot::pieces(const uint32& first_row,
+                           const uint32& last_row) const noexcept
+{
+  std::vector<Piece> pieces;
+  const uint32 end_row = std::min(last_row, this->size());
+  if(first_row >= end_row)
+  {
+    return pieces;
+  }
+
+  pieces.reserve(end_row - first_row);
+  PieceTable::_collect(_root.get(), first_row, end_row, pieces);
+  return pieces;
+}
+
+std::span<const Piece>
+PieceTableSnapshot::pieces_from(const uint32& row) const noexcept
+{
+  const PieceTable::Node* node = _root.get();
+  uint32 leaf_row = row;
+  while(!node->leaf)
+  {
+    for(const std::shared_ptr<PieceTable::Node>& child : node->children)
+    {
+      if(leaf_row < child->lines)
+      {
+        node = child.get();
+        break;
+      }
+      leaf_row -= child->lines;
+    }
+  }
+  return std::span<const Piece>(node->pieces).subspan(leaf_row);
+}
@@ -0,0 +1,479 @@
+#include "../include/project_search.hpp"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+#include <utility>
+#include "../include/macros.hpp"
+#include "../include/mapped_file.hpp"
+#include "../include/text_search.hpp"
+
+/// Bytes at start of file checked for NUL bytes, files having them are
+/// binary and skipped (like git does).
+static constexpr std::size_t binary_check_bytes = 8000;
+
+/// Bytes of matched line shown in results, longer lines are cut.
+static constexpr std::size_t max_result_text_bytes = 256;
+
+/// Time an idle thread waits before looking for tasks to steal again.
+static constexpr std::chrono::microseconds idle_wait(100);
+
+/// @brief Appends line of results for matched line.
+/// @param path path of file.
+/// @param line_begin pointer to first byte of line.
+/// @param line_end pointer after last byte of line, without line break.
+/// @param row index of line.
+/// @param column index of first matched byte in line.
+/// @param tab_width number of spaces a tab is expanded into.
+/// @param results lines of results to append to.
+/// @throws No exceptions.
+static void add_result(const std::string& path,
+                       const char* line_begin,
+                       const char* line_end,
+                       const std::size_t& row,
+                       const std::size_t& column,
+                       const uint8& tab_width,
+                       std::vector<std::string>& results) noexcept
+{
+  // lines of opened files have their tabs expanded,
+  // columns are of expanded lines
+  const std::size_t tabs_count =
+    std::count(line_begin, line_begin + column, '\t');
+  std::string result =
+    path + ":" + std::to_string(row + 1) + ":" +
+    std::to_string(column + tabs_count * (tab_width - 1) + 1) + ": ";
+
+  // long lines are cut at start of a character
+  const char* text_end = line_end;
+  if(static_cast<std::size_t>(line_end - line_begin) > max_result_text_bytes)
+  {
+    text_end = line_begin + max_result_text_bytes;
+    while(text_end > line_begin && (*text_end & 0xC0) == 0x80)
+    {
+      text_end--;
+    }
+  }
+  for(const char* byte = line_begin; byte != text_end; byte++)
+  {
+    if(*byte == '\t')
+    {
+      result.append(tab_width, ' ');
+    }
+    else
+    {
+      result.push_back(*byte);
+    }
+  }
+  results.push_back(std::move(result));
+}
+
+ProjectSearch::ProjectSearch() noexcept
+  : _case_sensitive(false)
+  , _tab_width(4)
+  , _pending_tasks(0)
+  , _running_threads(0)
+  , _cancelled(false)
+  , _searched_files(0)
+  , _searched_bytes(0)
+{}
+
+ProjectSearch::~ProjectSearch() noexcept
+{
+  this->cancel();
+}
+
+bool ProjectSearch::start(const std::string& directory,
+                          const std::string& query,
+                          const bool& case_sensitive,
+                          const bool& regex,
+                          const uint8& tab_width,
+                          const uint32& threads_count) noexcept
+{
+  this->cancel();
+
+  if(query.empty())
+  {
+    return false;
+  }
+  if(regex)
+  {
+    Regex compiled;
+    if(!compiled.compile(query, case_sensitive))
+    {
+      return false;
+    }
+    _regex = std::move(compiled);
+    _query.clear();
+  }
+  else
+  {
+    // matched lines are listed, so a query can't span lines
+    if(query.find_first_of("\r\n") != std::string::npos)
+    {
+      return false;
+    }
+    _regex = std::nullopt;
+    _query = query;
+    if(!case_sensitive)
+    {
+      std::transform(_query.begin(),
+                     _query.end(),
+                     _query.begin(),
+                     [](const char& character)
+                     {
+                       return static_cast<char>(std::tolower(
+                         static_cast<unsigned char>(character)));
+                     });
+    }
+  }
+
+  _directory = directory;
+  if(!_directory.empty() && _directory.back() != '/')
+  {
+    _directory += '/';
+  }
+  _case_sensitive = case_sensitive;
+  _tab_width = tab_width;
+  _searched_files = 0;
+  _searched_bytes = 0;
+  _cancelled = false;
+
+  const uint32 count =
+    threads_count != 0
+      ? threads_count
+      : std::max<uint32>(1, std::thread::hardware_concurrency());
+  for(uint32 i = 0; i < count; i++)
+  {
+    _queues.push_back(std::make_unique<TaskQueue>());
+  }
+  this->_queue_task(0, Task{"", nullptr});
+
+  _running_threads = count;
+  for(uint32 i = 0; i < count; i++)
+  {
+    _threads.emplace_back(&ProjectSearch::_run, this, std::size_t(i));
+  }
+  return true;
+}
+
+void ProjectSearch::cancel() noexcept
+{
+  _cancelled = true;
+  this->wait();
+  _threads.clear();
+  _queues.clear();
+  _pending_tasks = 0;
+  _running_threads = 0;
+
+  std::lock_guard<std::mutex> lock(_batches_mutex);
+  _batches.clear();
+}
+
+void ProjectSearch::wait() noexcept
+{
+  for(std::thread& thread : _threads)
+  {
+    if(thread.joinable())
+    {
+      thread.join();
+    }
+  }
+}
+
+bool ProjectSearch::running() const noexcept
+{
+  if(_running_threads > 0)
+  {
+    return true;
+  }
+
+  std::lock_guard<std::mutex> lock(_batches_mutex);
+  return !_batches.empty();
+}
+
+std::optional<std::vector<std::string>>
+ProjectSearch::get_next_batch() noexcept
+{
+  std::lock_guard<std::mutex> lock(_batches_mutex);
+  if(_batches.empty())
+  {
+    return std::nullopt;
+  }
+
+  std::vector<std::string> batch = std::move(_batches.front());
+  _batches.pop_front();
+  return batch;
+}
+
+const std::string& ProjectSearch::directory() const noexcept
+{
+  return _directory;
+}
+
+std::size_t ProjectSearch::searched_files_count() const noexcept
+{
+  return _searched_files;
+}
+
+std::size_t ProjectSearch::searched_bytes_count() const noexcept
+{
+  return _searched_bytes;
+}
+
+std::optional<ProjectMatch>
+ProjectSearch::parse_result(std::string_view line) noexcept
+{
+  // path can have ':', so the first ":line:column: " after it is taken
+  std::size_t colon = line.find(':');
+  while(colon != std::string_view::npos)
+  {
+    const char* end = line.data() + line.size();
+    uint32 row = 0, column = 0;
+    const std::from_chars_result parsed_row =
+      std::from_chars(line.data() + colon + 1, end, row);
+    if(parsed_row.ec == std::errc() && parsed_row.ptr != end &&
+       *parsed_row.ptr == ':')
+    {
+      const std::from_chars_result parsed_column =
+        std::from_chars(parsed_row.ptr + 1, end, column);
+      if(parsed_column.ec == std::errc() && parsed_column.ptr + 1 < end &&
+         parsed_column.ptr[0] == ':' && parsed_column.ptr[1] == ' ' &&
+         colon > 0 && row > 0 && column > 0)
+      {
+        return ProjectMatch{std::string(line.substr(0, colon)),
+                            row - 1,
+                            static_cast<int32>(column - 1)};
+      }
+    }
+    colon = line.find(':', colon + 1);
+  }
+  return std::nullopt;
+}
+
+void ProjectSearch::_run(const std::size_t& index) noexcept
+{
+  // DFA states of regex are built while matching, each thread has a copy
+  const std::optional<Regex> regex = _regex;
+  while(!_cancelled)
+  {
+    std::optional<Task> task = this->_take_task(index);
+    if(!task)
+    {
+      // other threads can still queue tasks while listing directories
+      if(_pending_tasks == 0)
+      {
+        break;
+      }
+      std::this_thread::sleep_for(idle_wait);
+      continue;
+    }
+
+    if(task.value().path.empty() || task.value().path.back() == '/')
+    {
+      this->_list_directory(index, task.value());
+    }
+    else
+    {
+      this->_search_file(regex, task.value().path);
+    }
+    _pending_tasks--;
+  }
+  _running_threads--;
+}
+
+std::optional<ProjectSearch::Task>
+ProjectSearch::_take_task(const std::size_t& index) noexcept
+{
+  {
+    TaskQueue& queue = *_queues[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if(!queue.tasks.empty())
+    {
+      Task task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+      return task;
+    }
+  }
+
+  // stealing oldest task, directories near the root give most work
+  for(std::size_t i = 1; i < _queues.size(); i++)
+  {
+    TaskQueue& queue = *_queues[(index + i) % _queues.size()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if(!queue.tasks.empty())
+    {
+      Task task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+      return task;
+    }
+  }
+  return std::nullopt;
+}
+
+void ProjectSearch::_queue_task(const std::size_t& index, Task&& task) noexcept
+{
+  _pending_tasks++;
+  TaskQueue& queue = *_queues[index];
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  queue.tasks.push_back(std::move(task));
+}
+
+void ProjectSearch::_list_directory(const std::size_t& index,
+                                    const Task& task) noexcept
+{
+  const std::string directory_path =
+    _directory.empty() && task.path.empty() ? "./" : _directory + task.path;
+
+  // patterns of .gitignore apply to this directory and below
+  std::shared_ptr<const IgnoreRules> rules = task.rules;
+  {
+    std::shared_ptr<IgnoreRules> directory_rules =
+      std::make_shared<IgnoreRules>(rules, task.path);
+    if(directory_rules->load(directory_path + ".gitignore"))
+    {
+      rules = std::move(directory_rules);
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::directory_iterator entries(
+    directory_path,
+    std::filesystem::directory_options::skip_permission_denied,
+    error);
+  if(error)
+  {
+    WARN_BOII("Unable to list directory: %s", directory_path.c_str());
+    return;
+  }
+
+  for(; !error && entries != std::filesystem::directory_iterator();
+      entries.increment(error))
+  {
+    // symbolic links aren't followed, they can form cycles
+    std::error_code status_error;
+    const std::filesystem::file_status status =
+      entries->symlink_status(status_error);
+    const bool directory = std::filesystem::is_directory(status);
+    if(status_error ||
+       (!directory && !std::filesystem::is_regular_file(status)))
+    {
+      continue;
+    }
+
+    const std::string name = entries->path().filename().string();
+    if(directory && name == ".git")
+    {
+      continue;
+    }
+    std::string path = task.path + name;
+    if(rules && rules->ignored(path, directory))
+    {
+      continue;
+    }
+    if(directory)
+    {
+      path += '/';
+    }
+    this->_queue_task(index, Task{std::move(path), rules});
+  }
+}
+
+void ProjectSearch::_search_file(const std::optional<Regex>& regex,
+                                 const std::string& path) noexcept
+{
+  MappedFile file;
+  if(!file.open(_directory + path) || file.size() == 0)
+  {
+    return;
+  }
+
+  const char* data = file.data();
+  const char* end = data + file.size();
+  if(std::memchr(data, '\0', std::min(file.size(), binary_check_bytes)))
+  {
+    return;
+  }
+  _searched_files++;
+  _searched_bytes += file.size();
+
+  std::vector<std::string> results;
+  if(regex)
+  {
+    // regex is matched line by line
+    std::vector<std::pair<std::size_t, std::size_t>> matches;
+    const char* line_begin = data;
+    std::size_t row = 0;
+    while(!_cancelled)
+    {
+      const char* newline = static_cast<const char*>(
+        std::memchr(line_begin, '\n', end - line_begin));
+      const char* line_end = newline ? newline : end;
+      if(line_end != line_begin && line_end[-1] == '\r')
+      {
+        line_end--;
+      }
+      matches.clear();
+      regex.value().find_all(
+        std::string_view(line_begin, line_end - line_begin), matches);
+      if(!matches.empty())
+      {
+        add_result(path,
+                   line_begin,
+                   line_end,
+                   row,
+                   matches.front().first,
+                   _tab_width,
+                   results);
+      }
+      if(!newline)
+      {
+        break;
+      }
+      line_begin = newline + 1;
+      row++;
+    }
+  }
+  else
+  {
+    // whole file is scanned at once, lines are counted up to matches
+    std::vector<std::size_t> offsets;
+    find_occurrences(data, file.size(), _query, _case_sensitive, offsets);
+    const char* line_begin = data;
+    const char* line_end = data;
+    std::size_t row = 0;
+    for(const std::size_t& offset : offsets)
+    {
+      const char* match = data + offset;
+      // only first match of a line is listed
+      if(match < line_end)
+      {
+        continue;
+      }
+      while(const char* newline = static_cast<const char*>(
+              std::memchr(line_begin, '\n', match - line_begin)))
+      {
+        line_begin = newline + 1;
+        row++;
+      }
+      const char* newline =
+        static_cast<const char*>(std::memchr(match, '\n', end - match));
+      line_end = newline ? newline : end;
+      add_result(path,
+                 line_begin,
+                 line_end != line_begin && line_end[-1] == '\r' ? line_end - 1
+                                                                : line_end,
+                 row,
+                 offset - (line_begin - data),
+                 _tab_width,
+                 results);
+    }
+  }
+
+  if(!results.empty() && !_cancelled)
+  {
+    std::lock_guard<std::mutex> lock(_batches_mutex);
+    _batches.push_back(std::move(results));
+  }
+}
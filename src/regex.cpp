@@ -0,0 +1,960 @@
+#include "../include/regex.hpp"
+#include <algorithm>
+#include <cctype>
+#include <limits>
+
+/// Largest count of "{m,n}" repetition.
+static constexpr uint32 max_repetitions = 1000;
+
+/// Deepest nesting of groups.
+static constexpr uint32 max_group_depth = 128;
+
+/// Largest number of NFA states of a pattern.
+static constexpr std::size_t max_nfa_states = 100000;
+
+/// Number of DFA states built before they are dropped and built again,
+/// bounding memory of patterns with too many states.
+static constexpr std::size_t max_dfa_states = 2048;
+
+/// Maximum count of repetition without upper bound.
+static constexpr uint32 unbounded = std::numeric_limits<uint32>::max();
+
+/// @brief Kinds of nodes of parsed pattern.
+enum class RegexNodeType
+{
+  /// @brief Matches empty text.
+  EMPTY,
+  /// @brief Matches a byte of the set.
+  BYTES,
+  /// @brief Matches children one after another.
+  CONCAT,
+  /// @brief Matches any of children.
+  ALTERNATE,
+  /// @brief Matches child repeated min to max times.
+  REPEAT,
+  /// @brief Matches at beginning of line.
+  LINE_BEGIN,
+  /// @brief Matches at end of line.
+  LINE_END
+};
+
+/// @brief Node of parsed pattern.
+struct RegexNode
+{
+  /// @brief Kind of node.
+  RegexNodeType type = RegexNodeType::EMPTY;
+
+  /// @brief Bytes of BYTES node.
+  std::bitset<256> bytes;
+
+  /// @brief Children of CONCAT, ALTERNATE and REPEAT nodes.
+  std::vector<RegexNode> children;
+
+  /// @brief Minimum count of REPEAT node.
+  uint32 min = 0;
+
+  /// @brief Maximum count of REPEAT node, unbounded if there is none.
+  uint32 max = 0;
+};
+
+/// @brief Gives length of UTF-8 sequence starting with byte,
+///        1 for ASCII and invalid bytes.
+/// @throws No exceptions.
+static std::size_t utf8_sequence_length(const unsigned char& lead) noexcept
+{
+  if(lead >= 0xF0 && lead <= 0xF7)
+  {
+    return 4;
+  }
+  if(lead >= 0xE0)
+  {
+    return lead <= 0xEF ? 3 : 1;
+  }
+  if(lead >= 0xC0)
+  {
+    return 2;
+  }
+  return 1;
+}
+
+/// @brief Adds other case of ASCII letters in set.
+/// @throws No exceptions.
+static void fold_case(std::bitset<256>& bytes) noexcept
+{
+  for(unsigned char lower = 'a'; lower <= 'z'; lower++)
+  {
+    const unsigned char upper = lower - 'a' + 'A';
+    if(bytes[lower] || bytes[upper])
+    {
+      bytes.set(lower);
+      bytes.set(upper);
+    }
+  }
+}
+
+/// @brief Creates node matching a byte of set.
+/// @throws No exceptions.
+static RegexNode bytes_node(const std::bitset<256>& bytes) noexcept
+{
+  RegexNode node;
+  node.type = RegexNodeType::BYTES;
+  node.bytes = bytes;
+  return node;
+}
+
+/// @brief Creates node matching bytes one after another.
+/// @throws No exceptions.
+static RegexNode sequence_node(const std::string_view& sequence) noexcept
+{
+  RegexNode node;
+  node.type = RegexNodeType::CONCAT;
+  for(const char& byte : sequence)
+  {
+    std::bitset<256> bytes;
+    bytes.set(static_cast<unsigned char>(byte));
+    node.children.push_back(bytes_node(bytes));
+  }
+  return node;
+}
+
+/// @brief Creates node matching ASCII characters not in set,
+///        and all multi-byte UTF-8 characters.
+/// @throws No exceptions.
+static RegexNode negated_node(const std::bitset<256>& bytes) noexcept
+{
+  std::bitset<256> ascii;
+  for(std::size_t byte = 0; byte < 0x80; byte++)
+  {
+    ascii[byte] = !bytes[byte];
+  }
+
+  // lead byte followed by its continuation bytes
+  std::bitset<256> continuation;
+  for(std::size_t byte = 0x80; byte <= 0xBF; byte++)
+  {
+    continuation.set(byte);
+  }
+  RegexNode node;
+  node.type = RegexNodeType::ALTERNATE;
+  node.children.push_back(bytes_node(ascii));
+  for(std::size_t length = 2; length <= 4; length++)
+  {
+    std::bitset<256> leads;
+    for(std::size_t byte = 0xC0; byte <= 0xF7; byte++)
+    {
+      leads[byte] = utf8_sequence_length(byte) == length;
+    }
+    RegexNode sequence;
+    sequence.type = RegexNodeType::CONCAT;
+    sequence.children.push_back(bytes_node(leads));
+    for(std::size_t i = 1; i < length; i++)
+    {
+      sequence.children.push_back(bytes_node(continuation));
+    }
+    node.children.push_back(std::move(sequence));
+  }
+  return node;
+}
+
+/// @brief Recursive descent parser of patterns.
+class RegexParser
+{
+public:
+  /// @brief Creates parser of pattern.
+  /// @param pattern regular expression.
+  /// @param case_sensitive false to ignore case of ASCII letters.
+  /// @throws No exceptions.
+  RegexParser(const std::string& pattern, const bool& case_sensitive) noexcept
+    : _pattern(pattern)
+    , _position(0)
+    , _case_sensitive(case_sensitive)
+    , _depth(0)
+  {}
+
+  /// @brief Parses whole pattern.
+  /// @param node parsed pattern is stored in it.
+  /// @return Returns false if pattern is invalid.
+  /// @throws No exceptions.
+  [[nodiscard]] bool parse(RegexNode& node) noexcept
+  {
+    return this->_alternation(node) && _position == _pattern.size();
+  }
+
+private:
+  /// @brief Pattern being parsed.
+  const std::string& _pattern;
+
+  /// @brief Position of next byte to parse.
+  std::size_t _position;
+
+  /// @brief Tells if case of letters is matched.
+  bool _case_sensitive;
+
+  /// @brief Depth of groups being parsed.
+  uint32 _depth;
+
+  /// @brief Tells if next byte is character.
+  /// @throws No exceptions.
+  [[nodiscard]] bool _next_is(const char& character) const noexcept
+  {
+    return _position < _pattern.size() && _pattern[_position] == character;
+  }
+
+  /// @brief Parses alternatives separated by '|'.
+  /// @throws No exceptions.
+  [[nodiscard]] bool _alternation(RegexNode& node) noexcept
+  {
+    if(!this->_concatenation(node))
+    {
+      return false;
+    }
+    if(!this->_next_is('|'))
+    {
+      return true;
+    }
+
+    RegexNode alternation;
+    alternation.type = RegexNodeType::ALTERNATE;
+    alternation.children.push_back(std::move(node));
+    while(this->_next_is('|'))
+    {
+      _position++;
+      RegexNode alternative;
+      if(!this->_concatenation(alternative))
+      {
+        return false;
+      }
+      alternation.children.push_back(std::move(alternative));
+    }
+    node = std::move(alternation);
+    return true;
+  }
+
+  /// @brief Parses repetitions following each other.
+  /// @throws No exceptions.
+  [[nodiscard]] bool _concatenation(RegexNode& node) noexcept
+  {
+    node = RegexNode();
+    node.type = RegexNodeType::CONCAT;
+    while(_position < _pattern.size() && !this->_next_is('|') &&
+          !this->_next_is(')'))
+    {
+      RegexNode repetition;
+      if(!this->_repetition(repetition))
+      {
+        return false;
+      }
+      node.children.push_back(std::move(repetition));
+    }
+
+    if(node.children.empty())
+    {
+      node.type = RegexNodeType::EMPTY;
+    }
+    else if(node.children.size() == 1)
+    {
+      RegexNode child = std::move(node.children[0]);
+      node = std::move(child);
+    }
+    return true;
+  }
+
+  /// @brief Parses atom followed by quantifiers.
+  /// @throws No exceptions.
+  [[nodiscard]] bool _repetition(RegexNode& node) noexcept
+  {
+    if(!this->_atom(node))
+    {
+      return false;
+    }
+
+    while(_position < _pattern.size())
+    {
+      uint32 min, max;
+      const char quantifier = _pattern[_position];
+      if(quantifier == '*')
+      {
+        min = 0;
+        max = unbounded;
+        _position++;
+      }
+      else if(quantifier == '+')
+      {
+        min = 1;
+        max = unbounded;
+        _position++;
+      }
+      else if(quantifier == '?')
+      {
+        min = 0;
+        max = 1;
+        _position++;
+      }
+      else if(quantifier != '{' || !this->_bounds(min, max))
+      {
+        break;
+      }
+
+      // lazy quantifier matches like greedy one
+      if(this->_next_is('?'))
+      {
+        _position++;
+      }
+
+      RegexNode repeat;
+      repeat.type = RegexNodeType::REPEAT;
+      repeat.min = min;
+      repeat.max = max;
+      repeat.children.push_back(std::move(node));
+      node = std::move(repeat);
+    }
+    return true;
+  }
+
+  /// @brief Parses "{m}", "{m,}" or "{m,n}". Position isn't moved if
+  ///        there are no bounds, '{' is a literal then.
+  /// @return Returns false if there are no valid bounds.
+  /// @throws No exceptions.
+  [[nodiscard]] bool _bounds(uint32& min, uint32& max) noexcept
+  {
+    std::size_t position = _position + 1;
+    auto number = [&](uint32& value)
+    {
+      const std::size_t start = position;
+      value = 0;
+      while(position < _pattern.size() && _pattern[position] >= '0' &&
+            _pattern[position] <= '9' && value <= max_repetitions)
+      {
+        value = value * 10 + (_pattern[position] - '0');
+        position++;
+      }
+      return position != start && value <= max_repetitions;
+    };
+
+    if(!number(min))
+    {
+      return false;
+    }
+    max = min;
+    if(position < _pattern.size() && _pattern[position] == ',')
+    {
+      position++;
+      max = unbounded;
+      if(position < _pattern.size() && _pattern[position] != '}' &&
+         (!number(max) || max < min))
+      {
+        return false;
+      }
+    }
+    if(position >= _pattern.size() || _pattern[position] != '}')
+    {
+      return false;
+    }
+    _position = position + 1;
+    return true;
+  }
+
+  /// @brief Parses group, class, escape, anchor or literal character.
+  /// @throws No exceptions.
+  [[nodiscard]] bool _atom(RegexNode& node) noexcept
+  {
+    const char character = _pattern[_position];
+    if(character == '(')
+    {
+      if(++_depth > max_group_depth)
+      {
+        return false;
+      }
+      _position++;
+      // non-capturing group, nothing is captured anyway
+      if(this->_next_is('?') && _position + 1 < _pattern.size() &&
+         _pattern[_position + 1] == ':')
+      {
+        _position += 2;
+      }
+      if(!this->_alternation(node) || !this->_next_is(')'))
+      {
+        return false;
+      }
+      _position++;
+      _depth--;
+      return true;
+    }
+    if(character == '[')
+    {
+      return this->_class(node);
+    }
+    if(character == '*' || character == '+' || character == '?')
+    {
+      // nothing to repeat
+      return false;
+    }
+
+    _position++;
+    if(character == '.')
+    {
+      node = negated_node(std::bitset<256>());
+      return true;
+    }
+    if(character == '^')
+    {
+      node.type = RegexNodeType::LINE_BEGIN;
+      return true;
+    }
+    if(character == '$')
+    {
+      node.type = RegexNodeType::LINE_END;
+      return true;
+    }
+    if(character == '\\')
+    {
+      std::bitset<256> bytes;
+      bool negated;
+      if(!this->_escape(bytes, negated))
+      {
+        return false;
+      }
+      if(!_case_sensitive)
+      {
+        fold_case(bytes);
+      }
+      node = negated ? negated_node(bytes) : bytes_node(bytes);
+      return true;
+    }
+
+    // multi-byte characters are matched as a whole
+    const std::size_t length = utf8_sequence_length(character);
+    if(length > 1 && _position - 1 + length <= _pattern.size())
+    {
+      node = sequence_node(
+        std::string_view(_pattern).substr(_position - 1, length));
+      _position += length - 1;
+      return true;
+    }
+
+    std::bitset<256> bytes;
+    bytes.set(static_cast<unsigned char>(character));
+    if(!_case_sensitive)
+    {
+      fold_case(bytes);
+    }
+    node = bytes_node(bytes);
+    return true;
+  }
+
+  /// @brief Parses escape after '\', position is after the escape.
+  /// @param bytes bytes matched by escape are set in it.
+  /// @param negated set to true if bytes not in set are matched.
+  /// @return Returns false if escape is unknown (or unsupported, like
+  ///         back references and word boundaries).
+  /// @throws No exceptions.
+  [[nodiscard]] bool _escape(std::bitset<256>& bytes, bool& negated) noexcept
+  {
+    if(_position >= _pattern.size())
+    {
+      return false;
+    }
+
+    const char character = _pattern[_position++];
+    negated = character == 'D' || character == 'W' || character == 'S';
+    switch(character)
+    {
+      case 'd':
+      case 'D':
+        for(char digit = '0'; digit <= '9'; digit++)
+        {
+          bytes.set(digit);
+        }
+        return true;
+      case 'w':
+      case 'W':
+        for(std::size_t byte = 0; byte < 0x80; byte++)
+        {
+          bytes[byte] = std::isalnum(static_cast<int>(byte)) || byte == '_';
+        }
+        return true;
+      case 's':
+      case 'S':
+        for(const char& space : std::string_view(" \t\r\n\f\v"))
+        {
+          bytes.set(space);
+        }
+        return true;
+      case 't':
+        bytes.set('\t');
+        return true;
+      case 'n':
+        bytes.set('\n');
+        return true;
+      case 'r':
+        bytes.set('\r');
+        return true;
+      case 'f':
+        bytes.set('\f');
+        return true;
+      case 'v':
+        bytes.set('\v');
+        return true;
+      case 'x':
+      {
+        if(_position + 2 > _pattern.size() ||
+           !std::isxdigit(static_cast<unsigned char>(_pattern[_position])) ||
+           !std::isxdigit(static_cast<unsigned char>(_pattern[_position + 1])))
+        {
+          return false;
+        }
+        bytes.set(std::stoul(_pattern.substr(_position, 2), nullptr, 16));
+        _position += 2;
+        return true;
+      }
+      default:
+        if(std::isalnum(static_cast<unsigned char>(character)))
+        {
+          return false;
+        }
+        bytes.set(static_cast<unsigned char>(character));
+        return true;
+    }
+  }
+
+  /// @brief Parses class "[...]".
+  /// @throws No exceptions.
+  [[nodiscard]] bool _class(RegexNode& node) noexcept
+  {
+    _position++;
+    const bool negated = this->_next_is('^');
+    if(negated)
+    {
+      _position++;
+    }
+
+    std::bitset<256> bytes;
+    std::vector<std::string_view> sequences;
+    bool first = true;
+    while(true)
+    {
+      if(_position >= _pattern.size())
+      {
+        return false;
+      }
+
+      const unsigned char character = _pattern[_position];
+      if(character == ']' && !first)
+      {
+        _position++;
+        break;
+      }
+      first = false;
+
+      if(character == '\\')
+      {
+        _position++;
+        std::bitset<256> escaped;
+        bool escape_negated;
+        if(!this->_escape(escaped, escape_negated) || escape_negated)
+        {
+          return false;
+        }
+        bytes |= escaped;
+        continue;
+      }
+
+      // multi-byte characters are matched as a whole,
+      // ranges of them aren't supported
+      const std::size_t length = utf8_sequence_length(character);
+      if(length > 1)
+      {
+        if(negated || _position + length > _pattern.size())
+        {
+          return false;
+        }
+        sequences.push_back(
+          std::string_view(_pattern).substr(_position, length));
+        _position += length;
+        continue;
+      }
+
+      _position++;
+      if(this->_next_is('-') && _position + 1 < _pattern.size() &&
+         _pattern[_position + 1] != ']')
+      {
+        const unsigned char last = _pattern[_position + 1];
+        if(last < character || last >= 0x80 || last == '\\')
+        {
+          return false;
+        }
+        for(std::size_t byte = character; byte <= last; byte++)
+        {
+          bytes.set(byte);
+        }
+        _position += 2;
+      }
+      else
+      {
+        bytes.set(character);
+      }
+    }
+
+    if(!_case_sensitive)
+    {
+      fold_case(bytes);
+    }
+    if(negated)
+    {
+      node = negated_node(bytes);
+      return true;
+    }
+    if(sequences.empty())
+    {
+      node = bytes_node(bytes);
+      return true;
+    }
+    node = RegexNode();
+    node.type = RegexNodeType::ALTERNATE;
+    node.children.push_back(bytes_node(bytes));
+    for(const std::string_view& sequence : sequences)
+    {
+      node.children.push_back(sequence_node(sequence));
+    }
+    return true;
+  }
+};
+
+Regex::Regex() noexcept : _valid(false) {}
+
+bool Regex::compile(const std::string& pattern,
+                    const bool& case_sensitive) noexcept
+{
+  _valid = false;
+  _forward = Dfa();
+  _reverse = Dfa();
+
+  RegexNode root;
+  RegexParser parser(pattern, case_sensitive);
+  if(!parser.parse(root))
+  {
+    return false;
+  }
+
+  // state 0 is the match state, pattern is compiled before it
+  for(Dfa* dfa : {&_forward, &_reverse})
+  {
+    const bool reversed = dfa == &_reverse;
+    dfa->nfa.push_back(NfaState{NfaStateType::MATCH, {}, 0, 0});
+    dfa->nfa_start = _compile(dfa->nfa, root, 0, reversed);
+    dfa->unanchored = reversed;
+    if(dfa->nfa.size() > max_nfa_states)
+    {
+      _forward = Dfa();
+      _reverse = Dfa();
+      return false;
+    }
+  }
+
+  _valid = true;
+  return true;
+}
+
+bool Regex::valid() const noexcept
+{
+  return _valid;
+}
+
+void Regex::find_all(
+  std::string_view line,
+  std::vector<std::pair<std::size_t, std::size_t>>& matches) const noexcept
+{
+  if(!_valid)
+  {
+    return;
+  }
+
+  // scanning backwards, reversed pattern matches from every position,
+  // accepting at a position means a match starts there
+  const std::size_t length = line.size();
+  _match_starts.assign(length + 1, false);
+  bool any_match = false;
+  uint32 state = _start(_reverse, true);
+  for(std::size_t position = length;; position--)
+  {
+    const DfaState& current = _reverse.states[state];
+    if(current.accepting || (position == 0 && current.accepting_at_end))
+    {
+      _match_starts[position] = true;
+      any_match = true;
+    }
+    if(position == 0)
+    {
+      break;
+    }
+
+    const unsigned char byte = line[position - 1];
+    const int32 next = current.next[byte];
+    state = next >= 0 ? next : _step(_reverse, state, byte);
+  }
+  if(!any_match)
+  {
+    return;
+  }
+
+  // longest match from each start, after the previous match
+  for(std::size_t start = 0; start < length; start++)
+  {
+    if(!_match_starts[start])
+    {
+      continue;
+    }
+
+    std::size_t end = start;
+    state = _start(_forward, start == 0);
+    for(std::size_t position = start;; position++)
+    {
+      const DfaState& current = _forward.states[state];
+      if(position > start &&
+         (current.accepting ||
+          (position == length && current.accepting_at_end)))
+      {
+        end = position;
+      }
+      if(position == length || current.nfa_states.empty())
+      {
+        break;
+      }
+
+      const unsigned char byte = line[position];
+      const int32 next = current.next[byte];
+      state = next >= 0 ? next : _step(_forward, state, byte);
+    }
+
+    if(end > start)
+    {
+      matches.emplace_back(start, end);
+      start = end - 1;
+    }
+  }
+}
+
+uint32 Regex::_compile(std::vector<NfaState>& nfa,
+                       const RegexNode& node,
+                       const uint32& next,
+                       const bool& reversed) noexcept
+{
+  if(nfa.size() > max_nfa_states)
+  {
+    return next;
+  }
+
+  switch(node.type)
+  {
+    case RegexNodeType::EMPTY:
+      return next;
+    case RegexNodeType::BYTES:
+      nfa.push_back(NfaState{NfaStateType::BYTES, node.bytes, next, 0});
+      return nfa.size() - 1;
+    case RegexNodeType::LINE_BEGIN:
+      nfa.push_back(NfaState{
+        reversed ? NfaStateType::END : NfaStateType::BEGIN, {}, next, 0});
+      return nfa.size() - 1;
+    case RegexNodeType::LINE_END:
+      nfa.push_back(NfaState{
+        reversed ? NfaStateType::BEGIN : NfaStateType::END, {}, next, 0});
+      return nfa.size() - 1;
+    case RegexNodeType::CONCAT:
+    {
+      uint32 state = next;
+      if(reversed)
+      {
+        for(const RegexNode& child : node.children)
+        {
+          state = _compile(nfa, child, state, reversed);
+        }
+      }
+      else
+      {
+        for(auto child = node.children.rbegin(); child != node.children.rend();
+            child++)
+        {
+          state = _compile(nfa, *child, state, reversed);
+        }
+      }
+      return state;
+    }
+    case RegexNodeType::ALTERNATE:
+    {
+      uint32 state = _compile(nfa, node.children.back(), next, reversed);
+      for(std::size_t i = node.children.size() - 1; i-- > 0;)
+      {
+        const uint32 alternative =
+          _compile(nfa, node.children[i], next, reversed);
+        nfa.push_back(NfaState{NfaStateType::SPLIT, {}, alternative, state});
+        state = nfa.size() - 1;
+      }
+      return state;
+    }
+    case RegexNodeType::REPEAT:
+    {
+      const RegexNode& child = node.children[0];
+      uint32 state = next;
+      if(node.max == unbounded)
+      {
+        // loop, split goes to child (which comes back) or skips it
+        nfa.push_back(NfaState{NfaStateType::SPLIT, {}, 0, next});
+        const uint32 split = nfa.size() - 1;
+        nfa[split].out = _compile(nfa, child, split, reversed);
+        state = split;
+      }
+      else
+      {
+        // optional repetitions, each can skip the ones after it
+        for(uint32 i = node.min; i < node.max; i++)
+        {
+          const uint32 optional = _compile(nfa, child, state, reversed);
+          nfa.push_back(NfaState{NfaStateType::SPLIT, {}, optional, next});
+          state = nfa.size() - 1;
+        }
+      }
+      for(uint32 i = 0; i < node.min; i++)
+      {
+        state = _compile(nfa, child, state, reversed);
+      }
+      return state;
+    }
+  }
+  return next;
+}
+
+uint32 Regex::_start(Dfa& dfa, const bool& at_edge) noexcept
+{
+  int32& start = dfa.starts[at_edge ? 0 : 1];
+  if(start < 0)
+  {
+    std::vector<bool> visited(dfa.nfa.size(), false);
+    std::vector<uint32> states;
+    _closure(dfa.nfa, dfa.nfa_start, at_edge, false, visited, states);
+    start = _state(dfa, std::move(states));
+  }
+  return start;
+}
+
+uint32 Regex::_step(Dfa& dfa, uint32 state, const unsigned char& byte) noexcept
+{
+  // too many states are built, dropping them
+  // except the current state which is built again
+  if(dfa.states.size() >= max_dfa_states)
+  {
+    std::vector<uint32> current = std::move(dfa.states[state].nfa_states);
+    dfa.states.clear();
+    dfa.ids.clear();
+    dfa.starts = {-1, -1};
+    state = _state(dfa, std::move(current));
+  }
+
+  std::vector<bool> visited(dfa.nfa.size(), false);
+  std::vector<uint32> states;
+  for(const uint32& nfa_state : dfa.states[state].nfa_states)
+  {
+    const NfaState& current = dfa.nfa[nfa_state];
+    if(current.type == NfaStateType::BYTES && current.bytes[byte])
+    {
+      _closure(dfa.nfa, current.out, false, false, visited, states);
+    }
+  }
+  if(dfa.unanchored)
+  {
+    _closure(dfa.nfa, dfa.nfa_start, false, false, visited, states);
+  }
+
+  const uint32 next = _state(dfa, std::move(states));
+  dfa.states[state].next[byte] = next;
+  return next;
+}
+
+uint32 Regex::_state(Dfa& dfa, std::vector<uint32>&& nfa_states) noexcept
+{
+  std::sort(nfa_states.begin(), nfa_states.end());
+  auto it = dfa.ids.find(nfa_states);
+  if(it != dfa.ids.end())
+  {
+    return it->second;
+  }
+
+  DfaState state;
+  state.accepting = false;
+  state.accepting_at_end = false;
+  state.next.fill(-1);
+
+  // pattern may be matched passing END states, at the edge of line
+  std::vector<bool> visited(dfa.nfa.size(), false);
+  std::vector<uint32> at_end;
+  for(const uint32& nfa_state : nfa_states)
+  {
+    const NfaState& current = dfa.nfa[nfa_state];
+    if(current.type == NfaStateType::MATCH)
+    {
+      state.accepting = true;
+    }
+    else if(current.type == NfaStateType::END)
+    {
+      _closure(dfa.nfa, current.out, false, true, visited, at_end);
+    }
+  }
+  state.accepting_at_end =
+    state.accepting ||
+    std::any_of(at_end.begin(),
+                at_end.end(),
+                [&dfa](const uint32& nfa_state)
+                {
+                  return dfa.nfa[nfa_state].type == NfaStateType::MATCH;
+                });
+
+  state.nfa_states = nfa_states;
+  dfa.ids.emplace(std::move(nfa_states), dfa.states.size());
+  dfa.states.push_back(std::move(state));
+  return dfa.states.size() - 1;
+}
+
+void Regex::_closure(const std::vector<NfaState>& nfa,
+                     const uint32& state,
+                     const bool& at_edge,
+                     const bool& pass_end,
+                     std::vector<bool>& visited,
+                     std::vector<uint32>& states) noexcept
+{
+  std::vector<uint32> stack = {state};
+  while(!stack.empty())
+  {
+    const uint32 current = stack.back();
+    stack.pop_back();
+    if(visited[current])
+    {
+      continue;
+    }
+    visited[current] = true;
+
+    const NfaState& nfa_state = nfa[current];
+    switch(nfa_state.type)
+    {
+      case NfaStateType::SPLIT:
+        stack.push_back(nfa_state.out1);
+        stack.push_back(nfa_state.out);
+        break;
+      case NfaStateType::BEGIN:
+        if(at_edge)
+        {
+          stack.push_back(nfa_state.out);
+        }
+        break;
+      case NfaStateType::END:
+        states.push_back(current);
+        if(pass_end)
+        {
+          stack.push_back(nfa_state.out);
+        }
+        break;
+      case NfaStateType::BYTES:
+      case NfaStateType::MATCH:
+        states.push_back(current);
+        break;
+    }
+  }
+}
@@ -0,0 +1,285 @@
+#include "../include/regex_search.hpp"
+#include <algorithm>
+#include <string_view>
+
+/// Lines scanned between checks for cancellation.
+static constexpr uint32 rows_per_chunk = 1024;
+
+/// Lines scanned before publishing a batch, after the first batch.
+static constexpr uint32 rows_per_batch = 64 * 1024;
+
+/// Replacing lines rescans them right away up to this many lines,
+/// more are rescanned in background.
+static constexpr uint32 max_synchronous_rows = 4096;
+
+RegexSearch::RegexSearch() noexcept
+  : _scan_rows(0, 0)
+  , _pending_rows(0, 0)
+  , _cancelled(false)
+  , _finished(true)
+  , _scanned_rows(0)
+  , _untaken_count(0)
+{}
+
+RegexSearch::~RegexSearch() noexcept
+{
+  this->_cancel();
+}
+
+bool RegexSearch::search(const PieceTableSnapshot& lines,
+                         const std::string& pattern,
+                         const bool& case_sensitive) noexcept
+{
+  this->_cancel();
+  _matches.clear();
+  _pending_rows = {0, 0};
+  _pattern = pattern;
+  if(_pattern.empty())
+  {
+    _regex = Regex();
+    return true;
+  }
+  if(!_regex.compile(_pattern, case_sensitive))
+  {
+    return false;
+  }
+
+  this->_start(lines, 0, lines.size());
+  return true;
+}
+
+void RegexSearch::replace_lines(const PieceTableSnapshot& lines,
+                                const uint32& row,
+                                const uint32& count,
+                                const uint32& new_count) noexcept
+{
+  if(!_regex.valid())
+  {
+    return;
+  }
+
+  if(this->running())
+  {
+    // lines of file loaded after scanned lines wait for the scan,
+    // any other change makes scanned lines stale
+    const bool appended = count == 0 && row >= _scan_rows.second &&
+                          row + new_count == lines.size() &&
+                          (_pending_rows.first == _pending_rows.second ||
+                           _pending_rows.second == row);
+    if(appended)
+    {
+      if(_pending_rows.first == _pending_rows.second)
+      {
+        _pending_rows.first = row;
+      }
+      _pending_rows.second = row + new_count;
+      return;
+    }
+
+    _matches.clear();
+    _pending_rows = {0, 0};
+    this->_start(lines, 0, lines.size());
+    return;
+  }
+
+  std::vector<TextMatch> matches;
+  const bool synchronous = new_count <= max_synchronous_rows;
+  if(synchronous)
+  {
+    _scan(_regex, lines, row, row + new_count, matches);
+  }
+  replace_matches(_matches, row, count, new_count, matches);
+  if(!synchronous)
+  {
+    this->_start(lines, row, row + new_count);
+  }
+}
+
+bool RegexSearch::take_matches(const PieceTableSnapshot& lines) noexcept
+{
+  // read before taking, so no batch is published after it
+  const bool finished = _finished;
+
+  bool taken = false;
+  {
+    std::lock_guard<std::mutex> lock(_batches_mutex);
+    this->_reserve(lines, _untaken_count);
+    for(std::vector<TextMatch>& batch : _batches)
+    {
+      // batches of rescanned lines go in between matches
+      const std::size_t position =
+        first_match_from(_matches, batch.front().row, batch.front().column);
+      _matches.insert(_matches.begin() + position, batch.begin(), batch.end());
+      _untaken_count -= batch.size();
+      taken = true;
+    }
+    _batches.clear();
+  }
+
+  if(finished && _pending_rows.first != _pending_rows.second)
+  {
+    const std::pair<uint32, uint32> rows = _pending_rows;
+    _pending_rows = {0, 0};
+    this->_start(lines, rows.first, std::min(rows.second, lines.size()));
+  }
+  return taken;
+}
+
+void RegexSearch::clear() noexcept
+{
+  this->_cancel();
+  _regex = Regex();
+  _pattern.clear();
+  _matches.clear();
+  _pending_rows = {0, 0};
+}
+
+bool RegexSearch::running() const noexcept
+{
+  return !_finished || _untaken_count > 0 ||
+         _pending_rows.first != _pending_rows.second;
+}
+
+float32 RegexSearch::progress() const noexcept
+{
+  if(!this->running() || _scan_rows.second == _scan_rows.first)
+  {
+    return 1.0f;
+  }
+
+  return static_cast<float32>(_scanned_rows) /
+         static_cast<float32>(_scan_rows.second - _scan_rows.first);
+}
+
+std::size_t RegexSearch::found_count() const noexcept
+{
+  return _matches.size() + _untaken_count;
+}
+
+const std::string& RegexSearch::pattern() const noexcept
+{
+  return _pattern;
+}
+
+bool RegexSearch::valid() const noexcept
+{
+  return _regex.valid();
+}
+
+const std::vector<TextMatch>& RegexSearch::matches() const noexcept
+{
+  return _matches;
+}
+
+void RegexSearch::_start(const PieceTableSnapshot& lines,
+                         const uint32& first_row,
+                         const uint32& last_row) noexcept
+{
+  this->_cancel();
+
+  _scan_rows = {first_row, last_row};
+  _scanned_rows = 0;
+  _cancelled = false;
+  _finished = false;
+  // scanning thread has its own copy of regex, as DFA states are built
+  // while matching, and its own snapshot, lines can be edited meanwhile
+  _thread = std::thread(
+    [this, lines, regex = _regex, first_row, last_row]()
+    {
+      std::vector<TextMatch> batch;
+      auto publish = [this, &batch]()
+      {
+        std::lock_guard<std::mutex> lock(_batches_mutex);
+        _untaken_count += batch.size();
+        _batches.push_back(std::move(batch));
+        batch = std::vector<TextMatch>();
+      };
+
+      // first matches are published right away, so they are shown before
+      // the scan is done, the rest in batches of many lines
+      uint32 row = first_row, published_row = first_row;
+      bool published = false;
+      while(row < last_row && !_cancelled)
+      {
+        const uint32 end = std::min(row + rows_per_chunk, last_row);
+        _scan(regex, lines, row, end, batch);
+        row = end;
+        _scanned_rows = row - first_row;
+
+        if(!batch.empty() &&
+           (!published || row - published_row >= rows_per_batch))
+        {
+          publish();
+          published = true;
+          published_row = row;
+        }
+      }
+      if(!batch.empty() && !_cancelled)
+      {
+        publish();
+      }
+      _finished = true;
+    });
+}
+
+void RegexSearch::_reserve(const PieceTableSnapshot& lines,
+                           const std::size_t& count) noexcept
+{
+  const std::size_t size = _matches.size() + count;
+  const uint32 scanned_row = _scan_rows.first + _scanned_rows;
+  if(size <= _matches.capacity() || scanned_row == 0 ||
+     (!_matches.empty() && _matches.back().row >= scanned_row))
+  {
+    return;
+  }
+
+  // all matches are in scanned lines, so the final count is estimated
+  // from their density, to not copy millions of matches each time
+  // vector grows
+  const std::size_t estimate =
+    size * std::max(lines.size(), scanned_row) / scanned_row;
+  _matches.reserve(std::max(estimate + estimate / 8, 2 * size));
+}
+
+void RegexSearch::_cancel() noexcept
+{
+  _cancelled = true;
+  if(_thread.joinable())
+  {
+    _thread.join();
+  }
+  _finished = true;
+
+  std::lock_guard<std::mutex> lock(_batches_mutex);
+  _batches.clear();
+  _untaken_count = 0;
+}
+
+void RegexSearch::_scan(const Regex& regex,
+                        const PieceTableSnapshot& lines,
+                        const uint32& first_row,
+                        const uint32& last_row,
+                        std::vector<TextMatch>& matches) noexcept
+{
+  std::vector<std::pair<std::size_t, std::size_t>> offsets;
+  uint32 row = first_row;
+  while(row < last_row)
+  {
+    std::span<const Piece> pieces = lines.pieces_from(row);
+    pieces = pieces.first(std::min<std::size_t>(pieces.size(), last_row - row));
+    for(std::size_t i = 0; i < pieces.size(); i++)
+    {
+      offsets.clear();
+      regex.find_all(std::string_view(pieces[i].data, pieces[i].length),
+                     offsets);
+      for(const std::pair<std::size_t, std::size_t>& offset : offsets)
+      {
+        matches.push_back(
+          TextMatch{static_cast<uint32>(row + i),
+                    static_cast<uint32>(offset.first),
+                    static_cast<uint32>(offset.second - offset.first)});
+      }
+    }
+    row += pieces.size();
+  }
+}
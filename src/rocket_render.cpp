@@ -1,5 +1,6 @@
 #include "../include/rocket_render.hpp"
 #include "../include/cairo_context.hpp"
+#include "../include/line_layout.hpp"
 
 void RocketRender::line(const int32& x1,
                         const int32& y1,
@@ -99,7 +100,7 @@ void RocketRender::rectangle_outlined_rounded(const int32& x,
 
 void RocketRender::text(const int32& x,
                         const int32& y,
-                        const std::string& text,
+                        const std::string_view& text,
                         const SDL_Color& color)
 {
   cairo_t* cr = CairoContext::get_instance()->get_context();
@@ -112,13 +113,25 @@ void RocketRender::text(const int32& x,
   cairo_font_extents(cr, &font_extents);
   float32 painter_x = x,
           painter_y = y + font_extents.height - font_extents.descent;
-  // cairo_show_text(cr, text.c_str());
-  for(const char& c : text)
+  // clusters are drawn whole, in the cells line layout gives them, invalid
+  // bytes are replaced as invalid UTF-8 puts cairo in an error state
+  std::string cluster;
+  std::size_t start = 0;
+  while(start < text.size())
   {
+    uint32 cells = 0;
+    const std::size_t end = LineLayout::cluster_end(text, start, cells);
+    if(end - start == 1 && static_cast<unsigned char>(text[start]) >= 0x80)
+    {
+      cluster = "\xEF\xBF\xBD";
+    }
+    else
+    {
+      cluster.assign(text, start, end - start);
+    }
     cairo_move_to(cr, painter_x, painter_y);
-    char str[2] = {c, '\0'};
-    cairo_show_text(cr, str);
-    painter_x += font_extents.max_x_advance;
+    cairo_show_text(cr, cluster.c_str());
+    painter_x += cells * font_extents.max_x_advance;
+    start = end;
   }
-  // cairo_show_glyphs(cr, nullptr, text.size());
 }
@@ -0,0 +1,444 @@
+#include "../include/text_search.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#if defined(__AVX2__)
+#  include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#  include <emmintrin.h>
+#endif
+
+/// Positions of text tested at once.
+static constexpr std::size_t block_size = 64;
+
+/// @brief Lowers ASCII letter, other characters are returned as is.
+/// @throws No exceptions.
+static inline char lower_ascii(const char& character) noexcept
+{
+  return character >= 'A' && character <= 'Z'
+           ? static_cast<char>(character | 0x20)
+           : character;
+}
+
+/// @brief Bits set in bytes of text before comparing them with a (lowered)
+///        byte of query, so both cases of a letter compare equal.
+/// @throws No exceptions.
+static inline char case_bits(const char& character,
+                             const bool& case_sensitive) noexcept
+{
+  return !case_sensitive && character >= 'a' && character <= 'z' ? 0x20 : 0;
+}
+
+/// @brief Finds positions in a block where first and last byte of query
+///        match, candidates for a match.
+/// @param starts pointer to block_size bytes, at first byte of positions.
+/// @param ends pointer to block_size bytes, at last byte of positions.
+/// @param first first byte of query.
+/// @param first_bits case bits of first byte.
+/// @param last last byte of query.
+/// @param last_bits case bits of last byte.
+/// @return Returns bitmask of candidates, bit i for position i.
+/// @throws No exceptions.
+static inline std::uint64_t find_candidates(const char* starts,
+                                            const char* ends,
+                                            const char& first,
+                                            const char& first_bits,
+                                            const char& last,
+                                            const char& last_bits) noexcept
+{
+  std::uint64_t candidates = 0;
+#if defined(__AVX2__)
+  for(std::size_t half = 0; half < block_size; half += 32)
+  {
+    const __m256i first_bytes = _mm256_or_si256(
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(starts + half)),
+      _mm256_set1_epi8(first_bits));
+    const __m256i last_bytes = _mm256_or_si256(
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ends + half)),
+      _mm256_set1_epi8(last_bits));
+    candidates |=
+      static_cast<std::uint64_t>(static_cast<std::uint32_t>(
+        _mm256_movemask_epi8(_mm256_and_si256(
+          _mm256_cmpeq_epi8(first_bytes, _mm256_set1_epi8(first)),
+          _mm256_cmpeq_epi8(last_bytes, _mm256_set1_epi8(last))))))
+      << half;
+  }
+#elif defined(__SSE2__) || defined(_M_X64)
+  for(std::size_t quarter = 0; quarter < block_size; quarter += 16)
+  {
+    const __m128i first_bytes = _mm_or_si128(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(starts + quarter)),
+      _mm_set1_epi8(first_bits));
+    const __m128i last_bytes = _mm_or_si128(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(ends + quarter)),
+      _mm_set1_epi8(last_bits));
+    candidates |=
+      static_cast<std::uint64_t>(static_cast<std::uint32_t>(
+        _mm_movemask_epi8(
+          _mm_and_si128(_mm_cmpeq_epi8(first_bytes, _mm_set1_epi8(first)),
+                        _mm_cmpeq_epi8(last_bytes, _mm_set1_epi8(last))))))
+      << quarter;
+  }
+#else
+  for(std::size_t i = 0; i < block_size; i++)
+  {
+    const bool candidate =
+      (starts[i] | first_bits) == first && (ends[i] | last_bits) == last;
+    candidates |= static_cast<std::uint64_t>(candidate) << i;
+  }
+#endif
+  return candidates;
+}
+
+/// @brief Tells if query matches text at position.
+/// @param text pointer to text, atleast query size bytes long.
+/// @param query query, lowered when ignoring case.
+/// @param case_sensitive false to ignore case of ASCII letters.
+/// @throws No exceptions.
+static inline bool matches_at(const char* text,
+                              const std::string& query,
+                              const bool& case_sensitive) noexcept
+{
+  if(case_sensitive)
+  {
+    return std::memcmp(text, query.data(), query.size()) == 0;
+  }
+
+  for(std::size_t i = 0; i < query.size(); i++)
+  {
+    if(lower_ascii(text[i]) != query[i])
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+void find_occurrences(const char* text,
+                      const std::size_t& size,
+                      const std::string& query,
+                      const bool& case_sensitive,
+                      std::vector<std::size_t>& offsets) noexcept
+{
+  const std::size_t length = query.size();
+  if(size < length)
+  {
+    return;
+  }
+
+  const char first = query.front();
+  const char first_bits = case_bits(first, case_sensitive);
+  const char last = query.back();
+  const char last_bits = case_bits(last, case_sensitive);
+
+  // appends candidates of block at position which are matches
+  auto add_matches = [&](std::uint64_t candidates, const std::size_t& position)
+  {
+    while(candidates != 0)
+    {
+      const std::size_t offset = position + std::countr_zero(candidates);
+      candidates &= candidates - 1;
+      if(matches_at(text + offset, query, case_sensitive))
+      {
+        offsets.push_back(offset);
+      }
+    }
+  };
+
+  // blocks of positions are tested while last bytes fit in text
+  std::size_t position = 0;
+  while(position + length - 1 + block_size <= size)
+  {
+    add_matches(find_candidates(text + position,
+                                text + position + length - 1,
+                                first,
+                                first_bits,
+                                last,
+                                last_bits),
+                position);
+    position += block_size;
+  }
+
+  // positions left are fewer than a block, lines are short so this is
+  // done for most texts, it's tested as a block copied into padding
+  const std::size_t positions_left = size - length + 1 - position;
+  if(positions_left == 0)
+  {
+    return;
+  }
+  if(length > block_size)
+  {
+    for(; position + length <= size; position++)
+    {
+      if(matches_at(text + position, query, case_sensitive))
+      {
+        offsets.push_back(position);
+      }
+    }
+    return;
+  }
+
+  char padded[2 * block_size] = {};
+  std::memcpy(padded, text + position, size - position);
+  add_matches(find_candidates(padded,
+                              padded + length - 1,
+                              first,
+                              first_bits,
+                              last,
+                              last_bits) &
+                ((std::uint64_t(1) << positions_left) - 1),
+              position);
+}
+
+/// Line break bytes skipped between lines searched as one text.
+static constexpr std::size_t max_line_breaks_gap = 16;
+
+/// @brief Tells if text of next line follows text of previous line in
+///        memory, separated only by line breaks (of empty lines between
+///        them too). Query has no line breaks, so both lines can be
+///        searched as one text.
+/// @throws No exceptions.
+static inline bool follows(const char* previous_end, const char* next) noexcept
+{
+  if(next == previous_end + 1) [[likely]]
+  {
+    return *previous_end == '\n';
+  }
+  if(next <= previous_end ||
+     static_cast<std::size_t>(next - previous_end) > max_line_breaks_gap)
+  {
+    return false;
+  }
+  for(const char* byte = previous_end; byte != next; byte++)
+  {
+    if(*byte != '\n' && *byte != '\r')
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::size_t first_match_from(const std::vector<TextMatch>& matches,
+                             const uint32& row,
+                             const uint32& column) noexcept
+{
+  return std::lower_bound(matches.begin(),
+                          matches.end(),
+                          TextMatch{row, column, 0},
+                          [](const TextMatch& a, const TextMatch& b)
+                          {
+                            return a.row < b.row ||
+                                   (a.row == b.row && a.column < b.column);
+                          }) -
+         matches.begin();
+}
+
+void replace_matches(std::vector<TextMatch>& matches,
+                     const uint32& row,
+                     const uint32& count,
+                     const uint32& new_count,
+                     const std::vector<TextMatch>& new_matches) noexcept
+{
+  auto first = std::lower_bound(matches.begin(),
+                                matches.end(),
+                                row,
+                                [](const TextMatch& match, const uint32& row)
+                                {
+                                  return match.row < row;
+                                });
+  auto last = std::lower_bound(first,
+                               matches.end(),
+                               row + count,
+                               [](const TextMatch& match, const uint32& row)
+                               {
+                                 return match.row < row;
+                               });
+
+  // matches after replaced lines move with them,
+  // typing in a line doesn't move lines
+  if(new_count != count)
+  {
+    for(auto it = last; it != matches.end(); it++)
+    {
+      it->row = it->row + new_count - count;
+    }
+  }
+
+  if(new_matches.size() == static_cast<std::size_t>(last - first))
+  {
+    std::copy(new_matches.begin(), new_matches.end(), first);
+    return;
+  }
+  first = matches.erase(first, last);
+  matches.insert(first, new_matches.begin(), new_matches.end());
+}
+
+TextSearch::TextSearch() noexcept
+  : _case_sensitive(false)
+  , _version(0)
+{}
+
+void TextSearch::search(
+  const PieceTableSnapshot& lines,
+  const std::string& query,
+  const bool& case_sensitive,
+  const std::vector<std::pair<uint32, uint32>>& row_ranges) noexcept
+{
+  // occurrences of query are occurrences of its prefix,
+  // so typing more of query only drops matches
+  const bool refine = !_query.empty() && case_sensitive == _case_sensitive &&
+                      lines.version() == _version &&
+                      query.size() > _query.size() &&
+                      query.compare(0, _query.size(), _query) == 0;
+
+  _query = query;
+  _lowered_query = query;
+  if(!case_sensitive)
+  {
+    std::transform(
+      _lowered_query.begin(), _lowered_query.end(), _lowered_query.begin(),
+      lower_ascii);
+  }
+  _case_sensitive = case_sensitive;
+  _version = lines.version();
+
+  if(_query.empty() || _query.find_first_of("\r\n") != std::string::npos)
+  {
+    _matches.clear();
+    return;
+  }
+
+  if(!refine)
+  {
+    _matches.clear();
+    for(const std::pair<uint32, uint32>& rows : row_ranges)
+    {
+      this->_scan(lines, rows.first, rows.second, _matches);
+    }
+    return;
+  }
+
+  // matches are in order, so lines are read leaf by leaf
+  std::span<const Piece> pieces;
+  uint32 pieces_row = 0;
+  std::size_t kept = 0;
+  for(const TextMatch& match : _matches)
+  {
+    if(match.row < pieces_row || match.row >= pieces_row + pieces.size())
+    {
+      pieces = lines.pieces_from(match.row);
+      pieces_row = match.row;
+    }
+
+    const Piece& piece = pieces[match.row - pieces_row];
+    if(match.column + _query.size() <= piece.length &&
+       matches_at(piece.data + match.column,
+                  _case_sensitive ? _query : _lowered_query,
+                  _case_sensitive))
+    {
+      // matches grow with query
+      _matches[kept] = match;
+      _matches[kept++].length = _query.size();
+    }
+  }
+  _matches.resize(kept);
+}
+
+void TextSearch::replace_lines(const PieceTableSnapshot& lines,
+                               const uint32& row,
+                               const uint32& count,
+                               const uint32& new_count) noexcept
+{
+  _version = lines.version();
+  if(_query.empty() || _query.find_first_of("\r\n") != std::string::npos)
+  {
+    return;
+  }
+
+  std::vector<TextMatch> matches;
+  this->_scan(lines, row, row + new_count, matches);
+  replace_matches(_matches, row, count, new_count, matches);
+}
+
+void TextSearch::clear() noexcept
+{
+  _query.clear();
+  _lowered_query.clear();
+  _matches.clear();
+}
+
+const std::string& TextSearch::query() const noexcept
+{
+  return _query;
+}
+
+bool TextSearch::case_sensitive() const noexcept
+{
+  return _case_sensitive;
+}
+
+const std::vector<TextMatch>& TextSearch::matches() const noexcept
+{
+  return _matches;
+}
+
+void TextSearch::_scan(const PieceTableSnapshot& lines,
+                       const uint32& first_row,
+                       const uint32& last_row,
+                       std::vector<TextMatch>& matches) const noexcept
+{
+  const std::string& query = _case_sensitive ? _query : _lowered_query;
+  std::vector<std::size_t> offsets;
+  uint32 row = first_row;
+  while(row < last_row)
+  {
+    std::span<const Piece> pieces = lines.pieces_from(row);
+    pieces = pieces.first(std::min<std::size_t>(pieces.size(), last_row - row));
+
+    std::size_t index = 0;
+    while(index < pieces.size())
+    {
+      // empty lines have no text to search
+      if(pieces[index].length == 0)
+      {
+        index++;
+        continue;
+      }
+
+      // lines following each other in memory are searched at once
+      const char* text = pieces[index].data;
+      const char* text_end = text + pieces[index].length;
+      std::size_t end = index + 1;
+      while(end < pieces.size() &&
+            (pieces[end].length == 0 || follows(text_end, pieces[end].data)))
+      {
+        if(pieces[end].length != 0)
+        {
+          text_end = pieces[end].data + pieces[end].length;
+        }
+        end++;
+      }
+      offsets.clear();
+      find_occurrences(text, text_end - text, query, _case_sensitive, offsets);
+
+      // occurrences can't contain line breaks, each is inside a line
+      std::size_t line = index;
+      for(const std::size_t& offset : offsets)
+      {
+        while(pieces[line].length == 0 ||
+              text + offset >= pieces[line].data + pieces[line].length)
+        {
+          line++;
+        }
+        matches.push_back(
+          TextMatch{static_cast<uint32>(row + line),
+                    static_cast<uint32>(text + offset - pieces[line].data),
+                    static_cast<uint32>(query.size())});
+      }
+      index = end;
+    }
+    row += pieces.size();
+  }
+}
@@ -0,0 +1,435 @@
+#include "../include/trigram_index.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <string_view>
+#include "../include/macros.hpp"
+
+/// Bytes of lines in a chunk, a chunk ends at the first line after these.
+static constexpr std::size_t chunk_bytes = 1024 * 1024;
+
+/// Trigrams are hashed to this many bits, bitmap of a chunk has a bit
+/// for each hash.
+static constexpr uint32 trigram_hash_bits = 18;
+
+/// Number of words of bitmap of a chunk.
+static constexpr std::size_t bitmap_words =
+  (std::size_t(1) << trigram_hash_bits) / 64;
+
+/// Start of saved index file, its last byte is the format version.
+static constexpr char index_magic[8] = {'R', 'K', 'T', 'T', 'R', 'I', 'G', '1'};
+
+/// @brief Lowers ASCII letters, so index serves both cases of query.
+/// @throws No exceptions.
+static inline std::uint32_t lower_ascii(const char& character) noexcept
+{
+  const std::uint32_t byte = static_cast<unsigned char>(character);
+  return byte - 'A' < 26 ? byte + ('a' - 'A') : byte;
+}
+
+/// @brief Hashes trigram, last 3 bytes read, to a bit of bitmap.
+/// @throws No exceptions.
+static inline std::uint32_t trigram_hash(const std::uint32_t& trigram) noexcept
+{
+  return ((trigram & 0xFFFFFF) * 0x9E3779B1u) >> (32 - trigram_hash_bits);
+}
+
+/// @brief Sets bits of trigrams of text in bitmap.
+/// @throws No exceptions.
+static void add_trigrams(std::string_view text, std::uint64_t* bitmap) noexcept
+{
+  std::uint32_t trigram = 0;
+  for(std::size_t i = 0; i < text.size(); i++)
+  {
+    trigram = (trigram << 8) | lower_ascii(text[i]);
+    if(i >= 2)
+    {
+      const std::uint32_t hash = trigram_hash(trigram);
+      bitmap[hash >> 6] |= std::uint64_t(1) << (hash & 63);
+    }
+  }
+}
+
+TrigramIndex::TrigramIndex() noexcept
+  : _ready(false)
+  , _cancelled(false)
+  , _finished(true)
+{}
+
+TrigramIndex::~TrigramIndex() noexcept
+{
+  this->_cancel();
+}
+
+void TrigramIndex::build(const PieceTableSnapshot& lines,
+                         const std::string& filepath,
+                         const uint8& tab_width,
+                         const bool& save) noexcept
+{
+  this->clear();
+
+  // saved index is valid for same contents of file, told by its size
+  // and modification time, and same expansion of tabs
+  std::error_code error;
+  const std::filesystem::path path(filepath);
+  const std::uintmax_t file_size = std::filesystem::file_size(path, error);
+  const std::filesystem::file_time_type file_time =
+    std::filesystem::last_write_time(path, error);
+  if(error)
+  {
+    WARN_BOII("Unable to index file: %s", filepath.c_str());
+    return;
+  }
+  const std::vector<std::int64_t> stamp = {
+    static_cast<std::int64_t>(file_size),
+    static_cast<std::int64_t>(file_time.time_since_epoch().count()),
+    tab_width};
+  const std::string index_path =
+    (path.parent_path() / ("." + path.filename().string() + ".trigrams"))
+      .string();
+
+  _cancelled = false;
+  _finished = false;
+  _thread = std::thread(
+    [this, lines, index_path, stamp, save]()
+    {
+      std::vector<Chunk> chunks;
+      if(!_load(index_path, stamp, lines.size(), chunks))
+      {
+        chunks.clear();
+        _index(lines, 0, lines.size(), chunks, &_cancelled);
+        if(!_cancelled && save && !_save(index_path, stamp, chunks))
+        {
+          WARN_BOII("Unable to save index: %s", index_path.c_str());
+        }
+      }
+      if(!_cancelled)
+      {
+        std::lock_guard<std::mutex> lock(_built_mutex);
+        _built_chunks = std::move(chunks);
+      }
+      _finished = true;
+    });
+}
+
+bool TrigramIndex::take_built_index() noexcept
+{
+  if(_ready || !_thread.joinable() || !_finished)
+  {
+    return false;
+  }
+
+  _thread.join();
+  {
+    std::lock_guard<std::mutex> lock(_built_mutex);
+    _chunks = std::move(_built_chunks);
+    _built_chunks.clear();
+  }
+  for(const std::tuple<uint32, uint32, uint32>& edit : _pending_edits)
+  {
+    this->_replace_lines(
+      std::get<0>(edit), std::get<1>(edit), std::get<2>(edit));
+  }
+  _pending_edits.clear();
+  _ready = true;
+  return true;
+}
+
+void TrigramIndex::clear() noexcept
+{
+  this->_cancel();
+  _chunks.clear();
+  _ready = false;
+  _pending_edits.clear();
+  std::lock_guard<std::mutex> lock(_built_mutex);
+  _built_chunks.clear();
+}
+
+bool TrigramIndex::ready() const noexcept
+{
+  return _ready;
+}
+
+void TrigramIndex::replace_lines(const uint32& row,
+                                 const uint32& count,
+                                 const uint32& new_count) noexcept
+{
+  if(_ready)
+  {
+    this->_replace_lines(row, count, new_count);
+  }
+  else if(_thread.joinable())
+  {
+    // index being built is of lines before edit
+    _pending_edits.emplace_back(row, count, new_count);
+  }
+}
+
+std::vector<std::pair<uint32, uint32>>
+TrigramIndex::candidate_rows(const PieceTableSnapshot& lines,
+                             const std::string& query) noexcept
+{
+  const std::vector<std::pair<uint32, uint32>> all_rows = {
+    {0, lines.size()}};
+  if(!_ready || query.size() < 3)
+  {
+    return all_rows;
+  }
+
+  uint32 rows = 0;
+  bool edited = false;
+  for(const Chunk& chunk : _chunks)
+  {
+    rows += chunk.rows;
+    edited = edited || chunk.trigrams.empty();
+  }
+  if(rows != lines.size()) [[unlikely]]
+  {
+    WARN_BOII("Trigram index doesn't match lines, dropping it!");
+    this->clear();
+    return all_rows;
+  }
+
+  // re-indexing edited chunks, large ones are split again
+  if(edited)
+  {
+    std::vector<Chunk> chunks;
+    chunks.reserve(_chunks.size());
+    uint32 row = 0;
+    for(Chunk& chunk : _chunks)
+    {
+      const uint32 chunk_rows = chunk.rows;
+      if(chunk.trigrams.empty())
+      {
+        _index(lines, row, row + chunk_rows, chunks, nullptr);
+      }
+      else
+      {
+        chunks.push_back(std::move(chunk));
+      }
+      row += chunk_rows;
+    }
+    _chunks = std::move(chunks);
+  }
+
+  std::vector<std::uint32_t> hashes;
+  std::uint32_t trigram = 0;
+  for(std::size_t i = 0; i < query.size(); i++)
+  {
+    trigram = (trigram << 8) | lower_ascii(query[i]);
+    if(i >= 2)
+    {
+      hashes.push_back(trigram_hash(trigram));
+    }
+  }
+
+  // chunks having all trigrams of query, adjacent ones joined
+  std::vector<std::pair<uint32, uint32>> ranges;
+  uint32 row = 0;
+  for(const Chunk& chunk : _chunks)
+  {
+    const bool candidate =
+      std::all_of(hashes.begin(),
+                  hashes.end(),
+                  [&chunk](const std::uint32_t& hash)
+                  {
+                    return (chunk.trigrams[hash >> 6] >> (hash & 63)) & 1;
+                  });
+    if(candidate)
+    {
+      if(!ranges.empty() && ranges.back().second == row)
+      {
+        ranges.back().second += chunk.rows;
+      }
+      else
+      {
+        ranges.emplace_back(row, row + chunk.rows);
+      }
+    }
+    row += chunk.rows;
+  }
+  return ranges;
+}
+
+void TrigramIndex::_cancel() noexcept
+{
+  _cancelled = true;
+  if(_thread.joinable())
+  {
+    _thread.join();
+  }
+  _finished = true;
+}
+
+void TrigramIndex::_replace_lines(const uint32& row,
+                                  const uint32& count,
+                                  const uint32& new_count) noexcept
+{
+  if(_chunks.empty())
+  {
+    if(new_count != 0)
+    {
+      _chunks.push_back(Chunk{new_count, {}});
+    }
+    return;
+  }
+
+  // chunk of first replaced line, lines appended at end go to last chunk
+  std::size_t first = 0;
+  uint32 first_row = 0;
+  while(first + 1 < _chunks.size() && first_row + _chunks[first].rows <= row)
+  {
+    first_row += _chunks[first].rows;
+    first++;
+  }
+  // chunks till the last replaced line are merged
+  std::size_t last = first;
+  uint32 end_row = first_row + _chunks[first].rows;
+  while(last + 1 < _chunks.size() && end_row < row + count)
+  {
+    last++;
+    end_row += _chunks[last].rows;
+  }
+
+  const uint32 rows =
+    end_row - first_row - std::min(count, end_row - first_row) + new_count;
+  _chunks[first] = Chunk{rows, {}};
+  _chunks.erase(_chunks.begin() + first + 1, _chunks.begin() + last + 1);
+  if(rows == 0)
+  {
+    _chunks.erase(_chunks.begin() + first);
+  }
+}
+
+void TrigramIndex::_index(const PieceTableSnapshot& lines,
+                          const uint32& first_row,
+                          const uint32& last_row,
+                          std::vector<Chunk>& chunks,
+                          const std::atomic<bool>* cancelled) noexcept
+{
+  Chunk chunk = {0, std::vector<std::uint64_t>(bitmap_words)};
+  std::size_t bytes = 0;
+  uint32 row = first_row;
+  while(row < last_row)
+  {
+    if(cancelled && *cancelled)
+    {
+      return;
+    }
+
+    std::span<const Piece> pieces = lines.pieces_from(row);
+    pieces = pieces.first(std::min<std::size_t>(pieces.size(), last_row - row));
+    for(const Piece& piece : pieces)
+    {
+      add_trigrams(std::string_view(piece.data, piece.length),
+                   chunk.trigrams.data());
+      chunk.rows++;
+      bytes += piece.length + 1;
+      if(bytes >= chunk_bytes)
+      {
+        chunks.push_back(std::move(chunk));
+        chunk = Chunk{0, std::vector<std::uint64_t>(bitmap_words)};
+        bytes = 0;
+      }
+    }
+    row += pieces.size();
+  }
+  if(chunk.rows != 0)
+  {
+    chunks.push_back(std::move(chunk));
+  }
+}
+
+bool TrigramIndex::_load(const std::string& path,
+                         const std::vector<std::int64_t>& stamp,
+                         const uint32& rows,
+                         std::vector<Chunk>& chunks) noexcept
+{
+  std::ifstream file(path, std::ios::binary);
+  if(!file.is_open())
+  {
+    return false;
+  }
+
+  char magic[sizeof(index_magic)] = {};
+  std::vector<std::int64_t> saved_stamp(stamp.size());
+  std::uint64_t saved_rows = 0, chunks_count = 0;
+  file.read(magic, sizeof(magic));
+  file.read(reinterpret_cast<char*>(saved_stamp.data()),
+            saved_stamp.size() * sizeof(std::int64_t));
+  file.read(reinterpret_cast<char*>(&saved_rows), sizeof(saved_rows));
+  file.read(reinterpret_cast<char*>(&chunks_count), sizeof(chunks_count));
+  if(!file || !std::equal(magic, magic + sizeof(magic), index_magic) ||
+     saved_stamp != stamp || saved_rows != rows || chunks_count > rows)
+  {
+    return false;
+  }
+
+  uint32 chunks_rows = 0;
+  chunks.reserve(chunks_count);
+  for(std::uint64_t i = 0; i < chunks_count; i++)
+  {
+    std::uint32_t chunk_rows = 0;
+    Chunk chunk = {0, std::vector<std::uint64_t>(bitmap_words)};
+    file.read(reinterpret_cast<char*>(&chunk_rows), sizeof(chunk_rows));
+    file.read(reinterpret_cast<char*>(chunk.trigrams.data()),
+              bitmap_words * sizeof(std::uint64_t));
+    if(!file || chunk_rows == 0)
+    {
+      return false;
+    }
+    chunk.rows = chunk_rows;
+    chunks_rows += chunk.rows;
+    chunks.push_back(std::move(chunk));
+  }
+  return chunks_rows == rows;
+}
+
+bool TrigramIndex::_save(const std::string& path,
+                         const std::vector<std::int64_t>& stamp,
+                         const std::vector<Chunk>& chunks) noexcept
+{
+  // written to a temporary file first, so an interrupted save
+  // doesn't leave a broken index
+  const std::string temporary_path = path + ".tmp";
+  {
+    std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+    if(!file.is_open())
+    {
+      return false;
+    }
+
+    std::uint64_t rows = 0;
+    for(const Chunk& chunk : chunks)
+    {
+      rows += chunk.rows;
+    }
+    const std::uint64_t chunks_count = chunks.size();
+    file.write(index_magic, sizeof(index_magic));
+    file.write(reinterpret_cast<const char*>(stamp.data()),
+               stamp.size() * sizeof(std::int64_t));
+    file.write(reinterpret_cast<const char*>(&rows), sizeof(rows));
+    file.write(reinterpret_cast<const char*>(&chunks_count),
+               sizeof(chunks_count));
+    for(const Chunk& chunk : chunks)
+    {
+      const std::uint32_t chunk_rows = static_cast<std::uint32_t>(chunk.rows);
+      file.write(reinterpret_cast<const char*>(&chunk_rows),
+                 sizeof(chunk_rows));
+      file.write(reinterpret_cast<const char*>(chunk.trigrams.data()),
+                 bitmap_words * sizeof(std::uint64_t));
+    }
+    if(!file)
+    {
+      file.close();
+      std::error_code error;
+      std::filesystem::remove(temporary_path, error);
+      return false;
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::rename(temporary_path, path, error);
+  return !error;
+}
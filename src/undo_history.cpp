@@ -0,0 +1,242 @@
+#include "../include/undo_history.hpp"
+#include <algorithm>
+#include "../include/config_manager.hpp"
+
+/// @brief Tells if character is part of a word.
+/// @throws No exceptions.
+static bool is_word_character(const char& character) noexcept
+{
+  return !ConfigManager::get_instance()
+            ->get_config_struct()
+            .word_classes.separator[static_cast<unsigned char>(character)];
+}
+
+UndoHistory::UndoHistory() noexcept
+  : _position(0)
+  , _memory_usage(0)
+  , _coalescing(false)
+{}
+
+void UndoHistory::record(EditDelta&& delta) noexcept
+{
+  // edits which were undone can't be redone after a new edit
+  while(_entries.size() > _position)
+  {
+    _memory_usage -= _cost(_entries.back());
+    _entries.pop_back();
+  }
+
+  if(_coalescing && this->_coalesce(delta))
+  {
+    return;
+  }
+
+  _memory_usage += _cost(delta);
+  _entries.push_back(std::move(delta));
+  _position = _entries.size();
+  _coalescing = true;
+  this->_compact();
+}
+
+const EditDelta* UndoHistory::undo() noexcept
+{
+  _coalescing = false;
+  if(_position == 0)
+  {
+    return nullptr;
+  }
+
+  _position--;
+  return &_entries[_position];
+}
+
+const EditDelta* UndoHistory::redo() noexcept
+{
+  _coalescing = false;
+  if(_position == _entries.size())
+  {
+    return nullptr;
+  }
+
+  _position++;
+  return &_entries[_position - 1];
+}
+
+void UndoHistory::break_coalescing() noexcept
+{
+  _coalescing = false;
+}
+
+void UndoHistory::clear() noexcept
+{
+  _entries.clear();
+  _position = 0;
+  _memory_usage = 0;
+  _coalescing = false;
+}
+
+std::size_t UndoHistory::memory_usage() const noexcept
+{
+  return _memory_usage;
+}
+
+void UndoHistory::collect_pieces(std::vector<Piece*>& pieces) noexcept
+{
+  for(EditDelta& entry : _entries)
+  {
+    for(Piece& piece : entry.old_lines)
+    {
+      pieces.push_back(&piece);
+    }
+    for(Piece& piece : entry.new_lines)
+    {
+      pieces.push_back(&piece);
+    }
+  }
+}
+
+bool UndoHistory::_coalesce(const EditDelta& delta) noexcept
+{
+  if(_entries.empty())
+  {
+    return false;
+  }
+
+  EditDelta& last = _entries.back();
+  if(delta.kind == EditKind::OTHER || delta.kind != last.kind ||
+     delta.row != last.row || delta.cursor_before != last.cursor_after ||
+     delta.old_lines.size() != 1 || delta.new_lines.size() != 1 ||
+     last.old_lines.size() != 1 || last.new_lines.size() != 1)
+  {
+    return false;
+  }
+
+  // a word and the separators typed (or deleted) after it form a group,
+  // next group starts when a word character follows a separator
+  if(delta.kind == EditKind::INSERT_CHARACTERS)
+  {
+    const char last_inserted =
+      last.new_lines[0].data[last.cursor_after.second];
+    const char inserted =
+      delta.new_lines[0].data[delta.cursor_before.second + 1];
+    if(!is_word_character(last_inserted) && is_word_character(inserted))
+    {
+      return false;
+    }
+  }
+  else
+  {
+    const char last_deleted =
+      last.old_lines[0].data[last.cursor_after.second + 1];
+    const char deleted = delta.old_lines[0].data[delta.cursor_after.second + 1];
+    if(!is_word_character(last_deleted) && is_word_character(deleted))
+    {
+      return false;
+    }
+  }
+
+  last.new_lines[0] = delta.new_lines[0];
+  last.cursor_after = delta.cursor_after;
+  return true;
+}
+
+void UndoHistory::_compact() noexcept
+{
+  const std::size_t memory_limit =
+    static_cast<std::size_t>(
+      ConfigManager::get_instance()->get_config_struct().undo.memory_limit) *
+    1024 * 1024;
+
+  while(_memory_usage > memory_limit && _entries.size() > 1)
+  {
+    const EditDelta& first = _entries[0];
+    const EditDelta& second = _entries[1];
+    _memory_usage -= _cost(first) + _cost(second);
+    if(second.row <= first.row + first.new_lines.size() &&
+       first.row <= second.row + second.old_lines.size())
+    {
+      EditDelta composed = _compose(first, second);
+      _memory_usage += _cost(composed);
+      _entries.pop_front();
+      _entries.front() = std::move(composed);
+    }
+    else
+    {
+      _memory_usage += _cost(second);
+      _entries.pop_front();
+    }
+    _position--;
+  }
+}
+
+EditDelta UndoHistory::_compose(const EditDelta& first,
+                                const EditDelta& second) noexcept
+{
+  // rows are in coordinates of text after first edit,
+  // where lines [first_begin, first_end) are produced by first edit
+  // and lines [second_begin, second_end) are replaced by second edit
+  const std::size_t first_begin = first.row;
+  const std::size_t first_end = first.row + first.new_lines.size();
+  const std::size_t second_begin = second.row;
+  const std::size_t second_end = second.row + second.old_lines.size();
+  const std::size_t begin = std::min(first_begin, second_begin);
+  const std::size_t end = std::max(first_end, second_end);
+
+  EditDelta composed;
+  composed.row = begin;
+  composed.cursor_before = first.cursor_before;
+  composed.cursor_after = second.cursor_after;
+  composed.kind = EditKind::OTHER;
+
+  // lines before composed edit: lines replaced by first edit, surrounded by
+  // lines replaced by second edit which weren't produced by first edit
+  composed.old_lines.reserve(first.old_lines.size() + end - first_end +
+                             first_begin - begin);
+  composed.old_lines.insert(composed.old_lines.end(),
+                            second.old_lines.begin(),
+                            second.old_lines.begin() + (first_begin - begin));
+  composed.old_lines.insert(composed.old_lines.end(),
+                            first.old_lines.begin(),
+                            first.old_lines.end());
+  if(second_end > first_end)
+  {
+    composed.old_lines.insert(composed.old_lines.end(),
+                              second.old_lines.end() - (second_end - first_end),
+                              second.old_lines.end());
+  }
+
+  // lines after composed edit: lines produced by second edit, surrounded by
+  // lines produced by first edit which weren't replaced by second edit
+  composed.new_lines.reserve(second.new_lines.size() + end - second_end +
+                             second_begin - begin);
+  composed.new_lines.insert(composed.new_lines.end(),
+                            first.new_lines.begin(),
+                            first.new_lines.begin() + (second_begin - begin));
+  composed.new_lines.insert(composed.new_lines.end(),
+                            second.new_lines.begin(),
+                            second.new_lines.end());
+  if(first_end > second_end)
+  {
+    composed.new_lines.insert(composed.new_lines.end(),
+                              first.new_lines.end() - (first_end - second_end),
+                              first.new_lines.end());
+  }
+  return composed;
+}
+
+std::size_t UndoHistory::_cost(const EditDelta& delta) noexcept
+{
+  std::size_t cost =
+    sizeof(EditDelta) +
+    (delta.old_lines.size() + delta.new_lines.size()) * sizeof(Piece);
+  // text shared between entries is counted by each of them
+  for(const Piece& piece : delta.old_lines)
+  {
+    cost += piece.length;
+  }
+  for(const Piece& piece : delta.new_lines)
+  {
+    cost += piece.length;
+  }
+  return cost;
+}
@@ -1,6 +1,9 @@
 #include "../include/utils.hpp"
+#include <algorithm>
+#include <cctype>
 #include "../include/cairo_context.hpp"
 #include "../include/config_manager.hpp"
+#include "../include/line_layout.hpp"
 #include "../include/rocket_render.hpp"
 
 [[nodiscard]] SDL_Color
@@ -100,11 +103,136 @@ bool animator(float32* animatable, const float32* target) noexcept
   return true;
 }
 
+bool scroll_to_cursor(const Buffer& buffer,
+                      const float32& line_height,
+                      const float32& window_height,
+                      float32* scroll_y_offset,
+                      float32* scroll_y_target) noexcept
+{
+  std::pair<uint32, int32> cursor_coords = buffer.cursor_coords();
+  float32 effective_cursor_y =
+    *scroll_y_offset + static_cast<int32>(cursor_coords.first) * line_height;
+  if(effective_cursor_y < 0)
+  {
+    *scroll_y_target = *scroll_y_offset =
+      -static_cast<int32>(cursor_coords.first) * line_height;
+    return true;
+  }
+  if(effective_cursor_y + line_height > window_height)
+  {
+    *scroll_y_offset -= effective_cursor_y + line_height - window_height;
+    *scroll_y_target = *scroll_y_offset;
+    return true;
+  }
+  return false;
+}
+
+std::string complete_identifier(const Buffer& buffer,
+                                const IdentifierIndex& identifiers,
+                                const std::size_t& max_count,
+                                std::vector<std::string>& completions) noexcept
+{
+  completions.clear();
+  const std::pair<uint32, int32> cursor_coords = buffer.cursor_coords();
+  const std::string_view line =
+    buffer.line(cursor_coords.first).value_or("").substr(
+      0, cursor_coords.second + 1);
+
+  // identifier is letters, digits and '_', not starting with digit
+  std::size_t start = line.size();
+  while(start > 0 &&
+        (std::isalnum(static_cast<unsigned char>(line[start - 1])) ||
+         line[start - 1] == '_'))
+  {
+    start--;
+  }
+  while(start < line.size() &&
+        std::isdigit(static_cast<unsigned char>(line[start])))
+  {
+    start++;
+  }
+
+  const std::string_view identifier = line.substr(start);
+  if(identifier.size() >= 2)
+  {
+    identifiers.complete(identifier, max_count, completions);
+  }
+  return std::string(identifier);
+}
+
+std::optional<std::string>
+identifier_at_cursor(const Buffer& buffer,
+                     const CppTokenizerCache& tokenizer_cache) noexcept
+{
+  // cursor is after byte at its column
+  const std::pair<uint32, int32> cursor_coords = buffer.cursor_coords();
+  std::optional<std::string> identifier = tokenizer_cache.identifier_at(
+    cursor_coords.first, static_cast<uint32>(cursor_coords.second + 1));
+  if(!identifier && cursor_coords.second >= 0)
+  {
+    identifier = tokenizer_cache.identifier_at(
+      cursor_coords.first, static_cast<uint32>(cursor_coords.second));
+  }
+  return identifier;
+}
+
+std::optional<std::pair<std::pair<uint32, uint32>, std::pair<uint32, uint32>>>
+bracket_pair_at_cursor(const Buffer& buffer,
+                       CppTokenizerCache& tokenizer_cache,
+                       const uint32& last_row) noexcept
+{
+  // cursor is after byte at its column
+  const std::pair<uint32, int32> cursor_coords = buffer.cursor_coords();
+  for(const int32& column : {cursor_coords.second + 1, cursor_coords.second})
+  {
+    if(column < 0)
+    {
+      continue;
+    }
+    const std::optional<std::pair<uint32, uint32>> match =
+      tokenizer_cache.matching_bracket(
+        buffer, cursor_coords.first, static_cast<uint32>(column), last_row);
+    if(match)
+    {
+      return std::pair(
+        std::pair(cursor_coords.first, static_cast<uint32>(column)),
+        match.value());
+    }
+  }
+  return std::nullopt;
+}
+
+/// @brief Gives colour of bracket at nesting depth.
+/// @param token_color colour of bracket's token type.
+/// @param depth nesting depth, inside an opening bracket (or the one
+///              closed by a closing bracket).
+/// @return Returns token_color if bracket colours are disabled.
+/// @throws No exceptions.
+static const std::string& bracket_color(const std::string& token_color,
+                                        const int32& depth) noexcept
+{
+  const std::vector<std::string>& colors =
+    ConfigManager::get_instance()->get_config_struct().bracket_colors.colors;
+  if(!ConfigManager::get_instance()
+         ->get_config_struct()
+         .bracket_colors.enabled ||
+     colors.empty())
+  {
+    return token_color;
+  }
+  // depth is negative after closing brackets without opening ones, colours
+  // keep cycling below 0 so brackets after them stay coloured
+  const int32 count = colors.size();
+  return colors[((depth % count) + count) % count];
+}
+
 void render_tokens(int32 x,
                    int32 y,
                    const std::vector<CppTokenizer::Token>& tokens,
+                   const std::string& text,
                    const Buffer& buffer,
                    const uint32& line_index,
+                   const int32& bracket_depth,
                    const cairo_font_extents_t& font_extents) noexcept
 {
   if(tokens.empty())
@@ -128,10 +256,16 @@ void render_tokens(int32 x,
     return;
   }
 
+  int32 depth = bracket_depth;
   for(uint32 i = 0; i < tokens.size(); i++)
   {
-    CppTokenizer::Token token = tokens[i];
-    if(token.value == "\r")
+    const CppTokenizer::Token& token = tokens[i];
+    const std::string_view value = token.value(text);
+    // brackets of a pair get colour of depth inside them
+    const int32 depth_change = bracket_depth_change(token);
+    const int32 pair_depth = std::min(depth, depth + depth_change);
+    depth += depth_change;
+    if(value == "\r")
     {
       uint8 indent_count =
         buffer.line_tab_indent_count_to_show(line_index).value();
@@ -185,7 +319,7 @@ void render_tokens(int32 x,
     {
       RocketRender::text(x,
                          y,
-                         token.value,
+                         value,
                          hexcode_to_SDL_Color(ConfigManager::get_instance()
                                                 ->get_config_struct()
                                                 .cpp_token_colors.semicolon));
@@ -195,7 +329,7 @@ void render_tokens(int32 x,
     {
       RocketRender::text(x,
                          y,
-                         token.value,
+                         value,
                          hexcode_to_SDL_Color(ConfigManager::get_instance()
                                                 ->get_config_struct()
                                                 .cpp_token_colors.comma));
@@ -206,7 +340,7 @@ void render_tokens(int32 x,
       RocketRender::text(
         x,
         y,
-        token.value,
+        value,
         hexcode_to_SDL_Color(ConfigManager::get_instance()
                                ->get_config_struct()
                                .cpp_token_colors.escape_backslash));
@@ -215,12 +349,14 @@ void render_tokens(int32 x,
     else if(token.type == CppTokenizer::TokenType::BRACKET_OPEN ||
             token.type == CppTokenizer::TokenType::BRACKET_CLOSE)
     {
-      RocketRender::text(x,
-                         y,
-                         token.value,
-                         hexcode_to_SDL_Color(ConfigManager::get_instance()
-                                                ->get_config_struct()
-                                                .cpp_token_colors.bracket));
+      RocketRender::text(
+        x,
+        y,
+        value,
+        hexcode_to_SDL_Color(bracket_color(ConfigManager::get_instance()
+                                             ->get_config_struct()
+                                             .cpp_token_colors.bracket,
+                                           pair_depth)));
       x += font_extents.max_x_advance;
     }
     else if(token.type == CppTokenizer::TokenType::SQUARE_BRACKET_OPEN ||
@@ -229,10 +365,11 @@ void render_tokens(int32 x,
       RocketRender::text(
         x,
         y,
-        token.value,
-        hexcode_to_SDL_Color(ConfigManager::get_instance()
-                               ->get_config_struct()
-                               .cpp_token_colors.square_bracket));
+        value,
+        hexcode_to_SDL_Color(bracket_color(ConfigManager::get_instance()
+                                             ->get_config_struct()
+                                             .cpp_token_colors.square_bracket,
+                                           pair_depth)));
       x += font_extents.max_x_advance;
     }
     else if(token.type == CppTokenizer::TokenType::CURLY_BRACE_OPEN ||
@@ -241,49 +378,50 @@ void render_tokens(int32 x,
       RocketRender::text(
         x,
         y,
-        token.value,
-        hexcode_to_SDL_Color(ConfigManager::get_instance()
-                               ->get_config_struct()
-                               .cpp_token_colors.curly_bracket));
+        value,
+        hexcode_to_SDL_Color(bracket_color(ConfigManager::get_instance()
+                                             ->get_config_struct()
+                                             .cpp_token_colors.curly_bracket,
+                                           pair_depth)));
       x += font_extents.max_x_advance;
     }
     else if(token.type == CppTokenizer::TokenType::CHARACTER)
     {
       RocketRender::text(x,
                          y,
-                         token.value,
+                         value,
                          hexcode_to_SDL_Color(ConfigManager::get_instance()
                                                 ->get_config_struct()
                                                 .cpp_token_colors.character));
-      x += token.value.size() * font_extents.max_x_advance;
+      x += LineLayout::width_of(value) * font_extents.max_x_advance;
     }
     else if(token.type == CppTokenizer::TokenType::STRING)
     {
       RocketRender::text(x,
                          y,
-                         token.value,
+                         value,
                          hexcode_to_SDL_Color(ConfigManager::get_instance()
                                                 ->get_config_struct()
                                                 .cpp_token_colors.string));
-      x += token.value.size() * font_extents.max_x_advance;
+      x += LineLayout::width_of(value) * font_extents.max_x_advance;
     }
     else if(token.type == CppTokenizer::TokenType::COMMENT)
     {
       RocketRender::text(x,
                          y,
-                         token.value,
+                         value,
                          hexcode_to_SDL_Color(ConfigManager::get_instance()
                                                 ->get_config_struct()
                                                 .cpp_token_colors.comment));
-      x += token.value.size() * font_extents.max_x_advance;
+      x += LineLayout::width_of(value) * font_extents.max_x_advance;
     }
     else if(token.type == CppTokenizer::TokenType::MULTILINE_COMMENT ||
             token.type == CppTokenizer::TokenType::MULTILINE_COMMENT_INCOMPLETE)
     {
-      std::string trimmed_token = token.value;
-      if(trimmed_token.back() == '\n')
+      std::string_view trimmed_token = value;
+      if(!trimmed_token.empty() && trimmed_token.back() == '\n')
       {
-        trimmed_token.pop_back();
+        trimmed_token.remove_suffix(1);
       }
       RocketRender::text(x,
                          y,
@@ -291,78 +429,78 @@ void render_tokens(int32 x,
                          hexcode_to_SDL_Color(ConfigManager::get_instance()
                                                 ->get_config_struct()
                                                 .cpp_token_colors.comment));
-      x += trimmed_token.size() * font_extents.max_x_advance;
+      x += LineLayout::width_of(trimmed_token) * font_extents.max_x_advance;
     }
     else if(token.type == CppTokenizer::TokenType::OPERATOR)
     {
       RocketRender::text(x,
                          y,
-                         token.value,
+                         value,
                          hexcode_to_SDL_Color(ConfigManager::get_instance()
                                                 ->get_config_struct()
                                                 .cpp_token_colors.operator_));
-      x += token.value.size() * font_extents.max_x_advance;
+      x += LineLayout::width_of(value) * font_extents.max_x_advance;
     }
     else if(token.type == CppTokenizer::TokenType::KEYWORD)
     {
       RocketRender::text(x,
                          y,
-                         token.value,
+                         value,
                          hexcode_to_SDL_Color(ConfigManager::get_instance()
                                                 ->get_config_struct()
                                                 .cpp_token_colors.keyword));
-      x += token.value.size() * font_extents.max_x_advance;
+      x += LineLayout::width_of(value) * font_extents.max_x_advance;
     }
     else if(token.type == CppTokenizer::TokenType::PREPROCESSOR_DIRECTIVE)
     {
       RocketRender::text(
         x,
         y,
-        token.value,
+        value,
         hexcode_to_SDL_Color(ConfigManager::get_instance()
                                ->get_config_struct()
                                .cpp_token_colors.preprocessor_directive));
-      x += token.value.size() * font_extents.max_x_advance;
+      x += LineLayout::width_of(value) * font_extents.max_x_advance;
     }
     else if(token.type == CppTokenizer::TokenType::IDENTIFIER)
     {
       RocketRender::text(x,
                          y,
-                         token.value,
+                         value,
                          hexcode_to_SDL_Color(ConfigManager::get_instance()
                                                 ->get_config_struct()
                                                 .cpp_token_colors.identifier));
-      x += token.value.size() * font_extents.max_x_advance;
+      x += LineLayout::width_of(value) * font_extents.max_x_advance;
     }
     else if(token.type == CppTokenizer::TokenType::NUMBER)
     {
       RocketRender::text(x,
                          y,
-                         token.value,
+                         value,
                          hexcode_to_SDL_Color(ConfigManager::get_instance()
                                                 ->get_config_struct()
                                                 .cpp_token_colors.number));
-      x += token.value.size() * font_extents.max_x_advance;
+      x += LineLayout::width_of(value) * font_extents.max_x_advance;
     }
     else if(token.type == CppTokenizer::TokenType::FUNCTION)
     {
       RocketRender::text(x,
                          y,
-                         token.value,
+                         value,
                          hexcode_to_SDL_Color(ConfigManager::get_instance()
                                                 ->get_config_struct()
                                                 .cpp_token_colors.function));
-      x += token.value.size() * font_extents.max_x_advance;
+      x += LineLayout::width_of(value) * font_extents.max_x_advance;
     }
     else if(token.type == CppTokenizer::TokenType::HEADER)
     {
       RocketRender::text(x,
                          y,
-                         token.value,
+                         value,
                          hexcode_to_SDL_Color(ConfigManager::get_instance()
                                                 ->get_config_struct()
                                                 .cpp_token_colors.header));
-      x += token.value.size() * font_extents.max_x_advance;
+      x += LineLayout::width_of(value) * font_extents.max_x_advance;
     }
   }
 }
@@ -386,27 +524,24 @@ mouse_coords_to_buffer_coords(const int& x,
     return std::make_pair(row, static_cast<int32>(-1));
   }
 
-  int32 column = -1;
+  uint32 cells = 0;
   float32 max_x_advance =
     CairoContext::get_instance()->get_font_extents().max_x_advance;
 
-  // finding best column based on grid
+  // finding best cell based on grid
   int32 left_grid_column = (x - x_offset) / max_x_advance;
   int32 right_grid_column = left_grid_column + 1;
   if(x - x_offset - max_x_advance * left_grid_column <
      max_x_advance * right_grid_column - x + x_offset)
   {
-    column = left_grid_column - 1;
+    cells = left_grid_column;
   }
   else
   {
-    column = right_grid_column - 1;
-  }
-
-  if(column > static_cast<int32>(buffer.line_length(row).value()) - 1)
-  {
-    column = static_cast<int32>(buffer.line_length(row).value()) - 1;
+    cells = right_grid_column;
   }
 
-  return std::make_pair(row, column);
+  // wide characters take two cells, layout maps cells to column
+  // and clamps it to end of line
+  return std::make_pair(row, buffer.line_layout(row).column_at(cells));
 }
@@ -0,0 +1,192 @@
+#include "../include/word_classes.hpp"
+#include <bit>
+
+#if defined(__AVX2__)
+#  include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#  include <emmintrin.h>
+#endif
+
+/// Bytes classified at once.
+static constexpr std::size_t block_size = 32;
+
+/// @brief Finds separators in a block of bytes. Only called when non ASCII
+///        bytes are of the same class.
+/// @param block pointer to block_size bytes.
+/// @param classes classes of bytes.
+/// @return Returns bitmask of separators, bit i for byte i.
+/// @throws No exceptions.
+static inline std::uint32_t separators_in_block(
+  const char* block, const WordClasses& classes) noexcept
+{
+#if defined(__AVX2__)
+  // separator bits of low nibble, tested with bit of high nibble,
+  // high nibbles of non ASCII bytes select no bit
+  const __m256i bytes =
+    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+  const __m256i nibble_mask = _mm256_set1_epi8(0x0F);
+  const __m256i rows = _mm256_shuffle_epi8(
+    _mm256_broadcastsi128_si256(_mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(classes.ascii_separator_bits.data()))),
+    _mm256_and_si256(bytes, nibble_mask));
+  const __m256i bits = _mm256_shuffle_epi8(
+    _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0,
+                     1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0),
+    _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibble_mask));
+  const std::uint32_t words =
+    static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(
+      _mm256_and_si256(rows, bits), _mm256_setzero_si256())));
+  const std::uint32_t non_ascii =
+    static_cast<std::uint32_t>(_mm256_movemask_epi8(bytes));
+  return (~words & ~non_ascii) |
+         (classes.non_ascii_separator ? non_ascii : 0);
+#else
+#  if defined(__SSE2__) || defined(_M_X64)
+  // without byte shuffles, separators are tested run by run, a byte is in
+  // a run if its distance from the start (wrapping) is at most the span,
+  // non ASCII bytes are never in a run
+  if(classes.separator_runs <= max_separator_runs)
+  {
+    const __m128i low_bytes =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+    const __m128i high_bytes =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16));
+    __m128i low_in_runs = _mm_setzero_si128();
+    __m128i high_in_runs = _mm_setzero_si128();
+    for(std::size_t run = 0; run < classes.separator_runs; run++)
+    {
+      const __m128i start = _mm_loadu_si128(reinterpret_cast<const __m128i*>(
+        classes.separator_run_starts[run].data()));
+      const __m128i span = _mm_loadu_si128(reinterpret_cast<const __m128i*>(
+        classes.separator_run_spans[run].data()));
+      const __m128i low_distances = _mm_sub_epi8(low_bytes, start);
+      const __m128i high_distances = _mm_sub_epi8(high_bytes, start);
+      low_in_runs = _mm_or_si128(
+        low_in_runs,
+        _mm_cmpeq_epi8(_mm_min_epu8(low_distances, span), low_distances));
+      high_in_runs = _mm_or_si128(
+        high_in_runs,
+        _mm_cmpeq_epi8(_mm_min_epu8(high_distances, span), high_distances));
+    }
+    const std::uint32_t separators =
+      static_cast<std::uint32_t>(_mm_movemask_epi8(low_in_runs)) |
+      static_cast<std::uint32_t>(_mm_movemask_epi8(high_in_runs)) << 16;
+    const std::uint32_t non_ascii =
+      static_cast<std::uint32_t>(_mm_movemask_epi8(low_bytes)) |
+      static_cast<std::uint32_t>(_mm_movemask_epi8(high_bytes)) << 16;
+    return separators | (classes.non_ascii_separator ? non_ascii : 0);
+  }
+#  endif
+
+  std::uint32_t separators = 0;
+  for(std::size_t i = 0; i < block_size; i++)
+  {
+    separators |=
+      static_cast<std::uint32_t>(
+        classes.separator[static_cast<unsigned char>(block[i])])
+      << i;
+  }
+  return separators;
+#endif
+}
+
+WordClasses build_word_classes(std::string_view separators) noexcept
+{
+  WordClasses classes{};
+  for(const char& separator : separators)
+  {
+    const unsigned char byte = static_cast<unsigned char>(separator);
+    classes.separator[byte] = true;
+    if(byte < 0x80)
+    {
+      classes.ascii_separator_bits[byte & 0xF] |=
+        static_cast<std::uint8_t>(1 << (byte >> 4));
+    }
+  }
+
+  for(std::size_t byte = 0; byte < 0x80; byte++)
+  {
+    if(!classes.separator[byte])
+    {
+      continue;
+    }
+    if(byte > 0 && classes.separator[byte - 1])
+    {
+      if(classes.separator_runs <= max_separator_runs)
+      {
+        for(std::uint8_t& span :
+            classes.separator_run_spans[classes.separator_runs - 1])
+        {
+          span++;
+        }
+      }
+      continue;
+    }
+    if(classes.separator_runs < max_separator_runs)
+    {
+      classes.separator_run_starts[classes.separator_runs].fill(
+        static_cast<std::uint8_t>(byte));
+    }
+    classes.separator_runs++;
+  }
+
+  classes.non_ascii_separator = classes.separator[0x80];
+  classes.uniform_non_ascii = true;
+  for(std::size_t byte = 0x80; byte < 0x100; byte++)
+  {
+    classes.uniform_non_ascii = classes.uniform_non_ascii &&
+                                classes.separator[byte] ==
+                                  classes.non_ascii_separator;
+  }
+  return classes;
+}
+
+std::size_t word_end(const WordClasses& classes,
+                     std::string_view text,
+                     std::size_t position) noexcept
+{
+  if(classes.uniform_non_ascii)
+  {
+    for(; position + block_size <= text.size(); position += block_size)
+    {
+      const std::uint32_t separators =
+        separators_in_block(text.data() + position, classes);
+      if(separators != 0)
+      {
+        return position + std::countr_zero(separators);
+      }
+    }
+  }
+
+  while(position < text.size() &&
+        !classes.separator[static_cast<unsigned char>(text[position])])
+  {
+    position++;
+  }
+  return position;
+}
+
+std::size_t word_start(const WordClasses& classes,
+                       std::string_view text,
+                       std::size_t position) noexcept
+{
+  if(classes.uniform_non_ascii)
+  {
+    for(; position >= block_size; position -= block_size)
+    {
+      const std::uint32_t separators =
+        separators_in_block(text.data() + position - block_size, classes);
+      if(separators != 0)
+      {
+        return position - std::countl_zero(separators);
+      }
+    }
+  }
+
+  while(position > 0 &&
+        !classes.separator[static_cast<unsigned char>(text[position - 1])])
+  {
+    position--;
+  }
+  return position;
+}
@@ -0,0 +1,311 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include "../include/buffer.hpp"
+#include "../include/config_manager.hpp"
+#include "../include/incremental_render_update.hpp"
+#include "../include/line_indexer.hpp"
+
+/// @brief Counts failed checks.
+static int failures = 0;
+
+/// @brief Reports failed check.
+/// @param passed result of check.
+/// @param what description of check.
+static void check(const bool& passed, const char* what) noexcept
+{
+  if(!passed)
+  {
+    std::printf("FAILED: %s\n", what);
+    failures++;
+  }
+}
+
+/// @brief Splits text into lines one byte at a time, dropping CR of CRLF
+///        line endings and expanding tabs.
+static std::vector<std::string> split_lines(const std::string& text,
+                                            const uint8& tab_width,
+                                            std::size_t& crlf_line_endings,
+                                            std::size_t& lf_line_endings)
+{
+  std::vector<std::string> lines;
+  std::string line;
+  for(const char& c : text)
+  {
+    if(c == '\n')
+    {
+      if(!line.empty() && line.back() == '\r')
+      {
+        line.pop_back();
+        crlf_line_endings++;
+      }
+      else
+      {
+        lf_line_endings++;
+      }
+      lines.push_back(line);
+      line.clear();
+    }
+    else if(c == '\t')
+    {
+      line.append(tab_width, ' ');
+    }
+    else
+    {
+      line.push_back(c);
+    }
+  }
+  lines.push_back(line);
+  return lines;
+}
+
+/// @brief Validates UTF-8 one code point at a time.
+static bool is_valid_utf8(const std::string& text) noexcept
+{
+  const unsigned char* bytes =
+    reinterpret_cast<const unsigned char*>(text.data());
+  std::size_t i = 0;
+  while(i < text.size())
+  {
+    const unsigned char lead = bytes[i];
+    if(lead < 0x80)
+    {
+      i++;
+      continue;
+    }
+    std::size_t length;
+    uint32 code_point;
+    if(lead >= 0xC2 && lead <= 0xDF)
+    {
+      length = 2;
+      code_point = lead & 0x1F;
+    }
+    else if(lead >= 0xE0 && lead <= 0xEF)
+    {
+      length = 3;
+      code_point = lead & 0x0F;
+    }
+    else if(lead >= 0xF0 && lead <= 0xF4)
+    {
+      length = 4;
+      code_point = lead & 0x07;
+    }
+    else
+    {
+      return false;
+    }
+    if(i + length > text.size())
+    {
+      return false;
+    }
+    for(std::size_t j = 1; j < length; j++)
+    {
+      if((bytes[i + j] & 0xC0) != 0x80)
+      {
+        return false;
+      }
+      code_point = (code_point << 6) | (bytes[i + j] & 0x3F);
+    }
+    if((length == 3 && code_point < 0x800) ||
+       (length == 4 && code_point < 0x10000) || code_point > 0x10FFFF ||
+       (code_point >= 0xD800 && code_point <= 0xDFFF))
+    {
+      return false;
+    }
+    i += length;
+  }
+  return true;
+}
+
+/// @brief Pieces of random text, with line endings, tabs, valid and
+///        invalid UTF-8, and runs longer than a SIMD block.
+static const std::vector<std::string> pieces = {
+  "a",
+  "b",
+  " ",
+  "\t",
+  "\n",
+  "\r\n",
+  "\r",
+  "\xc3\xa9",
+  "\xe2\x82\xac",
+  "\xf0\x9f\x98\x80",
+  "xyzxyzxyzxyzxyzxyzxyzxyzxyzxyzxyzxyz",
+  "\xff",
+  "\xc0\xaf",
+  "\xed\xa0\x80",
+  "\xe2\x82",
+  "\xf4\x90\x80\x80"};
+
+/// @brief Gives random text, with invalid UTF-8 when asked.
+static std::string random_text(std::mt19937& random,
+                               const std::size_t& length,
+                               const bool& invalid_utf8)
+{
+  const std::size_t piece_count = invalid_utf8 ? pieces.size() : 11;
+  std::string text;
+  for(std::size_t i = 0; i < length; i++)
+  {
+    text += pieces[random() % piece_count];
+  }
+  return text;
+}
+
+/// @brief Indexing random text in batches of random size gives the lines,
+///        line endings and UTF-8 validity of splitting it byte by byte.
+static void test_index_lines() noexcept
+{
+  std::mt19937 random(7);
+  for(int round = 0; round < 20000; round++)
+  {
+    const std::string text =
+      random_text(random, random() % 120, round % 3 == 0);
+    const uint8 tab_width = 1 + random() % 4;
+    std::size_t crlf_line_endings = 0;
+    std::size_t lf_line_endings = 0;
+    const std::vector<std::string> expected =
+      split_lines(text, tab_width, crlf_line_endings, lf_line_endings);
+
+    std::vector<std::string> lines;
+    std::size_t offset = 0;
+    std::size_t crlf_indexed = 0;
+    std::size_t lf_indexed = 0;
+    bool done = false;
+    while(!done)
+    {
+      LineBatch batch;
+      done = LineIndexer::index_lines(
+        text.data(), text.size(), offset, 1 + random() % 64, tab_width, batch);
+      for(const Piece& piece : batch.pieces)
+      {
+        lines.emplace_back(piece.data, piece.length);
+      }
+      crlf_indexed += batch.crlf_line_endings;
+      lf_indexed += batch.lf_line_endings;
+    }
+    check(lines == expected, "indexed lines equal split lines");
+    check(crlf_indexed == crlf_line_endings && lf_indexed == lf_line_endings,
+          "line endings are counted");
+
+    LineBatch whole;
+    offset = 0;
+    LineIndexer::index_lines(
+      text.data(), text.size(), offset, text.size() + 1, tab_width, whole);
+    check(whole.valid_utf8 == is_valid_utf8(text), "UTF-8 is validated");
+  }
+}
+
+/// @brief Writes text to a temporary file and loads it into buffer,
+///        waiting for lines loaded in background.
+static bool load_text(Buffer& buffer, const std::string& text) noexcept
+{
+  const std::filesystem::path path =
+    std::filesystem::temp_directory_path() / "line_indexer_test.txt";
+  {
+    std::ofstream file(path, std::ios::binary);
+    file << text;
+  }
+  const bool loaded = buffer.load_from_file(path.string());
+  while(buffer.is_loading())
+  {
+    buffer.append_background_loaded_lines();
+  }
+  while(buffer.get_next_token_cache_update_command())
+  {}
+  while(buffer.get_next_incremental_render_update_command())
+  {}
+  std::filesystem::remove(path);
+  return loaded;
+}
+
+/// @brief Copies lines of buffer.
+static std::vector<std::string> lines_of(const Buffer& buffer) noexcept
+{
+  std::vector<std::string> lines;
+  for(uint32 row = 0; row < buffer.length(); row++)
+  {
+    lines.emplace_back(buffer.line(row).value());
+  }
+  return lines;
+}
+
+/// @brief Small files, empty or not ending with a new line, are loaded
+///        with the lines of splitting them.
+static void test_load_small_files() noexcept
+{
+  const uint8 tab_width =
+    ConfigManager::get_instance()->get_config_struct().tab_width;
+  for(const std::string& text : {std::string(""),
+                                 std::string("\n"),
+                                 std::string("no new line"),
+                                 std::string("a\nb\n"),
+                                 std::string("a\r\nb\r\n\r\n"),
+                                 std::string("\tx\t\ty\n\t\n"),
+                                 std::string("caf\xc3\xa9\n\xff\xfe\n")})
+  {
+    std::size_t crlf_line_endings = 0;
+    std::size_t lf_line_endings = 0;
+    const std::vector<std::string> expected =
+      split_lines(text, tab_width, crlf_line_endings, lf_line_endings);
+    Buffer buffer;
+    check(load_text(buffer, text), "small file is loaded");
+    check(lines_of(buffer) == expected, "small file is split into lines");
+    check(buffer.is_valid_utf8() == is_valid_utf8(text),
+          "UTF-8 of small file is validated");
+  }
+}
+
+/// @brief A file above large_file_threshold, loaded in background, gets
+///        the same lines as when it is read at once.
+static void test_load_large_file() noexcept
+{
+  std::mt19937 random(11);
+  const std::string text = random_text(random, 600000, false) + "\xff\n";
+
+  Buffer small;
+  check(load_text(small, text), "file is loaded at once");
+
+  const std::filesystem::path path =
+    std::filesystem::temp_directory_path() / "line_indexer_test.toml";
+  {
+    std::ofstream file(path);
+    file << "large_file_threshold = 1\n";
+  }
+  check(ConfigManager::get_instance()->load_config(path.string()),
+        "config with 1 MB large file threshold is loaded");
+  Buffer large;
+  check(load_text(large, text), "file is loaded in background");
+  check(lines_of(large) == lines_of(small),
+        "file loaded in background has the same lines");
+  check(!large.is_valid_utf8() && !small.is_valid_utf8(),
+        "invalid UTF-8 is found in both");
+
+  std::filesystem::remove(path);
+  check(ConfigManager::get_instance()->load_config(),
+        "default config is loaded again");
+}
+
+int main()
+{
+  ConfigManager::create_instance();
+  if(!ConfigManager::get_instance()->load_config())
+  {
+    std::printf("config isn't loaded, run from root of repository\n");
+    return 1;
+  }
+
+  test_index_lines();
+  test_load_small_files();
+  test_load_large_file();
+
+  if(failures > 0)
+  {
+    std::printf("%d checks failed\n", failures);
+    return 1;
+  }
+  std::printf("all checks passed\n");
+  return 0;
+}
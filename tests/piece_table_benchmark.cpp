@@ -0,0 +1,71 @@
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "../include/piece_table.hpp"
+
+/// @brief Microseconds since start.
+static double microseconds_since(
+  const std::chrono::steady_clock::time_point& start) noexcept
+{
+  return std::chrono::duration<double, std::micro>(
+           std::chrono::steady_clock::now() - start)
+    .count();
+}
+
+/// Inserts a line near the top of 500K lines and erases another, with
+/// lines stored in a vector of strings (as Buffer used to) and in the
+/// piece table, and looks up rows of the piece table.
+int main()
+{
+  constexpr uint32 line_count = 500000;
+  constexpr int edits = 1000;
+  std::vector<std::string> lines;
+  for(uint32 i = 0; i < line_count; i++)
+  {
+    std::string line = "    int value_" + std::to_string(i) + " = compute(";
+    line.resize(40, 'x');
+    lines.push_back(std::move(line));
+  }
+  PieceTable table(lines);
+
+  auto start = std::chrono::steady_clock::now();
+  for(int i = 0; i < edits; i++)
+  {
+    lines.insert(lines.begin() + 10, "  // inserted line");
+    lines.erase(lines.begin() + 20);
+  }
+  std::printf("vector<string>: %.2f us per insert+erase\n",
+              microseconds_since(start) / edits);
+
+  start = std::chrono::steady_clock::now();
+  for(int i = 0; i < edits; i++)
+  {
+    table.insert_line(10, "  // inserted line");
+    table.erase_lines(20, 21);
+  }
+  std::printf("piece table:    %.2f us per insert+erase\n",
+              microseconds_since(start) / edits);
+
+  constexpr uint32 lookups = 1000000;
+  std::size_t bytes = 0;
+  start = std::chrono::steady_clock::now();
+  for(uint32 i = 0; i < lookups; i++)
+  {
+    bytes += table[(i * 7919) % line_count].size();
+  }
+  std::printf("piece table:    %.0f ns per row lookup (%zu bytes)\n",
+              microseconds_since(start) * 1000 / lookups,
+              bytes);
+
+  // both layouts must hold the same lines
+  for(uint32 row = 0; row < line_count; row++)
+  {
+    if(table[row] != lines[row])
+    {
+      std::printf("line %lu differs\n", static_cast<unsigned long>(row));
+      return 1;
+    }
+  }
+  return 0;
+}
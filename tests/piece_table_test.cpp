@@ -0,0 +1,357 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "../include/buffer.hpp"
+#include "../include/config_manager.hpp"
+#include "../include/incremental_render_update.hpp"
+#include "../include/piece_table.hpp"
+
+/// @brief Counts failed checks.
+static int failures = 0;
+
+/// @brief Reports failed check.
+/// @param passed result of check.
+/// @param what description of check.
+static void check(const bool& passed, const char* what) noexcept
+{
+  if(!passed)
+  {
+    std::printf("FAILED: %s\n", what);
+    failures++;
+  }
+}
+
+/// @brief Copies lines of piece table.
+static std::vector<std::string> lines_of(const PieceTable& table) noexcept
+{
+  std::vector<std::string> lines;
+  for(uint32 row = 0; row < table.size(); row++)
+  {
+    lines.emplace_back(table[row]);
+  }
+  return lines;
+}
+
+/// @brief Compares sizes, offsets and positions of piece table with the
+///        ones counted over lines.
+static void check_offsets(const PieceTable& table,
+                          const std::vector<std::string>& lines) noexcept
+{
+  std::size_t bytes = 0;
+  std::size_t max_line_length = 0;
+  for(const std::string& line : lines)
+  {
+    bytes += line.size();
+    max_line_length = std::max(max_line_length, line.size());
+  }
+  check(table.bytes() == bytes, "bytes are sum of line lengths");
+  check(table.max_line_length() == max_line_length,
+        "max line length is length of longest line");
+
+  bool offsets_match = true;
+  std::size_t offset = 0;
+  for(uint32 row = 0; row < lines.size(); row++)
+  {
+    offsets_match = offsets_match && table.offset_of(row) == offset &&
+                    table.position_of(offset) ==
+                      std::make_pair(row, std::size_t(0)) &&
+                    table.position_of(offset + lines[row].size()) ==
+                      std::make_pair(row, lines[row].size());
+    offset += lines[row].size() + 1;
+  }
+  check(offsets_match, "offsets and positions of lines match");
+  check(table.offset_of(lines.size()) == offset,
+        "offset past last line is end of text");
+  check(table.position_of(offset + 100) ==
+          std::make_pair(static_cast<uint32>(lines.size() - 1),
+                         lines.back().size()),
+        "position past end of text is clamped");
+}
+
+/// @brief Random edits of a piece table give the lines of the same edits of
+///        a vector of strings, with matching offsets and positions.
+static void test_random_edits() noexcept
+{
+  std::mt19937 random(1);
+  std::vector<std::string> lines;
+  for(int i = 0; i < 5000; i++)
+  {
+    lines.emplace_back(random() % 50, 'x');
+  }
+  PieceTable table(lines);
+  for(int step = 0; step < 10000; step++)
+  {
+    const uint32 row = random() % lines.size();
+    const int edit = random() % 5;
+    if(edit == 0)
+    {
+      // an occasional long line changes max line length
+      const std::string line(random() % (step % 1000 == 0 ? 5000 : 60), 'y');
+      table.set_line(row, line);
+      lines[row] = line;
+    }
+    else if(edit == 1)
+    {
+      // an occasional large insert splits many nodes
+      const uint32 count = random() % (step % 500 == 0 ? 3000 : 4) + 1;
+      std::vector<std::string> inserted;
+      for(uint32 i = 0; i < count; i++)
+      {
+        inserted.emplace_back(random() % 70, 'z');
+      }
+      const std::vector<std::string_view> views(inserted.begin(),
+                                                inserted.end());
+      table.insert_lines(row, views);
+      lines.insert(lines.begin() + row, inserted.begin(), inserted.end());
+    }
+    else if(edit == 2 && lines.size() > 10)
+    {
+      // an occasional large erase merges many nodes
+      const uint32 last = std::min<std::size_t>(
+        lines.size() - 1, row + random() % (step % 700 == 0 ? 2000 : 5));
+      table.erase_lines(row, last);
+      lines.erase(lines.begin() + row, lines.begin() + last);
+    }
+    else if(edit == 3)
+    {
+      // lines moved within table, as undo does
+      const uint32 count =
+        std::min<uint32>(lines.size() - row - 1, random() % 20);
+      const uint32 first = random() % lines.size();
+      const std::vector<Piece> pieces = table.pieces(
+        first, std::min<uint32>(lines.size(), first + random() % 20));
+      std::vector<std::string> replacing;
+      for(const Piece& piece : pieces)
+      {
+        replacing.emplace_back(piece.data, piece.length);
+      }
+      table.replace_lines(row, count, pieces);
+      lines.erase(lines.begin() + row, lines.begin() + row + count);
+      lines.insert(lines.begin() + row, replacing.begin(), replacing.end());
+    }
+    else if(table.should_compact())
+    {
+      table.compact({});
+    }
+
+    if(step % 250 == 0)
+    {
+      check(lines_of(table) == lines, "lines of piece table match");
+      check_offsets(table, lines);
+    }
+  }
+  check(lines_of(table) == lines, "lines of piece table match at end");
+}
+
+/// @brief Copies lines of snapshot.
+static std::vector<std::string>
+lines_of(const PieceTableSnapshot& snapshot) noexcept
+{
+  std::vector<std::string> lines;
+  for(uint32 row = 0; row < snapshot.size(); row++)
+  {
+    lines.emplace_back(snapshot[row]);
+  }
+  return lines;
+}
+
+/// @brief Snapshots keep the lines they were taken with while the piece
+///        table is edited and compacted, and edits bump the version.
+static void test_snapshots() noexcept
+{
+  for(unsigned seed = 0; seed < 50; seed++)
+  {
+    std::mt19937 random(seed);
+    std::vector<std::string> lines;
+    for(int i = 0; i < 2000; i++)
+    {
+      lines.push_back("line " + std::to_string(i));
+    }
+    PieceTable table(lines);
+    std::vector<std::pair<PieceTableSnapshot, std::vector<std::string>>>
+      snapshots;
+    for(int step = 0; step < 300; step++)
+    {
+      const uint32 row = random() % lines.size();
+      const std::uint64_t version = table.version();
+      const int edit = random() % 6;
+      if(edit == 0)
+      {
+        snapshots.emplace_back(table.snapshot(), lines);
+        check(snapshots.back().first.version() == version,
+              "snapshot has version of piece table");
+        continue;
+      }
+      else if(edit == 1 && !snapshots.empty())
+      {
+        snapshots.erase(snapshots.begin() + random() % snapshots.size());
+        continue;
+      }
+      else if(edit == 2)
+      {
+        const std::string line = "set " + std::to_string(step);
+        table.set_line(row, line);
+        lines[row] = line;
+      }
+      else if(edit == 3)
+      {
+        std::vector<std::string> inserted;
+        for(uint32 i = random() % 700 + 1; i > 0; i--)
+        {
+          inserted.push_back("inserted " + std::to_string(i));
+        }
+        const std::vector<std::string_view> views(inserted.begin(),
+                                                  inserted.end());
+        table.insert_lines(row, views);
+        lines.insert(lines.begin() + row, inserted.begin(), inserted.end());
+      }
+      else if(row + 1 < lines.size())
+      {
+        const uint32 last = std::min<std::size_t>(
+          lines.size() - 1, row + 1 + random() % 900);
+        table.erase_lines(row, last);
+        lines.erase(lines.begin() + row, lines.begin() + last);
+      }
+      else
+      {
+        continue;
+      }
+      check(table.version() > version, "edit bumps version");
+      if(table.should_compact())
+      {
+        table.compact({});
+      }
+    }
+    check(lines_of(table) == lines, "lines of edited piece table match");
+    bool snapshots_match = true;
+    for(const auto& [snapshot, snapshot_lines] : snapshots)
+    {
+      snapshots_match =
+        snapshots_match && lines_of(snapshot) == snapshot_lines;
+    }
+    check(snapshots_match, "snapshots keep their lines");
+  }
+}
+
+/// @brief A thread reading snapshots sees whole lines while the piece
+///        table is edited and compacted.
+static void test_snapshot_reader() noexcept
+{
+  std::vector<std::string> lines;
+  for(int i = 0; i < 100000; i++)
+  {
+    lines.push_back("some text of line " + std::to_string(i));
+  }
+  PieceTable table(lines);
+  std::atomic<PieceTableSnapshot*> pending = nullptr;
+  std::atomic<bool> stop = false;
+  std::atomic<int> torn_reads = 0;
+  std::thread reader(
+    [&]()
+    {
+      while(!stop)
+      {
+        PieceTableSnapshot* snapshot = pending.exchange(nullptr);
+        if(snapshot == nullptr)
+        {
+          std::this_thread::yield();
+          continue;
+        }
+        std::size_t bytes = 0;
+        for(uint32 row = 0; row < snapshot->size(); row++)
+        {
+          bytes += (*snapshot)[row].size();
+        }
+        if(bytes != snapshot->bytes())
+        {
+          torn_reads++;
+        }
+        delete snapshot;
+      }
+    });
+
+  std::mt19937 random(7);
+  for(int step = 0; step < 50000; step++)
+  {
+    const uint32 row = random() % (table.size() - 5);
+    const int edit = random() % 3;
+    if(edit == 0)
+    {
+      table.set_line(row, "edited " + std::to_string(step));
+    }
+    else if(edit == 1)
+    {
+      table.insert_line(row, "inserted");
+    }
+    else
+    {
+      table.erase_lines(row, row + 1 + random() % 3);
+    }
+    if(step % 100 == 0)
+    {
+      delete pending.exchange(new PieceTableSnapshot(table.snapshot()));
+    }
+    if(table.should_compact())
+    {
+      table.compact({});
+    }
+  }
+  while(pending.load() != nullptr)
+  {
+    std::this_thread::yield();
+  }
+  stop = true;
+  reader.join();
+  check(torn_reads == 0, "snapshots read on another thread are whole");
+}
+
+/// @brief Offsets of buffer count a newline after each line, and go back
+///        to the same positions.
+static void test_buffer_offsets() noexcept
+{
+  const Buffer buffer(std::vector<std::string>{"ab", "", "cde"});
+  check(buffer.offset_of(0, -1) == 0, "start of text is offset 0");
+  check(buffer.offset_of(0, 1) == 2, "offset counts characters");
+  check(buffer.offset_of(2, -1) == 4, "offset counts newlines");
+  check(buffer.offset_of(2, 2) == 7, "offset of end of text");
+  check(!buffer.offset_of(3, -1).has_value(), "row out of bounds");
+  check(!buffer.offset_of(0, 2).has_value(), "column out of bounds");
+  bool positions_match = true;
+  for(std::size_t offset = 0; offset <= 7; offset++)
+  {
+    const std::pair<uint32, int32> position = buffer.position_of(offset);
+    positions_match =
+      positions_match &&
+      buffer.offset_of(position.first, position.second) == offset;
+  }
+  check(positions_match, "positions of offsets give the same offsets");
+}
+
+int main()
+{
+  ConfigManager::create_instance();
+  if(!ConfigManager::get_instance()->load_config())
+  {
+    std::printf("config isn't loaded, run from root of repository\n");
+    return 1;
+  }
+
+  test_random_edits();
+  test_snapshots();
+  test_snapshot_reader();
+  test_buffer_offsets();
+
+  if(failures > 0)
+  {
+    std::printf("%d checks failed\n", failures);
+    return 1;
+  }
+  std::printf("all checks passed\n");
+  return 0;
+}
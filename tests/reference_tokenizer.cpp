@@ -0,0 +1,718 @@
+#include "reference_tokenizer.hpp"
+#include <algorithm>
+#include <array>
+
+// static std::vector<std::string> seperators = {
+//   " ", "\n", ".", "!", "\t", ";", ":", "\\", "/", "+", "-",  "*",  "&",
+//   "%", "<",  ">", "=", "(",  ")", "{", "}",  "[", "]", "\"", "\'", ","};
+
+// static std::vector<char> char_seps = {
+//   ' ', '\n', '.', '!', '\t', ';', ':', '\\', '/', '+', '-', '*', '&',
+//   '%', '<', '>', '=', '(', ')', '{', '}', '[', ']', '"', '\'', ','
+// };
+
+static std::string seperators = " \n\r.!\t;:\\/+-*&%<>=(){}[]\"',|~^";
+
+static std::vector<std::string> operators = {
+  "::", "->", "<=", ">=", "+=", "-=", "/=", "*=", "^=", "&&", "==",
+  "&=", "||", "%=", ">>", "<<", "~",  "+",  "-",  "*",  "/",  "=",
+  "<",  ">",  "!",  "?",  ":",  "^",  "&",  "|",  "%",  "."};
+
+static constexpr auto keywords = std::to_array<std::string_view>({
+  "alignas", "alignof", "and_eq", "and", "asm", "atomic_cancel",
+  "atomic_commit", "atomic_noexcept", "auto", "bitand", "bitor", "bool",
+  "break", "case", "catch", "char8_t", "char16_t", "char32_t", "char", "class",
+  "compl", "concept", "consteval", "constexpr", "constinit", "const_cast",
+  "const", "continue", "co_await", "co_return", "co_yeild", "decltype",
+  "default", "delete", "double", "do", "dynamic_cast", "else", "enum",
+  "explicit", "export", "extern", "false", "float", "for", "friend", "goto",
+  "if", "inline", "int", "long", "mutable", "namespace", "new", "noexcept",
+  "not_eq", "not", "nullptr", "operator", "or_eq", "or", "private",
+  "protected", "public", "reflexpr", "register", "reinterpret_cast",
+  "requires", "return", "short", "signed", "sizeof", "static_assert",
+  "static_cast", "static", "struct", "switch", "synchronized", "template",
+  "this", "thread_local", "throw", "true", "try", "typedef", "typeid",
+  "typename", "union", "unsigned", "using", "virtual", "void", "volatile",
+  "wchar_t", "while", "xor_eq", "xor"});
+
+static constexpr auto preprocessor_directives =
+  std::to_array<std::string_view>({"#ifndef", "#ifdef", "#if", "#else",
+                                   "#elif", "#elifdef", "#elifndef", "#endif",
+                                   "#define", "#undef", "#include", "#error",
+                                   "#warning", "#pragma", "#line"});
+
+/// @brief Hash of word, FNV-1a with seed, its bits mixed down.
+static constexpr uint32_t word_hash(std::string_view word,
+                                    const uint32_t& seed) noexcept
+{
+  uint32_t hash = seed;
+  for(const char& c : word)
+  {
+    hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+  }
+  return hash ^ (hash >> 16);
+}
+
+/// @brief Perfect hash table of words, built at compile time. Each word
+///        has a slot of its own, holding its index + 1 (0 for empty
+///        slots), so looking up a word costs one hash and one compare.
+template<std::size_t TableSize>
+struct WordTable
+{
+  /// @brief Seed of hash with no collisions among words.
+  uint32_t seed;
+
+  /// @brief Shortest and longest word, other lengths aren't hashed.
+  std::size_t min_length, max_length;
+
+  /// @brief Slots, by hash of word.
+  std::array<uint8_t, TableSize> slots;
+};
+
+/// @brief Builds perfect hash table of words, trying seeds till words
+///        land in distinct slots.
+template<std::size_t TableSize, std::size_t Count>
+static consteval WordTable<TableSize>
+build_word_table(const std::array<std::string_view, Count>& words) noexcept
+{
+  static_assert((TableSize & (TableSize - 1)) == 0 && Count < 256);
+  for(uint32_t seed = 2166136261u;; seed++)
+  {
+    WordTable<TableSize> table{seed, words[0].size(), words[0].size(), {}};
+    bool collided = false;
+    for(std::size_t i = 0; i < Count && !collided; i++)
+    {
+      uint8_t& slot = table.slots[word_hash(words[i], seed) & (TableSize - 1)];
+      collided = slot != 0;
+      slot = i + 1;
+      table.min_length = std::min(table.min_length, words[i].size());
+      table.max_length = std::max(table.max_length, words[i].size());
+    }
+    if(!collided)
+    {
+      return table;
+    }
+  }
+}
+
+/// @brief Tells if word is one of words of table.
+template<std::size_t TableSize, std::size_t Count>
+static inline bool
+is_word_of(const WordTable<TableSize>& table,
+           const std::array<std::string_view, Count>& words,
+           std::string_view word) noexcept
+{
+  if(word.size() < table.min_length || word.size() > table.max_length)
+  {
+    return false;
+  }
+  const uint8_t slot =
+    table.slots[word_hash(word, table.seed) & (TableSize - 1)];
+  return slot != 0 && words[slot - 1] == word;
+}
+
+static constexpr WordTable<1024> keywords_table =
+  build_word_table<1024>(keywords);
+
+static constexpr WordTable<64> preprocessor_directives_table =
+  build_word_table<64>(preprocessor_directives);
+
+/// @brief Gives word at offset of string, characters till a separator.
+static inline std::string_view word_at(const std::string& str,
+                                       const uint32_t& offset) noexcept
+{
+  std::size_t end = offset;
+  while(end < str.size() && seperators.find(str[end]) == std::string::npos)
+  {
+    end++;
+  }
+  return std::string_view(str).substr(offset, end - offset);
+}
+
+namespace ReferenceTokenizer
+{
+
+Token::Token() noexcept
+  : type(TokenType::UNKNOWN), start_offset(0), length(0)
+{}
+
+Token::Token(const TokenType& token_type) noexcept
+  : type(token_type), start_offset(0), length(0)
+{}
+
+bool Token::operator!=(const Token& other) const noexcept
+{
+  return type != other.type || start_offset != other.start_offset ||
+         length != other.length;
+}
+
+std::string_view Token::value(std::string_view str) const noexcept
+{
+  return str.substr(start_offset, length);
+}
+
+Tokenizer::Tokenizer() noexcept
+  : _current_token(Token())
+  , _tokens({})
+  , _inside_string(false)
+  , _inside_char(false)
+  , _inside_comment(false)
+  , _inside_multiline_comment(false)
+  , _position(0)
+  , _char_start_offset(0)
+{}
+
+const std::vector<Token>& Tokenizer::tokenize(const std::string& str) noexcept
+{
+  while(_position < str.size())
+  {
+    char character = str[_position];
+
+    /// Preprocessor Directive
+    if(character == '#')
+    {
+      // mathcing with preprocessor directives
+      const std::string_view directive = word_at(str, _position);
+      if(is_word_of(
+           preprocessor_directives_table, preprocessor_directives, directive))
+      {
+        // found directive match
+        _current_token = Token(TokenType::PREPROCESSOR_DIRECTIVE);
+        _current_token.start_offset = _position;
+        _current_token.length = directive.size();
+        _tokens.emplace_back(_current_token);
+        _position += directive.size();
+        goto while_loop_continue;
+      }
+    }
+
+    /// Separator
+    if(seperators.find(character) != std::string::npos)
+    {
+      if(character == '\'')
+      {
+        if(_inside_char)
+        {
+          // operators (and keywords) matched inside the character are
+          // part of it
+          while(!_tokens.empty() &&
+                _tokens.back().start_offset > _char_start_offset)
+          {
+            _tokens.pop_back();
+          }
+          _inside_char = false;
+          _current_token = Token(TokenType::CHARACTER);
+          _current_token.start_offset = _char_start_offset;
+          _current_token.length = _position - _char_start_offset + 1;
+          _tokens.emplace_back(_current_token);
+          _position++;
+          continue;
+        }
+        _inside_char = true;
+        _char_start_offset = _position;
+        _position++;
+        continue;
+      }
+      else if(character == '"')
+      {
+        if(this->inside_include_declaration(str))
+        {
+          _current_token = Token(TokenType::HEADER);
+          _current_token.start_offset = _position;
+          _position++;
+          // move forward until we encounter '"'
+          std::string header_string_separators =
+            " \n\r!\t;:+*&%<>=(){}[]\"',|~^";
+          while(_position < str.size() &&
+                header_string_separators.find(str[_position]) ==
+                  std::string::npos)
+          {
+            _position++;
+          }
+          if(str[_position] == '"')
+          {
+            _position++;
+          }
+          _current_token.length = _position - _current_token.start_offset;
+          _tokens.emplace_back(_current_token);
+          goto while_loop_continue;
+        }
+
+        // it is just a string, move forward until u find a string separator
+        _current_token = Token(TokenType::STRING);
+        _current_token.start_offset = _position;
+        _position++;
+        while(_position < str.size() && str[_position] != '\n' &&
+              str[_position] != '\t' && str[_position] != '\r' &&
+              str[_position] != '"')
+        {
+          _position++;
+        }
+        if(str[_position] == '"')
+        {
+          _position++;
+        }
+        _current_token.length = _position - _current_token.start_offset;
+        _tokens.emplace_back(_current_token);
+        goto while_loop_continue;
+      }
+      else if(character == '<')
+      {
+        // check if it is include declaration
+        if(this->inside_include_declaration(str))
+        {
+          _current_token = Token(TokenType::HEADER);
+          _current_token.start_offset = _position;
+          // move forward until we encounter '>'
+          while(_position < str.size() && str[_position] != '>' &&
+                str[_position] != '\n' && str[_position] != '\t' &&
+                str[_position] != '\r' && str[_position] != ' ')
+          {
+            _position++;
+          }
+          if(str[_position] == '>')
+          {
+            _position++;
+          }
+          _current_token.length = _position - _current_token.start_offset;
+          _tokens.emplace_back(_current_token);
+          goto while_loop_continue;
+        }
+        // else consider it as operator
+      }
+      else if(character == '/')
+      {
+        if(_inside_multiline_comment)
+        {
+          if(str[_position - 1] == '*')
+          {
+            _inside_multiline_comment = false;
+            _current_token.length = _position - _current_token.start_offset + 1;
+            _tokens.emplace_back(_current_token);
+            _position++;
+            goto while_loop_continue;
+          }
+          _position++;
+          goto while_loop_continue;
+        }
+        if(_position + 1 < str.size() && str[_position + 1] == '/')
+        {
+          // single line comment
+          _current_token = Token(TokenType::COMMENT);
+          _current_token.start_offset = _position;
+          while(_position < str.size() && str[_position] != '\r' &&
+                str[_position] != '\n')
+          {
+            _position++;
+          }
+          _current_token.length = _position - _current_token.start_offset;
+          _tokens.push_back(_current_token);
+          goto while_loop_continue;
+        }
+        if(_position + 1 < str.size() && str[_position + 1] == '*')
+        {
+          // multiline comment
+          _current_token = Token(TokenType::MULTILINE_COMMENT);
+          _current_token.start_offset = _position;
+          _position += 2;
+          bool inserted_multiline_comment_token = false;
+          while(_position < str.size())
+          {
+            if(str[_position] == '*' && _position + 1 < str.size() &&
+               str[_position + 1] == '/')
+            {
+              // multiline comment ended
+              _position += 2;
+              _current_token.length = _position - _current_token.start_offset;
+              _tokens.push_back(_current_token);
+              inserted_multiline_comment_token = true;
+              break;
+            }
+            if(str[_position] == '\r')
+            {
+              // skipping these characters for now
+              // as this is geared towards syntax highlighting
+              // while rendering these characters there will be glitches
+              _position++;
+              continue;
+            }
+            _position++;
+          }
+          if(_position >= str.size() && !inserted_multiline_comment_token)
+          {
+            // end of string
+            // although the miltiline comment is unclosed,
+            // with token as incomplete type
+            _current_token.type = TokenType::MULTILINE_COMMENT_INCOMPLETE;
+            _current_token.length = _position - _current_token.start_offset;
+            _tokens.push_back(_current_token);
+          }
+          goto while_loop_continue;
+        }
+      }
+      else if(character == '\n')
+      {
+        if(_inside_comment)
+        {
+          _inside_comment = false;
+          _current_token.length = _position - _current_token.start_offset;
+          _tokens.emplace_back(_current_token);
+          _position++;
+          goto while_loop_continue;
+        }
+        if(_inside_multiline_comment || _inside_string)
+        {
+          _position++;
+          goto while_loop_continue;
+        }
+        if(_current_token.type == TokenType::IDENTIFIER &&
+           (_tokens.empty() || _tokens.back() != _current_token))
+        {
+          _current_token.length = _position - _current_token.start_offset;
+          _tokens.emplace_back(_current_token);
+          _position++;
+          goto while_loop_continue;
+        }
+        // ignore
+        _position++;
+        goto while_loop_continue;
+      }
+      else if(character == '\r')
+      {
+        // ignore carriage return characters
+        _position++;
+        goto while_loop_continue;
+      }
+      else if(character == ' ')
+      {
+        if(_inside_comment || _inside_multiline_comment || _inside_char || _inside_string)
+        {
+          _position++;
+          goto while_loop_continue;
+        }
+        _current_token = Token(TokenType::WHITESPACE);
+        _current_token.start_offset = _position;
+        _current_token.length = 1;
+        _tokens.emplace_back(_current_token);
+        _position++;
+        goto while_loop_continue;
+      }
+      else if(character == '\t')
+      {
+        if(_inside_comment || _inside_multiline_comment || _inside_string)
+        {
+          _position++;
+          goto while_loop_continue;
+        }
+
+        _current_token = Token(TokenType::TAB);
+        _current_token.start_offset = _position;
+        _current_token.length = 1;
+        _tokens.emplace_back(_current_token);
+        _position++;
+        goto while_loop_continue;
+      }
+      else if(character == '.')
+      {
+        if(_inside_comment || _inside_multiline_comment || _inside_char ||
+           _inside_string)
+        {
+          _position++;
+          goto while_loop_continue;
+        }
+      }
+      else if(character == ',')
+      {
+        if(_inside_comment || _inside_multiline_comment || _inside_char ||
+           _inside_string)
+        {
+          _position++;
+          goto while_loop_continue;
+        }
+        _current_token = Token(TokenType::COMMA);
+        _current_token.start_offset = _position;
+        _current_token.length = 1;
+        _tokens.emplace_back(_current_token);
+        _position++;
+        goto while_loop_continue;
+      }
+      else if(character == ';')
+      {
+        if(_inside_comment || _inside_multiline_comment || _inside_char ||
+           _inside_string)
+        {
+          _position++;
+          goto while_loop_continue;
+        }
+        _current_token = Token(TokenType::SEMICOLON);
+        _current_token.start_offset = _position;
+        _current_token.length = 1;
+        _tokens.emplace_back(_current_token);
+        _position++;
+        goto while_loop_continue;
+      }
+      else if(character == '(')
+      {
+        if(_inside_comment || _inside_multiline_comment || _inside_char ||
+           _inside_string)
+        {
+          _position++;
+          goto while_loop_continue;
+        }
+        if(!_tokens.empty() && _tokens.back().type == TokenType::IDENTIFIER)
+        {
+          // this identifier should definitely be function
+          _tokens.back().type = TokenType::FUNCTION;
+        }
+        _current_token = Token(TokenType::BRACKET_OPEN);
+        _current_token.start_offset = _position;
+        _current_token.length = 1;
+        _tokens.emplace_back(_current_token);
+        _position++;
+        goto while_loop_continue;
+      }
+      else if(character == ')')
+      {
+        if(_inside_comment || _inside_multiline_comment || _inside_char ||
+           _inside_string)
+        {
+          _position++;
+          goto while_loop_continue;
+        }
+        _current_token = Token(TokenType::BRACKET_CLOSE);
+        _current_token.start_offset = _position;
+        _current_token.length = 1;
+        _tokens.emplace_back(_current_token);
+        _position++;
+        goto while_loop_continue;
+      }
+      else if(character == '[')
+      {
+        if(_inside_comment || _inside_multiline_comment || _inside_char ||
+           _inside_string)
+        {
+          _position++;
+          goto while_loop_continue;
+        }
+        _current_token = Token(TokenType::SQUARE_BRACKET_OPEN);
+        _current_token.start_offset = _position;
+        _current_token.length = 1;
+        _tokens.emplace_back(_current_token);
+        _position++;
+        goto while_loop_continue;
+      }
+      else if(character == ']')
+      {
+        if(_inside_comment || _inside_multiline_comment || _inside_char ||
+           _inside_string)
+        {
+          _position++;
+          goto while_loop_continue;
+        }
+        _current_token = Token(TokenType::SQUARE_BRACKET_CLOSE);
+        _current_token.start_offset = _position;
+        _current_token.length = 1;
+        _tokens.emplace_back(_current_token);
+        _position++;
+        goto while_loop_continue;
+      }
+      else if(character == '{')
+      {
+        if(_inside_comment || _inside_multiline_comment || _inside_char ||
+           _inside_string)
+        {
+          _position++;
+          goto while_loop_continue;
+        }
+        _current_token = Token(TokenType::CURLY_BRACE_OPEN);
+        _current_token.start_offset = _position;
+        _current_token.length = 1;
+        _tokens.emplace_back(_current_token);
+        _position++;
+        goto while_loop_continue;
+      }
+      else if(character == '}')
+      {
+        if(_inside_comment || _inside_multiline_comment || _inside_char ||
+           _inside_string)
+        {
+          _position++;
+          goto while_loop_continue;
+        }
+        _current_token = Token(TokenType::CURLY_BRACE_CLOSE);
+        _current_token.start_offset = _position;
+        _current_token.length = 1;
+        _tokens.emplace_back(_current_token);
+        _position++;
+        goto while_loop_continue;
+      }
+    }
+
+    /// continuing if inside comment
+    if(_inside_comment)
+    {
+      while(_position < str.size() && str[_position] != '\n')
+      {
+        _position++;
+      }
+      goto while_loop_continue;
+    }
+
+    /// continuing if inside multiline comment
+    if(_inside_multiline_comment)
+    {
+      while(_position < str.size() && str[_position] != '*')
+      {
+        _position++;
+      }
+      goto while_loop_continue;
+    }
+
+    /// Operator
+    for(const std::string& op : operators)
+    {
+      if(str.compare(_position, op.size(), op) == 0)
+      {
+        // found operator match
+        _current_token = Token(TokenType::OPERATOR);
+        _current_token.start_offset = _position;
+        _current_token.length = op.size();
+        _tokens.emplace_back(_current_token);
+        _position += op.size();
+        goto while_loop_continue;
+      }
+    }
+
+    /// Keyword
+    {
+      // word followed by a non separator is an identifier
+      const std::string_view keyword = word_at(str, _position);
+      if(is_word_of(keywords_table, keywords, keyword))
+      {
+        // found keyword match
+        _current_token = Token(TokenType::KEYWORD);
+        _current_token.start_offset = _position;
+        _current_token.length = keyword.size();
+        _tokens.emplace_back(_current_token);
+        _position += keyword.size();
+        goto while_loop_continue;
+      }
+    }
+
+    /// Alphabets
+    if(_inside_comment || _inside_multiline_comment || _inside_string ||
+       _inside_char)
+    {
+      _position++;
+      goto while_loop_continue;
+    }
+    if(isdigit(character))
+    {
+      // character is number - '0' to '9'
+      _current_token = Token(TokenType::NUMBER);
+      _current_token.start_offset = _position;
+      while(_position < str.size())
+      {
+        if(isdigit(str[_position]) || str[_position] == '.' ||
+           str[_position] == 'e' || str[_position] == 'f' ||
+           (str[_position] == '-' && str[_position - 1] == 'e'))
+        {
+          _position++;
+          continue;
+        }
+        break;
+      }
+      _current_token.length = _position - _current_token.start_offset;
+      _tokens.emplace_back(_current_token);
+      goto while_loop_continue;
+    }
+    _current_token = Token(TokenType::IDENTIFIER);
+    _current_token.start_offset = _position;
+    _position++;
+    // moving forward until a separator is encountered
+    while(_position < str.size() &&
+          seperators.find(str[_position]) == std::string::npos)
+    {
+      _position++;
+    }
+    _current_token.length = _position - _current_token.start_offset;
+    _tokens.emplace_back(_current_token);
+
+  while_loop_continue:
+    continue;
+  }
+
+  return _tokens;
+}
+
+const std::vector<Token>& Tokenizer::tokenize_from_imcomplete_token(
+  const std::string& str, const Token& incomplete_token) noexcept
+{
+  if(incomplete_token.type == TokenType::MULTILINE_COMMENT_INCOMPLETE)
+  {
+    _current_token = Token(TokenType::MULTILINE_COMMENT_INCOMPLETE);
+    bool inserted_multiline_comment_token = false;
+    while(_position < str.size())
+    {
+      if(str[_position] == '*' && _position + 1 < str.size() &&
+         str[_position + 1] == '/')
+      {
+        // multiline comment ended.
+        _current_token.length = _position + 2 - _current_token.start_offset;
+        _position += 2;
+        _current_token.type = TokenType::MULTILINE_COMMENT;
+        _tokens.push_back(_current_token);
+        inserted_multiline_comment_token = true;
+        break;
+      }
+      if(str[_position] == '\r')
+      {
+        _position++;
+        continue;
+      }
+      _position++;
+    }
+    if(_position >= str.size() && !inserted_multiline_comment_token)
+    {
+      _current_token.length = _position - _current_token.start_offset;
+      _tokens.push_back(_current_token);
+      return _tokens;
+    }
+  }
+
+  return this->tokenize(str);
+}
+
+void Tokenizer::clear_tokens() noexcept
+{
+  _inside_char = false;
+  _inside_string = false;
+  _inside_comment = false;
+  _inside_multiline_comment = false;
+  _position = 0;
+  _char_start_offset = 0;
+  _current_token = Token();
+  _tokens.clear();
+}
+
+bool Tokenizer::inside_include_declaration(
+  const std::string& str) const noexcept
+{
+  // first token backwards which is not whitespace
+  // if it is #include, it is include declaration
+  for(auto it = _tokens.rbegin(); it != _tokens.rend(); it++)
+  {
+    if(it->type != TokenType::WHITESPACE)
+    {
+      if(it->type == TokenType::PREPROCESSOR_DIRECTIVE &&
+         it->value(str) == "#include")
+      {
+        return true;
+      }
+      break;
+    }
+  }
+  return false;
+}
+
+}; // namespace ReferenceTokenizer
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+/// @brief Tokenizer as it was before lexing with a character table, kept
+///        unchanged to test the current tokenizer against it.
+namespace ReferenceTokenizer
+{
+
+/// @brief TokenType - enum of all token types.
+typedef enum class TokenType : uint8_t
+{
+  /// @brief Whitespace - ' ' character.
+  WHITESPACE,
+  /// @brief Newline - '\n' character.
+  NEWLINE,
+  /// @brief Tab - '\t' character.
+  TAB,
+
+  /// @brief Semicolon - ';' character.
+  SEMICOLON,
+  /// @brief Coma - ',' character.
+  COMMA,
+
+  /// @brief Escape backslash - '\' character.
+  ESCAPE_BACKSLASH,
+
+  /// @brief Open bracket - '(' character.
+  BRACKET_OPEN,
+  /// @brief Closed bracket - ')' character.
+  BRACKET_CLOSE,
+
+  /// @brief Open square bracket - '[' character.
+  SQUARE_BRACKET_OPEN,
+  /// @brief Closed square bracket - ']' character.
+  SQUARE_BRACKET_CLOSE,
+
+  /// @brief Open curly brace - '{' character.
+  CURLY_BRACE_OPEN,
+  /// @brief Closed curly brace - '}' character.
+  CURLY_BRACE_CLOSE,
+
+  /// @brief Charcter token type.
+  CHARACTER,
+  /// @brief Strng token type.
+  STRING,
+  /// @brief Comment token type.
+  COMMENT,
+  /// @brief Multiline token type.
+  MULTILINE_COMMENT,
+  /// @brief Incomplete multiline token type.
+  ///        Incomplete means this token is not closed by "*/"
+  MULTILINE_COMMENT_INCOMPLETE,
+  /// @brief Operator token type.
+  OPERATOR,
+  /// @brief Keyword token type.
+  KEYWORD,
+  /// @brief Preprocessor directive token type.
+  PREPROCESSOR_DIRECTIVE,
+  /// @brief Identifier token type.
+  IDENTIFIER,
+  /// @brief Number token type.
+  NUMBER,
+  /// @brief Function token type.
+  FUNCTION,
+  /// @brief Header token type.
+  HEADER,
+
+  /// @brief Unknown token type.
+  UNKNOWN
+} TokenType;
+
+/// @brief Token - consists of type, start offset & length of token in
+///        tokenized string. Tokens don't own their string, it's a view
+///        into tokenized string, so they are small and cheap to copy.
+class Token
+{
+public:
+  /// @brief Default constructor.
+  Token() noexcept;
+
+  /// @brief Constructor with token type argument.
+  /// @param token_type the type of token to construct.
+  Token(const TokenType& token_type) noexcept;
+
+  /// @brief Checks if given token is not equal to this token.
+  /// @param other the token to compare with this token.
+  /// @return Returns true if the tokens are not equal.
+  bool operator!=(const Token& other) const noexcept;
+
+  /// @brief Gives token string.
+  /// @param str the string this token is of.
+  /// @return Returns view into str.
+  [[nodiscard]] std::string_view value(std::string_view str) const noexcept;
+
+  /// @brief Type of token.
+  TokenType type;
+
+  /// @brief Starting offset or position of token in string.
+  uint32_t start_offset;
+
+  /// @brief Length of token in string.
+  uint32_t length;
+};
+
+class Tokenizer
+{
+public:
+  /// @brief Default constructor.
+  Tokenizer() noexcept;
+
+  /// @brief Tokenizes the given string into tokens.
+  /// @param str const reference to the string to tokenize, tokens are
+  ///            spans of it.
+  /// @return Const reference to vector of Tokens.
+  [[nodiscard]] const std::vector<Token>&
+  tokenize(const std::string& str) noexcept;
+
+  [[nodiscard]] const std::vector<Token>&
+  tokenize_from_imcomplete_token(const std::string& str,
+                                 const Token& incomplete_token) noexcept;
+
+  /// @brief Clears tokens stored in previous tokenization.
+  void clear_tokens() noexcept;
+
+private:
+  Token _current_token;
+  std::vector<Token> _tokens;
+  bool _inside_string, _inside_char, _inside_comment, _inside_multiline_comment;
+  uint32_t _position;
+
+  /// @brief Starting offset of character being tokenized.
+  uint32_t _char_start_offset;
+
+  [[nodiscard]] bool
+  inside_include_declaration(const std::string& str) const noexcept;
+};
+
+}; // namespace ReferenceTokenizer
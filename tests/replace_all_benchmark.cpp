@@ -0,0 +1,93 @@
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include "../include/buffer.hpp"
+#include "../include/config_manager.hpp"
+#include "../include/incremental_render_update.hpp"
+
+/// @brief Milliseconds since start.
+static double milliseconds_since(
+  const std::chrono::steady_clock::time_point& start) noexcept
+{
+  return std::chrono::duration<double, std::milli>(
+           std::chrono::steady_clock::now() - start)
+    .count();
+}
+
+/// @brief Takes queued render and token cache updates.
+/// @return Returns number of updates.
+static std::size_t take_updates(Buffer& buffer) noexcept
+{
+  std::size_t count = 0;
+  while(buffer.get_next_token_cache_update_command())
+  {
+    count++;
+  }
+  while(buffer.get_next_incremental_render_update_command())
+  {
+    count++;
+  }
+  return count;
+}
+
+/// Replaces 1M matches of "foo" in 500K lines with replace_all(), and
+/// undoes and redoes it.
+int main()
+{
+  ConfigManager::create_instance();
+  if(!ConfigManager::get_instance()->load_config())
+  {
+    std::printf("config isn't loaded\n");
+    return 1;
+  }
+
+  const std::filesystem::path path =
+    std::filesystem::temp_directory_path() / "replace_all_benchmark.txt";
+  {
+    std::ofstream file(path, std::ios::binary);
+    for(int i = 0; i < 500000; i++)
+    {
+      file << "  int foo = bar(foo, 42); // line " << i << "\n";
+    }
+  }
+  Buffer buffer;
+  if(!buffer.load_from_file(path.string()))
+  {
+    std::printf("file isn't loaded\n");
+    return 1;
+  }
+  while(buffer.is_loading())
+  {
+    buffer.append_background_loaded_lines();
+    std::this_thread::sleep_for(std::chrono::milliseconds(16));
+  }
+  buffer.append_background_loaded_lines();
+  take_updates(buffer);
+
+  buffer.find("foo", true, false);
+  std::printf("%zu matches in %lu lines\n",
+              buffer.matches().size(),
+              static_cast<unsigned long>(buffer.length()));
+
+  auto start = std::chrono::steady_clock::now();
+  buffer.replace_all("quux_value");
+  std::printf("replace_all: %.1f ms, %zu queued updates\n",
+              milliseconds_since(start),
+              take_updates(buffer));
+
+  start = std::chrono::steady_clock::now();
+  buffer.undo();
+  std::printf("undo: %.1f ms\n", milliseconds_since(start));
+  take_updates(buffer);
+
+  start = std::chrono::steady_clock::now();
+  buffer.redo();
+  std::printf("redo: %.1f ms\n", milliseconds_since(start));
+  take_updates(buffer);
+
+  std::filesystem::remove(path);
+  return 0;
+}
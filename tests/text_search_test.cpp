@@ -0,0 +1,361 @@
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "../include/buffer.hpp"
+#include "../include/config_manager.hpp"
+#include "../include/incremental_render_update.hpp"
+#include "../include/piece_table.hpp"
+#include "../include/text_search.hpp"
+#include "../include/trigram_index.hpp"
+
+/// @brief Counts failed checks.
+static int failures = 0;
+
+/// @brief Reports failed check.
+/// @param passed result of check.
+/// @param what description of check.
+static void check(const bool& passed, const char* what) noexcept
+{
+  if(!passed)
+  {
+    std::printf("FAILED: %s\n", what);
+    failures++;
+  }
+}
+
+/// @brief Loads buffer from text, through a temporary file.
+/// @param buffer buffer to load.
+/// @param text text of file.
+/// @return Returns false if file couldn't be loaded.
+static bool load_text(Buffer& buffer, const std::string& text) noexcept
+{
+  const std::filesystem::path path =
+    std::filesystem::temp_directory_path() / "text_search_test.txt";
+  {
+    std::ofstream file(path, std::ios::binary);
+    file << text;
+  }
+  const bool loaded = buffer.load_from_file(path.string());
+  while(buffer.get_next_token_cache_update_command())
+  {}
+  while(buffer.get_next_incremental_render_update_command())
+  {}
+  std::filesystem::remove(path);
+  return loaded;
+}
+
+/// @brief Matches refined while query grows have length of query, and
+///        replacing them replaces whole matches.
+static void test_refined_matches_grow() noexcept
+{
+  Buffer buffer;
+  check(load_text(buffer, "foo foo\nxfoo\n"), "buffer is loaded");
+
+  buffer.find("f", true, false);
+  buffer.find("fo", true, false);
+  buffer.find("foo", true, false);
+  check(buffer.matches().size() == 3, "refined query has 3 matches");
+  for(const TextMatch& match : buffer.matches())
+  {
+    check(match.length == 3, "refined match has length of query");
+  }
+
+  check(buffer.replace_all("bar"), "refined matches are replaced");
+  check(buffer.line(0).value() == "bar bar", "first line is replaced");
+  check(buffer.line(1).value() == "xbar", "second line is replaced");
+}
+
+/// @brief Ranges not inside current lines are skipped, instead of
+///        splicing text outside lines.
+static void test_stale_ranges_are_skipped() noexcept
+{
+  Buffer buffer;
+  check(load_text(buffer, "foo foo\nxfoo\n"), "buffer is loaded");
+
+  const std::vector<TextMatch> ranges = {
+    {0, 4, 3}, {0, 6, 3}, {1, 1, 3}, {1, 4, 1}, {7, 0, 3}};
+  check(buffer.replace_ranges(ranges, "bar"), "ranges are replaced");
+  check(buffer.line(0).value() == "foo bar", "range past line is skipped");
+  check(buffer.line(1).value() == "xbar", "range at end of line is skipped");
+
+  const std::vector<TextMatch> stale = {{0, 8, 1}, {9, 0, 1}};
+  check(!buffer.replace_ranges(stale, "bar"), "stale ranges aren't replaced");
+  check(buffer.line(0).value() == "foo bar", "line isn't changed");
+}
+
+/// @brief Finds query in lines of buffer one position at a time.
+/// @param buffer buffer to search.
+/// @param query text to find.
+/// @param case_sensitive false to ignore case of ASCII letters.
+/// @return Returns matches, in order of position.
+static std::vector<TextMatch> find_naively(const Buffer& buffer,
+                                           const std::string& query,
+                                           const bool& case_sensitive)
+{
+  const auto lowered = [&](const char& c)
+  {
+    return !case_sensitive && c >= 'A' && c <= 'Z' ? c | 0x20 : c;
+  };
+  std::vector<TextMatch> matches;
+  for(uint32 row = 0; !query.empty() && row < buffer.length(); row++)
+  {
+    const std::string_view line = buffer.line(row).value();
+    for(std::size_t column = 0; column + query.size() <= line.size();
+        column++)
+    {
+      std::size_t i = 0;
+      while(i < query.size() && lowered(line[column + i]) == lowered(query[i]))
+      {
+        i++;
+      }
+      if(i == query.size())
+      {
+        matches.push_back({row,
+                           static_cast<uint32>(column),
+                           static_cast<uint32>(query.size())});
+      }
+    }
+  }
+  return matches;
+}
+
+/// @brief Tells if matches are at the same positions with same lengths.
+static bool same_matches(const std::vector<TextMatch>& matches,
+                         const std::vector<TextMatch>& expected) noexcept
+{
+  if(matches.size() != expected.size())
+  {
+    return false;
+  }
+  for(std::size_t i = 0; i < matches.size(); i++)
+  {
+    if(matches[i].row != expected[i].row ||
+       matches[i].column != expected[i].column ||
+       matches[i].length != expected[i].length)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// @brief Matches of queries, with and without case, refined as they
+///        grow and updated by edits and undos, are the matches of finding
+///        the query naively in current lines.
+static void test_matches_follow_edits() noexcept
+{
+  const std::vector<std::string> pieces = {
+    "a", "A", "b", "ab", "aB", " ", "\t", "x", "Ab", "\xc3\xa9"};
+  for(unsigned seed = 0; seed < 300; seed++)
+  {
+    std::mt19937 random(seed);
+    const char* line_ending = random() % 2 == 0 ? "\n" : "\r\n";
+    std::string text;
+    for(uint32 lines = 1 + random() % 60; lines > 0; lines--)
+    {
+      for(uint32 length = random() % 50; length > 0; length--)
+      {
+        text += pieces[random() % pieces.size()];
+      }
+      text += line_ending;
+    }
+    Buffer buffer;
+    check(load_text(buffer, text), "buffer is loaded");
+
+    std::string query;
+    bool case_sensitive = true;
+    bool matches_found = true;
+    for(int step = 0; step < 40; step++)
+    {
+      const int action = query.empty() ? 0 : random() % 5;
+      if(action < 2)
+      {
+        query.clear();
+        for(uint32 length = 1 + random() % 3; length > 0; length--)
+        {
+          query += pieces[random() % 5];
+        }
+        case_sensitive = random() % 2 == 0;
+      }
+      else if(action < 3)
+      {
+        query += pieces[random() % 5];
+      }
+      else
+      {
+        buffer.set_cursor_row(random() % buffer.length());
+        buffer.set_cursor_column(-1);
+        const int edit = random() % 4;
+        if(edit == 0)
+        {
+          buffer.insert_string("ab");
+        }
+        else if(edit == 1)
+        {
+          buffer.process_enter();
+        }
+        else if(edit == 2)
+        {
+          buffer.process_backspace();
+        }
+        else
+        {
+          buffer.undo();
+        }
+        while(buffer.get_next_token_cache_update_command())
+        {}
+        while(buffer.get_next_incremental_render_update_command())
+        {}
+      }
+      if(action < 3)
+      {
+        buffer.find(query, case_sensitive, false);
+      }
+      matches_found =
+        matches_found &&
+        same_matches(buffer.matches(),
+                     find_naively(buffer, query, case_sensitive));
+    }
+    check(matches_found, "matches are the ones found naively");
+  }
+}
+
+/// @brief Searches lines narrowed by trigram index, and all lines, and
+///        tells if both find the same matches.
+static bool same_indexed_matches(TrigramIndex& index,
+                                 const PieceTable& table,
+                                 const std::string& query,
+                                 const bool& case_sensitive) noexcept
+{
+  const PieceTableSnapshot lines = table.snapshot();
+  TextSearch indexed;
+  indexed.search(
+    lines, query, case_sensitive, index.candidate_rows(lines, query));
+  TextSearch full;
+  full.search(lines, query, case_sensitive, {{0, lines.size()}});
+  return same_matches(indexed.matches(), full.matches());
+}
+
+/// @brief Number of rows trigram index narrows search of query to.
+static uint32 candidate_row_count(TrigramIndex& index,
+                                  const PieceTable& table,
+                                  const std::string& query) noexcept
+{
+  uint32 rows = 0;
+  for(const auto& [first, last] :
+      index.candidate_rows(table.snapshot(), query))
+  {
+    rows += last - first;
+  }
+  return rows;
+}
+
+/// @brief Searching lines narrowed by trigram index finds the matches of
+///        searching all lines, before and after lines are edited.
+static void test_trigram_index_keeps_matches() noexcept
+{
+  // a few megabytes of lines, so there are several chunks
+  std::mt19937 random(3);
+  const std::vector<std::string> words = {
+    "int", "value", "return", "Foo", "bar", "//", "x", "{", "}", "caf\xc3\xa9"};
+  std::vector<std::string> lines;
+  for(int i = 0; i < 60000; i++)
+  {
+    std::string line;
+    while(line.size() < 50)
+    {
+      line += words[random() % words.size()] + " ";
+    }
+    lines.push_back(std::move(line));
+  }
+  lines[123] += "needle_xyz";
+  lines[45678] += "NEEDLE_xyz";
+  PieceTable table(lines);
+
+  // index is built for a file, without saving it next to the file
+  const std::filesystem::path path =
+    std::filesystem::temp_directory_path() / "text_search_test_index.txt";
+  {
+    std::ofstream file(path, std::ios::binary);
+    for(const std::string& line : lines)
+    {
+      file << line << '\n';
+    }
+  }
+  TrigramIndex index;
+  index.build(table.snapshot(), path.string(), 2, false);
+  for(int wait = 0; wait < 10000 && !index.ready(); wait++)
+  {
+    index.take_built_index();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  std::filesystem::remove(path);
+  check(index.ready(), "trigram index is built");
+
+  const std::vector<std::pair<std::string, bool>> queries = {
+    {"needle_xyz", true},
+    {"needle_xyz", false},
+    {"Foo bar", true},
+    {"foo BAR", false},
+    {"caf\xc3\xa9 x", true},
+    {"ab", true},
+    {"absent query", false}};
+  bool indexed_matches_same = true;
+  for(const auto& [query, case_sensitive] : queries)
+  {
+    indexed_matches_same =
+      indexed_matches_same &&
+      same_indexed_matches(index, table, query, case_sensitive);
+  }
+  check(indexed_matches_same, "indexed search finds all matches");
+  check(candidate_row_count(index, table, "needle_xyz") < table.size(),
+        "rare query is narrowed to some chunks");
+
+  // edits in different chunks, re-indexed when next searched
+  table.set_line(30000, "a new needle_xyz");
+  index.replace_lines(30000, 1, 1);
+  const std::vector<std::string_view> inserted = {"NeEdLe_XyZ", "x"};
+  table.insert_lines(50000, inserted);
+  index.replace_lines(50000, 0, 2);
+  table.erase_lines(100, 200);
+  index.replace_lines(100, 100, 0);
+  indexed_matches_same = true;
+  for(const auto& [query, case_sensitive] : queries)
+  {
+    indexed_matches_same =
+      indexed_matches_same &&
+      same_indexed_matches(index, table, query, case_sensitive);
+  }
+  check(indexed_matches_same, "indexed search of edited lines finds all");
+  check(candidate_row_count(index, table, "needle_xyz") < table.size(),
+        "edited index still narrows rare query");
+}
+
+int main()
+{
+  ConfigManager::create_instance();
+  if(!ConfigManager::get_instance()->load_config())
+  {
+    std::printf("config isn't loaded\n");
+    return 1;
+  }
+
+  test_refined_matches_grow();
+  test_stale_ranges_are_skipped();
+  test_matches_follow_edits();
+  test_trigram_index_keeps_matches();
+
+  if(failures != 0)
+  {
+    std::printf("%d checks failed\n", failures);
+    return 1;
+  }
+  std::printf("all checks passed\n");
+  return 0;
+}
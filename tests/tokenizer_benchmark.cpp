@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include "../cpp-tokenizer/cpp_tokenizer.hpp"
+#include "reference_tokenizer.hpp"
+
+/// @brief Best time of tokenizing lines a few times, in seconds.
+/// @param tokenizer tokenizer to time.
+/// @param lines lines to tokenize, one by one.
+template<typename Tokenizer>
+static double best_time(Tokenizer& tokenizer,
+                        const std::vector<std::string>& lines) noexcept
+{
+  double best = 1e9;
+  for(int run = 0; run < 5; run++)
+  {
+    const auto start = std::chrono::steady_clock::now();
+    std::size_t tokens = 0;
+    for(const std::string& line : lines)
+    {
+      tokens += tokenizer.tokenize(line).size();
+      tokenizer.clear_tokens();
+    }
+    best = std::min(best,
+                    std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - start)
+                      .count());
+    if(tokens == 0)
+    {
+      std::printf("no tokens\n");
+    }
+  }
+  return best;
+}
+
+/// @brief Prints throughput of both tokenizers on lines.
+/// @param name name of lines.
+/// @param lines lines to tokenize.
+static void report(const char* name,
+                   const std::vector<std::string>& lines) noexcept
+{
+  std::size_t bytes = 0;
+  for(const std::string& line : lines)
+  {
+    bytes += line.size() + 1;
+  }
+  CppTokenizer::Tokenizer tokenizer;
+  ReferenceTokenizer::Tokenizer reference;
+  const double reference_time = best_time(reference, lines);
+  const double time = best_time(tokenizer, lines);
+  std::printf("%s (%zu lines): %.1f -> %.1f MB/s\n",
+              name,
+              lines.size(),
+              bytes / reference_time / 1e6,
+              bytes / time / 1e6);
+}
+
+/// Tokenizes a keyword dense file and the editor's sources with the
+/// tokenizer kept for the differential test, and with the current one.
+int main()
+{
+  // 200K lines, most words are keywords or directives
+  std::mt19937 random(7);
+  const std::vector<std::string> keywords = {
+    "const",  "static", "constexpr", "return", "if",    "else",
+    "while",  "for",    "unsigned",  "int",    "char",  "auto",
+    "struct", "class",  "template",  "typename", "noexcept", "void"};
+  const std::vector<std::string> directives = {
+    "#include", "#define", "#if", "#ifdef", "#endif", "#pragma"};
+  std::vector<std::string> keyword_lines;
+  for(int i = 0; i < 200000; i++)
+  {
+    std::string line =
+      i % 10 == 0 ? directives[random() % directives.size()] + " " : "  ";
+    for(int j = 0; j < 8; j++)
+    {
+      line += random() % 10 < 7 ? keywords[random() % keywords.size()]
+                                : "value_" + std::to_string(j);
+      line += j % 3 == 2 ? "; " : " ";
+    }
+    keyword_lines.push_back(std::move(line));
+  }
+  report("keyword dense", keyword_lines);
+
+  // sources repeated to 1M lines, run from root of repository
+  std::vector<std::string> source_lines;
+  for(const char* directory : {"src", "include", "cpp-tokenizer"})
+  {
+    std::error_code error;
+    for(const std::filesystem::directory_entry& entry :
+        std::filesystem::directory_iterator(directory, error))
+    {
+      std::ifstream file(entry.path());
+      std::string line;
+      while(std::getline(file, line))
+      {
+        source_lines.push_back(line);
+      }
+    }
+  }
+  if(source_lines.empty())
+  {
+    std::printf("sources aren't found, run from root of repository\n");
+    return 1;
+  }
+  const std::size_t source_count = source_lines.size();
+  while(source_lines.size() < 1000000)
+  {
+    source_lines.push_back(
+      source_lines[source_lines.size() % source_count]);
+  }
+  report("sources", source_lines);
+  return 0;
+}
@@ -0,0 +1,329 @@
+#include <algorithm>
+#include <cstdio>
+#include <optional>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../include/bracket_index.hpp"
+#include "../include/buffer.hpp"
+#include "../include/config_manager.hpp"
+#include "../include/cpp_tokenizer_cache.hpp"
+#include "../include/identifier_index.hpp"
+#include "../include/incremental_render_update.hpp"
+#include "../include/text_search.hpp"
+
+/// @brief Counts failed checks.
+static int failures = 0;
+
+/// @brief Reports failed check.
+/// @param passed result of check.
+/// @param what description of check.
+static void check(const bool& passed, const char* what) noexcept
+{
+  if(!passed)
+  {
+    std::printf("FAILED: %s\n", what);
+    failures++;
+  }
+}
+
+/// @brief Tells if cache has tokens and text of a cache built from
+///        scratch, for lines before last_row.
+static bool same_tokens(const CppTokenizerCache& cache,
+                        const CppTokenizerCache& fresh,
+                        uint32 last_row) noexcept
+{
+  last_row = std::min<uint32>(last_row, cache.tokens().size());
+  for(uint32 row = 0; row < last_row; row++)
+  {
+    const std::vector<CppTokenizer::Token>& tokens = cache.tokens()[row];
+    const std::vector<CppTokenizer::Token>& expected = fresh.tokens()[row];
+    if(tokens.size() != expected.size() ||
+       cache.text_for_line(row) != fresh.text_for_line(row))
+    {
+      return false;
+    }
+    for(std::size_t i = 0; i < tokens.size(); i++)
+    {
+      if(tokens[i] != expected[i])
+      {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/// @brief Tells if cache has identifiers of a cache built from scratch,
+///        comparing completions of each first letter.
+static bool same_identifiers(const CppTokenizerCache& cache,
+                             const CppTokenizerCache& fresh) noexcept
+{
+  if(cache.identifiers().size() != fresh.identifiers().size())
+  {
+    return false;
+  }
+  for(char letter = 'a'; letter <= 'z'; letter++)
+  {
+    const std::string prefix(1, letter);
+    std::vector<std::string> identifiers;
+    cache.identifiers().complete(
+      prefix, cache.identifiers().size(), identifiers);
+    std::vector<std::string> expected;
+    fresh.identifiers().complete(
+      prefix, fresh.identifiers().size(), expected);
+    if(identifiers != expected)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// @brief Tells if occurrences of identifiers found from postings of cache
+///        are the ones found in a cache built from scratch, and each
+///        spans the identifier in its line.
+static bool same_occurrences(const Buffer& buffer,
+                             CppTokenizerCache& cache,
+                             CppTokenizerCache& fresh) noexcept
+{
+  for(const std::string identifier : {"foo", "fo", "x", "a"})
+  {
+    std::vector<TextMatch> occurrences;
+    cache.find_identifier(identifier, 0, buffer.length(), occurrences);
+    std::vector<TextMatch> expected;
+    fresh.find_identifier(identifier, 0, buffer.length(), expected);
+    if(occurrences.size() != expected.size())
+    {
+      return false;
+    }
+    for(std::size_t i = 0; i < occurrences.size(); i++)
+    {
+      const TextMatch& occurrence = occurrences[i];
+      if(occurrence.row != expected[i].row ||
+         occurrence.column != expected[i].column ||
+         buffer.line(occurrence.row)
+             .value()
+             .substr(occurrence.column, occurrence.length) != identifier)
+      {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/// @brief Tells if nesting depth at start of each line, kept by bracket
+///        index of cache, is the depth of summing brackets of lines
+///        before it.
+static bool same_depths(const CppTokenizerCache& cache) noexcept
+{
+  int32 depth = 0;
+  for(uint32 row = 0; row < cache.tokens().size(); row++)
+  {
+    if(cache.brackets().depth_before(row) != depth)
+    {
+      return false;
+    }
+    for(const CppTokenizer::Token& token : cache.tokens()[row])
+    {
+      depth += bracket_depth_change(token);
+    }
+  }
+  return cache.brackets().depth_before(cache.tokens().size()) == depth;
+}
+
+/// @brief Pieces of lines, opening and closing comments and brackets.
+static const std::vector<std::string> pieces = {
+  "foo", "(", ")", "{", "}", "/*", "*/", "*", "/", " ", "    ", "x", "a",
+  "\"s\"", "//"};
+
+/// @brief Gives random lines made of pieces.
+static std::vector<std::string> random_lines(std::mt19937& random) noexcept
+{
+  std::vector<std::string> lines;
+  for(uint32 count = 1 + random() % 40; count > 0; count--)
+  {
+    std::string line;
+    for(uint32 length = random() % 10; length > 0; length--)
+    {
+      line += pieces[random() % pieces.size()];
+    }
+    lines.push_back(std::move(line));
+  }
+  return lines;
+}
+
+/// @brief Edits buffer at random, with typing, new lines, deleting, undo,
+///        redo and replacing all matches.
+static void random_edit(Buffer& buffer, std::mt19937& random) noexcept
+{
+  const uint32 row = random() % buffer.length();
+  buffer.set_cursor_row(row);
+  buffer.set_cursor_column(
+    std::min<int32>(random() % 8, buffer.line_length(row).value()) - 1);
+  const int edit = random() % 7;
+  if(edit == 0)
+  {
+    buffer.insert_string(pieces[random() % pieces.size()]);
+  }
+  else if(edit == 1)
+  {
+    buffer.process_enter();
+  }
+  else if(edit == 2)
+  {
+    buffer.process_backspace();
+  }
+  else if(edit == 3)
+  {
+    buffer.undo();
+  }
+  else if(edit == 4)
+  {
+    buffer.redo();
+  }
+  else if(edit == 5)
+  {
+    buffer.find("*", true, false);
+    buffer.replace_all(random() % 2 == 0 ? "/*" : "*/");
+  }
+  else
+  {
+    buffer.insert_string("\n  ");
+  }
+}
+
+/// @brief Token cache updated by random edits, tokenizing lines lazily
+///        till random rows, has the tokens of a cache built from scratch.
+static void test_lazy_cache_matches_fresh() noexcept
+{
+  for(unsigned seed = 0; seed < 300; seed++)
+  {
+    std::mt19937 random(seed);
+    Buffer buffer(random_lines(random));
+    CppTokenizerCache cache;
+    cache.build_cache(buffer);
+    cache.build_cache_till(buffer, random() % 50);
+    bool tokens_match = true;
+    for(int step = 0; step < 100; step++)
+    {
+      random_edit(buffer, random);
+      cache.update_cache(buffer);
+      while(buffer.get_next_incremental_render_update_command())
+      {}
+
+      // lines past shown ones are left stale
+      const uint32 shown_row = random() % 50;
+      cache.build_cache_till(buffer, shown_row);
+      CppTokenizerCache fresh;
+      fresh.build_cache(buffer);
+      fresh.build_cache_till(buffer, buffer.length());
+      tokens_match =
+        tokens_match && same_tokens(cache, fresh, shown_row + 1);
+    }
+    cache.build_cache_till(buffer, buffer.length());
+    CppTokenizerCache fresh;
+    fresh.build_cache(buffer);
+    fresh.build_cache_till(buffer, buffer.length());
+    check(tokens_match, "shown lines have tokens of fresh cache");
+    check(cache.tokens().size() == buffer.length() &&
+            same_tokens(cache, fresh, buffer.length()),
+          "all lines have tokens of fresh cache");
+    check(same_identifiers(cache, fresh),
+          "identifiers are counted as in fresh cache");
+    check(same_occurrences(buffer, cache, fresh),
+          "occurrences are found as in fresh cache");
+    check(same_depths(cache), "bracket depths are sums of brackets");
+  }
+}
+
+/// @brief Brackets are matched by depth, skipping comments and strings,
+///        and a bracket paired with one of another kind is unmatched.
+static void test_matching_brackets() noexcept
+{
+  struct Case
+  {
+    std::vector<std::string> lines;
+    std::pair<uint32, uint32> bracket;
+    std::optional<std::pair<uint32, uint32>> match;
+  };
+  const std::vector<Case> cases = {
+    {{"()"}, {0, 0}, std::make_pair(0, 1)},
+    {{"()"}, {0, 1}, std::make_pair(0, 0)},
+    {{"{ ( ) }"}, {0, 0}, std::make_pair(0, 6)},
+    {{"{ ( ) }"}, {0, 6}, std::make_pair(0, 0)},
+    {{"{ ( ) }"}, {0, 2}, std::make_pair(0, 4)},
+    {{"( \")\" )"}, {0, 0}, std::make_pair(0, 6)},
+    {{"( /* ) */ )"}, {0, 0}, std::make_pair(0, 10)},
+    {{"{", "x", "}"}, {0, 0}, std::make_pair(2, 0)},
+    {{"{", "x", "}"}, {2, 0}, std::make_pair(0, 0)},
+    {{"(]"}, {0, 0}, std::nullopt},
+    {{"(]"}, {0, 1}, std::nullopt},
+    {{"{", "(", "]"}, {0, 0}, std::nullopt},
+    {{"[", "x", ")"}, {2, 0}, std::nullopt},
+    {{"( x"}, {0, 0}, std::nullopt},
+    {{"x )"}, {0, 0}, std::nullopt}};
+  for(const Case& bracket_case : cases)
+  {
+    const Buffer buffer(bracket_case.lines);
+    CppTokenizerCache cache;
+    cache.build_cache(buffer);
+    cache.build_cache_till(buffer, bracket_case.bracket.first);
+    check(cache.matching_bracket(buffer,
+                                 bracket_case.bracket.first,
+                                 bracket_case.bracket.second,
+                                 buffer.length()) == bracket_case.match,
+          bracket_case.lines.front().c_str());
+  }
+}
+
+/// @brief Identifiers are completed while counted, in sorted order.
+static void test_identifier_completion() noexcept
+{
+  IdentifierIndex identifiers;
+  for(const char* identifier : {"foo", "food", "foobar", "bar", "foo"})
+  {
+    identifiers.add(identifier);
+  }
+  std::vector<std::string> completions;
+  identifiers.complete("foo", 10, completions);
+  check(completions == std::vector<std::string>{"foobar", "food"},
+        "longer identifiers with prefix are completed in order");
+  completions.clear();
+  identifiers.complete("foo", 1, completions);
+  check(completions == std::vector<std::string>{"foobar"},
+        "completions are limited to max count");
+
+  identifiers.remove("foo");
+  identifiers.remove("food");
+  completions.clear();
+  identifiers.complete("fo", 10, completions);
+  check(completions == std::vector<std::string>{"foo", "foobar"},
+        "identifier counted twice is kept after one removal");
+  identifiers.remove("foo");
+  check(identifiers.size() == 2, "identifier is dropped with its count");
+}
+
+int main()
+{
+  ConfigManager::create_instance();
+  if(!ConfigManager::get_instance()->load_config())
+  {
+    std::printf("config isn't loaded, run from root of repository\n");
+    return 1;
+  }
+
+  test_lazy_cache_matches_fresh();
+  test_identifier_completion();
+  test_matching_brackets();
+
+  if(failures > 0)
+  {
+    std::printf("%d checks failed\n", failures);
+    return 1;
+  }
+  std::printf("all checks passed\n");
+  return 0;
+}
@@ -0,0 +1,174 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include "../cpp-tokenizer/cpp_tokenizer.hpp"
+#include "reference_tokenizer.hpp"
+
+/// @brief Counts lines tokenized differently.
+static int mismatches = 0;
+
+/// @brief Tokenizes line with both tokenizers, reporting first mismatches.
+/// @param line text of line.
+/// @param in_comment tokenize line as continuing a multiline comment.
+static void compare(const std::string& line, const bool& in_comment) noexcept
+{
+  static CppTokenizer::Tokenizer tokenizer;
+  static ReferenceTokenizer::Tokenizer reference;
+  const std::vector<CppTokenizer::Token>& tokens =
+    in_comment ? tokenizer.tokenize_from_imcomplete_token(
+                   line,
+                   CppTokenizer::Token(
+                     CppTokenizer::TokenType::MULTILINE_COMMENT_INCOMPLETE))
+               : tokenizer.tokenize(line);
+  const std::vector<ReferenceTokenizer::Token>& expected =
+    in_comment
+      ? reference.tokenize_from_imcomplete_token(
+          line,
+          ReferenceTokenizer::Token(
+            ReferenceTokenizer::TokenType::MULTILINE_COMMENT_INCOMPLETE))
+      : reference.tokenize(line);
+
+  bool same = tokens.size() == expected.size();
+  for(std::size_t i = 0; same && i < tokens.size(); i++)
+  {
+    same = static_cast<int>(tokens[i].type) ==
+             static_cast<int>(expected[i].type) &&
+           tokens[i].start_offset == expected[i].start_offset &&
+           tokens[i].length == expected[i].length;
+  }
+  if(!same && mismatches++ < 10)
+  {
+    std::printf("MISMATCH (%s): %s\n  tokens:  ",
+                in_comment ? "in comment" : "normal",
+                line.c_str());
+    for(const CppTokenizer::Token& token : tokens)
+    {
+      std::printf(" %d@%u+%u",
+                  static_cast<int>(token.type),
+                  token.start_offset,
+                  token.length);
+    }
+    std::printf("\n  expected:");
+    for(const ReferenceTokenizer::Token& token : expected)
+    {
+      std::printf(" %d@%u+%u",
+                  static_cast<int>(token.type),
+                  token.start_offset,
+                  token.length);
+    }
+    std::printf("\n");
+  }
+  tokenizer.clear_tokens();
+  reference.clear_tokens();
+}
+
+/// @brief Lines at edges of the lexer states.
+static const std::vector<std::string> edge_cases = {
+  // comment continuation
+  "",
+  "*/",
+  "still comment */ int x;",
+  "*/*/",
+  "** / *//",
+  "/* nested /* */ */",
+  "a /* b */ c /* d",
+  "// line comment /* not multiline",
+  "x = a / b /* c */ / d;",
+  // character literals
+  "'a'",
+  "'/'",
+  "'*'",
+  "'\\''",
+  "'\\\\'",
+  "'\\n' + '\"'",
+  "''",
+  "'",
+  "'ab",
+  "c == '/' && d == '*'",
+  "u8'x' L'y'",
+  // strings
+  "\"a // b /* c\"",
+  "\"\\\"\" \"'\"",
+  "\"unterminated",
+  // directives
+  "#include <vector>",
+  "#include \"buffer.hpp\"",
+  "  #  include <a/b.h>",
+  "#include<x>",
+  "#define MAX(a, b) ((a) > (b) ? (a) : (b))",
+  "#if defined(__AVX2__)",
+  "#elifdef X",
+  "#pragma once",
+  "#",
+  "# 1 \"file\"",
+  "#notadirective",
+  "a # b ## c",
+  // numbers and operators
+  "1e-5f 0x1F 1'000'000 .5",
+  "a->b::c <<= d >>= e <=> f",
+  "\t\t  \t x",
+};
+
+int main()
+{
+  for(const std::string& line : edge_cases)
+  {
+    compare(line, false);
+    compare(line, true);
+  }
+
+  // sources of the editor itself
+  for(const char* directory : {"src", "include", "cpp-tokenizer", "tests"})
+  {
+    std::error_code error;
+    for(const std::filesystem::directory_entry& entry :
+        std::filesystem::directory_iterator(directory, error))
+    {
+      std::ifstream file(entry.path());
+      std::string line;
+      while(std::getline(file, line))
+      {
+        compare(line, false);
+        compare(line, true);
+      }
+    }
+  }
+
+  // fuzzed lines, mostly made of pieces starting lexer states
+  std::mt19937 random(42);
+  const std::string characters =
+    "abcdeifntx_019#<>\"'/*\\.,;:!?+-=&|%^~()[]{} \t@$";
+  const std::vector<std::string> pieces = {
+    "#include", "#if", "#elifdef", "#define", "int",  "constexpr",
+    "char",     "/*",  "*/",       "//",      "'",    "\"",
+    "<",        ">",   "::",       "->",      "1e-5f", "x(",
+    " ",        "\t",  "#",        "'a'",     "'+'",  "or_eq"};
+  for(int i = 0; i < 300000; i++)
+  {
+    std::string line;
+    const int length = random() % 24;
+    for(int j = 0; j < length; j++)
+    {
+      if(random() % 3 == 0)
+      {
+        line += pieces[random() % pieces.size()];
+      }
+      else
+      {
+        line += characters[random() % characters.size()];
+      }
+    }
+    compare(line, random() % 4 == 0);
+  }
+
+  if(mismatches > 0)
+  {
+    std::printf("%d lines tokenized differently\n", mismatches);
+    return 1;
+  }
+  std::printf("all lines tokenized the same\n");
+  return 0;
+}
@@ -0,0 +1,256 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include "../include/buffer.hpp"
+#include "../include/config_manager.hpp"
+#include "../include/incremental_render_update.hpp"
+#include "../include/undo_history.hpp"
+
+/// @brief Counts failed checks.
+static int failures = 0;
+
+/// @brief Reports failed check.
+/// @param passed result of check.
+/// @param what description of check.
+static void check(const bool& passed, const char* what) noexcept
+{
+  if(!passed)
+  {
+    std::printf("FAILED: %s\n", what);
+    failures++;
+  }
+}
+
+/// @brief Takes queued render and token cache updates.
+static void take_updates(Buffer& buffer) noexcept
+{
+  while(buffer.get_next_token_cache_update_command())
+  {}
+  while(buffer.get_next_incremental_render_update_command())
+  {}
+}
+
+/// @brief Copies lines of buffer.
+static std::vector<std::string> lines_of(const Buffer& buffer) noexcept
+{
+  std::vector<std::string> lines;
+  for(uint32 row = 0; row < buffer.length(); row++)
+  {
+    lines.emplace_back(buffer.line(row).value());
+  }
+  return lines;
+}
+
+/// @brief Gives random cursor position in buffer.
+static std::pair<uint32, int32> random_position(const Buffer& buffer,
+                                                std::mt19937& random) noexcept
+{
+  const uint32 row = random() % buffer.length();
+  const int32 column =
+    static_cast<int32>(random() % (buffer.line_length(row).value() + 1)) - 1;
+  return {row, column};
+}
+
+/// @brief Random typing, deleting, new lines and typing over selections,
+///        then undoing everything restores the original lines, and redoing
+///        everything restores the edited ones.
+static void test_undo_all_restores_text() noexcept
+{
+  const std::vector<std::string> words = {
+    "a", "b", " ", "(", "x", "{", ".", "foo", "[", "\"", "ab cd"};
+  for(unsigned seed = 0; seed < 300; seed++)
+  {
+    std::mt19937 random(seed);
+    Buffer buffer(
+      std::vector<std::string>{"int main() {", "  return 0;", "}"});
+    const std::vector<std::string> original = lines_of(buffer);
+    for(int step = 0; step < 200; step++)
+    {
+      const std::pair<uint32, int32> position =
+        random_position(buffer, random);
+      const int edit = random() % 10;
+      if(edit < 4)
+      {
+        buffer.insert_string(words[random() % words.size()]);
+      }
+      else if(edit < 6)
+      {
+        buffer.process_backspace();
+      }
+      else if(edit < 7)
+      {
+        buffer.process_enter();
+      }
+      else if(edit < 8)
+      {
+        buffer.set_cursor_row(position.first);
+        buffer.set_cursor_column(position.second);
+      }
+      else
+      {
+        const std::pair<uint32, int32> end = random_position(buffer, random);
+        buffer.set_selection_start_coordinate(position);
+        buffer.set_selection_end_coordinate(end);
+        buffer.set_cursor_row(end.first);
+        buffer.set_cursor_column(end.second);
+        if(random() % 2 == 0)
+        {
+          buffer.process_backspace();
+        }
+        else
+        {
+          buffer.insert_string("z");
+        }
+      }
+      take_updates(buffer);
+    }
+
+    const std::vector<std::string> edited = lines_of(buffer);
+    while(buffer.undo())
+    {
+      take_updates(buffer);
+    }
+    check(lines_of(buffer) == original, "undo all restores original lines");
+    while(buffer.redo())
+    {
+      take_updates(buffer);
+    }
+    check(lines_of(buffer) == edited, "redo all restores edited lines");
+  }
+}
+
+/// @brief Typing over 100K selected lines is undone in one step.
+static void test_large_edit_is_one_step() noexcept
+{
+  std::vector<std::string> lines;
+  for(int i = 0; i < 200000; i++)
+  {
+    lines.push_back("line number " + std::to_string(i));
+  }
+  Buffer buffer(lines);
+  buffer.set_selection_start_coordinate({10, -1});
+  buffer.set_selection_end_coordinate({100010, 3});
+  buffer.set_cursor_row(100010);
+  buffer.set_cursor_column(3);
+  buffer.insert_string("z");
+  take_updates(buffer);
+  check(buffer.length() == 100000, "selected lines are replaced");
+
+  check(buffer.undo(), "large edit is undone");
+  take_updates(buffer);
+  check(lines_of(buffer) == lines, "one undo restores all lines");
+  check(buffer.redo(), "large edit is redone");
+  take_updates(buffer);
+  check(buffer.length() == 100000, "one redo replaces lines again");
+}
+
+/// @brief Gives edit replacing line at row.
+static EditDelta line_edit(const uint32& row,
+                           const std::string& old_line,
+                           const std::string& new_line) noexcept
+{
+  EditDelta delta;
+  delta.row = row;
+  delta.old_lines = {Piece{old_line.data(), old_line.size()}};
+  delta.new_lines = {Piece{new_line.data(), new_line.size()}};
+  delta.cursor_before = {row, -1};
+  delta.cursor_after = {row, -1};
+  delta.kind = EditKind::OTHER;
+  return delta;
+}
+
+/// @brief Memory used by entries counts text of their lines.
+static void test_cost_counts_text() noexcept
+{
+  const std::string old_line(100000, 'a');
+  const std::string new_line(200000, 'b');
+  UndoHistory history;
+  history.record(line_edit(0, old_line, new_line));
+  check(history.memory_usage() >= old_line.size() + new_line.size(),
+        "cost of entry counts text of its lines");
+  history.clear();
+  check(history.memory_usage() == 0, "clearing history frees its memory");
+}
+
+/// @brief Entries beyond memory limit are dropped, or composed when they
+///        touch, so undoing them all still gives the oldest lines.
+static void test_memory_limit_trims() noexcept
+{
+  const std::filesystem::path path =
+    std::filesystem::temp_directory_path() / "undo_history_test.toml";
+  {
+    std::ofstream file(path);
+    file << "[undo]\n  memory_limit = 1\n";
+  }
+  check(ConfigManager::get_instance()->load_config(path.string()),
+        "config with 1 MB undo limit is loaded");
+
+  // 40 edits of 100 KB lines far apart can't all be kept
+  std::vector<std::string> texts;
+  texts.reserve(81);
+  texts.emplace_back("");
+  for(int i = 0; i < 80; i++)
+  {
+    texts.emplace_back(100000, static_cast<char>('a' + i % 26));
+  }
+  UndoHistory history;
+  for(uint32 i = 0; i < 40; i++)
+  {
+    history.record(line_edit(i * 10, texts[0], texts[i + 1]));
+  }
+  check(history.memory_usage() <= 1024 * 1024,
+        "history is trimmed to memory limit");
+  int undos = 0;
+  while(history.undo())
+  {
+    undos++;
+  }
+  check(undos > 0 && undos < 40, "oldest far apart edits are dropped");
+
+  // edits of the same line are composed, keeping the oldest line
+  history.clear();
+  for(uint32 i = 0; i < 40; i++)
+  {
+    history.record(line_edit(5, texts[i], texts[i + 1]));
+  }
+  check(history.memory_usage() <= 1024 * 1024,
+        "history of one line is trimmed to memory limit");
+  const EditDelta* oldest = nullptr;
+  while(const EditDelta* delta = history.undo())
+  {
+    oldest = delta;
+  }
+  check(oldest != nullptr && oldest->old_lines.size() == 1 &&
+          oldest->old_lines[0].data == texts[0].data(),
+        "composed edits undo to the oldest line");
+
+  std::filesystem::remove(path);
+  check(ConfigManager::get_instance()->load_config(),
+        "default config is loaded again");
+}
+
+int main()
+{
+  ConfigManager::create_instance();
+  if(!ConfigManager::get_instance()->load_config())
+  {
+    std::printf("config isn't loaded, run from root of repository\n");
+    return 1;
+  }
+
+  test_undo_all_restores_text();
+  test_large_edit_is_one_step();
+  test_cost_counts_text();
+  test_memory_limit_trims();
+
+  if(failures > 0)
+  {
+    std::printf("%d checks failed\n", failures);
+    return 1;
+  }
+  std::printf("all checks passed\n");
+  return 0;
+}
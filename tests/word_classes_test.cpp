@@ -0,0 +1,116 @@
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include "../include/word_classes.hpp"
+
+/// @brief Counts failed checks.
+static int failures = 0;
+
+/// @brief Reports failed check.
+/// @param passed result of check.
+/// @param what description of check.
+static void check(const bool& passed, const char* what) noexcept
+{
+  if(!passed)
+  {
+    std::printf("FAILED: %s\n", what);
+    failures++;
+  }
+}
+
+/// @brief Word boundaries found with SIMD run-skips are the ones found by
+///        looking up bytes one by one, for separator sets taking each path.
+static void test_word_boundaries() noexcept
+{
+  std::string all_non_ascii;
+  for(int byte = 0x80; byte < 0x100; byte++)
+  {
+    all_non_ascii.push_back(static_cast<char>(byte));
+  }
+  const std::vector<std::string> separator_sets = {
+    // default separators of config
+    " \n\r.!\t;:\\/+-*&%<>=(){}[]\"',|~^",
+    " \n\r.!\t;:\\/+-*&%<>=(){}[]\"',|~^" + all_non_ascii,
+    // no separators, and a single one
+    "",
+    " ",
+    // some non ASCII bytes, so non ASCII bytes aren't uniform
+    " \x80\x81",
+    // letters, more runs than fit SSE2 registers
+    "abcdefghijklmnopqrstuvwxyz0123456789",
+    "acegikmoqsuwy",
+    "acegikmoqsuwy" + all_non_ascii,
+    // control characters at edges of ASCII
+    "\x7f\x01 ?_"};
+
+  std::mt19937 random(7);
+  for(const std::string& separators : separator_sets)
+  {
+    const WordClasses classes = build_word_classes(separators);
+    bool ends_match = true;
+    bool starts_match = true;
+    for(int round = 0; round < 20000; round++)
+    {
+      // mostly letters, so word runs span SIMD blocks
+      std::string text;
+      for(uint32_t length = random() % 200; length > 0; length--)
+      {
+        text.push_back(random() % 10 < 7
+                         ? static_cast<char>('a' + random() % 26)
+                         : static_cast<char>(random() % 256));
+      }
+      const std::size_t position =
+        text.empty() ? 0 : random() % (text.size() + 1);
+
+      std::size_t end = position;
+      while(end < text.size() &&
+            !classes.separator[static_cast<unsigned char>(text[end])])
+      {
+        end++;
+      }
+      std::size_t start = position;
+      while(start > 0 &&
+            !classes.separator[static_cast<unsigned char>(text[start - 1])])
+      {
+        start--;
+      }
+      ends_match = ends_match && word_end(classes, text, position) == end;
+      starts_match =
+        starts_match && word_start(classes, text, position) == start;
+    }
+    check(ends_match, "word ends are found");
+    check(starts_match, "word starts are found");
+  }
+}
+
+/// @brief Table of separators has exactly the separator bytes.
+static void test_separator_table() noexcept
+{
+  const std::string separators = " .\x80(";
+  const WordClasses classes = build_word_classes(separators);
+  bool table_matches = true;
+  for(int byte = 0; byte < 256; byte++)
+  {
+    table_matches =
+      table_matches &&
+      classes.separator[byte] ==
+        (separators.find(static_cast<char>(byte)) != std::string::npos);
+  }
+  check(table_matches, "separator table has separator bytes");
+  check(!classes.uniform_non_ascii, "one non ASCII separator isn't uniform");
+}
+
+int main()
+{
+  test_word_boundaries();
+  test_separator_table();
+
+  if(failures > 0)
+  {
+    std::printf("%d checks failed\n", failures);
+    return 1;
+  }
+  std::printf("all checks passed\n");
+  return 0;
+}